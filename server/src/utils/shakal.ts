@@ -0,0 +1,135 @@
+import net from 'net';
+
+/**
+ * Client for shakald, the local image degradation daemon (see src/Daemon.h
+ * in the repository root). Each call opens one Unix socket connection and
+ * sends a single request.
+ *
+ * Library only for now: no route calls it, so uploads are stored as sent
+ * until a feature opts in.
+ */
+
+const SOCKET_PATH = process.env.SHAKAL_SOCKET || '/tmp/shakald.sock';
+const MAGIC = Buffer.from('SHK1', 'ascii');
+
+enum Op {
+  Process = 1,
+  Stats = 2,
+}
+
+enum Status {
+  Ok = 0,
+  Busy = 1,
+  BadRequest = 2,
+  Failed = 3,
+}
+
+/** Settings keys as in the editor's settings INI, e.g. { jpegQuality: 20 }. */
+export type ShakalSettings = Record<string, number | boolean | string>;
+
+export type ShakalFormat = 'png' | 'jpeg';
+
+export interface ShakalStats {
+  queued: number;
+  running: number;
+  workers: number;
+  queueLimit: number;
+  connections: number;
+  completed: number;
+  coalesced: number;
+  rejected: number;
+  failed: number;
+  sourceHits: number;
+  sourceMisses: number;
+  resultHits: number;
+  resultMisses: number;
+  p50Ms: number;
+  p99Ms: number;
+  mpixPerSec: number;
+}
+
+/** The daemon's queue stayed full; worth retrying later (HTTP 503). */
+export class ShakalBusyError extends Error {}
+
+/** The daemon rejected or failed the request, or could not be reached. */
+export class ShakalError extends Error {}
+
+/**
+ * One key=value per line. Line breaks or `=` in a key or value could slip
+ * further keys past the caller, so those are refused.
+ */
+function settingsText(settings: ShakalSettings): string {
+  return Object.entries(settings)
+    .map(([key, value]) => {
+      const text = String(typeof value === 'boolean' ? Number(value) : value);
+      if (/[\r\n=]/.test(key) || /[\r\n=]/.test(text)) {
+        throw new ShakalError(`Invalid character in setting ${JSON.stringify(key)}`);
+      }
+      return `${key}=${text}\n`;
+    })
+    .join('');
+}
+
+function request(op: Op, format: number, settings: string, data: Buffer): Promise<Buffer> {
+  const body = Buffer.from(settings, 'utf8');
+  const header = Buffer.alloc(16);
+  MAGIC.copy(header, 0);
+  header.writeUInt8(op, 4);
+  header.writeUInt8(format, 5);
+  header.writeUInt32LE(body.length, 8);
+  header.writeUInt32LE(data.length, 12);
+
+  return new Promise((resolve, reject) => {
+    const socket = net.createConnection(SOCKET_PATH);
+    const chunks: Buffer[] = [];
+    let received = 0;
+    let settled = false;
+
+    const finish = (err: Error | null, payload?: Buffer) => {
+      if (settled) return;
+      settled = true;
+      socket.destroy();
+      if (err) reject(err);
+      else resolve(payload as Buffer);
+    };
+
+    socket.on('connect', () => socket.write(Buffer.concat([header, body, data])));
+    socket.on('data', (chunk: Buffer) => {
+      chunks.push(chunk);
+      received += chunk.length;
+      if (received < 12) return;
+      const reply = Buffer.concat(chunks);
+      if (!reply.subarray(0, 4).equals(MAGIC)) {
+        finish(new ShakalError('Malformed reply from shakald'));
+        return;
+      }
+      const size = reply.readUInt32LE(8);
+      if (reply.length < 12 + size) return;
+      const status = reply.readUInt8(4) as Status;
+      const payload = reply.subarray(12, 12 + size);
+      if (status === Status.Ok) finish(null, payload);
+      else if (status === Status.Busy) finish(new ShakalBusyError(payload.toString('utf8')));
+      else finish(new ShakalError(payload.toString('utf8')));
+    });
+    socket.on('error', (err) => finish(new ShakalError(`shakald unavailable: ${err.message}`)));
+    socket.on('close', () => finish(new ShakalError('shakald closed the connection')));
+  });
+}
+
+/**
+ * Run an encoded image (PNG, JPEG, GIF first frame, ...) through the effect
+ * chain and return the result encoded as `format`.
+ */
+export async function degradeImage(
+  image: Buffer,
+  settings: ShakalSettings,
+  format: ShakalFormat = 'jpeg',
+): Promise<Buffer> {
+  return request(Op.Process, format === 'jpeg' ? 1 : 0, settingsText(settings), image);
+}
+
+/** Queue depth, latency percentiles and throughput of the daemon. */
+export async function shakalStats(): Promise<ShakalStats> {
+  const payload = await request(Op.Stats, 0, '', Buffer.alloc(0));
+  return JSON.parse(payload.toString('utf8')) as ShakalStats;
+}
@@ -0,0 +1,78 @@
+import path from 'path';
+import type { ShakalFormat, ShakalSettings } from './shakal';
+
+/**
+ * In-process alternative to the shakald client: loads shakal.node (built with
+ * -DSHAKAL_NODE_ADDON=ON, see src/NodeAddon.cpp in the repository root) and
+ * runs the effect chain on the libuv threadpool, so the event loop stays free.
+ * The returned Buffers wrap the native result without copying.
+ *
+ * Intentionally unused for now, like ./shakal: no route degrades uploads yet,
+ * and the addon is an opt-in build.
+ */
+
+const ADDON_PATH =
+  process.env.SHAKAL_ADDON || path.resolve(__dirname, '../../../build/shakal.node');
+
+export interface ShakalImage {
+  data: Buffer;
+  width: number;
+  height: number;
+}
+
+interface ShakalAddon {
+  process(
+    input: Buffer,
+    settings?: ShakalSettings,
+    options?: { width?: number; height?: number; format?: 'rgba' | ShakalFormat; signal?: AbortSignal },
+  ): Promise<ShakalImage>;
+}
+
+let addon: ShakalAddon | null | undefined;
+
+/** The addon, or null when it was not built; callers fall back to shakald. */
+export function shakalAddon(): ShakalAddon | null {
+  if (addon === undefined) {
+    try {
+      // eslint-disable-next-line @typescript-eslint/no-var-requires
+      addon = require(ADDON_PATH) as ShakalAddon;
+    } catch {
+      addon = null;
+    }
+  }
+  return addon;
+}
+
+function requireAddon(): ShakalAddon {
+  const loaded = shakalAddon();
+  if (!loaded) throw new Error(`shakal.node not found at ${ADDON_PATH}`);
+  return loaded;
+}
+
+/**
+ * Run an encoded image through the effect chain and return it encoded as
+ * `format`. Rejects with the signal's reason once `signal` aborts.
+ */
+export async function degradeImageInProcess(
+  image: Buffer,
+  settings: ShakalSettings,
+  format: ShakalFormat = 'jpeg',
+  signal?: AbortSignal,
+): Promise<Buffer> {
+  const result = await requireAddon().process(image, settings, { format, signal });
+  return result.data;
+}
+
+/**
+ * Raw RGBA in and out. `pixels` is read in place and must stay unchanged
+ * until the promise settles.
+ */
+export function degradePixels(
+  pixels: Buffer,
+  width: number,
+  height: number,
+  settings: ShakalSettings,
+  signal?: AbortSignal,
+): Promise<ShakalImage> {
+  return requireAddon().process(pixels, settings, { width, height, signal });
+}
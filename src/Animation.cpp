@@ -0,0 +1,247 @@
+#include "Animation.h"
+#include "GifCodec.h"
+#include "MappedFile.h"
+#include "ResultCache.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <deque>
+#include <future>
+#include <map>
+#include <vector>
+
+namespace {
+
+using Rgb = std::array<uint8_t, 3>;
+
+constexpr size_t PALETTE_SAMPLE_PIXELS = size_t(1) << 20;  // across all sampled frames
+constexpr int LUT_BITS = 5;                                 // per channel
+
+// Shared palette plus a coarse RGB -> index table; the last palette entry is
+// reserved for transparent pixels
+struct Quantizer {
+    std::array<Rgb, 256> palette{};
+    int colors = 0;                 // opaque entries
+    std::vector<uint8_t> lut;
+
+    int transparentIndex() const { return colors; }
+    int paletteSize() const { return colors + 1; }
+};
+
+ImageBuffer asRGBA(const ImageBuffer& img) {
+    ImageBuffer rgba = img;
+    if (rgba.channels != 4 || rgba.layout != PixelLayout::Interleaved || !rgba.alpha.empty())
+        ImageProcessor::toRGBA(rgba);
+    return rgba;
+}
+
+Quantizer buildQuantizer(const std::vector<const ImageBuffer*>& frames) {
+    size_t total = 0;
+    for (const ImageBuffer* f : frames) total += f->pixelCount();
+    const size_t stride = std::max<size_t>(1, total / PALETTE_SAMPLE_PIXELS);
+
+    std::vector<Rgb> samples;
+    samples.reserve(total / stride + frames.size());
+    for (const ImageBuffer* f : frames) {
+        const uint8_t* p = f->data.data();
+        for (size_t i = 0; i < f->pixelCount(); i += stride, p += stride * 4)
+            if (p[3] >= 128) samples.push_back({p[0], p[1], p[2]});
+    }
+
+    Quantizer q;
+    q.colors = ImageProcessor::medianCutPalette(samples.data(), samples.size(), 255, q.palette.data());
+    if (q.colors == 0) q.palette[q.colors++] = {0, 0, 0};  // fully transparent input
+
+    // Nearest entry for the center of every LUT cell
+    constexpr int CELLS = 1 << LUT_BITS;
+    constexpr int SHIFT = 8 - LUT_BITS;
+    q.lut.resize(static_cast<size_t>(CELLS) * CELLS * CELLS);
+    for (int r = 0; r < CELLS; ++r)
+        for (int g = 0; g < CELLS; ++g)
+            for (int b = 0; b < CELLS; ++b) {
+                const int cr = (r << SHIFT) | (1 << (SHIFT - 1));
+                const int cg = (g << SHIFT) | (1 << (SHIFT - 1));
+                const int cb = (b << SHIFT) | (1 << (SHIFT - 1));
+                int best = 0, bestDist = INT_MAX;
+                for (int i = 0; i < q.colors; ++i) {
+                    const int dr = cr - q.palette[i][0];
+                    const int dg = cg - q.palette[i][1];
+                    const int db = cb - q.palette[i][2];
+                    const int d = dr * dr + dg * dg + db * db;
+                    if (d < bestDist) { bestDist = d; best = i; }
+                }
+                q.lut[(r << (2 * LUT_BITS)) | (g << LUT_BITS) | b] = static_cast<uint8_t>(best);
+            }
+    return q;
+}
+
+// RGBA frame -> one encoded GIF frame
+std::vector<uint8_t> encodeFrame(const ImageBuffer& rgba, const Quantizer& q, int delayCs) {
+    constexpr int SHIFT = 8 - LUT_BITS;
+    std::vector<uint8_t> indices(rgba.pixelCount());
+    bool transparent = false;
+    const uint8_t* p = rgba.data.data();
+    for (size_t i = 0; i < indices.size(); ++i, p += 4) {
+        if (p[3] < 128) {
+            indices[i] = static_cast<uint8_t>(q.transparentIndex());
+            transparent = true;
+        } else {
+            indices[i] = q.lut[((p[0] >> SHIFT) << (2 * LUT_BITS)) |
+                               ((p[1] >> SHIFT) << LUT_BITS) | (p[2] >> SHIFT)];
+        }
+    }
+    return GifWriter::encodeFrame(indices.data(), rgba.width, rgba.height, q.paletteSize(),
+                                  delayCs, transparent ? q.transparentIndex() : -1);
+}
+
+bool writeChunk(FILE* f, const std::vector<uint8_t>& bytes) {
+    return std::fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+}
+
+bool finishFile(FILE* f, const std::string& path, bool ok) {
+    ok = ok && std::fputc(GifWriter::TRAILER, f) != EOF;
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok) std::remove(path.c_str());
+    return ok;
+}
+
+} // namespace
+
+namespace Animation {
+
+Settings frameSettings(const Settings& settings, int index) {
+    Settings s = settings;
+    if (s.animateSeeds) {
+        s.noiseSeed += index;
+        s.glitchSeed += index;
+        s.displacementSeed += index;
+    }
+    return s;
+}
+
+bool processGif(const std::string& srcPath, const std::string& dstPath, const Settings& settings,
+                const Options& options, std::atomic<float>* progress) {
+    auto file = MappedFile::open(srcPath);
+    if (!file) return false;
+    const int frameCount = GifReader::countFrames(file->data(), file->size());
+    if (frameCount <= 0) return false;
+    if (progress) progress->store(0.0f);
+
+    ThreadPool& pool = options.pool ? *options.pool : ThreadPool::shared();
+
+    auto processFrame = [&settings, &options](const ImageBuffer& frame, int index) {
+        std::atomic<bool> cancel{false};
+        const Settings s = frameSettings(settings, index);
+        return options.cache ? options.cache->process(frame, s, cancel)
+                             : ImageProcessor::processImage(frame, s, cancel);
+    };
+
+    // Pass 1: process evenly spaced frames (frame 0 always among them) and
+    // build the shared palette from them. The results are kept for pass 2.
+    const int sampleCount = std::clamp(options.paletteSampleFrames, 1, frameCount);
+    std::map<int, std::future<ImageBuffer>> sampleJobs;
+    GifReader reader;
+    if (!reader.open(file->data(), file->size())) return false;
+    {
+        ImageBuffer frame;
+        int delay = 0;
+        int next = 0;
+        for (int i = 0; next < sampleCount && reader.nextFrame(frame, delay); ++i) {
+            if (i != next * frameCount / sampleCount) continue;
+            sampleJobs[i] = pool.submit([&processFrame, frame, i] { return processFrame(frame, i); });
+            ++next;
+        }
+    }
+    std::map<int, ImageBuffer> samples;
+    bool ok = true;
+    for (auto& [index, job] : sampleJobs) {
+        try {
+            ImageBuffer img = asRGBA(job.get());
+            if (img.valid()) samples[index] = std::move(img);
+            else ok = false;
+        } catch (...) {
+            ok = false;
+        }
+    }
+    if (!ok || samples.find(0) == samples.end()) return false;
+
+    std::vector<const ImageBuffer*> sampleFrames;
+    for (auto& [index, img] : samples) sampleFrames.push_back(&img);
+    const Quantizer quantizer = buildQuantizer(sampleFrames);
+    const int outWidth = samples[0].width;
+    const int outHeight = samples[0].height;
+
+    // Pass 2: decode in order, process and encode a few frames ahead of the
+    // writer
+    FILE* out = std::fopen(dstPath.c_str(), "wb");
+    if (!out) return false;
+    // The first pass read every frame up to the last sample; the loop count
+    // sits before the first frame, so it is known by now
+    ok = writeChunk(out, GifWriter::header(outWidth, outHeight, quantizer.palette.data(),
+                                           quantizer.paletteSize(), reader.loopCount()));
+
+    if (!reader.open(file->data(), file->size())) ok = false;
+    const int maxInFlight = static_cast<int>(pool.size()) * 2;
+    std::deque<std::future<std::vector<uint8_t>>> inFlight;
+    ImageBuffer frame;
+    int delay = 0;
+    int submitted = 0;
+    bool decoding = true;
+    for (int written = 0; ok && written < frameCount; ++written) {
+        while (decoding && submitted < frameCount && static_cast<int>(inFlight.size()) < maxInFlight) {
+            if (!reader.nextFrame(frame, delay)) { decoding = false; break; }
+            const int index = submitted++;
+            auto sample = samples.find(index);
+            if (sample != samples.end()) {
+                ImageBuffer processed = std::move(sample->second);
+                samples.erase(sample);
+                inFlight.push_back(pool.submit([&quantizer, processed = std::move(processed), delay] {
+                    return encodeFrame(processed, quantizer, delay);
+                }));
+            } else {
+                inFlight.push_back(pool.submit([&, frame, index, delay] {
+                    ImageBuffer processed = asRGBA(processFrame(frame, index));
+                    if (processed.width != outWidth || processed.height != outHeight)
+                        return std::vector<uint8_t>{};
+                    return encodeFrame(processed, quantizer, delay);
+                }));
+            }
+        }
+        if (inFlight.empty()) break;  // fewer frames than counted: truncated file
+
+        std::vector<uint8_t> encoded;
+        try {
+            encoded = inFlight.front().get();
+        } catch (...) {
+            ok = false;
+        }
+        inFlight.pop_front();
+        ok = ok && !encoded.empty() && writeChunk(out, encoded);
+        if (progress) progress->store(static_cast<float>(written + 1) / frameCount);
+    }
+    // Workers reference the quantizer and settings: wait for stragglers
+    for (auto& f : inFlight) f.wait();
+
+    return finishFile(out, dstPath, ok);
+}
+
+bool writeGif(const std::string& path, const ImageBuffer& img, std::atomic<float>* progress) {
+    if (!img.valid() || img.width > 65535 || img.height > 65535) return false;
+    if (progress) progress->store(0.0f);
+
+    const ImageBuffer rgba = asRGBA(img);
+    const Quantizer quantizer = buildQuantizer({&rgba});
+
+    FILE* out = std::fopen(path.c_str(), "wb");
+    if (!out) return false;
+    bool ok = writeChunk(out, GifWriter::header(rgba.width, rgba.height, quantizer.palette.data(),
+                                                quantizer.paletteSize(), -1)) &&
+              writeChunk(out, encodeFrame(rgba, quantizer, 0));
+    ok = finishFile(out, path, ok);
+    if (progress) progress->store(1.0f);
+    return ok;
+}
+
+} // namespace Animation
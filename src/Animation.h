@@ -0,0 +1,43 @@
+#pragma once
+
+#include "ImageProcessor.h"
+
+#include <atomic>
+#include <string>
+
+class ResultCache;
+class ThreadPool;
+
+// ---------------------------------------------------------------------------
+// Animation - GIF export
+//
+// Every frame of an animated GIF goes through processImage and the results
+// are written as a new animated GIF. All frames share one global palette,
+// median-cut from a handful of evenly spaced processed frames, so colors do
+// not flicker between frames. Frames are decoded one at a time and processed
+// and LZW-encoded on a ThreadPool a few ahead of the writer, so memory stays
+// flat however long the animation is.
+// ---------------------------------------------------------------------------
+
+namespace Animation {
+
+struct Options {
+    int paletteSampleFrames = 8;  // processed frames the palette is built from
+    ThreadPool* pool = nullptr;   // nullptr = ThreadPool::shared()
+    ResultCache* cache = nullptr; // serves frames processed before
+};
+
+// `settings` as applied to frame `index`: with Settings::animateSeeds the
+// noise, glitch and displacement seeds advance by one per frame
+Settings frameSettings(const Settings& settings, int index);
+
+// Process the GIF at `srcPath` frame by frame (see frameSettings) and write
+// it to `dstPath`. `progress` goes from 0 to 1 as frames are written.
+bool processGif(const std::string& srcPath, const std::string& dstPath, const Settings& settings,
+                const Options& options = {}, std::atomic<float>* progress = nullptr);
+
+// Write a single image as a one-frame GIF (any layout; alpha below 128
+// becomes transparent)
+bool writeGif(const std::string& path, const ImageBuffer& img, std::atomic<float>* progress = nullptr);
+
+} // namespace Animation
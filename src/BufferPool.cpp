@@ -0,0 +1,583 @@
+#include "BufferPool.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <new>
+
+#ifdef _WIN32
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
+// ---------------------------------------------------------------------------
+// Per-thread state
+// ---------------------------------------------------------------------------
+
+static thread_local BufferPool* t_currentPool = nullptr;
+static thread_local uint64_t t_allocationCount = 0;
+
+// Scratch held by the thread, for Trace spans; compiled out without SHAKAL_TRACE
+#ifdef SHAKAL_TRACE
+static thread_local int64_t t_bytesInUse = 0;
+static thread_local int64_t t_peakBytes = 0;
+
+static void noteAcquired(size_t capacity) {
+    t_bytesInUse += static_cast<int64_t>(capacity);
+    t_peakBytes = std::max(t_peakBytes, t_bytesInUse);
+}
+
+static void noteReleased(size_t capacity) {
+    t_bytesInUse -= static_cast<int64_t>(capacity);
+}
+#else
+static void noteAcquired(size_t) {}
+static void noteReleased(size_t) {}
+#endif
+
+static constexpr size_t kMinClassSize = 256;
+static constexpr size_t kBlockAlign   = 64;
+static constexpr size_t kHugePageSize = size_t(2) << 20; // 2 MiB
+
+static size_t roundUp(size_t v, size_t align) {
+    return (v + align - 1) / align * align;
+}
+
+// ---------------------------------------------------------------------------
+// Size classes: 256 B, then four steps per power of two (<= 25% slack)
+// ---------------------------------------------------------------------------
+
+int BufferPool::classIndex(size_t bytes) {
+    if (bytes <= kMinClassSize) return 0;
+    int octave = 63 - std::countl_zero(static_cast<uint64_t>(bytes - 1));
+    size_t base = size_t(1) << octave;
+    size_t step = base >> 2;
+    int sub = static_cast<int>((bytes - base + step - 1) / step); // 1..4
+    return (octave - 8) * 4 + sub;
+}
+
+size_t BufferPool::classSize(int index) {
+    if (index == 0) return kMinClassSize;
+    int octave = (index - 1) / 4 + 8;
+    int sub = (index - 1) % 4 + 1;
+    size_t base = size_t(1) << octave;
+    return base + sub * (base >> 2);
+}
+
+// ---------------------------------------------------------------------------
+// OS allocation
+// ---------------------------------------------------------------------------
+
+uint8_t* BufferPool::osAllocate(size_t capacity) {
+    ++t_allocationCount;
+    if (capacity >= kHugePageSize) {
+        size_t len = roundUp(capacity, kHugePageSize);
+#ifdef _WIN32
+        void* p = VirtualAlloc(nullptr, len, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        return static_cast<uint8_t*>(p);
+#else
+        // Over-map so the block can start on a huge page boundary
+        size_t mapLen = len + kHugePageSize;
+        void* raw = mmap(nullptr, mapLen, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) return nullptr;
+        auto addr = reinterpret_cast<uintptr_t>(raw);
+        uintptr_t aligned = roundUp(addr, kHugePageSize);
+        size_t head = aligned - addr;
+        size_t tail = mapLen - head - len;
+        if (head) munmap(raw, head);
+        if (tail) munmap(reinterpret_cast<void*>(aligned + len), tail);
+#  ifdef MADV_HUGEPAGE
+        madvise(reinterpret_cast<void*>(aligned), len, MADV_HUGEPAGE);
+#  endif
+        return reinterpret_cast<uint8_t*>(aligned);
+#endif
+    }
+#ifdef _MSC_VER
+    return static_cast<uint8_t*>(_aligned_malloc(capacity, kBlockAlign));
+#else
+    return static_cast<uint8_t*>(std::aligned_alloc(kBlockAlign, capacity));
+#endif
+}
+
+void BufferPool::osFree(uint8_t* block, size_t capacity) {
+    if (!block) return;
+    if (capacity >= kHugePageSize) {
+#ifdef _WIN32
+        VirtualFree(block, 0, MEM_RELEASE);
+#else
+        munmap(block, roundUp(capacity, kHugePageSize));
+#endif
+        return;
+    }
+#ifdef _MSC_VER
+    _aligned_free(block);
+#else
+    std::free(block);
+#endif
+}
+
+// Scratch-file mapping for out-of-core blocks. The file is unlinked (or
+// delete-on-close) right away, so nothing is left behind after a crash and
+// freeing the block is a plain unmap.
+uint8_t* BufferPool::spillAllocate(size_t capacity, const std::string& directory) {
+    size_t len = roundUp(capacity, kHugePageSize);
+    std::error_code ec;
+    std::filesystem::path dir = directory.empty()
+        ? std::filesystem::temp_directory_path(ec) : std::filesystem::path(directory);
+    if (ec) return nullptr;
+#ifdef _WIN32
+    char name[MAX_PATH];
+    if (!GetTempFileNameA(dir.string().c_str(), "shk", 0, name)) return nullptr;
+    HANDLE file = CreateFileA(name, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return nullptr;
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE,
+                                        static_cast<DWORD>(uint64_t(len) >> 32),
+                                        static_cast<DWORD>(len & 0xFFFFFFFFu), nullptr);
+    void* p = mapping ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, len) : nullptr;
+    // The view keeps the section (and the file) alive
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
+    return static_cast<uint8_t*>(p);
+#else
+    std::string tmpl = (dir / "shakal-XXXXXX").string();
+    int fd = mkstemp(tmpl.data());
+    if (fd < 0) return nullptr;
+    unlink(tmpl.c_str());
+    void* p = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(len)) == 0)
+        p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return p == MAP_FAILED ? nullptr : static_cast<uint8_t*>(p);
+#endif
+}
+
+static void spillFree(uint8_t* block, size_t capacity) {
+#ifdef _WIN32
+    (void)capacity;
+    UnmapViewOfFile(block);
+#else
+    munmap(block, roundUp(capacity, kHugePageSize));
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Pool
+// ---------------------------------------------------------------------------
+
+BufferPool::BufferPool(size_t cacheLimit) : m_cacheLimit(cacheLimit) {}
+
+std::shared_ptr<BufferPool> BufferPool::create(size_t cacheLimit) {
+    return std::shared_ptr<BufferPool>(new BufferPool(cacheLimit));
+}
+
+BufferPool::~BufferPool() {
+    trim();
+}
+
+uint8_t* BufferPool::acquire(size_t bytes, size_t& capacity, bool* spilled) {
+    int idx = classIndex(std::max<size_t>(bytes, 1));
+    capacity = classSize(idx);
+    if (spilled) *spilled = false;
+
+    size_t spillThreshold;
+    std::string spillDir;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        spillThreshold = m_spillThreshold;
+        if (spillThreshold && bytes >= spillThreshold) spillDir = m_spillDir;
+    }
+    if (spillThreshold && bytes >= spillThreshold) {
+        ++t_allocationCount;
+        if (uint8_t* block = spillAllocate(capacity, spillDir)) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_spilled.push_back(block);
+            m_stats.osAllocations++;
+            m_stats.bytesInUse += capacity;
+            m_stats.peakInUse = std::max(m_stats.peakInUse, m_stats.bytesInUse);
+            if (spilled) *spilled = true;
+            noteAcquired(capacity);
+            return block;
+        }
+        // No scratch space: fall back to anonymous memory
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& list = m_free[idx];
+        if (!list.empty()) {
+            uint8_t* block = list.back();
+            list.pop_back();
+            m_stats.reuses++;
+            m_stats.bytesCached -= capacity;
+            m_stats.bytesInUse += capacity;
+            m_stats.peakInUse = std::max(m_stats.peakInUse, m_stats.bytesInUse);
+            noteAcquired(capacity);
+            return block;
+        }
+    }
+
+    uint8_t* block = osAllocate(capacity);
+    if (!block) throw std::bad_alloc();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.osAllocations++;
+    m_stats.bytesInUse += capacity;
+    m_stats.peakInUse = std::max(m_stats.peakInUse, m_stats.bytesInUse);
+    noteAcquired(capacity);
+    return block;
+}
+
+void BufferPool::release(uint8_t* block, size_t capacity) {
+    if (!block) return;
+    noteReleased(capacity);
+    int idx = classIndex(capacity);
+    bool spilled = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.bytesInUse -= capacity;
+        auto it = std::find(m_spilled.begin(), m_spilled.end(), block);
+        spilled = it != m_spilled.end();
+        if (spilled) {
+            m_spilled.erase(it);
+        } else if (m_stats.bytesCached + capacity <= m_cacheLimit) {
+            // Reserve free-list space up front so caching itself never allocates
+            auto& list = m_free[idx];
+            if (list.capacity() == list.size()) list.reserve(list.size() * 2 + 4);
+            list.push_back(block);
+            m_stats.bytesCached += capacity;
+            return;
+        }
+    }
+    if (spilled)
+        spillFree(block, capacity);
+    else
+        osFree(block, capacity);
+}
+
+void BufferPool::trim() {
+    std::array<std::vector<uint8_t*>, NUM_CLASSES> blocks;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        blocks.swap(m_free);
+        m_stats.bytesCached = 0;
+    }
+    for (int i = 0; i < NUM_CLASSES; ++i)
+        for (uint8_t* b : blocks[i]) osFree(b, classSize(i));
+}
+
+void BufferPool::setSpillThreshold(size_t bytes, const std::string& directory) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_spillThreshold = bytes;
+    m_spillDir = directory;
+}
+
+size_t BufferPool::spillThreshold() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_spillThreshold;
+}
+
+BufferPool::Stats BufferPool::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void BufferPool::resetPeak() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.peakInUse = m_stats.bytesInUse;
+}
+
+BufferPool& BufferPool::current() {
+    if (t_currentPool) return *t_currentPool;
+    // Intentionally leaked: buffers may outlive static destruction order
+    static auto* s_default = new std::shared_ptr<BufferPool>(BufferPool::create());
+    return **s_default;
+}
+
+BufferPool::Scope::Scope(BufferPool& pool) : m_prev(t_currentPool) {
+    t_currentPool = &pool;
+}
+
+BufferPool::Scope::~Scope() {
+    t_currentPool = m_prev;
+}
+
+uint64_t BufferPool::threadAllocationCount() {
+    return t_allocationCount;
+}
+
+#ifdef SHAKAL_TRACE
+int64_t BufferPool::threadBytesInUse() {
+    return t_bytesInUse;
+}
+
+int64_t BufferPool::threadPeakBytes() {
+    return t_peakBytes;
+}
+
+int64_t BufferPool::resetThreadPeak() {
+    int64_t old = t_peakBytes;
+    t_peakBytes = t_bytesInUse;
+    return old;
+}
+
+void BufferPool::raiseThreadPeak(int64_t bytes) {
+    t_peakBytes = std::max(t_peakBytes, bytes);
+}
+#else
+int64_t BufferPool::threadBytesInUse() { return 0; }
+int64_t BufferPool::threadPeakBytes() { return 0; }
+int64_t BufferPool::resetThreadPeak() { return 0; }
+void BufferPool::raiseThreadPeak(int64_t) {}
+#endif
+
+// ---------------------------------------------------------------------------
+// malloc-compatible shim: a 64-byte header keeps the owning pool alive
+// ---------------------------------------------------------------------------
+
+namespace {
+struct RawHeader {
+    std::shared_ptr<BufferPool> pool;
+    size_t capacity;
+    size_t size;
+};
+static_assert(sizeof(RawHeader) <= kBlockAlign);
+}
+
+void* BufferPool::rawAlloc(size_t size) {
+    BufferPool& pool = current();
+    size_t capacity = 0;
+    uint8_t* block = pool.acquire(size + kBlockAlign, capacity);
+    new (block) RawHeader{pool.shared_from_this(), capacity, size};
+    return block + kBlockAlign;
+}
+
+void* BufferPool::rawRealloc(void* p, size_t newSize) {
+    if (!p) return rawAlloc(newSize);
+    auto* hdr = reinterpret_cast<RawHeader*>(static_cast<uint8_t*>(p) - kBlockAlign);
+    if (newSize + kBlockAlign <= hdr->capacity) {
+        hdr->size = newSize;
+        return p;
+    }
+    void* q = rawAlloc(newSize);
+    std::memcpy(q, p, std::min(hdr->size, newSize));
+    rawFree(p);
+    return q;
+}
+
+void BufferPool::rawFree(void* p) {
+    if (!p) return;
+    auto* block = static_cast<uint8_t*>(p) - kBlockAlign;
+    auto* hdr = reinterpret_cast<RawHeader*>(block);
+    std::shared_ptr<BufferPool> pool = std::move(hdr->pool);
+    size_t capacity = hdr->capacity;
+    hdr->~RawHeader();
+    pool->release(block, capacity);
+}
+
+bool BufferPool::rawSpilled(const void* p) {
+    if (!p) return false;
+    auto* block = static_cast<const uint8_t*>(p) - kBlockAlign;
+    auto* hdr = reinterpret_cast<const RawHeader*>(block);
+    std::lock_guard<std::mutex> lock(hdr->pool->m_mutex);
+    const auto& spilled = hdr->pool->m_spilled;
+    return std::find(spilled.begin(), spilled.end(), block) != spilled.end();
+}
+
+// ---------------------------------------------------------------------------
+// ByteBuffer
+// ---------------------------------------------------------------------------
+
+ByteBuffer::ByteBuffer(size_t size) {
+    allocate(size);
+}
+
+ByteBuffer::ByteBuffer(size_t size, uint8_t value) {
+    allocate(size);
+    fill(value);
+}
+
+ByteBuffer::ByteBuffer(const ByteBuffer& other) {
+    allocate(other.m_size);
+    if (m_size) std::memcpy(m_data, other.m_data, m_size);
+}
+
+ByteBuffer::ByteBuffer(ByteBuffer&& other) noexcept
+    : m_data(other.m_data), m_size(other.m_size), m_capacity(other.m_capacity),
+      m_pool(std::move(other.m_pool)), m_spilled(other.m_spilled),
+      m_deleter(other.m_deleter), m_deleterContext(other.m_deleterContext) {
+    other.m_data = nullptr;
+    other.m_spilled = false;
+    other.m_size = other.m_capacity = 0;
+    other.m_deleter = nullptr;
+    other.m_deleterContext = nullptr;
+}
+
+ByteBuffer& ByteBuffer::operator=(const ByteBuffer& other) {
+    if (this == &other) return *this;
+    if (m_capacity >= other.m_size && !m_deleter) {
+        m_size = other.m_size;
+    } else {
+        reset();
+        allocate(other.m_size);
+    }
+    if (m_size) std::memcpy(m_data, other.m_data, m_size);
+    return *this;
+}
+
+ByteBuffer& ByteBuffer::operator=(ByteBuffer&& other) noexcept {
+    if (this == &other) return *this;
+    reset();
+    m_data = other.m_data;
+    m_size = other.m_size;
+    m_capacity = other.m_capacity;
+    m_pool = std::move(other.m_pool);
+    m_spilled = other.m_spilled;
+    m_deleter = other.m_deleter;
+    m_deleterContext = other.m_deleterContext;
+    other.m_data = nullptr;
+    other.m_spilled = false;
+    other.m_size = other.m_capacity = 0;
+    other.m_deleter = nullptr;
+    other.m_deleterContext = nullptr;
+    return *this;
+}
+
+ByteBuffer::~ByteBuffer() {
+    reset();
+}
+
+ByteBuffer ByteBuffer::adopt(uint8_t* data, size_t size, Deleter deleter, void* context) {
+    ByteBuffer buf;
+    buf.m_data = data;
+    buf.m_size = buf.m_capacity = size;
+    buf.m_deleter = deleter;
+    buf.m_deleterContext = context;
+    return buf;
+}
+
+static void rawDeleter(void*, uint8_t* data) {
+    BufferPool::rawFree(data);
+}
+
+ByteBuffer ByteBuffer::adoptRaw(void* data, size_t size) {
+    ByteBuffer buf = adopt(static_cast<uint8_t*>(data), size, rawDeleter);
+    buf.m_spilled = BufferPool::rawSpilled(data);
+    return buf;
+}
+
+void ByteBuffer::resize(size_t size) {
+    if (size <= m_capacity && !m_deleter) {
+        m_size = size;
+        return;
+    }
+    if (size <= m_size) {
+        m_size = size;
+        return;
+    }
+    ByteBuffer grown(size);
+    if (m_size) std::memcpy(grown.m_data, m_data, m_size);
+    *this = std::move(grown);
+}
+
+void ByteBuffer::assign(const uint8_t* first, const uint8_t* last) {
+    size_t n = static_cast<size_t>(last - first);
+    if (n > m_capacity || m_deleter) {
+        reset();
+        allocate(n);
+    }
+    m_size = n;
+    if (n) std::memcpy(m_data, first, n);
+}
+
+void ByteBuffer::fill(uint8_t value) {
+    if (m_size) std::memset(m_data, value, m_size);
+}
+
+void ByteBuffer::clear() {
+    reset();
+}
+
+void ByteBuffer::discard(size_t offset, size_t length) const {
+    if (!m_spilled || offset >= m_size) return;
+    length = std::min(length, m_size - offset);
+#ifdef _WIN32
+    // Mapped views are trimmed from the working set by the OS on demand
+    (void)length;
+#else
+    // Only whole pages inside the range may be dropped
+    static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    auto first = roundUp(reinterpret_cast<uintptr_t>(m_data + offset), pageSize);
+    auto last = reinterpret_cast<uintptr_t>(m_data + offset + length) / pageSize * pageSize;
+    if (last > first)
+        madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+#endif
+}
+
+void ByteBuffer::allocate(size_t size) {
+    m_size = size;
+    if (size == 0) return;
+    BufferPool& pool = BufferPool::current();
+    m_data = pool.acquire(size, m_capacity, &m_spilled);
+    m_pool = pool.shared_from_this();
+}
+
+void ByteBuffer::reset() {
+    if (m_data) {
+        if (m_deleter)
+            m_deleter(m_deleterContext, m_data);
+        else if (m_pool)
+            m_pool->release(m_data, m_capacity);
+    }
+    m_data = nullptr;
+    m_size = m_capacity = 0;
+    m_pool.reset();
+    m_spilled = false;
+    m_deleter = nullptr;
+    m_deleterContext = nullptr;
+}
+
+// ---------------------------------------------------------------------------
+// Debug allocation counter: replaces global new/delete to count every heap
+// allocation made by the calling thread.
+// ---------------------------------------------------------------------------
+
+#ifdef SHAKAL_DEBUG_ALLOCATIONS
+
+void* operator new(size_t size) {
+    ++t_allocationCount;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t align) {
+    ++t_allocationCount;
+    size_t a = static_cast<size_t>(align);
+#ifdef _MSC_VER
+    if (void* p = _aligned_malloc(size ? size : 1, a)) return p;
+#else
+    if (void* p = std::aligned_alloc(a, roundUp(size ? size : 1, a))) return p;
+#endif
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+#ifdef _MSC_VER
+void operator delete(void* p, std::align_val_t) noexcept { _aligned_free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { _aligned_free(p); }
+#else
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+#endif
+
+#endif // SHAKAL_DEBUG_ALLOCATIONS
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// BufferPool - size-classed cache of scratch blocks
+//
+// Every processing stage draws its full-frame temporaries from the pool that
+// is current on the calling thread (see BufferPool::Scope). Released blocks
+// are kept on per-class free lists, so after the first processImage call the
+// same sizes are served without touching the heap. Blocks of 2 MiB and more
+// are mapped directly from the OS and backed by huge pages where available.
+// Blocks above the spill threshold are backed by unlinked scratch files
+// instead, so out-of-core frames can be paged out to disk band by band.
+// ---------------------------------------------------------------------------
+
+class BufferPool : public std::enable_shared_from_this<BufferPool> {
+public:
+    struct Stats {
+        uint64_t osAllocations = 0; // blocks obtained from the OS (pool misses)
+        uint64_t reuses = 0;        // acquisitions served from a free list
+        size_t bytesInUse = 0;
+        size_t bytesCached = 0;
+        size_t peakInUse = 0;
+    };
+
+    static constexpr size_t DEFAULT_CACHE_LIMIT = size_t(1) << 30;     // 1 GiB
+    static constexpr size_t DEFAULT_SPILL_THRESHOLD = size_t(512) << 20; // 512 MiB
+
+    static std::shared_ptr<BufferPool> create(size_t cacheLimit = DEFAULT_CACHE_LIMIT);
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // Acquire a block of at least `bytes`; the real size is returned in `capacity`.
+    // Contents are unspecified. Blocks are 64-byte aligned. `spilled` is set
+    // when the block is backed by a scratch file.
+    uint8_t* acquire(size_t bytes, size_t& capacity, bool* spilled = nullptr);
+    void release(uint8_t* block, size_t capacity);
+
+    // Blocks of at least `bytes` are file-backed (0 disables spilling).
+    // Scratch files are created in `directory` (system temp dir if empty).
+    void setSpillThreshold(size_t bytes, const std::string& directory = {});
+    size_t spillThreshold() const;
+
+    // Return every cached block to the OS
+    void trim();
+
+    Stats stats() const;
+    void resetPeak();
+
+    // Pool used by the calling thread (a process-wide default if no Scope is active)
+    static BufferPool& current();
+
+    // Makes a pool current on this thread for the lifetime of the scope
+    class Scope {
+    public:
+        explicit Scope(BufferPool& pool);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        BufferPool* m_prev;
+    };
+
+    // Heap/OS allocations made by the calling thread so far. Counts pool misses
+    // always; with SHAKAL_DEBUG_ALLOCATIONS every operator new is counted too.
+    static uint64_t threadAllocationCount();
+
+    // Pool bytes acquired minus released by the calling thread, and the most
+    // that has reached since the last resetThreadPeak(). A block released on
+    // another thread than the one that acquired it skews both, so they are
+    // only meaningful as differences across a span of work (see Trace).
+    // Tracked in SHAKAL_TRACE builds only; always 0 otherwise.
+    static int64_t threadBytesInUse();
+    static int64_t threadPeakBytes();
+    static int64_t resetThreadPeak();          // peak = in use; returns the old peak
+    static void raiseThreadPeak(int64_t bytes);
+
+    // malloc-compatible entry points for third-party code (stb_image & co.)
+    static void* rawAlloc(size_t size);
+    static void* rawRealloc(void* p, size_t newSize);
+    static void rawFree(void* p);
+    static bool rawSpilled(const void* p); // block behind `p` is file-backed
+
+private:
+    explicit BufferPool(size_t cacheLimit);
+
+    static constexpr int NUM_CLASSES = 160;
+    static int classIndex(size_t bytes);
+    static size_t classSize(int index);
+
+    static uint8_t* osAllocate(size_t capacity);
+    static void osFree(uint8_t* block, size_t capacity);
+    static uint8_t* spillAllocate(size_t capacity, const std::string& directory);
+
+    mutable std::mutex m_mutex;
+    std::array<std::vector<uint8_t*>, NUM_CLASSES> m_free;
+    std::vector<uint8_t*> m_spilled; // live file-backed blocks (never cached)
+    size_t m_cacheLimit;
+    size_t m_spillThreshold = DEFAULT_SPILL_THRESHOLD;
+    std::string m_spillDir;
+    Stats m_stats;
+};
+
+// ---------------------------------------------------------------------------
+// ByteBuffer - owning byte array with value semantics
+//
+// Storage comes from BufferPool::current() and goes back to the same pool on
+// destruction. Foreign memory (e.g. a decoder's output) can be adopted
+// without copying by supplying a deleter.
+// ---------------------------------------------------------------------------
+
+class ByteBuffer {
+public:
+    using Deleter = void (*)(void* context, uint8_t* data);
+
+    ByteBuffer() = default;
+    explicit ByteBuffer(size_t size);          // contents unspecified
+    ByteBuffer(size_t size, uint8_t value);
+    ByteBuffer(const ByteBuffer& other);
+    ByteBuffer(ByteBuffer&& other) noexcept;
+    ByteBuffer& operator=(const ByteBuffer& other);
+    ByteBuffer& operator=(ByteBuffer&& other) noexcept;
+    ~ByteBuffer();
+
+    // Take ownership of `data`; `deleter(context, data)` is called on release
+    static ByteBuffer adopt(uint8_t* data, size_t size, Deleter deleter, void* context = nullptr);
+    // Take ownership of memory from BufferPool::rawAlloc (e.g. stb's output)
+    static ByteBuffer adoptRaw(void* data, size_t size);
+
+    uint8_t* data() { return m_data; }
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    uint8_t& operator[](size_t i) { return m_data[i]; }
+    const uint8_t& operator[](size_t i) const { return m_data[i]; }
+
+    uint8_t* begin() { return m_data; }
+    uint8_t* end() { return m_data + m_size; }
+    const uint8_t* begin() const { return m_data; }
+    const uint8_t* end() const { return m_data + m_size; }
+
+    // Resize keeping the existing prefix; new bytes are unspecified
+    void resize(size_t size);
+    void assign(const uint8_t* first, const uint8_t* last);
+    void fill(uint8_t value);
+    void clear();
+
+    // Hint that [offset, offset + length) will not be read again soon. For
+    // file-backed storage the pages are dropped from RAM (the contents stay
+    // in the scratch file); otherwise this is a no-op.
+    void discard(size_t offset, size_t length) const;
+    bool spilled() const { return m_spilled; }
+
+private:
+    void allocate(size_t size);
+    void reset();
+
+    uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_capacity = 0;
+    std::shared_ptr<BufferPool> m_pool;   // set when the storage belongs to a pool
+    bool m_spilled = false;
+    Deleter m_deleter = nullptr;          // set when the storage was adopted
+    void* m_deleterContext = nullptr;
+};
+
+// Typed scratch array on top of ByteBuffer (trivially copyable element types only)
+template <typename T>
+class ScratchArray {
+    static_assert(std::is_trivially_copyable_v<T>, "ScratchArray needs a trivially copyable type");
+public:
+    ScratchArray() = default;
+    explicit ScratchArray(size_t count) : m_buf(count * sizeof(T)), m_count(count) {}
+    ScratchArray(size_t count, const T& value) : ScratchArray(count) {
+        for (size_t i = 0; i < count; ++i) data()[i] = value;
+    }
+
+    T* data() { return reinterpret_cast<T*>(m_buf.data()); }
+    const T* data() const { return reinterpret_cast<const T*>(m_buf.data()); }
+    size_t size() const { return m_count; }
+
+    T& operator[](size_t i) { return data()[i]; }
+    const T& operator[](size_t i) const { return data()[i]; }
+
+    T* begin() { return data(); }
+    T* end() { return data() + m_count; }
+
+private:
+    ByteBuffer m_buf;
+    size_t m_count = 0;
+};
@@ -0,0 +1,541 @@
+#include "Daemon.h"
+#include "ImageLoader.h"
+#include "JpegWriter.h"
+#include "PngWriter.h"
+#include "SettingsFile.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char MAGIC[4] = {'S', 'H', 'K', '1'};
+constexpr size_t REQUEST_HEADER = 16;
+constexpr size_t REPLY_HEADER = 12;
+
+void put32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+uint32_t get32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// Close-on-exec set after the fact: SOCK_CLOEXEC, accept4 and pipe2 are
+// Linux-only, and the daemon builds on macOS too
+void setCloseOnExec(int fd) {
+    int flags = ::fcntl(fd, F_GETFD);
+    if (flags >= 0) ::fcntl(fd, F_SETFD, flags | FD_CLOEXEC);
+}
+
+// Socket setup shared by every descriptor the daemon and its clients open.
+// Where send() has no MSG_NOSIGNAL (macOS), the socket itself is told not to
+// raise SIGPIPE.
+int prepareSocket(int fd) {
+    if (fd < 0) return fd;
+    setCloseOnExec(fd);
+#if !defined(MSG_NOSIGNAL) && defined(SO_NOSIGPIPE)
+    int on = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    return fd;
+}
+
+int unixSocket() {
+    return prepareSocket(::socket(AF_UNIX, SOCK_STREAM, 0));
+}
+
+bool readFully(int fd, void* dst, size_t size) {
+    auto* p = static_cast<uint8_t*>(dst);
+    while (size > 0) {
+        ssize_t n = ::recv(fd, p, size, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool writeFully(int fd, const void* src, size_t size) {
+    auto* p = static_cast<const uint8_t*>(src);
+    while (size > 0) {
+        // A client that hung up is an error here, not SIGPIPE
+#ifdef MSG_NOSIGNAL
+        ssize_t n = ::send(fd, p, size, MSG_NOSIGNAL);
+#else
+        ssize_t n = ::send(fd, p, size, 0);     // SO_NOSIGPIPE, see prepareSocket
+#endif
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool sendReply(int fd, Daemon::Status status, const uint8_t* payload, size_t size) {
+    uint8_t header[REPLY_HEADER] = {};
+    std::memcpy(header, MAGIC, 4);
+    header[4] = static_cast<uint8_t>(status);
+    put32(header + 8, static_cast<uint32_t>(size));
+    return writeFully(fd, header, sizeof(header)) && writeFully(fd, payload, size);
+}
+
+std::shared_ptr<const std::vector<uint8_t>> textPayload(const std::string& text) {
+    return std::make_shared<const std::vector<uint8_t>>(text.begin(), text.end());
+}
+
+bool socketAddress(const std::string& path, sockaddr_un& addr) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) return false;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+} // namespace
+
+Daemon::Daemon(Options options)
+    : m_options(std::move(options)),
+      m_workers(std::make_unique<ThreadPool>(m_options.workers)),
+      m_results(m_options.resultCacheBytes) {
+    if (m_options.queueLimit <= 0) m_options.queueLimit = 4 * static_cast<int>(m_workers->size());
+}
+
+Daemon::~Daemon() {
+    // Running requests still use the caches and counters below
+    m_workers.reset();
+    if (m_listenFd >= 0) ::close(m_listenFd);
+    for (int fd : m_wakeFds)
+        if (fd >= 0) ::close(fd);
+}
+
+bool Daemon::listen() {
+    sockaddr_un addr;
+    if (!socketAddress(m_options.socketPath, addr)) {
+        std::fprintf(stderr, "Socket path \"%s\" is empty or too long\n", m_options.socketPath.c_str());
+        return false;
+    }
+
+    // A socket file nobody answers on is left over from a daemon that died
+    int probe = unixSocket();
+    if (probe >= 0) {
+        bool live = ::connect(probe, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+        ::close(probe);
+        if (live) {
+            std::fprintf(stderr, "Another daemon is listening on %s\n", addr.sun_path);
+            return false;
+        }
+    }
+    // Only ever remove a socket: the path comes from the command line or
+    // the environment, and may name anything
+    struct stat existing;
+    if (::lstat(addr.sun_path, &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+            std::fprintf(stderr, "%s exists and is not a socket\n", addr.sun_path);
+            return false;
+        }
+        ::unlink(addr.sun_path);
+    }
+
+    m_listenFd = unixSocket();
+    if (m_listenFd < 0 || ::bind(m_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(m_listenFd, 64) != 0 || ::pipe(m_wakeFds) != 0) {
+        std::fprintf(stderr, "Cannot listen on %s: %s\n", addr.sun_path, std::strerror(errno));
+        return false;
+    }
+    setCloseOnExec(m_wakeFds[0]);
+    setCloseOnExec(m_wakeFds[1]);
+    return true;
+}
+
+void Daemon::run() {
+    while (!m_stop.load()) {
+        pollfd fds[2] = {{m_listenFd, POLLIN, 0}, {m_wakeFds[0], POLLIN, 0}};
+        if (::poll(fds, 2, 1000) < 0 && errno != EINTR) break;
+        reapConnections(false);
+        if (fds[1].revents) break;
+        if (!(fds[0].revents & POLLIN)) continue;
+
+        int fd = prepareSocket(::accept(m_listenFd, nullptr, nullptr));
+        if (fd < 0) continue;
+        std::lock_guard<std::mutex> lock(m_connMutex);
+        if (static_cast<int>(m_connections.size()) >= m_options.maxConnections) {
+            const char message[] = "too many connections";
+            sendReply(fd, Status::Busy, reinterpret_cast<const uint8_t*>(message), sizeof(message) - 1);
+            ::close(fd);
+            continue;
+        }
+        auto done = std::make_shared<std::atomic<bool>>(false);
+        m_connections.push_back({fd, std::thread([this, fd, done] {
+            serveConnection(fd);
+            done->store(true);
+        }), done});
+    }
+
+    // Unblock connections waiting for their client and let them finish
+    {
+        std::lock_guard<std::mutex> lock(m_connMutex);
+        for (Connection& c : m_connections) ::shutdown(c.fd, SHUT_RDWR);
+    }
+    m_queueCv.notify_all();
+    reapConnections(true);
+    ::close(m_listenFd);
+    m_listenFd = -1;
+    ::unlink(m_options.socketPath.c_str());
+}
+
+void Daemon::stop() {
+    m_stop.store(true);
+    if (m_wakeFds[1] >= 0) {
+        const char byte = 0;
+        [[maybe_unused]] ssize_t n = ::write(m_wakeFds[1], &byte, 1);
+    }
+}
+
+void Daemon::reapConnections(bool all) {
+    std::list<Connection> finished;
+    {
+        std::lock_guard<std::mutex> lock(m_connMutex);
+        for (auto it = m_connections.begin(); it != m_connections.end();) {
+            auto next = std::next(it);
+            if (all || it->done->load()) finished.splice(finished.end(), m_connections, it);
+            it = next;
+        }
+    }
+    // The descriptor is closed only here, so run() never shuts down a reused one
+    for (Connection& c : finished) {
+        c.thread.join();
+        ::close(c.fd);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Requests
+// ---------------------------------------------------------------------------
+
+void Daemon::serveConnection(int fd) {
+    for (;;) {
+        uint8_t header[REQUEST_HEADER];
+        if (!readFully(fd, header, sizeof(header))) return;
+        const size_t settingsBytes = get32(header + 8);
+        const size_t dataBytes = get32(header + 12);
+
+        Reply reply;
+        if (std::memcmp(header, MAGIC, 4) != 0) {
+            reply = {Status::BadRequest, textPayload("not a shakald request")};
+        } else if (settingsBytes + dataBytes > m_options.maxRequestBytes) {
+            reply = {Status::BadRequest, textPayload("request too large")};
+        }
+        if (reply.payload) {
+            // The stream can't be resynchronized after a header like this
+            sendReply(fd, reply.status, reply.payload->data(), reply.payload->size());
+            return;
+        }
+
+        std::string settings(settingsBytes, '\0');
+        auto data = std::make_shared<std::vector<uint8_t>>(dataBytes);
+        if (!readFully(fd, settings.data(), settingsBytes) || !readFully(fd, data->data(), dataBytes))
+            return;
+
+        const auto op = static_cast<Op>(header[4]);
+        const uint8_t format = header[5];
+        if (op == Op::Stats)
+            reply = {Status::Ok, textPayload(statsJson(stats()))};
+        else if (op == Op::Process && format <= static_cast<uint8_t>(Format::Jpeg))
+            reply = handleProcess(static_cast<Format>(format), settings, std::move(data));
+        else
+            reply = {Status::BadRequest, textPayload("unknown op or format")};
+
+        const std::vector<uint8_t> none;
+        const std::vector<uint8_t>& payload = reply.payload ? *reply.payload : none;
+        if (!sendReply(fd, reply.status, payload.data(), payload.size())) return;
+    }
+}
+
+Daemon::Reply Daemon::handleProcess(Format format, const std::string& settingsText,
+                                    std::shared_ptr<const std::vector<uint8_t>> data) {
+    const auto start = std::chrono::steady_clock::now();
+    Settings settings;
+    SettingsFile::parse(settingsText, settings);
+
+    // A small file can still decode to gigabytes; the header says how many
+    int width = 0, height = 0;
+    if (!ImageLoader::probeMemory(data->data(), data->size(), width, height)) {
+        m_failed.fetch_add(1);
+        return {Status::BadRequest, textPayload("cannot decode image")};
+    }
+    if (static_cast<uint64_t>(width) * static_cast<uint64_t>(height) > m_options.maxPixels)
+        return {Status::BadRequest, textPayload("image too large")};
+
+    // Export options only matter for the format that is written
+    const int exportOptions[5] = {
+        static_cast<int>(format),
+        format == Format::Png ? settings.pngLevel : settings.jpegExportQuality,
+        format == Format::Png ? static_cast<int>(settings.pngFilter)
+                              : static_cast<int>(settings.jpegSubsampling),
+        format == Format::Png ? 0 : settings.jpegTargetKB,
+        format == Format::Png ? 0 : static_cast<int>(settings.jpegTargetResize),
+    };
+    const RequestKey key{
+        ResultCache::hashBytes(data->data(), data->size()),
+        ResultCache::hashBytes(exportOptions, sizeof(exportOptions), ResultCache::hashSettings(settings)),
+    };
+
+    auto join = [&]() -> std::shared_future<Reply> {
+        std::lock_guard<std::mutex> lock(m_inflightMutex);
+        auto it = m_inflight.find(key);
+        return it != m_inflight.end() ? it->second : std::shared_future<Reply>();
+    };
+    if (std::shared_future<Reply> running = join(); running.valid()) {
+        m_coalesced.fetch_add(1);
+        return running.get();
+    }
+
+    if (!admit()) {
+        m_rejected.fetch_add(1);
+        return {Status::Busy, textPayload("queue full")};
+    }
+
+    auto promise = std::make_shared<std::promise<Reply>>();
+    std::shared_future<Reply> result = promise->get_future().share();
+    std::shared_future<Reply> earlier;
+    {
+        std::lock_guard<std::mutex> lock(m_inflightMutex);
+        auto [it, inserted] = m_inflight.try_emplace(key, result);
+        if (!inserted) earlier = it->second;
+    }
+    if (earlier.valid()) {
+        // An identical request got in while this one waited for a slot
+        {
+            std::lock_guard<std::mutex> lock(m_queueMutex);
+            --m_queued;
+        }
+        m_queueCv.notify_one();
+        m_coalesced.fetch_add(1);
+        return earlier.get();
+    }
+
+    m_workers->submit([this, key, format, settings, data, promise, start] {
+        {
+            std::lock_guard<std::mutex> lock(m_queueMutex);
+            --m_queued;
+            ++m_running;
+        }
+        Reply reply;
+        try {
+            reply = runRequest(key, format, settings, *data, start);
+        } catch (const std::exception& e) {
+            m_failed.fetch_add(1);
+            reply = {Status::Failed, textPayload(e.what())};
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_inflightMutex);
+            m_inflight.erase(key);
+        }
+        promise->set_value(std::move(reply));
+        {
+            std::lock_guard<std::mutex> lock(m_queueMutex);
+            --m_running;
+        }
+        m_queueCv.notify_one();
+    });
+    return result.get();
+}
+
+bool Daemon::admit() {
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+    const int capacity = static_cast<int>(m_workers->size()) + m_options.queueLimit;
+    bool free = m_queueCv.wait_for(lock, std::chrono::milliseconds(m_options.admitTimeoutMs), [&] {
+        return m_stop.load() || m_queued + m_running < capacity;
+    });
+    if (!free || m_stop.load()) return false;
+    ++m_queued;
+    return true;
+}
+
+Daemon::Reply Daemon::runRequest(const RequestKey& key, Format format, const Settings& settings,
+                                 const std::vector<uint8_t>& data,
+                                 std::chrono::steady_clock::time_point start) {
+    std::shared_ptr<const ImageBuffer> source = decodeSource(key.source, data);
+    if (!source) {
+        m_failed.fetch_add(1);
+        return {Status::BadRequest, textPayload("cannot decode image")};
+    }
+
+    std::atomic<bool> cancel{false};
+    ImageBuffer result = m_results.process(*source, settings, cancel);
+
+    auto out = std::make_shared<std::vector<uint8_t>>();
+    auto sink = [&](const uint8_t* bytes, size_t size) {
+        out->insert(out->end(), bytes, bytes + size);
+        return true;
+    };
+    bool ok;
+    if (format == Format::Jpeg) {
+        JpegWriter::BudgetResult fitted;
+        ok = JpegWriter::encodeForSettings(result, settings, fitted);
+        *out = std::move(fitted.file);
+    } else {
+        PngWriter::Options options;
+        options.level = settings.pngLevel;
+        options.filter = settings.pngFilter;
+        ok = PngWriter::encode(result, options, sink);
+    }
+    if (!ok) {
+        m_failed.fetch_add(1);
+        return {Status::Failed, textPayload("cannot encode result")};
+    }
+
+    record(start, source->pixelCount());
+    return {Status::Ok, std::move(out)};
+}
+
+std::shared_ptr<const ImageBuffer> Daemon::decodeSource(uint64_t hash, const std::vector<uint8_t>& data) {
+    {
+        std::lock_guard<std::mutex> lock(m_sourceMutex);
+        for (auto it = m_sources.begin(); it != m_sources.end(); ++it) {
+            if (it->hash == hash) {
+                m_sources.splice(m_sources.begin(), m_sources, it);
+                m_sourceHits.fetch_add(1);
+                return it->image;
+            }
+        }
+    }
+    m_sourceMisses.fetch_add(1);
+
+    // Decode outside the lock; a concurrent miss on the same bytes decodes twice
+    auto image = std::make_shared<const ImageBuffer>(ImageLoader::decodeMemory(data.data(), data.size()));
+    if (!image->valid()) return nullptr;
+    const size_t bytes = image->data.size() + image->alpha.size();
+    if (bytes > m_options.sourceCacheBytes) return image;
+
+    std::lock_guard<std::mutex> lock(m_sourceMutex);
+    m_sources.push_front({hash, image});
+    m_sourceBytes += bytes;
+    while (m_sourceBytes > m_options.sourceCacheBytes) {
+        const ImageBuffer& last = *m_sources.back().image;
+        m_sourceBytes -= last.data.size() + last.alpha.size();
+        m_sources.pop_back();
+    }
+    return image;
+}
+
+// ---------------------------------------------------------------------------
+// Stats
+// ---------------------------------------------------------------------------
+
+void Daemon::record(std::chrono::steady_clock::time_point start, uint64_t pixels) {
+    m_completed.fetch_add(1);
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    m_samples.push_back({start, std::chrono::steady_clock::now(), pixels});
+    if (m_samples.size() > LATENCY_WINDOW) m_samples.pop_front();
+}
+
+Daemon::Stats Daemon::stats() const {
+    Stats s;
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        s.queued = m_queued;
+        s.running = m_running;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_connMutex);
+        s.connections = static_cast<int>(m_connections.size());
+    }
+    s.workers = m_workers->size();
+    s.queueLimit = m_options.queueLimit;
+    s.completed = m_completed.load();
+    s.coalesced = m_coalesced.load();
+    s.rejected = m_rejected.load();
+    s.failed = m_failed.load();
+    s.sourceHits = m_sourceHits.load();
+    s.sourceMisses = m_sourceMisses.load();
+    s.results = m_results.stats();
+
+    std::vector<double> latencies;
+    uint64_t pixels = 0;
+    std::chrono::steady_clock::time_point first, last;
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        if (m_samples.empty()) return s;
+        first = m_samples.front().start;
+        last = m_samples.front().end;
+        for (const Sample& sample : m_samples) {
+            latencies.push_back(std::chrono::duration<double, std::milli>(sample.end - sample.start).count());
+            pixels += sample.pixels;
+            first = std::min(first, sample.start);
+            last = std::max(last, sample.end);
+        }
+    }
+    auto percentile = [&](double p) {
+        size_t i = std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()));
+        std::nth_element(latencies.begin(), latencies.begin() + i, latencies.end());
+        return latencies[i];
+    };
+    s.p50Ms = percentile(0.50);
+    s.p99Ms = percentile(0.99);
+    const double seconds = std::chrono::duration<double>(last - first).count();
+    if (seconds > 0.0) s.mpixPerSec = pixels / 1e6 / seconds;
+    return s;
+}
+
+std::string Daemon::statsJson(const Stats& s) {
+    char buf[1024];
+    std::snprintf(buf, sizeof(buf),
+        "{\"queued\":%d,\"running\":%d,\"workers\":%u,\"queueLimit\":%d,\"connections\":%d,"
+        "\"completed\":%llu,\"coalesced\":%llu,\"rejected\":%llu,\"failed\":%llu,"
+        "\"sourceHits\":%llu,\"sourceMisses\":%llu,\"resultHits\":%llu,\"resultMisses\":%llu,"
+        "\"p50Ms\":%.3f,\"p99Ms\":%.3f,\"mpixPerSec\":%.3f}",
+        s.queued, s.running, s.workers, s.queueLimit, s.connections,
+        static_cast<unsigned long long>(s.completed), static_cast<unsigned long long>(s.coalesced),
+        static_cast<unsigned long long>(s.rejected), static_cast<unsigned long long>(s.failed),
+        static_cast<unsigned long long>(s.sourceHits), static_cast<unsigned long long>(s.sourceMisses),
+        static_cast<unsigned long long>(s.results.hits), static_cast<unsigned long long>(s.results.misses),
+        s.p50Ms, s.p99Ms, s.mpixPerSec);
+    return buf;
+}
+
+// ---------------------------------------------------------------------------
+// Client
+// ---------------------------------------------------------------------------
+
+bool Daemon::call(const std::string& socketPath, Op op, Format format,
+                  const std::string& settings, const std::vector<uint8_t>& data,
+                  Status& status, std::vector<uint8_t>& payload) {
+    sockaddr_un addr;
+    if (!socketAddress(socketPath, addr)) return false;
+    int fd = unixSocket();
+    if (fd < 0) return false;
+
+    uint8_t header[REQUEST_HEADER] = {};
+    std::memcpy(header, MAGIC, 4);
+    header[4] = static_cast<uint8_t>(op);
+    header[5] = static_cast<uint8_t>(format);
+    put32(header + 8, static_cast<uint32_t>(settings.size()));
+    put32(header + 12, static_cast<uint32_t>(data.size()));
+
+    uint8_t reply[REPLY_HEADER];
+    bool ok = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+              writeFully(fd, header, sizeof(header)) &&
+              writeFully(fd, settings.data(), settings.size()) &&
+              writeFully(fd, data.data(), data.size()) &&
+              readFully(fd, reply, sizeof(reply)) && std::memcmp(reply, MAGIC, 4) == 0;
+    if (ok) {
+        status = static_cast<Status>(reply[4]);
+        payload.resize(get32(reply + 8));
+        ok = readFully(fd, payload.data(), payload.size());
+    }
+    ::close(fd);
+    return ok;
+}
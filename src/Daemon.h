@@ -0,0 +1,186 @@
+#pragma once
+
+#include "ImageProcessor.h"
+#include "ResultCache.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Daemon - the effect chain as a local service on a Unix domain socket
+//
+// Lets other processes on the machine (the messenger server) degrade images
+// without the editor. Each connection sends requests one at a time and reads
+// the reply before the next. All integers are little-endian:
+//
+//   request  "SHK1" u8 op  u8 format  u16 0  u32 settingsBytes  u32 dataBytes
+//            settings (SettingsFile text)  data (encoded image)
+//   reply    "SHK1" u8 status  u8[3] 0  u32 payloadBytes  payload
+//
+// Op::Process returns the image encoded as `format`; Op::Stats ignores the
+// body and returns the counters below as a JSON object.
+//
+// Requests run on a fixed set of workers behind a bounded queue: once it is
+// full a request waits for a slot (the daemon stops reading its connection
+// meanwhile) and is answered Status::Busy if none frees up in time. A request
+// identical to one already queued or running waits for that one's reply
+// instead of running again. Decoded sources are kept in a small LRU, so
+// further settings on the same upload skip the decode, and processed images
+// go through a ResultCache.
+// ---------------------------------------------------------------------------
+
+class Daemon {
+public:
+    enum class Op : uint8_t { Process = 1, Stats = 2 };
+    enum class Format : uint8_t { Png = 0, Jpeg = 1 };
+    enum class Status : uint8_t { Ok = 0, Busy = 1, BadRequest = 2, Failed = 3 };
+
+    struct Options {
+        std::string socketPath;
+        unsigned workers = 0;                              // 0 = one per hardware thread
+        int queueLimit = 0;                                // waiting requests; 0 = 4 per worker
+        int admitTimeoutMs = 5000;                         // wait for a queue slot before Busy
+        int maxConnections = 64;
+        size_t maxRequestBytes = size_t(64) << 20;
+        uint64_t maxPixels = uint64_t(64) << 20;           // decoded source; 64 Mpx = 256 MiB RGBA
+        size_t sourceCacheBytes = size_t(256) << 20;       // decoded sources
+        size_t resultCacheBytes = size_t(256) << 20;       // processed images (PNG in memory)
+    };
+
+    struct Stats {
+        int queued = 0;                 // admitted, not started
+        int running = 0;
+        unsigned workers = 0;
+        int queueLimit = 0;
+        int connections = 0;
+        uint64_t completed = 0;
+        uint64_t coalesced = 0;         // served by an identical request in flight
+        uint64_t rejected = 0;          // answered Busy
+        uint64_t failed = 0;            // undecodable input or encode failure
+        uint64_t sourceHits = 0;
+        uint64_t sourceMisses = 0;
+        ResultCache::Stats results;
+        double p50Ms = 0.0;             // over the last LATENCY_WINDOW requests,
+        double p99Ms = 0.0;             // queue wait included
+        double mpixPerSec = 0.0;        // source pixels over the same window's span
+    };
+
+    static constexpr size_t LATENCY_WINDOW = 1024;
+
+    explicit Daemon(Options options);
+    ~Daemon();
+
+    Daemon(const Daemon&) = delete;
+    Daemon& operator=(const Daemon&) = delete;
+
+    // Bind and listen, replacing a stale socket file. Anything at the path
+    // that isn't a socket is left alone. False with a message on stderr on
+    // failure.
+    bool listen();
+
+    // Serve connections until stop()
+    void run();
+
+    // Make run() return; callable from a signal handler
+    void stop();
+
+    Stats stats() const;
+    static std::string statsJson(const Stats& stats);
+
+    // Client side: one request over a fresh connection to `socketPath`.
+    // False if the daemon could not be reached or hung up mid-reply.
+    static bool call(const std::string& socketPath, Op op, Format format,
+                     const std::string& settings, const std::vector<uint8_t>& data,
+                     Status& status, std::vector<uint8_t>& payload);
+
+private:
+    struct Reply {
+        Status status = Status::Failed;
+        std::shared_ptr<const std::vector<uint8_t>> payload;
+    };
+    // Encoded source bytes, and the settings with the output format and its
+    // export options folded in
+    struct RequestKey {
+        uint64_t source = 0;
+        uint64_t output = 0;
+        bool operator==(const RequestKey& o) const {
+            return source == o.source && output == o.output;
+        }
+    };
+    struct RequestKeyHash {
+        size_t operator()(const RequestKey& k) const {
+            return static_cast<size_t>(k.source ^ (k.output * 0x9E3779B97F4A7C15ull));
+        }
+    };
+    struct Source {
+        uint64_t hash = 0;
+        std::shared_ptr<const ImageBuffer> image;
+    };
+    struct Sample {
+        std::chrono::steady_clock::time_point start, end;
+        uint64_t pixels;
+    };
+
+    void serveConnection(int fd);
+    Reply handleProcess(Format format, const std::string& settingsText,
+                        std::shared_ptr<const std::vector<uint8_t>> data);
+    Reply runRequest(const RequestKey& key, Format format, const Settings& settings,
+                     const std::vector<uint8_t>& data, std::chrono::steady_clock::time_point start);
+    std::shared_ptr<const ImageBuffer> decodeSource(uint64_t hash, const std::vector<uint8_t>& data);
+    bool admit();
+    void record(std::chrono::steady_clock::time_point start, uint64_t pixels);
+    void reapConnections(bool all);
+
+    Options m_options;
+    int m_listenFd = -1;
+    int m_wakeFds[2] = {-1, -1};
+    std::atomic<bool> m_stop{false};
+
+    std::unique_ptr<ThreadPool> m_workers;
+    ResultCache m_results;
+
+    // Admission: requests handed to m_workers and not yet started
+    mutable std::mutex m_queueMutex;
+    std::condition_variable m_queueCv;
+    int m_queued = 0;
+    int m_running = 0;
+
+    // Requests queued or running, by what they would produce
+    std::mutex m_inflightMutex;
+    std::unordered_map<RequestKey, std::shared_future<Reply>, RequestKeyHash> m_inflight;
+
+    // Decoded sources, most recent first
+    mutable std::mutex m_sourceMutex;
+    std::list<Source> m_sources;
+    size_t m_sourceBytes = 0;
+
+    struct Connection {
+        int fd;
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> done;
+    };
+    mutable std::mutex m_connMutex;
+    std::list<Connection> m_connections;
+
+    mutable std::mutex m_statsMutex;
+    std::deque<Sample> m_samples;
+    std::atomic<uint64_t> m_completed{0};
+    std::atomic<uint64_t> m_coalesced{0};
+    std::atomic<uint64_t> m_rejected{0};
+    std::atomic<uint64_t> m_failed{0};
+    std::atomic<uint64_t> m_sourceHits{0};
+    std::atomic<uint64_t> m_sourceMisses{0};
+};
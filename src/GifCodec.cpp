@@ -0,0 +1,412 @@
+#include "GifCodec.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr int MAX_CODE_BITS = 12;
+constexpr int MAX_CODES = 1 << MAX_CODE_BITS;
+
+inline int readLE16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+inline void putLE16(std::vector<uint8_t>& out, int v) {
+    out.push_back(static_cast<uint8_t>(v));
+    out.push_back(static_cast<uint8_t>(v >> 8));
+}
+
+// Bits per index for a palette of `size` entries (GIF tables hold 2^bits)
+int paletteBits(int size) {
+    int bits = 1;
+    while ((1 << bits) < size) ++bits;
+    return bits;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Reader
+// ---------------------------------------------------------------------------
+
+bool GifReader::open(const uint8_t* data, size_t size) {
+    if (!data || size < 13 || std::memcmp(data, "GIF8", 4) != 0) return false;
+    m_data = data;
+    m_size = size;
+    m_width = readLE16(data + 6);
+    m_height = readLE16(data + 8);
+    if (m_width <= 0 || m_height <= 0) return false;
+
+    const uint8_t packed = data[10];
+    m_pos = 13;
+    m_globalPaletteSize = 0;
+    if (packed & 0x80) {
+        m_globalPaletteSize = 2 << (packed & 7);
+        if (m_pos + 3 * static_cast<size_t>(m_globalPaletteSize) > size) return false;
+        for (int i = 0; i < m_globalPaletteSize; ++i, m_pos += 3)
+            m_globalPalette[i] = {data[m_pos], data[m_pos + 1], data[m_pos + 2]};
+    }
+
+    // Start from a transparent canvas, as browsers do
+    m_canvas = ByteBuffer(static_cast<size_t>(m_width) * m_height * 4, 0);
+    m_restore.clear();
+    m_dispose = 0;
+    m_loopCount = 0;
+    return true;
+}
+
+bool GifReader::skipSubBlocks() {
+    while (m_pos < m_size) {
+        uint8_t len = m_data[m_pos++];
+        if (len == 0) return true;
+        m_pos += len;
+    }
+    return false;
+}
+
+// LZW-decode the image data sub-blocks at m_pos into `indices`; pixels past
+// the end of truncated data keep their previous value
+bool GifReader::decodeLzw(int minCodeSize, size_t pixelCount, std::vector<uint8_t>& indices) {
+    if (minCodeSize < 1 || minCodeSize >= MAX_CODE_BITS) return false;
+
+    uint16_t prefix[MAX_CODES];
+    uint8_t suffix[MAX_CODES];
+    uint8_t stack[MAX_CODES + 1];
+    const int clear = 1 << minCodeSize;
+    const int eoi = clear + 1;
+    for (int i = 0; i < clear; ++i) suffix[i] = static_cast<uint8_t>(i);
+
+    int codeSize = minCodeSize + 1;
+    int next = eoi + 1;
+    int old = -1;
+    uint8_t first = 0;
+    size_t out = 0;
+
+    uint32_t bits = 0;
+    int bitCount = 0;
+    size_t blockLeft = 0;
+    bool dataEnded = false;
+    auto readCode = [&](int& code) {
+        while (bitCount < codeSize) {
+            if (blockLeft == 0) {
+                if (m_pos >= m_size) return false;
+                blockLeft = m_data[m_pos++];
+                if (blockLeft == 0) { dataEnded = true; return false; }
+            }
+            if (m_pos >= m_size) return false;
+            bits |= static_cast<uint32_t>(m_data[m_pos++]) << bitCount;
+            bitCount += 8;
+            --blockLeft;
+        }
+        code = static_cast<int>(bits & ((1u << codeSize) - 1));
+        bits >>= codeSize;
+        bitCount -= codeSize;
+        return true;
+    };
+
+    int code;
+    while (out < pixelCount && readCode(code)) {
+        if (code == clear) {
+            codeSize = minCodeSize + 1;
+            next = eoi + 1;
+            old = -1;
+            continue;
+        }
+        if (code == eoi) break;
+        if (old < 0) {
+            if (code >= clear) break;
+            indices[out++] = static_cast<uint8_t>(code);
+            old = first = static_cast<uint8_t>(code);
+            continue;
+        }
+
+        const int in = code;
+        size_t sp = 0;
+        if (code >= next) {
+            if (code > next) break;  // corrupt
+            stack[sp++] = first;
+            code = old;
+        }
+        while (code > eoi) {
+            stack[sp++] = suffix[code];
+            code = prefix[code];
+        }
+        first = static_cast<uint8_t>(code);
+        stack[sp++] = first;
+        while (sp > 0 && out < pixelCount) indices[out++] = stack[--sp];
+
+        if (next < MAX_CODES) {
+            prefix[next] = static_cast<uint16_t>(old);
+            suffix[next] = first;
+            ++next;
+            if (next == (1 << codeSize) && codeSize < MAX_CODE_BITS) ++codeSize;
+        }
+        old = in;
+    }
+
+    if (!dataEnded) {
+        m_pos = std::min(m_size, m_pos + blockLeft);
+        skipSubBlocks();
+    }
+    return true;
+}
+
+bool GifReader::nextFrame(ImageBuffer& frame, int& delayCs) {
+    if (!m_data) return false;
+    const size_t canvasRow = static_cast<size_t>(m_width) * 4;
+
+    // Undo what the previous frame asked for
+    if (m_dispose == 2) {
+        for (int y = m_lastY; y < m_lastY + m_lastH; ++y)
+            std::memset(m_canvas.data() + y * canvasRow + static_cast<size_t>(m_lastX) * 4, 0,
+                        static_cast<size_t>(m_lastW) * 4);
+    } else if (m_dispose == 3 && !m_restore.empty()) {
+        m_canvas = m_restore;
+    }
+    m_dispose = 0;
+
+    int transparent = -1;
+    int disposal = 0;
+    delayCs = 0;
+
+    while (m_pos < m_size) {
+        const uint8_t block = m_data[m_pos++];
+        if (block == 0x3B) return false;  // trailer
+
+        if (block == 0x21) {
+            if (m_pos >= m_size) return false;
+            const uint8_t label = m_data[m_pos++];
+            if (label == 0xF9 && m_pos + 5 <= m_size && m_data[m_pos] == 4) {
+                // Graphic control: disposal, transparency, delay
+                const uint8_t packed = m_data[m_pos + 1];
+                disposal = (packed >> 2) & 7;
+                delayCs = readLE16(m_data + m_pos + 2);
+                transparent = (packed & 1) ? m_data[m_pos + 4] : -1;
+                m_pos += 5;
+            } else if (label == 0xFF && m_pos + 12 <= m_size && m_data[m_pos] == 11 &&
+                       std::memcmp(m_data + m_pos + 1, "NETSCAPE2.0", 11) == 0) {
+                m_pos += 12;
+                if (m_pos + 4 <= m_size && m_data[m_pos] == 3 && m_data[m_pos + 1] == 1)
+                    m_loopCount = readLE16(m_data + m_pos + 2);
+            }
+            if (!skipSubBlocks()) return false;
+            continue;
+        }
+
+        if (block != 0x2C || m_pos + 9 > m_size) return false;
+
+        // Image descriptor
+        const int fx = readLE16(m_data + m_pos);
+        const int fy = readLE16(m_data + m_pos + 2);
+        const int fw = readLE16(m_data + m_pos + 4);
+        const int fh = readLE16(m_data + m_pos + 6);
+        const uint8_t packed = m_data[m_pos + 8];
+        m_pos += 9;
+
+        std::array<std::array<uint8_t, 3>, 256> localPalette;
+        const std::array<std::array<uint8_t, 3>, 256>* palette = &m_globalPalette;
+        int paletteSize = m_globalPaletteSize;
+        if (packed & 0x80) {
+            paletteSize = 2 << (packed & 7);
+            if (m_pos + 3 * static_cast<size_t>(paletteSize) > m_size) return false;
+            for (int i = 0; i < paletteSize; ++i, m_pos += 3)
+                localPalette[i] = {m_data[m_pos], m_data[m_pos + 1], m_data[m_pos + 2]};
+            palette = &localPalette;
+        }
+        if (m_pos >= m_size) return false;
+        const int minCodeSize = m_data[m_pos++];
+
+        const size_t pixelCount = static_cast<size_t>(fw) * fh;
+        std::vector<uint8_t> indices(pixelCount, transparent >= 0 ? static_cast<uint8_t>(transparent) : 0);
+        if (!decodeLzw(minCodeSize, pixelCount, indices)) return false;
+
+        if (disposal == 3) m_restore = m_canvas;
+
+        // Composite, clipped to the canvas
+        const bool interlaced = (packed & 0x40) != 0;
+        int row = 0, pass = 0, step = interlaced ? 8 : 1;
+        for (int r = 0; r < fh; ++r) {
+            const int y = fy + row;
+            if (y < m_height) {
+                const uint8_t* src = indices.data() + static_cast<size_t>(r) * fw;
+                uint8_t* dst = m_canvas.data() + y * canvasRow;
+                for (int x = 0; x < fw && fx + x < m_width; ++x) {
+                    const int idx = src[x];
+                    if (idx == transparent || idx >= paletteSize) continue;
+                    uint8_t* p = dst + static_cast<size_t>(fx + x) * 4;
+                    p[0] = (*palette)[idx][0];
+                    p[1] = (*palette)[idx][1];
+                    p[2] = (*palette)[idx][2];
+                    p[3] = 255;
+                }
+            }
+            // Interlaced rows arrive as 0,8,16.. then 4,12.. then 2,6.. then 1,3..
+            row += step;
+            while (interlaced && row >= fh && pass < 3) {
+                ++pass;
+                row = pass == 1 ? 4 : pass == 2 ? 2 : 1;
+                step = pass == 1 ? 8 : pass == 2 ? 4 : 2;
+            }
+        }
+
+        m_dispose = disposal;
+        m_lastX = std::min(fx, m_width);
+        m_lastY = std::min(fy, m_height);
+        m_lastW = std::min(fw, m_width - m_lastX);
+        m_lastH = std::min(fh, m_height - m_lastY);
+
+        frame = ImageBuffer{};
+        frame.width = m_width;
+        frame.height = m_height;
+        frame.channels = 4;
+        frame.data = m_canvas;
+        return true;
+    }
+    return false;
+}
+
+int GifReader::countFrames(const uint8_t* data, size_t size) {
+    GifReader reader;
+    if (!reader.open(data, size)) return 0;
+    int frames = 0;
+    while (reader.m_pos < size) {
+        const uint8_t block = data[reader.m_pos++];
+        if (block == 0x21) {
+            ++reader.m_pos;  // label
+            if (!reader.skipSubBlocks()) break;
+        } else if (block == 0x2C) {
+            if (reader.m_pos + 9 > size) break;
+            const uint8_t packed = data[reader.m_pos + 8];
+            reader.m_pos += 9;
+            if (packed & 0x80) reader.m_pos += 3 * (static_cast<size_t>(2) << (packed & 7));
+            ++reader.m_pos;  // LZW minimum code size
+            if (!reader.skipSubBlocks()) break;
+            ++frames;
+        } else {
+            break;
+        }
+    }
+    return frames;
+}
+
+// ---------------------------------------------------------------------------
+// Writer
+// ---------------------------------------------------------------------------
+
+namespace GifWriter {
+
+std::vector<uint8_t> header(int width, int height, const std::array<uint8_t, 3>* palette,
+                            int paletteSize, int loopCount) {
+    const int bits = paletteBits(paletteSize);
+    std::vector<uint8_t> out = {'G', 'I', 'F', '8', '9', 'a'};
+    putLE16(out, width);
+    putLE16(out, height);
+    out.push_back(static_cast<uint8_t>(0x80 | ((bits - 1) << 4) | (bits - 1)));
+    out.push_back(0);  // background index
+    out.push_back(0);  // square pixels
+    for (int i = 0; i < (1 << bits); ++i) {
+        const std::array<uint8_t, 3> c = i < paletteSize ? palette[i] : std::array<uint8_t, 3>{};
+        out.insert(out.end(), c.begin(), c.end());
+    }
+    if (loopCount >= 0) {
+        static const uint8_t NETSCAPE[] = {0x21, 0xFF, 11, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E',
+                                           '2', '.', '0', 3, 1};
+        out.insert(out.end(), NETSCAPE, NETSCAPE + sizeof(NETSCAPE));
+        putLE16(out, loopCount);
+        out.push_back(0);
+    }
+    return out;
+}
+
+std::vector<uint8_t> encodeFrame(const uint8_t* indices, int width, int height,
+                                 int paletteSize, int delayCs, int transparentIndex) {
+    std::vector<uint8_t> out;
+
+    // Graphic control: transparent frames are cleared before the next one is
+    // drawn so nothing of them shows through
+    out.insert(out.end(), {0x21, 0xF9, 4});
+    out.push_back(transparentIndex >= 0 ? (2 << 2) | 1 : (1 << 2));
+    putLE16(out, std::clamp(delayCs, 0, 65535));
+    out.push_back(static_cast<uint8_t>(transparentIndex >= 0 ? transparentIndex : 0));
+    out.push_back(0);
+
+    // Image descriptor: the full canvas, global palette
+    out.push_back(0x2C);
+    putLE16(out, 0);
+    putLE16(out, 0);
+    putLE16(out, width);
+    putLE16(out, height);
+    out.push_back(0);
+
+    const int minCodeSize = std::max(2, paletteBits(paletteSize));
+    out.push_back(static_cast<uint8_t>(minCodeSize));
+
+    // LZW with codes packed LSB-first; the dictionary maps (prefix code, index)
+    // to a code through an open-addressed hash table
+    constexpr int HASH_BITS = 13;
+    constexpr uint32_t HASH_MASK = (1u << HASH_BITS) - 1;
+    std::vector<int32_t> keys(size_t(1) << HASH_BITS);
+    std::vector<uint16_t> codes(size_t(1) << HASH_BITS);
+
+    std::vector<uint8_t> packed;
+    packed.reserve(static_cast<size_t>(width) * height / 2 + 16);
+    uint32_t bitBuf = 0;
+    int bitCount = 0;
+    auto put = [&](int code, int size) {
+        bitBuf |= static_cast<uint32_t>(code) << bitCount;
+        bitCount += size;
+        while (bitCount >= 8) {
+            packed.push_back(static_cast<uint8_t>(bitBuf));
+            bitBuf >>= 8;
+            bitCount -= 8;
+        }
+    };
+
+    const int clear = 1 << minCodeSize;
+    const int eoi = clear + 1;
+    int codeSize = minCodeSize + 1;
+    int maxCode = eoi;
+    std::fill(keys.begin(), keys.end(), -1);
+    put(clear, codeSize);
+
+    const size_t count = static_cast<size_t>(width) * height;
+    int cur = indices[0];
+    for (size_t i = 1; i < count; ++i) {
+        const int c = indices[i];
+        const int32_t key = (cur << 8) | c;
+        uint32_t h = (static_cast<uint32_t>(key) * 2654435761u) >> (32 - HASH_BITS);
+        while (keys[h] != -1 && keys[h] != key) h = (h + 1) & HASH_MASK;
+        if (keys[h] == key) {
+            cur = codes[h];
+            continue;
+        }
+
+        put(cur, codeSize);
+        keys[h] = key;
+        codes[h] = static_cast<uint16_t>(++maxCode);
+        if (maxCode >= (1 << codeSize)) ++codeSize;
+        if (maxCode == MAX_CODES - 1) {
+            // Dictionary full: start over
+            put(clear, codeSize);
+            std::fill(keys.begin(), keys.end(), -1);
+            codeSize = minCodeSize + 1;
+            maxCode = eoi;
+        }
+        cur = c;
+    }
+    put(cur, codeSize);
+    put(eoi, codeSize);
+    if (bitCount > 0) packed.push_back(static_cast<uint8_t>(bitBuf));
+
+    // Data sub-blocks of at most 255 bytes
+    for (size_t pos = 0; pos < packed.size(); pos += 255) {
+        const size_t n = std::min<size_t>(255, packed.size() - pos);
+        out.push_back(static_cast<uint8_t>(n));
+        out.insert(out.end(), packed.begin() + pos, packed.begin() + pos + n);
+    }
+    out.push_back(0);
+    return out;
+}
+
+} // namespace GifWriter
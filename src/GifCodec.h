@@ -0,0 +1,76 @@
+#pragma once
+
+#include "ImageProcessor.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// GifReader - frame-at-a-time GIF decoder
+//
+// Frames are composited onto an RGBA canvas (disposal methods and
+// transparency applied) and handed out one by one, so memory does not grow
+// with the number of frames.
+// ---------------------------------------------------------------------------
+
+class GifReader {
+public:
+    // `data` must outlive the reader. Returns false if it is not a GIF.
+    bool open(const uint8_t* data, size_t size);
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    int loopCount() const { return m_loopCount; } // 0 = forever
+
+    // Next composited RGBA frame and its delay in 1/100 s. Returns false
+    // after the last frame or on corrupt data.
+    bool nextFrame(ImageBuffer& frame, int& delayCs);
+
+    // Number of frames, found by walking the block structure without decoding
+    static int countFrames(const uint8_t* data, size_t size);
+
+private:
+    bool skipSubBlocks();
+    bool decodeLzw(int minCodeSize, size_t pixelCount, std::vector<uint8_t>& indices);
+
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_pos = 0;
+
+    int m_width = 0;
+    int m_height = 0;
+    int m_loopCount = 0;
+    std::array<std::array<uint8_t, 3>, 256> m_globalPalette{};
+    int m_globalPaletteSize = 0;
+
+    ByteBuffer m_canvas;          // RGBA, what the last frame left behind
+    ByteBuffer m_restore;         // canvas saved for "restore to previous"
+    int m_dispose = 0;            // disposal of the last frame
+    int m_lastX = 0, m_lastY = 0, m_lastW = 0, m_lastH = 0;
+};
+
+// ---------------------------------------------------------------------------
+// GifWriter - GIF89a output pieces
+//
+// Frames are encoded independently (LZW included), so callers can encode
+// them in parallel and write the results in order between header() and
+// TRAILER.
+// ---------------------------------------------------------------------------
+
+namespace GifWriter {
+
+// Logical screen, global palette (up to 256 entries) and, for animations,
+// the looping extension (loopCount 0 = forever, -1 = no extension)
+std::vector<uint8_t> header(int width, int height, const std::array<uint8_t, 3>* palette,
+                            int paletteSize, int loopCount);
+
+// One full-canvas frame of palette indices. `transparentIndex` is -1 for
+// opaque frames; transparent frames clear the canvas when they are replaced.
+std::vector<uint8_t> encodeFrame(const uint8_t* indices, int width, int height,
+                                 int paletteSize, int delayCs, int transparentIndex);
+
+constexpr uint8_t TRAILER = 0x3B;
+
+} // namespace GifWriter
@@ -0,0 +1,82 @@
+#include "ImageLoader.h"
+#include "MappedFile.h"
+#include "stb_image.h"
+
+#include <climits>
+
+ImageLoader::~ImageLoader() {
+    if (m_future.valid())
+        m_future.wait();
+}
+
+ImageBuffer ImageLoader::decodeMemory(const uint8_t* data, size_t size) {
+    if (!data || size == 0 || size > static_cast<size_t>(INT_MAX)) return {};
+
+    int w, h, ch;
+    unsigned char* pixels = stbi_load_from_memory(data, static_cast<int>(size), &w, &h, &ch, 4);
+    if (!pixels) return {};
+
+    ImageBuffer img;
+    img.width = w;
+    img.height = h;
+    img.channels = 4;
+    // stb allocates through the pool shim, so its buffer is adopted as-is
+    img.data = ByteBuffer::adoptRaw(pixels, static_cast<size_t>(w) * h * 4);
+    return img;
+}
+
+bool ImageLoader::probeMemory(const uint8_t* data, size_t size, int& width, int& height) {
+    if (!data || size == 0 || size > static_cast<size_t>(INT_MAX)) return false;
+    int ch;
+    return stbi_info_from_memory(data, static_cast<int>(size), &width, &height, &ch) != 0;
+}
+
+ImageBuffer ImageLoader::decodeFile(const std::string& path) {
+    auto file = MappedFile::open(path);
+    if (!file) return {};
+    return decodeMemory(file->data(), file->size());
+}
+
+void ImageLoader::loadFile(const std::string& path, std::function<void(ImageBuffer)> onLoaded) {
+    start([path] { return decodeFile(path); }, std::move(onLoaded));
+}
+
+void ImageLoader::loadMemory(std::vector<uint8_t> bytes, std::function<void(ImageBuffer)> onLoaded) {
+    auto shared = std::make_shared<std::vector<uint8_t>>(std::move(bytes));
+    start([shared] { return decodeMemory(shared->data(), shared->size()); }, std::move(onLoaded));
+}
+
+void ImageLoader::start(Job job, std::function<void(ImageBuffer)> onLoaded) {
+    if (m_future.valid()) {
+        // stb cannot be interrupted: queue behind the running decode
+        m_pendingJob = std::move(job);
+        m_pendingCallback = std::move(onLoaded);
+        return;
+    }
+    m_callback = std::move(onLoaded);
+    m_future = std::async(std::launch::async, std::move(job));
+}
+
+bool ImageLoader::isLoading() const {
+    return m_future.valid();
+}
+
+void ImageLoader::poll() {
+    if (!m_future.valid() ||
+        m_future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return;
+
+    ImageBuffer result = m_future.get();
+    auto callback = std::move(m_callback);
+    m_callback = nullptr;
+
+    if (m_pendingJob) {
+        // Superseded: drop this result and start the latest request
+        start(std::move(m_pendingJob), std::move(m_pendingCallback));
+        m_pendingJob = nullptr;
+        m_pendingCallback = nullptr;
+        return;
+    }
+    if (callback)
+        callback(std::move(result));
+}
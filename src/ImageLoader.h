@@ -0,0 +1,51 @@
+#pragma once
+#include "ImageProcessor.h"
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <string>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// ImageLoader - decodes images on a background thread
+//
+// Files are memory-mapped and decoded straight from the mapping; the decoder's
+// RGBA output becomes the ImageBuffer's storage without a copy. A load started
+// while another one is running supersedes it.
+// ---------------------------------------------------------------------------
+
+class ImageLoader {
+public:
+    ImageLoader() = default;
+    ~ImageLoader();
+
+    // Start decoding. `onLoaded` is called from poll() with the result, which
+    // is an invalid buffer if the data could not be decoded.
+    void loadFile(const std::string& path, std::function<void(ImageBuffer)> onLoaded);
+    void loadMemory(std::vector<uint8_t> bytes, std::function<void(ImageBuffer)> onLoaded);
+
+    // True until the callback of the most recent load has run
+    bool isLoading() const;
+
+    // Deliver a finished result (call from main thread)
+    void poll();
+
+    // Synchronous decoding, as run by the background task
+    static ImageBuffer decodeFile(const std::string& path);
+    static ImageBuffer decodeMemory(const uint8_t* data, size_t size);
+
+    // Dimensions from the header alone, to refuse oversized input before
+    // decoding it. False if the format isn't recognized.
+    static bool probeMemory(const uint8_t* data, size_t size, int& width, int& height);
+
+private:
+    using Job = std::function<ImageBuffer()>;
+    void start(Job job, std::function<void(ImageBuffer)> onLoaded);
+
+    std::future<ImageBuffer> m_future;
+    std::function<void(ImageBuffer)> m_callback;
+
+    // Latest load requested while another was running
+    Job m_pendingJob;
+    std::function<void(ImageBuffer)> m_pendingCallback;
+};
@@ -1,10 +1,21 @@
+#include "ImageProcessor.h"
+#include "Kernels.h"
+#include "Trace.h"
+#include "Watermark.h"
+
+// Route stb's decode/encode buffers through the current scratch pool
+#define STBI_MALLOC(sz)            BufferPool::rawAlloc(sz)
+#define STBI_REALLOC(p, newsz)     BufferPool::rawRealloc(p, newsz)
+#define STBI_FREE(p)               BufferPool::rawFree(p)
+#define STBIW_MALLOC(sz)           BufferPool::rawAlloc(sz)
+#define STBIW_REALLOC(p, newsz)    BufferPool::rawRealloc(p, newsz)
+#define STBIW_FREE(p)              BufferPool::rawFree(p)
+
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 
-#include "ImageProcessor.h"
-
 #include <vector>
 #include <array>
 #include <string>
@@ -16,6 +27,9 @@
 #include <cstring>
 #include <functional>
 #include <numeric>
+#include <span>
+#include <climits>
+#include <initializer_list>
 
 namespace ImageProcessor {
 
@@ -31,90 +45,406 @@ static inline uint8_t clampByte(float v) {
     return static_cast<uint8_t>(std::clamp(static_cast<int>(std::round(v)), 0, 255));
 }
 
-// Simple 2-D pixel access helpers (RGBA assumed)
+// Simple 2-D pixel access helpers (interleaved layout assumed)
+static inline size_t pixelIndex(int x, int y, int w) {
+    return static_cast<size_t>(y) * w + x;
+}
+
 static inline uint8_t* pixelAt(ImageBuffer& img, int x, int y) {
-    return &img.data[static_cast<size_t>((y * img.width + x) * img.channels)];
+    return &img.data[pixelIndex(x, y, img.width) * img.channels];
 }
 
 static inline const uint8_t* pixelAt(const ImageBuffer& img, int x, int y) {
-    return &img.data[static_cast<size_t>((y * img.width + x) * img.channels)];
+    return &img.data[pixelIndex(x, y, img.width) * img.channels];
 }
 
 // ---------------------------------------------------------------------------
-// 1. Color Quantization  (median-cut + optional dither)
+// Band sweeps
+//
+// Kernels walk the frame top to bottom in bands of BAND_ROWS rows. Once a band
+// is done, rows that later bands no longer read are discarded: for frames
+// whose buffers spilled to scratch files (see BufferPool) this keeps only a
+// few bands resident, for in-memory frames it is free.
 // ---------------------------------------------------------------------------
 
-struct ColorBox {
-    std::vector<std::array<uint8_t, 3>> colors;
-
-    std::array<uint8_t, 3> average() const {
-        if (colors.empty()) return {0, 0, 0};
-        unsigned long long r = 0, g = 0, b = 0;
-        for (auto& c : colors) { r += c[0]; g += c[1]; b += c[2]; }
-        auto n = colors.size();
-        return {static_cast<uint8_t>(r / n),
-                static_cast<uint8_t>(g / n),
-                static_cast<uint8_t>(b / n)};
-    }
-
-    int longestAxis() const {
-        uint8_t minR = 255, minG = 255, minB = 255;
-        uint8_t maxR = 0, maxG = 0, maxB = 0;
-        for (auto& c : colors) {
-            minR = std::min(minR, c[0]); maxR = std::max(maxR, c[0]);
-            minG = std::min(minG, c[1]); maxG = std::max(maxG, c[1]);
-            minB = std::min(minB, c[2]); maxB = std::max(maxB, c[2]);
+static constexpr int BAND_ROWS = 64;
+
+struct BandRows {
+    const ByteBuffer* buf;
+    size_t rowBytes;
+    int reach = 0;  // rows above the current band that later bands still read
+};
+
+template <typename Fn>
+static void sweepBands(int height, std::initializer_list<BandRows> rows, Fn&& fn) {
+    for (int y0 = 0; y0 < height; y0 += BAND_ROWS) {
+        int y1 = std::min(height, y0 + BAND_ROWS);
+        fn(y0, y1);
+        for (const BandRows& r : rows) {
+            int from = std::max(0, y0 - r.reach);
+            int to = std::max(0, y1 - r.reach);
+            if (to > from)
+                r.buf->discard(from * r.rowBytes, (to - from) * r.rowBytes);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Compile-time specialization
+//
+// Per-pixel loops are templates over the channel count and effect switches.
+// These helpers turn the runtime value into a constant once per call, e.g.
+//
+//   withChannels(img.channels, [&]<int CH>(IntC<CH>) { ... CH ... });
+//
+// so the loops themselves are fixed-width and free of per-pixel branches.
+// ---------------------------------------------------------------------------
+
+template <int N> using IntC = std::integral_constant<int, N>;
+template <bool B> using BoolC = std::integral_constant<bool, B>;
+
+// fn(IntC<channels>) for 1-4 channels
+template <typename Fn>
+static decltype(auto) withChannels(int channels, Fn&& fn) {
+    switch (channels) {
+    case 1:  return fn(IntC<1>{});
+    case 2:  return fn(IntC<2>{});
+    case 3:  return fn(IntC<3>{});
+    default: return fn(IntC<4>{});
+    }
+}
+
+template <typename Fn>
+static decltype(auto) withFlag(bool flag, Fn&& fn) {
+    return flag ? fn(BoolC<true>{}) : fn(BoolC<false>{});
+}
+
+// dst[x] = src[clamp(x - shift)] for x in [x0, x1): a span moved right by
+// `shift` pixels (left if negative), repeating the row's edge pixel where it
+// would read outside. dst may be src: the middle goes first and never
+// overwrites an edge pixel the fills still need.
+template <int CH>
+static void shiftSpanClamped(const uint8_t* src, uint8_t* dst, int w, int x0, int x1, int shift) {
+    int lo = std::clamp(shift, x0, x1);           // dst [x0, lo) takes src pixel 0
+    int hi = std::clamp(w + shift, lo, x1);       // dst [hi, x1) takes src pixel w - 1
+    if (hi > lo)
+        std::memmove(dst + lo * CH, src + (lo - shift) * CH, static_cast<size_t>(hi - lo) * CH);
+    for (int x = x0; x < lo; ++x) std::memcpy(dst + x * CH, src, CH);
+    for (int x = hi; x < x1; ++x) std::memcpy(dst + x * CH, src + (w - 1) * CH, CH);
+}
+
+template <int CH>
+static void shiftRowClamped(const uint8_t* src, uint8_t* dst, int w, int shift) {
+    shiftSpanClamped<CH>(src, dst, w, 0, w, shift);
+}
+
+// ---------------------------------------------------------------------------
+// 0. Pixel layouts
+// ---------------------------------------------------------------------------
+
+static ImageBuffer splitAlpha(const ImageBuffer& src) {
+    size_t n = src.pixelCount();
+    size_t w = src.width;
+    ImageBuffer dst;
+    dst.width = src.width;
+    dst.height = src.height;
+    dst.channels = 3;
+    dst.data = ByteBuffer(n * 3);
+    ByteBuffer alpha(n);
+    const uint8_t* s = src.data.data();
+    uint8_t* d = dst.data.data();
+    uint8_t* a = alpha.data();
+    uint8_t opaque = 255;
+    sweepBands(src.height, {{&src.data, w * 4}, {&dst.data, w * 3}, {&alpha, w}},
+               [&](int y0, int y1) {
+        for (size_t i = y0 * w; i < y1 * w; ++i) {
+            d[i * 3 + 0] = s[i * 4 + 0];
+            d[i * 3 + 1] = s[i * 4 + 1];
+            d[i * 3 + 2] = s[i * 4 + 2];
+            a[i] = s[i * 4 + 3];
+            opaque &= a[i];
+        }
+    });
+    if (opaque != 255) dst.alpha = std::move(alpha);
+    return dst;
+}
+
+void toRGB(ImageBuffer& img) {
+    if (!img.valid() || img.channels != 4) return;
+    toInterleaved(img);
+    img = splitAlpha(img);
+}
+
+void toRGBA(ImageBuffer& img) {
+    if (!img.valid()) return;
+    toInterleaved(img);
+    if (img.channels == 4) return;
+
+    size_t n = img.pixelCount();
+    size_t w = img.width;
+    ByteBuffer rgba(n * 4);
+    const uint8_t* s = img.data.data();
+    const uint8_t* a = img.alpha.empty() ? nullptr : img.alpha.data();
+    uint8_t* d = rgba.data();
+    withFlag(a != nullptr, [&]<bool HAS_ALPHA>(BoolC<HAS_ALPHA>) {
+        sweepBands(img.height, {{&img.data, w * 3}, {&img.alpha, w}, {&rgba, w * 4}},
+                   [&](int y0, int y1) {
+            for (size_t i = y0 * w; i < y1 * w; ++i) {
+                d[i * 4 + 0] = s[i * 3 + 0];
+                d[i * 4 + 1] = s[i * 3 + 1];
+                d[i * 4 + 2] = s[i * 3 + 2];
+                d[i * 4 + 3] = HAS_ALPHA ? a[i] : 255;
+            }
+        });
+    });
+    img.data = std::move(rgba);
+    img.alpha.clear();
+    img.channels = 4;
+}
+
+void toPlanar(ImageBuffer& img) {
+    if (!img.valid() || img.layout == PixelLayout::Planar) return;
+    size_t n = img.pixelCount();
+    size_t w = img.width;
+    int ch = img.channels;
+    ByteBuffer planar(img.data.size());
+    const uint8_t* s = img.data.data();
+    // Band-major so out-of-core frames stream through once
+    withChannels(ch, [&]<int CH>(IntC<CH>) {
+        sweepBands(img.height, {{&img.data, w * CH}}, [&](int y0, int y1) {
+            for (int c = 0; c < CH; ++c) {
+                uint8_t* d = planar.data() + c * n;
+                for (size_t i = y0 * w; i < y1 * w; ++i) d[i] = s[i * CH + c];
+            }
+        });
+    });
+    img.data = std::move(planar);
+    img.layout = PixelLayout::Planar;
+}
+
+void toInterleaved(ImageBuffer& img) {
+    if (!img.valid() || img.layout == PixelLayout::Interleaved) return;
+    size_t n = img.pixelCount();
+    size_t w = img.width;
+    int ch = img.channels;
+    ByteBuffer packed(img.data.size());
+    uint8_t* d = packed.data();
+    withChannels(ch, [&]<int CH>(IntC<CH>) {
+        sweepBands(img.height, {{&packed, w * CH}}, [&](int y0, int y1) {
+            for (int c = 0; c < CH; ++c) {
+                const uint8_t* s = img.data.data() + c * n;
+                for (size_t i = y0 * w; i < y1 * w; ++i) d[i * CH + c] = s[i];
+            }
+        });
+    });
+    img.data = std::move(packed);
+    img.layout = PixelLayout::Interleaved;
+}
+
+int packedChannels(const ImageBuffer& img) {
+    return img.channels + (img.alpha.empty() ? 0 : 1);
+}
+
+void packRow(const ImageBuffer& img, int y, uint8_t* dst) {
+    const size_t w = img.width;
+    const size_t offset = static_cast<size_t>(y) * w;
+    const int ch = img.channels;
+    const int outCh = packedChannels(img);
+
+    if (img.layout == PixelLayout::Interleaved && img.alpha.empty()) {
+        std::memcpy(dst, img.data.data() + offset * ch, w * ch);
+        return;
+    }
+    const bool planar = img.layout == PixelLayout::Planar;
+    for (int c = 0; c < ch; ++c) {
+        const uint8_t* s = planar ? img.plane(c) + offset : img.data.data() + offset * ch + c;
+        const size_t step = planar ? 1 : ch;
+        for (size_t x = 0; x < w; ++x) dst[x * outCh + c] = s[x * step];
+    }
+    if (!img.alpha.empty()) {
+        const uint8_t* a = img.alpha.data() + offset;
+        for (size_t x = 0; x < w; ++x) dst[x * outCh + ch] = a[x];
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Visible tiles
+// ---------------------------------------------------------------------------
+
+// Alpha of every pixel, `stride` bytes apart, or nullptr for an opaque image
+static const uint8_t* alphaBytes(const ImageBuffer& img, size_t& stride) {
+    stride = 1;
+    if (!img.alpha.empty()) return img.alpha.data();
+    if (img.channels != 4) return nullptr;
+    if (img.layout == PixelLayout::Planar) return img.plane(3);
+    stride = 4;
+    return img.data.data() + 3;
+}
+
+AlphaTiles AlphaTiles::build(const ImageBuffer& img) {
+    AlphaTiles t;
+    t.width = img.width;
+    t.height = img.height;
+    t.tilesX = (img.width + TILE - 1) / TILE;
+    t.tilesY = (img.height + TILE - 1) / TILE;
+    size_t stride;
+    const uint8_t* alpha = alphaBytes(img, stride);
+    t.occupied = ScratchArray<uint8_t>(static_cast<size_t>(t.tilesX) * t.tilesY, alpha ? 0 : 1);
+
+    // A tile stops being scanned at its first visible pixel
+    for (int y = 0; alpha && y < img.height; ++y) {
+        uint8_t* occ = &t.occupied[static_cast<size_t>(y / TILE) * t.tilesX];
+        const uint8_t* a = alpha + pixelIndex(0, y, img.width) * stride;
+        for (int tx = 0; tx < t.tilesX; ++tx) {
+            if (occ[tx]) continue;
+            for (int x = tx * TILE; x < std::min(img.width, (tx + 1) * TILE); ++x) {
+                if (a[x * stride]) { occ[tx] = 1; break; }
+            }
+        }
+    }
+    t.collectSpans();
+    return t;
+}
+
+AlphaTiles AlphaTiles::grown(int radius) const {
+    const int reach = (std::max(0, radius) + TILE - 1) / TILE;
+    AlphaTiles t = *this;
+    for (int ty = 0; ty < tilesY; ++ty) {
+        for (int tx = 0; tx < tilesX; ++tx) {
+            if (!occupied[static_cast<size_t>(ty) * tilesX + tx]) continue;
+            for (int y = std::max(0, ty - reach); y <= std::min(tilesY - 1, ty + reach); ++y)
+                for (int x = std::max(0, tx - reach); x <= std::min(tilesX - 1, tx + reach); ++x)
+                    t.occupied[static_cast<size_t>(y) * tilesX + x] = 1;
+        }
+    }
+    t.collectSpans();
+    return t;
+}
+
+bool AlphaTiles::bounds(int& x0, int& y0, int& x1, int& y1) const {
+    x0 = width; y0 = height; x1 = 0; y1 = 0;
+    for (int ty = 0; ty < tilesY; ++ty) {
+        for (uint32_t i = rowStart[ty]; i < rowStart[ty + 1]; ++i) {
+            x0 = std::min(x0, spans[i].x0);
+            x1 = std::max(x1, spans[i].x1);
+            y0 = std::min(y0, ty * TILE);
+            y1 = std::min(height, (ty + 1) * TILE);
+        }
+    }
+    return x1 > x0;
+}
+
+void AlphaTiles::collectSpans() {
+    // Runs are separated by empty tiles, so a tile row has at most one per two tiles
+    spans = ScratchArray<Span>(static_cast<size_t>(tilesY) * ((tilesX + 1) / 2));
+    rowStart = ScratchArray<uint32_t>(tilesY + 1);
+    uint32_t count = 0;
+    rowStart[0] = 0;
+    for (int ty = 0; ty < tilesY; ++ty) {
+        const uint8_t* occ = &occupied[static_cast<size_t>(ty) * tilesX];
+        for (int tx = 0; tx < tilesX;) {
+            if (!occ[tx]) { ++tx; continue; }
+            int end = tx;
+            while (end < tilesX && occ[end]) ++end;
+            spans[count++] = {tx * TILE, std::min(width, end * TILE)};
+            tx = end;
         }
-        int dr = maxR - minR, dg = maxG - minG, db = maxB - minB;
-        if (dr >= dg && dr >= db) return 0;
-        if (dg >= dr && dg >= db) return 1;
-        return 2;
+        rowStart[ty + 1] = count;
     }
+}
+
+// fn(x0, x1) for each run of row y that `visible` marks occupied, or once for
+// the whole row without a mask
+template <typename Fn>
+static void forEachSpan(const AlphaTiles* visible, int y, int width, Fn&& fn) {
+    if (!visible) { fn(0, width); return; }
+    for (const AlphaTiles::Span* s = visible->rowBegin(y); s != visible->rowEnd(y); ++s)
+        fn(s->x0, s->x1);
+}
+
+// ---------------------------------------------------------------------------
+// 1. Color Quantization  (median-cut + optional dither)
+// ---------------------------------------------------------------------------
+
+using Rgb = std::array<uint8_t, 3>;
+static constexpr int MAX_PALETTE = 256;
+
+// A box is a contiguous range of the shared color array; splitting sorts the
+// range in place, so no per-box copies are made.
+struct ColorBox {
+    size_t begin = 0;
+    size_t end = 0;
+    size_t size() const { return end - begin; }
 };
 
-static std::vector<std::array<uint8_t, 3>> medianCut(
-        const std::vector<std::array<uint8_t, 3>>& pixels, int numColors) {
-    if (numColors <= 0) numColors = 1;
-    std::vector<ColorBox> boxes;
-    boxes.push_back({pixels});
+static Rgb boxAverage(const Rgb* colors, size_t n) {
+    if (n == 0) return {0, 0, 0};
+    unsigned long long r = 0, g = 0, b = 0;
+    for (size_t i = 0; i < n; ++i) { r += colors[i][0]; g += colors[i][1]; b += colors[i][2]; }
+    return {static_cast<uint8_t>(r / n),
+            static_cast<uint8_t>(g / n),
+            static_cast<uint8_t>(b / n)};
+}
+
+static int boxLongestAxis(const Rgb* colors, size_t n) {
+    uint8_t minR = 255, minG = 255, minB = 255;
+    uint8_t maxR = 0, maxG = 0, maxB = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const Rgb& c = colors[i];
+        minR = std::min(minR, c[0]); maxR = std::max(maxR, c[0]);
+        minG = std::min(minG, c[1]); maxG = std::max(maxG, c[1]);
+        minB = std::min(minB, c[2]); maxB = std::max(maxB, c[2]);
+    }
+    int dr = maxR - minR, dg = maxG - minG, db = maxB - minB;
+    if (dr >= dg && dr >= db) return 0;
+    if (dg >= dr && dg >= db) return 1;
+    return 2;
+}
 
-    while (static_cast<int>(boxes.size()) < numColors) {
+// Median cut over `pixels` (reordered in place). Writes up to MAX_PALETTE
+// colors to `palette` and returns how many were produced.
+static int medianCut(Rgb* pixels, size_t count, int numColors, Rgb* palette) {
+    SHAKAL_TRACE_SCOPE_PIXELS("medianCut", count);
+    numColors = std::clamp(numColors, 1, MAX_PALETTE);
+    std::array<ColorBox, MAX_PALETTE> boxes;
+    int numBoxes = 1;
+    boxes[0] = {0, count};
+
+    while (numBoxes < numColors) {
         // Find box with most colors to split
         int bestIdx = 0;
         size_t bestSize = 0;
-        for (int i = 0; i < static_cast<int>(boxes.size()); ++i) {
-            if (boxes[i].colors.size() > bestSize) {
-                bestSize = boxes[i].colors.size();
+        for (int i = 0; i < numBoxes; ++i) {
+            if (boxes[i].size() > bestSize) {
+                bestSize = boxes[i].size();
                 bestIdx = i;
             }
         }
         if (bestSize <= 1) break;
 
-        ColorBox& box = boxes[bestIdx];
-        int axis = box.longestAxis();
-        std::sort(box.colors.begin(), box.colors.end(),
-                  [axis](const auto& a, const auto& b) { return a[axis] < b[axis]; });
-
-        size_t mid = box.colors.size() / 2;
-        ColorBox left, right;
-        left.colors.assign(box.colors.begin(), box.colors.begin() + mid);
-        right.colors.assign(box.colors.begin() + mid, box.colors.end());
+        ColorBox box = boxes[bestIdx];
+        int axis = boxLongestAxis(pixels + box.begin, bestSize);
+        std::sort(pixels + box.begin, pixels + box.end,
+                  [axis](const Rgb& a, const Rgb& b) { return a[axis] < b[axis]; });
 
-        boxes[bestIdx] = std::move(left);
-        boxes.push_back(std::move(right));
+        size_t mid = box.begin + bestSize / 2;
+        boxes[bestIdx] = {box.begin, mid};
+        boxes[numBoxes++] = {mid, box.end};
     }
 
-    std::vector<std::array<uint8_t, 3>> palette;
-    palette.reserve(boxes.size());
-    for (auto& b : boxes) palette.push_back(b.average());
-    return palette;
+    for (int i = 0; i < numBoxes; ++i)
+        palette[i] = boxAverage(pixels + boxes[i].begin, boxes[i].size());
+    return numBoxes;
+}
+
+int medianCutPalette(Rgb* pixels, size_t count, int numColors, Rgb* palette) {
+    if (count == 0) return 0;
+    return medianCut(pixels, count, numColors, palette);
 }
 
-static std::array<uint8_t, 3> nearestPaletteColor(
-        const std::array<uint8_t, 3>& c,
-        const std::vector<std::array<uint8_t, 3>>& palette) {
+static Rgb nearestPaletteColor(const Rgb& c, std::span<const Rgb> palette) {
     int bestDist = INT_MAX;
-    std::array<uint8_t, 3> best = palette[0];
+    Rgb best = palette[0];
     for (auto& p : palette) {
         int dr = static_cast<int>(c[0]) - p[0];
         int dg = static_cast<int>(c[1]) - p[1];
@@ -125,84 +455,163 @@ static std::array<uint8_t, 3> nearestPaletteColor(
     return best;
 }
 
-void colorQuantize(ImageBuffer& img, int level, DitherMode dither) {
+// Replace `count` pixels `stride` bytes apart with their nearest palette
+// color, through the dispatched kernel
+class PaletteMapper {
+public:
+    explicit PaletteMapper(std::span<const Rgb> palette) : m_palette(palette) {
+        for (size_t i = 0; i < palette.size() && i < MAX_PALETTE; ++i) {
+            m_r[i] = palette[i][0];
+            m_g[i] = palette[i][1];
+            m_b[i] = palette[i][2];
+        }
+    }
+
+    void map(uint8_t* pixels, size_t count, int stride) {
+        if (m_palette.size() > MAX_PALETTE) {
+            // Indices are bytes: oversized custom palettes take the slow path
+            for (size_t i = 0; i < count; ++i) {
+                uint8_t* p = pixels + i * stride;
+                Rgb nc = nearestPaletteColor({p[0], p[1], p[2]}, m_palette);
+                std::memcpy(p, nc.data(), 3);
+            }
+            return;
+        }
+        m_indices.resize(count);
+        Kernels::table().nearestPalette(pixels, count, stride, m_r.data(), m_g.data(), m_b.data(),
+                                        static_cast<int>(m_palette.size()), m_indices.data());
+        for (size_t i = 0; i < count; ++i)
+            std::memcpy(pixels + i * stride, m_palette[m_indices[i]].data(), 3);
+    }
+
+private:
+    std::span<const Rgb> m_palette;
+    std::array<float, MAX_PALETTE> m_r{}, m_g{}, m_b{};
+    ByteBuffer m_indices;
+};
+
+// Every pixel, or only the occupied spans of `visible`, through `mapper`
+static void mapPixels(ImageBuffer& img, PaletteMapper& mapper, const AlphaTiles* visible) {
+    size_t rowBytes = static_cast<size_t>(img.width) * img.channels;
+    sweepBands(img.height, {{&img.data, rowBytes}}, [&](int y0, int y1) {
+        if (!visible) {
+            mapper.map(&img.data[y0 * rowBytes], static_cast<size_t>(y1 - y0) * img.width,
+                       img.channels);
+            return;
+        }
+        for (int y = y0; y < y1; ++y) {
+            forEachSpan(visible, y, img.width, [&](int x0, int x1) {
+                mapper.map(pixelAt(img, x0, y), x1 - x0, img.channels);
+            });
+        }
+    });
+}
+
+void colorQuantize(ImageBuffer& img, int level, DitherMode dither, const AlphaTiles* visible) {
     if (!img.valid() || level <= 0) return;
+    toInterleaved(img);
     int numColors = std::max(2, 256 - level * 254 / 100);
 
-    // Collect pixel colors
-    int total = img.width * img.height;
-    std::vector<std::array<uint8_t, 3>> pixels(total);
-    for (int i = 0; i < total; ++i) {
-        int idx = i * img.channels;
-        pixels[i] = {img.data[idx], img.data[idx + 1], img.data[idx + 2]};
+    // Collect pixel colors. Fully transparent pixels are left out so no
+    // palette entries go to colors nobody sees.
+    size_t total = img.pixelCount();
+    size_t rowBytes = static_cast<size_t>(img.width) * img.channels;
+    std::array<Rgb, MAX_PALETTE> paletteStorage;
+    int paletteSize;
+    {
+        ScratchArray<Rgb> pixels(total);
+        size_t alphaStride;
+        auto gather = [&](const uint8_t* alpha) {
+            size_t n = 0;
+            withChannels(img.channels, [&]<int CH>(IntC<CH>) {
+                withFlag(alpha != nullptr, [&]<bool MASKED>(BoolC<MASKED>) {
+                    const uint8_t* src = img.data.data();
+                    for (size_t i = 0; i < total; ++i) {
+                        if constexpr (MASKED) {
+                            if (!alpha[i * alphaStride]) continue;
+                        }
+                        std::memcpy(pixels[n++].data(), src + i * CH, 3);
+                    }
+                });
+            });
+            return n;
+        };
+        size_t count = gather(alphaBytes(img, alphaStride));
+        if (count == 0) count = gather(nullptr);   // nothing visible at all
+        paletteSize = medianCut(pixels.data(), count, numColors, paletteStorage.data());
     }
-
-    auto palette = medianCut(pixels, numColors);
+    std::span<const Rgb> palette(paletteStorage.data(), paletteSize);
 
     if (dither == DitherMode::FloydSteinberg) {
-        // Floyd-Steinberg error diffusion
-        std::vector<std::array<float, 3>> errors(total, {0.f, 0.f, 0.f});
-        for (int y = 0; y < img.height; ++y) {
-            for (int x = 0; x < img.width; ++x) {
-                int i = y * img.width + x;
-                int idx = i * img.channels;
-                std::array<float, 3> old = {
-                    std::clamp(img.data[idx + 0] + errors[i][0], 0.f, 255.f),
-                    std::clamp(img.data[idx + 1] + errors[i][1], 0.f, 255.f),
-                    std::clamp(img.data[idx + 2] + errors[i][2], 0.f, 255.f)};
-                std::array<uint8_t, 3> qc = {clampByte(old[0]), clampByte(old[1]), clampByte(old[2])};
-                auto nc = nearestPaletteColor(qc, palette);
-                img.data[idx + 0] = nc[0];
-                img.data[idx + 1] = nc[1];
-                img.data[idx + 2] = nc[2];
-                std::array<float, 3> err = {old[0] - nc[0], old[1] - nc[1], old[2] - nc[2]};
-                auto distribute = [&](int nx, int ny, float w) {
-                    if (nx >= 0 && nx < img.width && ny >= 0 && ny < img.height) {
-                        int ni = ny * img.width + nx;
-                        errors[ni][0] += err[0] * w;
-                        errors[ni][1] += err[1] * w;
-                        errors[ni][2] += err[2] * w;
+        // Floyd-Steinberg error diffusion, over empty tiles too since the
+        // error flows through them. Error only ever reaches the next
+        // row, so two rolling rows of accumulators are enough. Each row has a
+        // spare cell at both ends that soaks up error pushed past the edge,
+        // and the last row's spill into the next is simply never read, so
+        // the pixel loop needs no bounds checks.
+        using Err = std::array<float, 3>;
+        const size_t errWidth = static_cast<size_t>(img.width) + 2;
+        ScratchArray<Err> errorRows(2 * errWidth, Err{0.f, 0.f, 0.f});
+        Err* errCur = errorRows.data() + 1;
+        Err* errNext = errorRows.data() + errWidth + 1;
+        withChannels(img.channels, [&]<int CH>(IntC<CH>) {
+            sweepBands(img.height, {{&img.data, rowBytes}}, [&](int y0, int y1) {
+                for (int y = y0; y < y1; ++y) {
+                    uint8_t* p = &img.data[pixelIndex(0, y, img.width) * CH];
+                    for (int x = 0; x < img.width; ++x, p += CH) {
+                        Err old, err;
+                        Rgb qc;
+                        for (int c = 0; c < 3; ++c) {
+                            old[c] = std::clamp(p[c] + errCur[x][c], 0.f, 255.f);
+                            qc[c] = clampByte(old[c]);
+                        }
+                        Rgb nc = nearestPaletteColor(qc, palette);
+                        for (int c = 0; c < 3; ++c) {
+                            p[c] = nc[c];
+                            err[c] = old[c] - nc[c];
+                            errCur[x + 1][c]  += err[c] * (7.f / 16.f);
+                            errNext[x - 1][c] += err[c] * (3.f / 16.f);
+                            errNext[x][c]     += err[c] * (5.f / 16.f);
+                            errNext[x + 1][c] += err[c] * (1.f / 16.f);
+                        }
                     }
-                };
-                distribute(x + 1, y,     7.f / 16.f);
-                distribute(x - 1, y + 1, 3.f / 16.f);
-                distribute(x,     y + 1, 5.f / 16.f);
-                distribute(x + 1, y + 1, 1.f / 16.f);
-            }
-        }
+                    std::swap(errCur, errNext);
+                    std::fill(errNext - 1, errNext + img.width + 1, Err{0.f, 0.f, 0.f});
+                }
+            });
+        });
     } else if (dither == DitherMode::Ordered) {
         // 4x4 ordered (Bayer) dithering
-        static const float bayer[4][4] = {
+        static constexpr float BAYER[4][4] = {
             { 0.f / 16.f,  8.f / 16.f,  2.f / 16.f, 10.f / 16.f},
             {12.f / 16.f,  4.f / 16.f, 14.f / 16.f,  6.f / 16.f},
             { 3.f / 16.f, 11.f / 16.f,  1.f / 16.f,  9.f / 16.f},
             {15.f / 16.f,  7.f / 16.f, 13.f / 16.f,  5.f / 16.f}
         };
         float spread = 255.f / numColors;
-        for (int y = 0; y < img.height; ++y) {
-            for (int x = 0; x < img.width; ++x) {
-                int idx = (y * img.width + x) * img.channels;
-                float threshold = (bayer[y % 4][x % 4] - 0.5f) * spread;
-                std::array<uint8_t, 3> c = {
-                    clampByte(img.data[idx + 0] + threshold),
-                    clampByte(img.data[idx + 1] + threshold),
-                    clampByte(img.data[idx + 2] + threshold)};
-                auto nc = nearestPaletteColor(c, palette);
-                img.data[idx + 0] = nc[0];
-                img.data[idx + 1] = nc[1];
-                img.data[idx + 2] = nc[2];
-            }
-        }
+        float threshold[4][4];
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 4; ++j) threshold[i][j] = (BAYER[i][j] - 0.5f) * spread;
+        PaletteMapper mapper(palette);
+        withChannels(img.channels, [&]<int CH>(IntC<CH>) {
+            sweepBands(img.height, {{&img.data, rowBytes}}, [&](int y0, int y1) {
+                for (int y = y0; y < y1; ++y) {
+                    uint8_t* row = &img.data[pixelIndex(0, y, img.width) * CH];
+                    const float* t = threshold[y % 4];
+                    forEachSpan(visible, y, img.width, [&](int x0, int x1) {
+                        for (int x = x0; x < x1; ++x) {
+                            uint8_t* p = row + static_cast<size_t>(x) * CH;
+                            for (int c = 0; c < 3; ++c) p[c] = clampByte(p[c] + t[x % 4]);
+                        }
+                        mapper.map(row + static_cast<size_t>(x0) * CH, x1 - x0, CH);
+                    });
+                }
+            });
+        });
     } else {
         // No dither – direct mapping
-        for (int i = 0; i < total; ++i) {
-            int idx = i * img.channels;
-            std::array<uint8_t, 3> c = {img.data[idx], img.data[idx + 1], img.data[idx + 2]};
-            auto nc = nearestPaletteColor(c, palette);
-            img.data[idx + 0] = nc[0];
-            img.data[idx + 1] = nc[1];
-            img.data[idx + 2] = nc[2];
-        }
+        PaletteMapper mapper(palette);
+        mapPixels(img, mapper, visible);
     }
 }
 
@@ -210,185 +619,446 @@ void colorQuantize(ImageBuffer& img, int level, DitherMode dither) {
 // 2. Sharpen  (unsharp mask)
 // ---------------------------------------------------------------------------
 
-static ImageBuffer gaussianBlur(const ImageBuffer& src, float radius) {
-    ImageBuffer dst = src;
-    int r = std::max(1, static_cast<int>(std::ceil(radius * 2.f)));
-    // Build 1-D kernel
-    std::vector<float> kernel(2 * r + 1);
+static constexpr int MAX_BLUR_RADIUS = 16;
+
+// Separable Gaussian over one 8-bit plane; `tmp` holds the horizontal pass.
+// The horizontal pass runs `r` rows ahead of the vertical one, and
+// `rowsDone(y0, y1)` is called as soon as rows [y0, y1) of `dst` are final,
+// so the caller may then overwrite those rows of `src`. With tiles, only the
+// spans of `visible` are blurred, from the spans of `reached` (`visible`
+// grown by r) in `tmp`; the rest of `dst` is left unwritten.
+template <typename Fn>
+static void blurPlane(const uint8_t* src, ByteBuffer& dst, ByteBuffer& tmp,
+                      int w, int h, const float* kernel, int r,
+                      const AlphaTiles* visible, const AlphaTiles* reached, Fn&& rowsDone) {
+    SHAKAL_TRACE_SCOPE_PIXELS("blurPlane", static_cast<size_t>(w) * h);
+    const Kernels::Table& kernels = Kernels::table();
+    const int taps = 2 * r + 1;
+    std::array<const uint8_t*, 2 * MAX_BLUR_RADIUS + 1> rows;
+    ScratchArray<float> acc(w);
+    int hDone = 0;
+    sweepBands(h, {{&tmp, static_cast<size_t>(w), r}, {&dst, static_cast<size_t>(w)}},
+               [&](int y0, int y1) {
+        // Horizontal pass: columns whose taps stay inside the row go through
+        // the kernel as shifted views of the row, the edges are clamped here
+        for (int hEnd = std::min(h, y1 + r); hDone < hEnd; ++hDone) {
+            const uint8_t* row = src + pixelIndex(0, hDone, w);
+            uint8_t* out = tmp.data() + pixelIndex(0, hDone, w);
+            auto edge = [&](int x) {
+                float sum = 0.f;
+                for (int k = -r; k <= r; ++k)
+                    sum += row[std::clamp(x + k, 0, w - 1)] * kernel[k + r];
+                out[x] = clampByte(sum);
+            };
+            forEachSpan(reached, hDone, w, [&](int x0, int x1) {
+                int innerBegin = std::max(x0, r), innerEnd = std::min(x1, w - r);
+                if (innerEnd <= innerBegin) {
+                    for (int x = x0; x < x1; ++x) edge(x);
+                    return;
+                }
+                for (int k = 0; k < taps; ++k) rows[k] = row + innerBegin - r + k;
+                kernels.convolveRows(rows.data(), kernel, taps, innerEnd - innerBegin,
+                                     acc.data(), out + innerBegin);
+                for (int x = x0; x < innerBegin; ++x) edge(x);
+                for (int x = innerEnd; x < x1; ++x) edge(x);
+            });
+        }
+        // Vertical pass
+        for (int y = y0; y < y1; ++y) {
+            forEachSpan(visible, y, w, [&](int x0, int x1) {
+                for (int k = -r; k <= r; ++k)
+                    rows[k + r] = tmp.data() + pixelIndex(x0, std::clamp(y + k, 0, h - 1), w);
+                kernels.convolveRows(rows.data(), kernel, taps, x1 - x0, acc.data(),
+                                     dst.data() + pixelIndex(x0, y, w));
+            });
+        }
+        rowsDone(y0, y1);
+    });
+}
+
+struct GaussianKernel {
+    int radius = 0;
+    std::array<float, 2 * MAX_BLUR_RADIUS + 1> taps{};
+};
+
+static GaussianKernel buildSharpenKernel(int level) {
+    float radius = 0.5f + level * 4.5f / 100.f;   // 0.5..5.0
+    GaussianKernel k;
+    k.radius = std::clamp(static_cast<int>(std::ceil(radius * 2.f)), 1, MAX_BLUR_RADIUS);
+    const int r = k.radius;
     float sigma = radius;
     float sum = 0.f;
     for (int i = -r; i <= r; ++i) {
-        kernel[i + r] = std::exp(-(i * i) / (2.f * sigma * sigma));
-        sum += kernel[i + r];
-    }
-    for (auto& k : kernel) k /= sum;
-
-    int w = src.width, h = src.height, ch = src.channels;
-    // Horizontal pass
-    std::vector<uint8_t> tmp(src.data.size());
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            float acc[4] = {0, 0, 0, 0};
-            for (int k = -r; k <= r; ++k) {
-                int sx = std::clamp(x + k, 0, w - 1);
-                const uint8_t* p = &src.data[(y * w + sx) * ch];
-                float wt = kernel[k + r];
-                for (int c = 0; c < ch; ++c) acc[c] += p[c] * wt;
-            }
-            uint8_t* d = &tmp[(y * w + x) * ch];
-            for (int c = 0; c < ch; ++c) d[c] = clampByte(acc[c]);
-        }
+        k.taps[i + r] = std::exp(-(i * i) / (2.f * sigma * sigma));
+        sum += k.taps[i + r];
     }
-    // Vertical pass
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            float acc[4] = {0, 0, 0, 0};
-            for (int k = -r; k <= r; ++k) {
-                int sy = std::clamp(y + k, 0, h - 1);
-                const uint8_t* p = &tmp[(sy * w + x) * ch];
-                float wt = kernel[k + r];
-                for (int c = 0; c < ch; ++c) acc[c] += p[c] * wt;
-            }
-            uint8_t* d = &dst.data[(y * w + x) * ch];
-            for (int c = 0; c < ch; ++c) d[c] = clampByte(acc[c]);
-        }
-    }
-    return dst;
+    for (int i = 0; i < 2 * r + 1; ++i) k.taps[i] /= sum;
+    return k;
+}
+
+// Normalized 1-D kernel for a sharpen level; the slider's 1..100 are
+// tabulated on first use
+static GaussianKernel sharpenKernel(int level) {
+    static const auto table = [] {
+        std::array<GaussianKernel, 101> all;
+        for (int l = 1; l <= 100; ++l) all[l] = buildSharpenKernel(l);
+        return all;
+    }();
+    return (level >= 1 && level <= 100) ? table[level] : buildSharpenKernel(level);
 }
 
-void applySharpen(ImageBuffer& img, int level) {
+void applySharpen(ImageBuffer& img, int level, const AlphaTiles* visible) {
     if (!img.valid() || level <= 0) return;
     float amount = level * 5.f / 100.f;           // 0..5
-    float radius = 0.5f + level * 4.5f / 100.f;   // 0.5..5.0
-
-    auto blurred = gaussianBlur(img, radius);
-    size_t n = img.data.size();
-    for (size_t i = 0; i < n; ++i) {
-        float v = img.data[i] + amount * (static_cast<float>(img.data[i]) - blurred.data[i]);
-        img.data[i] = clampByte(v);
+    const GaussianKernel gauss = sharpenKernel(level);
+    const int r = gauss.radius;
+
+    // Blur plane by plane: contiguous single-channel rows vectorize cleanly,
+    // and alpha (if stored in `data`) is left alone.
+    toPlanar(img);
+    size_t n = img.pixelCount();
+    ByteBuffer blurred(n);
+    ByteBuffer tmp(n);
+    AlphaTiles reached;
+    if (visible) reached = visible->grown(r);
+    for (int c = 0; c < std::min(img.channels, 3); ++c) {
+        uint8_t* p = img.plane(c);
+        blurPlane(p, blurred, tmp, img.width, img.height, gauss.taps.data(), r,
+                  visible, visible ? &reached : nullptr, [&](int y0, int y1) {
+            for (int y = y0; y < y1; ++y) {
+                forEachSpan(visible, y, img.width, [&](int x0, int x1) {
+                    for (size_t i = pixelIndex(x0, y, img.width); i < pixelIndex(x1, y, img.width); ++i) {
+                        float v = p[i] + amount * (static_cast<float>(p[i]) - blurred[i]);
+                        p[i] = clampByte(v);
+                    }
+                });
+            }
+        });
     }
+    toInterleaved(img);
 }
 
 // ---------------------------------------------------------------------------
 // 3. Resolution  (downscale then upscale)
 // ---------------------------------------------------------------------------
 
-void applyResolution(ImageBuffer& img, int resPercent, bool hd8k) {
-    if (!img.valid() || resPercent >= 100 || resPercent <= 0) return;
-
-    int origW = img.width, origH = img.height, ch = img.channels;
-    int newW = std::max(1, origW * resPercent / 100);
-    int newH = std::max(1, origH * resPercent / 100);
-
-    // Downscale with box filter
-    std::vector<uint8_t> small(newW * newH * ch);
-    for (int y = 0; y < newH; ++y) {
-        for (int x = 0; x < newW; ++x) {
-            float x0f = static_cast<float>(x) * origW / newW;
+// Box-downscale `src` to newW x newH; every output column covers the same
+// source columns on every row. Streams top to bottom, dropping source rows
+// it is done with.
+template <int CH>
+static ByteBuffer boxDownscale(const ByteBuffer& src, int origW, int origH, int newW, int newH) {
+    size_t srcRow = static_cast<size_t>(origW) * CH;
+    size_t smallRow = static_cast<size_t>(newW) * CH;
+
+    ByteBuffer small(smallRow * newH);
+    ScratchArray<int32_t> spanX0(newW), spanX1(newW);
+    for (int x = 0; x < newW; ++x) {
+        float x0f = static_cast<float>(x) * origW / newW;
+        float x1f = static_cast<float>(x + 1) * origW / newW;
+        spanX0[x] = static_cast<int>(x0f);
+        spanX1[x] = std::min(static_cast<int>(std::ceil(x1f)), origW);
+    }
+    size_t srcRetired = 0;
+    for (int y0 = 0; y0 < newH; y0 += BAND_ROWS) {
+        int y1 = std::min(newH, y0 + BAND_ROWS);
+        for (int y = y0; y < y1; ++y) {
             float y0f = static_cast<float>(y) * origH / newH;
-            float x1f = static_cast<float>(x + 1) * origW / newW;
             float y1f = static_cast<float>(y + 1) * origH / newH;
-            int ix0 = static_cast<int>(x0f), iy0 = static_cast<int>(y0f);
-            int ix1 = std::min(static_cast<int>(std::ceil(x1f)), origW);
+            int iy0 = static_cast<int>(y0f);
             int iy1 = std::min(static_cast<int>(std::ceil(y1f)), origH);
-            float acc[4] = {0, 0, 0, 0};
-            int count = 0;
-            for (int sy = iy0; sy < iy1; ++sy) {
-                for (int sx = ix0; sx < ix1; ++sx) {
-                    const uint8_t* p = &img.data[(sy * origW + sx) * ch];
-                    for (int c = 0; c < ch; ++c) acc[c] += p[c];
-                    ++count;
+            for (int x = 0; x < newW; ++x) {
+                float acc[CH] = {};
+                int count = 0;
+                for (int sy = iy0; sy < iy1; ++sy) {
+                    const uint8_t* row = &src[pixelIndex(0, sy, origW) * CH];
+                    for (int sx = spanX0[x]; sx < spanX1[x]; ++sx) {
+                        for (int c = 0; c < CH; ++c) acc[c] += row[sx * CH + c];
+                        ++count;
+                    }
+                }
+                uint8_t* d = &small[pixelIndex(x, y, newW) * CH];
+                if (count > 0) {
+                    for (int c = 0; c < CH; ++c) d[c] = clampByte(acc[c] / count);
                 }
-            }
-            uint8_t* d = &small[(y * newW + x) * ch];
-            if (count > 0) {
-                for (int c = 0; c < ch; ++c) d[c] = clampByte(acc[c] / count);
             }
         }
+        // Rows above the next band's first source row are done
+        size_t next = static_cast<size_t>(static_cast<float>(y1) * origH / newH);
+        if (next > srcRetired) {
+            src.discard(srcRetired * srcRow, (next - srcRetired) * srcRow);
+            srcRetired = next;
+        }
     }
+    return small;
+}
 
-    // Upscale back to original size
-    std::vector<uint8_t> result(origW * origH * ch);
-    if (hd8k) {
-        // Nearest neighbor
-        for (int y = 0; y < origH; ++y) {
-            for (int x = 0; x < origW; ++x) {
-                int sx = x * newW / origW;
-                int sy = y * newH / origH;
-                sx = std::clamp(sx, 0, newW - 1);
-                sy = std::clamp(sy, 0, newH - 1);
-                const uint8_t* p = &small[(sy * newW + sx) * ch];
-                uint8_t* d = &result[(y * origW + x) * ch];
-                std::memcpy(d, p, ch);
-            }
+// Box-downscale `src` to newW x newH, then scale back up to the original size
+template <int CH, bool NEAREST>
+static ByteBuffer resampleDownUp(const ByteBuffer& src, int origW, int origH, int newW, int newH) {
+    size_t srcRow = static_cast<size_t>(origW) * CH;
+    size_t smallRow = static_cast<size_t>(newW) * CH;
+    ByteBuffer small = boxDownscale<CH>(src, origW, origH, newW, newH);
+
+    // Upscale back to original size; each band reads small rows around
+    // y * newH / origH, so everything two rows above that can go.
+    // Source columns (and bilinear weights) are the same for every row.
+    ByteBuffer result(srcRow * origH);
+    size_t smallRetired = 0;
+    const Kernels::Table& kernels = Kernels::table();
+    ScratchArray<int32_t> colX0(origW), colX1(NEAREST ? 0 : origW);
+    ScratchArray<float> colXf(NEAREST ? 0 : origW);
+    for (int x = 0; x < origW; ++x) {
+        if constexpr (NEAREST) {
+            int sx = static_cast<int>(static_cast<int64_t>(x) * newW / origW);
+            colX0[x] = std::clamp(sx, 0, newW - 1);
+        } else {
+            float fx = (x + 0.5f) * newW / origW - 0.5f;
+            int x0 = static_cast<int>(std::floor(fx));
+            colXf[x] = fx - x0;
+            colX1[x] = std::min(x0 + 1, newW - 1);
+            colX0[x] = std::max(x0, 0);
         }
-    } else {
-        // Bilinear
-        for (int y = 0; y < origH; ++y) {
-            for (int x = 0; x < origW; ++x) {
-                float fx = (x + 0.5f) * newW / origW - 0.5f;
+    }
+    sweepBands(origH, {{&result, srcRow}}, [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            uint8_t* d = &result[pixelIndex(0, y, origW) * CH];
+            if constexpr (NEAREST) {
+                int sy = static_cast<int>(static_cast<int64_t>(y) * newH / origH);
+                const uint8_t* row = &small[pixelIndex(0, std::clamp(sy, 0, newH - 1), newW) * CH];
+                for (int x = 0; x < origW; ++x)
+                    std::memcpy(d + x * CH, row + colX0[x] * CH, CH);
+            } else {
                 float fy = (y + 0.5f) * newH / origH - 0.5f;
-                int x0 = static_cast<int>(std::floor(fx));
-                int y0 = static_cast<int>(std::floor(fy));
-                float xf = fx - x0;
-                float yf = fy - y0;
-                int x1 = std::min(x0 + 1, newW - 1);
-                int y1 = std::min(y0 + 1, newH - 1);
-                x0 = std::max(x0, 0);
-                y0 = std::max(y0, 0);
-                const uint8_t* p00 = &small[(y0 * newW + x0) * ch];
-                const uint8_t* p10 = &small[(y0 * newW + x1) * ch];
-                const uint8_t* p01 = &small[(y1 * newW + x0) * ch];
-                const uint8_t* p11 = &small[(y1 * newW + x1) * ch];
-                uint8_t* d = &result[(y * origW + x) * ch];
-                for (int c = 0; c < ch; ++c) {
-                    float top = p00[c] * (1 - xf) + p10[c] * xf;
-                    float bot = p01[c] * (1 - xf) + p11[c] * xf;
-                    d[c] = clampByte(top * (1 - yf) + bot * yf);
-                }
+                int yy0 = static_cast<int>(std::floor(fy));
+                float yf = fy - yy0;
+                int yy1 = std::min(yy0 + 1, newH - 1);
+                yy0 = std::max(yy0, 0);
+                kernels.bilinearRow(&small[pixelIndex(0, yy0, newW) * CH],
+                                    &small[pixelIndex(0, yy1, newW) * CH],
+                                    colX0.data(), colX1.data(), colXf.data(), yf, origW, CH, d);
             }
         }
+        int64_t keep = static_cast<int64_t>(y1) * newH / origH - 2;
+        if (keep > static_cast<int64_t>(smallRetired)) {
+            small.discard(smallRetired * smallRow, (keep - smallRetired) * smallRow);
+            smallRetired = static_cast<size_t>(keep);
+        }
+    });
+    return result;
+}
+
+static ByteBuffer resampleDownUp(const ByteBuffer& src, int origW, int origH, int ch,
+                                 int newW, int newH, bool hd8k) {
+    return withChannels(ch, [&]<int CH>(IntC<CH>) {
+        return withFlag(hd8k, [&]<bool NEAREST>(BoolC<NEAREST>) {
+            return resampleDownUp<CH, NEAREST>(src, origW, origH, newW, newH);
+        });
+    });
+}
+
+void applyResolution(ImageBuffer& img, int resPercent, bool hd8k) {
+    if (!img.valid() || resPercent >= 100 || resPercent <= 0) return;
+    toInterleaved(img);
+
+    int origW = img.width, origH = img.height;
+    int newW = std::max(1, static_cast<int>(static_cast<int64_t>(origW) * resPercent / 100));
+    int newH = std::max(1, static_cast<int>(static_cast<int64_t>(origH) * resPercent / 100));
+
+    img.data = resampleDownUp(img.data, origW, origH, img.channels, newW, newH, hd8k);
+    if (!img.alpha.empty())
+        img.alpha = resampleDownUp(img.alpha, origW, origH, 1, newW, newH, hd8k);
+}
+
+ImageBuffer downscale(const ImageBuffer& img, int newW, int newH) {
+    ImageBuffer out;
+    if (!img.valid()) return out;
+    newW = std::clamp(newW, 1, img.width);
+    newH = std::clamp(newH, 1, img.height);
+    const ImageBuffer* src = &img;
+    ImageBuffer packed;
+    if (img.layout != PixelLayout::Interleaved) {
+        packed = img;
+        toInterleaved(packed);
+        src = &packed;
     }
-    img.data = std::move(result);
+    out.width = newW;
+    out.height = newH;
+    out.channels = src->channels;
+    out.data = withChannels(src->channels, [&]<int CH>(IntC<CH>) {
+        return boxDownscale<CH>(src->data, src->width, src->height, newW, newH);
+    });
+    if (!src->alpha.empty())
+        out.alpha = boxDownscale<1>(src->alpha, src->width, src->height, newW, newH);
+    return out;
 }
 
 // ---------------------------------------------------------------------------
 // 4. JPEG Compression artifact simulation
 // ---------------------------------------------------------------------------
 
+// Growable output buffer for stb's write callback
+struct JpegSink {
+    ByteBuffer buf;
+    size_t used = 0;
+};
+
 static void jpegWriteCallback(void* context, void* data, int size) {
-    auto* buf = static_cast<std::vector<uint8_t>*>(context);
-    auto* bytes = static_cast<const uint8_t*>(data);
-    buf->insert(buf->end(), bytes, bytes + size);
+    auto* sink = static_cast<JpegSink*>(context);
+    if (sink->used + size > sink->buf.size())
+        sink->buf.resize(std::max(sink->used + size, sink->buf.size() * 2));
+    std::memcpy(sink->buf.data() + sink->used, data, size);
+    sink->used += size;
+}
+
+// One encode/decode round trip of packed RGB; returns the decoder's output
+// (allocated through the pool shim) or nullptr on failure
+static uint8_t* jpegRoundTrip(const uint8_t* rgb, int w, int h, int quality, JpegSink& sink) {
+    sink.used = 0;
+    stbi_write_jpg_to_func(jpegWriteCallback, &sink, w, h, 3, rgb, quality);
+    int dw, dh, dch;
+    return stbi_load_from_memory(sink.buf.data(), static_cast<int>(sink.used), &dw, &dh, &dch, 3);
 }
 
-void applyJpegCompression(ImageBuffer& img, int quality, int iterations) {
+// JPEG caps dimensions at 65535 and stb_image caps a decode at 2 GB, so huge
+// or spilled frames are compressed in tiles instead. Tiles sit on the 16 px
+// MCU grid and carry 16 px of context per side and iteration: blocks are
+// coded independently and chroma upsampling reaches one MCU further per
+// round trip, so every tile core decodes exactly as the whole frame would.
+static constexpr int JPEG_MAX_DIMENSION = 65535;
+static constexpr int JPEG_TILE_WIDTH = 16384;
+static constexpr size_t JPEG_TILE_BYTES = size_t(48) << 20;
+
+static void jpegCompressTiled(ImageBuffer& img, int quality, int iterations) {
+    int w = img.width, h = img.height, ch = img.channels;
+    int context = 16 * iterations;
+    int coreW = (w + 2 * context <= JPEG_MAX_DIMENSION) ? w : JPEG_TILE_WIDTH;
+    size_t tileRow = static_cast<size_t>(std::min(w, coreW + 2 * context)) * 3;
+    int coreH = static_cast<int>(std::clamp<size_t>(JPEG_TILE_BYTES / tileRow, 16, 4096)) / 16 * 16;
+
+    size_t srcRow = static_cast<size_t>(w) * ch;
+    size_t outRow = static_cast<size_t>(w) * 3;
+    ByteBuffer out(outRow * h);
+    ByteBuffer tile;
+    JpegSink sink;
+
+    for (int ty0 = 0; ty0 < h; ty0 += coreH) {
+        int ty1 = std::min(h, ty0 + coreH);
+        int sy0 = std::max(0, ty0 - context), sy1 = std::min(h, ty1 + context);
+        for (int tx0 = 0; tx0 < w; tx0 += coreW) {
+            int tx1 = std::min(w, tx0 + coreW);
+            int sx0 = std::max(0, tx0 - context), sx1 = std::min(w, tx1 + context);
+            int tw = sx1 - sx0, th = sy1 - sy0;
+
+            tile.resize(static_cast<size_t>(tw) * th * 3);
+            for (int y = 0; y < th; ++y) {
+                const uint8_t* s = &img.data[pixelIndex(sx0, sy0 + y, w) * ch];
+                uint8_t* d = &tile[pixelIndex(0, y, tw) * 3];
+                for (int x = 0; x < tw; ++x)
+                    std::memcpy(d + x * 3, s + static_cast<size_t>(x) * ch, 3);
+            }
+            if (sink.buf.size() < tile.size() + 1024) sink.buf.resize(tile.size() + 1024);
+
+            bool ok = true;
+            for (int iter = 0; iter < iterations && ok; ++iter) {
+                SHAKAL_TRACE_SCOPE_PIXELS("jpegIteration", static_cast<size_t>(tw) * th);
+                uint8_t* decoded = jpegRoundTrip(tile.data(), tw, th, quality, sink);
+                ok = decoded != nullptr;
+                if (ok) std::memcpy(tile.data(), decoded, tile.size());
+                stbi_image_free(decoded);
+            }
+
+            for (int y = ty0; y < ty1; ++y)
+                std::memcpy(&out[pixelIndex(tx0, y, w) * 3],
+                            &tile[pixelIndex(tx0 - sx0, y - sy0, tw) * 3],
+                            static_cast<size_t>(tx1 - tx0) * 3);
+        }
+        // The next tile row reads source rows from ty1 - context on
+        int doneRows = std::max(0, ty1 - context);
+        img.data.discard(0, doneRows * srcRow);
+        out.discard(0, ty1 * outRow);
+    }
+
+    if (ch == 3) {
+        img.data = std::move(out);
+        return;
+    }
+    // RGBA: alpha stays unchanged
+    sweepBands(h, {{&img.data, srcRow}, {&out, outRow}}, [&](int y0, int y1) {
+        for (size_t i = pixelIndex(0, y0, w); i < pixelIndex(0, y1, w); ++i)
+            std::memcpy(&img.data[i * ch], &out[i * 3], 3);
+    });
+}
+
+void applyJpegCompression(ImageBuffer& img, int quality, int iterations,
+                          const AlphaTiles* visible) {
     if (!img.valid() || quality <= 0 || quality >= 100) return;
     quality = std::clamp(quality, 1, 99);
+    toInterleaved(img);
+
+    // Only the box around the visible tiles goes through the codec, with the
+    // same context per side and iteration as a tile of jpegCompressTiled and
+    // its corner on the MCU grid, so the box decodes exactly as the whole
+    // frame would. Just the box is copied back.
+    static_assert(AlphaTiles::TILE % 16 == 0, "visible boxes must sit on the MCU grid");
+    int bx0, by0, bx1, by1;
+    if (visible && !visible->bounds(bx0, by0, bx1, by1)) return;
+    const int context = 16 * iterations;
+    if (visible && (bx1 - bx0 < img.width || by1 - by0 < img.height)) {
+        const int sx0 = std::max(0, bx0 - context), sx1 = std::min(img.width, bx1 + context);
+        const int sy0 = std::max(0, by0 - context), sy1 = std::min(img.height, by1 + context);
+        ImageBuffer crop;
+        crop.width = sx1 - sx0;
+        crop.height = sy1 - sy0;
+        crop.channels = img.channels;
+        const size_t cropRow = static_cast<size_t>(crop.width) * img.channels;
+        crop.data = ByteBuffer(cropRow * crop.height);
+        for (int y = sy0; y < sy1; ++y)
+            std::memcpy(&crop.data[(y - sy0) * cropRow], pixelAt(img, sx0, y), cropRow);
+        applyJpegCompression(crop, quality, iterations);
+        const size_t boxRow = static_cast<size_t>(bx1 - bx0) * img.channels;
+        for (int y = by0; y < by1; ++y)
+            std::memcpy(pixelAt(img, bx0, y), pixelAt(crop, bx0 - sx0, y - sy0), boxRow);
+        return;
+    }
+
+    size_t total = img.pixelCount();
+    if (img.data.spilled() || img.width > JPEG_MAX_DIMENSION || img.height > JPEG_MAX_DIMENSION ||
+        total * 3 > static_cast<size_t>(INT_MAX)) {
+        if (iterations > 0) jpegCompressTiled(img, quality, iterations);
+        return;
+    }
+
+    bool packed = img.channels == 3;
+    ByteBuffer rgb;
+    if (!packed) rgb = ByteBuffer(total * 3);
+    JpegSink sink;
+    sink.buf.resize(total * 3 + 1024);
 
     for (int iter = 0; iter < iterations; ++iter) {
-        // Encode to JPEG in memory (RGB, 3 channels)
-        // Convert RGBA -> RGB for JPEG
-        std::vector<uint8_t> rgb(img.width * img.height * 3);
-        for (int i = 0; i < img.width * img.height; ++i) {
-            rgb[i * 3 + 0] = img.data[i * img.channels + 0];
-            rgb[i * 3 + 1] = img.data[i * img.channels + 1];
-            rgb[i * 3 + 2] = img.data[i * img.channels + 2];
+        SHAKAL_TRACE_SCOPE_PIXELS("jpegIteration", total);
+        // Encode to JPEG in memory (RGB, 3 channels). Packed RGB feeds the
+        // encoder directly; RGBA is repacked first.
+        if (!packed) {
+            for (size_t i = 0; i < total; ++i) {
+                rgb[i * 3 + 0] = img.data[i * img.channels + 0];
+                rgb[i * 3 + 1] = img.data[i * img.channels + 1];
+                rgb[i * 3 + 2] = img.data[i * img.channels + 2];
+            }
         }
 
-        std::vector<uint8_t> jpegBuf;
-        jpegBuf.reserve(img.width * img.height * 3);
-        stbi_write_jpg_to_func(jpegWriteCallback, &jpegBuf,
-                               img.width, img.height, 3, rgb.data(), quality);
-
-        // Decode back
-        int w, h, ch;
-        uint8_t* decoded = stbi_load_from_memory(
-            jpegBuf.data(), static_cast<int>(jpegBuf.size()), &w, &h, &ch, 3);
+        // Encode and decode back
+        uint8_t* decoded = jpegRoundTrip(packed ? img.data.data() : rgb.data(),
+                                         img.width, img.height, quality, sink);
         if (!decoded) break;
 
+        if (packed) {
+            // The decoder's RGB output becomes the image as-is
+            img.data = ByteBuffer::adoptRaw(decoded, total * 3);
+            continue;
+        }
+
         // Copy back to RGBA buffer
-        for (int i = 0; i < w * h; ++i) {
+        for (size_t i = 0; i < total; ++i) {
             img.data[i * img.channels + 0] = decoded[i * 3 + 0];
             img.data[i * img.channels + 1] = decoded[i * 3 + 1];
             img.data[i * img.channels + 2] = decoded[i * 3 + 2];
@@ -402,62 +1072,63 @@ void applyJpegCompression(ImageBuffer& img, int quality, int iterations) {
 // 5. Noise
 // ---------------------------------------------------------------------------
 
-void applyNoise(ImageBuffer& img, int intensity, NoiseType type, bool perChannel) {
+void applyNoise(ImageBuffer& img, int intensity, NoiseType type, bool perChannel, int seed) {
     if (!img.valid() || intensity <= 0) return;
+    toInterleaved(img);
     float strength = intensity / 100.f;
-    std::mt19937 rng(42);
+    std::mt19937 rng(seed);
     std::normal_distribution<float> gaussDist(0.f, 1.f);
     std::uniform_real_distribution<float> uniformDist(0.f, 1.f);
 
-    int w = img.width, h = img.height, ch = img.channels;
+    int w = img.width, h = img.height;
+    size_t rowBytes = static_cast<size_t>(w) * img.channels;
+    const Kernels::Table& kernels = Kernels::table();
 
+    // The generator runs in row-major order across bands, so banded and
+    // whole-frame runs draw the same sequence
     if (type == NoiseType::Gaussian) {
-        for (int y = 0; y < h; ++y) {
-            for (int x = 0; x < w; ++x) {
-                uint8_t* p = pixelAt(img, x, y);
-                if (perChannel) {
-                    for (int c = 0; c < 3; ++c) {
-                        float noise = gaussDist(rng) * strength * 128.f;
-                        p[c] = clampByte(static_cast<int>(p[c]) + static_cast<int>(noise));
-                    }
-                } else {
-                    float noise = gaussDist(rng) * strength * 128.f;
-                    for (int c = 0; c < 3; ++c)
-                        p[c] = clampByte(static_cast<int>(p[c]) + static_cast<int>(noise));
-                }
+        // Draw a row of offsets, then add them in one pass
+        const int perPixel = perChannel ? 3 : 1;
+        ScratchArray<int32_t> offsets(static_cast<size_t>(w) * perPixel);
+        sweepBands(h, {{&img.data, rowBytes}}, [&](int y0, int y1) {
+            for (int y = y0; y < y1; ++y) {
+                for (int32_t& o : offsets)
+                    o = static_cast<int>(gaussDist(rng) * strength * 128.f);
+                kernels.addOffsets(pixelAt(img, 0, y), w, img.channels, offsets.data(), perPixel);
             }
-        }
+        });
     } else if (type == NoiseType::SaltPepper) {
         float prob = strength * 0.5f;
-        for (int y = 0; y < h; ++y) {
-            for (int x = 0; x < w; ++x) {
-                float r = uniformDist(rng);
-                if (r < prob) {
-                    uint8_t* p = pixelAt(img, x, y);
-                    uint8_t val = (uniformDist(rng) < 0.5f) ? 0 : 255;
-                    p[0] = p[1] = p[2] = val;
+        sweepBands(h, {{&img.data, rowBytes}}, [&](int y0, int y1) {
+            for (int y = y0; y < y1; ++y) {
+                for (int x = 0; x < w; ++x) {
+                    float r = uniformDist(rng);
+                    if (r < prob) {
+                        uint8_t* p = pixelAt(img, x, y);
+                        uint8_t val = (uniformDist(rng) < 0.5f) ? 0 : 255;
+                        p[0] = p[1] = p[2] = val;
+                    }
                 }
             }
-        }
+        });
     } else if (type == NoiseType::DigitalBanding) {
         // Horizontal banding artifacts
         int bandHeight = std::max(1, h / std::max(1, static_cast<int>(10 * strength)));
-        for (int y = 0; y < h; ++y) {
-            int bandIdx = y / bandHeight;
-            float bandNoise = gaussDist(rng) * strength * 40.f;
-            // Only apply noise once per band
-            if (y % bandHeight != 0) {
-                // Reuse previous band noise – re-seed to be deterministic
-                std::mt19937 bandRng(42 + bandIdx);
-                std::normal_distribution<float> bd(0.f, 1.f);
-                bandNoise = bd(bandRng) * strength * 40.f;
-            }
-            for (int x = 0; x < w; ++x) {
-                uint8_t* p = pixelAt(img, x, y);
-                for (int c = 0; c < 3; ++c)
-                    p[c] = clampByte(static_cast<int>(p[c]) + static_cast<int>(bandNoise));
+        sweepBands(h, {{&img.data, rowBytes}}, [&](int y0, int y1) {
+            for (int y = y0; y < y1; ++y) {
+                int bandIdx = y / bandHeight;
+                float bandNoise = gaussDist(rng) * strength * 40.f;
+                // Only apply noise once per band
+                if (y % bandHeight != 0) {
+                    // Reuse previous band noise – re-seed to be deterministic
+                    std::mt19937 bandRng(seed + bandIdx);
+                    std::normal_distribution<float> bd(0.f, 1.f);
+                    bandNoise = bd(bandRng) * strength * 40.f;
+                }
+                int32_t offset = static_cast<int>(bandNoise);
+                kernels.addOffsets(pixelAt(img, 0, y), w, img.channels, &offset, 0);
             }
-        }
+        });
     }
 }
 
@@ -465,63 +1136,221 @@ void applyNoise(ImageBuffer& img, int intensity, NoiseType type, bool perChannel
 // 6. RGB Shift
 // ---------------------------------------------------------------------------
 
-void applyRGBShift(ImageBuffer& img, int amount, bool shiftX, bool shiftY) {
-    if (!img.valid() || amount <= 0) return;
+void applyRGBShift(ImageBuffer& img, int amount, bool shiftX, bool shiftY,
+                   const RgbShiftOffsets& offsets) {
+    bool moved = false;
+    for (const auto& o : offsets) moved |= o[0] != 0.f || o[1] != 0.f;
+    if (!img.valid() || (amount <= 0 && !moved)) return;
+    toInterleaved(img);
 
     int w = img.width, h = img.height, ch = img.channels;
-    std::vector<uint8_t> orig(img.data);
-
-    auto sampleChannel = [&](int x, int y, int c) -> uint8_t {
-        x = std::clamp(x, 0, w - 1);
-        y = std::clamp(y, 0, h - 1);
-        return orig[(y * w + x) * ch + c];
-    };
+    size_t rowBytes = static_cast<size_t>(w) * ch;
+
+    // Where channel c of pixel (x, y) reads from: R shifted +, G stays at its
+    // original position, B shifted -, then each channel moved by its offset.
+    // Whole-pixel reads copy, fractional ones blend the neighbours. Anything
+    // a full image or more away reads the edge anyway, so the reach is
+    // clamped to that before it becomes an int; non-finite offsets count as 0.
+    auto finite = [](float v) { return std::isfinite(v) ? v : 0.f; };
+    const float base[3] = {static_cast<float>(std::max(amount, 0)), 0.f,
+                           -static_cast<float>(std::max(amount, 0))};
+    int dx[3], dy[3];
+    float fx[3], fy[3];
+    bool whole = true;
+    int above = 0;
+    for (int c = 0; c < 3; ++c) {
+        float rx = std::clamp((shiftX ? base[c] : 0.f) - finite(offsets[c][0]),
+                              static_cast<float>(-w), static_cast<float>(w));
+        float ry = std::clamp((shiftY ? base[c] : 0.f) - finite(offsets[c][1]),
+                              static_cast<float>(-h), static_cast<float>(h));
+        dx[c] = static_cast<int>(std::floor(rx));
+        dy[c] = static_cast<int>(std::floor(ry));
+        fx[c] = rx - dx[c];
+        fy[c] = ry - dy[c];
+        whole &= fx[c] == 0.f && fy[c] == 0.f;
+        above = std::max(above, -dy[c]);
+    }
 
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            uint8_t* p = pixelAt(img, x, y);
-            int dxR = shiftX ? amount : 0;
-            int dyR = shiftY ? amount : 0;
-            int dxB = shiftX ? -amount : 0;
-            int dyB = shiftY ? -amount : 0;
-            p[0] = sampleChannel(x + dxR, y + dyR, 0);  // R shifted +
-            // G stays at original position
-            p[1] = sampleChannel(x, y, 1);
-            p[2] = sampleChannel(x + dxB, y + dyB, 2);  // B shifted -
+    // Rows are rewritten in place top to bottom. Rows below are still
+    // original; the current row and the ones above that are still read are
+    // kept in a ring, so only that much look-behind is copied.
+    int ringRows = std::min(above, h - 1) + 1;
+    ByteBuffer ring(rowBytes * ringRows);
+    const Kernels::Table& kernels = Kernels::table();
+    sweepBands(h, {{&img.data, rowBytes}}, [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            auto source = [&](int r) -> const uint8_t* {
+                r = std::clamp(r, 0, h - 1);
+                return r <= y ? &ring[(r % ringRows) * rowBytes] : pixelAt(img, 0, r);
+            };
+            uint8_t* out = pixelAt(img, 0, y);
+            std::memcpy(&ring[(y % ringRows) * rowBytes], out, rowBytes);
+            if (whole) {
+                const uint8_t* rows[3] = {source(y + dy[0]), source(y + dy[1]), source(y + dy[2])};
+                kernels.shiftChannels(rows, dx, w, ch, out);
+            } else {
+                for (int c = 0; c < 3; ++c)
+                    kernels.lerpChannel(source(y + dy[c]), source(y + dy[c] + 1), dx[c], fx[c],
+                                        fy[c], w, ch, c, out);
+            }
         }
-    }
+    });
 }
 
 // ---------------------------------------------------------------------------
 // 7. Glitch
 // ---------------------------------------------------------------------------
 
-void applyGlitch(ImageBuffer& img, int bands, int amplitude, int seed) {
+// Glitches touch only the rows their bands cover, so they work on row spans
+// in place: cost follows the glitched area, not the image size.
+
+// Rows saved the first time a glitch writes them, so spans that read them
+// later still see the original pixels
+class RowBackup {
+public:
+    RowBackup(const ImageBuffer& img, int maxRows)
+        : m_img(img),
+          m_rowBytes(static_cast<size_t>(img.width) * img.channels),
+          m_slot(img.height, -1),
+          m_data(m_rowBytes * maxRows),
+          m_alpha(img.alpha.empty() ? 0 : static_cast<size_t>(img.width) * maxRows) {}
+
+    // Call before writing row y
+    void touch(int y) {
+        if (m_slot[y] >= 0) return;
+        m_slot[y] = m_used++;
+        std::memcpy(&m_data[m_slot[y] * m_rowBytes], &m_img.data[y * m_rowBytes], m_rowBytes);
+        if (!m_alpha.empty())
+            std::memcpy(&m_alpha[m_slot[y] * size_t(m_img.width)],
+                        &m_img.alpha[y * size_t(m_img.width)], m_img.width);
+    }
+
+    const uint8_t* data(int y) const {
+        return m_slot[y] >= 0 ? &m_data[m_slot[y] * m_rowBytes] : &m_img.data[y * m_rowBytes];
+    }
+    const uint8_t* alpha(int y) const {
+        size_t w = m_img.width;
+        return m_slot[y] >= 0 ? &m_alpha[m_slot[y] * w] : &m_img.alpha[y * w];
+    }
+
+private:
+    const ImageBuffer& m_img;
+    size_t m_rowBytes;
+    ScratchArray<int32_t> m_slot;
+    ByteBuffer m_data;
+    ByteBuffer m_alpha;
+    int32_t m_used = 0;
+};
+
+// Channel c of one row moved right by `shift` in place, edges repeating.
+// Walking against the shift reads every pixel before it is overwritten.
+template <int CH>
+static void shiftChannelInPlace(uint8_t* row, int w, int c, int shift) {
+    if (shift > 0) {
+        for (int x = w - 1; x >= 0; --x) row[x * CH + c] = row[std::max(x - shift, 0) * CH + c];
+    } else {
+        for (int x = 0; x < w; ++x) row[x * CH + c] = row[std::min(x - shift, w - 1) * CH + c];
+    }
+}
+
+void applyGlitch(ImageBuffer& img, int bands, int amplitude, int seed, GlitchMode mode) {
     if (!img.valid() || bands <= 0 || amplitude <= 0) return;
+    toInterleaved(img);
 
     int w = img.width, h = img.height, ch = img.channels;
     std::mt19937 rng(seed);
     std::uniform_int_distribution<int> yDist(0, h - 1);
     std::uniform_int_distribution<int> hDist(1, std::max(1, h / 10));
     std::uniform_int_distribution<int> shiftDist(-amplitude, amplitude);
-
-    std::vector<uint8_t> orig(img.data);
-
-    for (int b = 0; b < bands; ++b) {
-        int bandY = yDist(rng);
-        int bandH = hDist(rng);
-        int shift = shiftDist(rng);
-        if (shift == 0) continue;
-
-        for (int y = bandY; y < std::min(bandY + bandH, h); ++y) {
-            for (int x = 0; x < w; ++x) {
-                int sx = x - shift;
-                sx = std::clamp(sx, 0, w - 1);
-                uint8_t* dst = &img.data[(y * w + x) * ch];
-                const uint8_t* src = &orig[(y * w + sx) * ch];
-                std::memcpy(dst, src, ch);
+    bool hasAlpha = !img.alpha.empty();
+    size_t rowBytes = static_cast<size_t>(w) * ch;
+
+    switch (mode) {
+    case GlitchMode::Rows: {
+        // Every band row is the original row moved sideways, and the last band
+        // over a row decides its shift: one in-place move per row
+        ScratchArray<int32_t> rowShift(h, 0);
+        for (int b = 0; b < bands; ++b) {
+            int bandY = yDist(rng);
+            int bandH = hDist(rng);
+            int shift = shiftDist(rng);
+            if (shift == 0) continue;
+            for (int y = bandY; y < std::min(bandY + bandH, h); ++y) rowShift[y] = shift;
+        }
+        withChannels(ch, [&]<int CH>(IntC<CH>) {
+            for (int y = 0; y < h; ++y) {
+                if (rowShift[y] == 0) continue;
+                uint8_t* row = &img.data[y * rowBytes];
+                shiftRowClamped<CH>(row, row, w, rowShift[y]);
+                if (hasAlpha) {
+                    uint8_t* a = &img.alpha[y * size_t(w)];
+                    shiftRowClamped<1>(a, a, w, rowShift[y]);
+                }
             }
+        });
+        break;
+    }
+    case GlitchMode::Blocks: {
+        // Rectangles copied from elsewhere in the original image
+        struct Block { int x, y, bw, bh, dx, dy; };
+        std::uniform_int_distribution<int> xDist(0, w - 1);
+        std::uniform_int_distribution<int> wDist(1, std::max(1, w / 4));
+        std::uniform_int_distribution<int> dyDist(-amplitude / 4, amplitude / 4);
+        ScratchArray<Block> blocks(bands);     // at most one per band
+        int blockCount = 0;
+        ScratchArray<uint8_t> written(h, 0);
+        int writtenRows = 0;
+        for (int b = 0; b < bands; ++b) {
+            Block k;
+            k.y = yDist(rng);
+            k.bh = hDist(rng);
+            k.dx = shiftDist(rng);
+            k.x = xDist(rng);
+            k.bw = wDist(rng);
+            k.dy = dyDist(rng);
+            if (k.dx == 0 && k.dy == 0) continue;
+            k.bh = std::min(k.bh, h - k.y);
+            k.bw = std::min(k.bw, w - k.x);
+            for (int y = k.y; y < k.y + k.bh; ++y) {
+                if (!written[y]) ++writtenRows;
+                written[y] = 1;
+            }
+            blocks[blockCount++] = k;
         }
+        RowBackup backup(img, writtenRows);
+        withChannels(ch, [&]<int CH>(IntC<CH>) {
+            for (int i = 0; i < blockCount; ++i) {
+                const Block& k = blocks[i];
+                for (int y = k.y; y < k.y + k.bh; ++y) {
+                    backup.touch(y);
+                    int sy = std::clamp(y - k.dy, 0, h - 1);
+                    shiftSpanClamped<CH>(backup.data(sy), &img.data[y * rowBytes], w,
+                                         k.x, k.x + k.bw, k.dx);
+                    if (hasAlpha)
+                        shiftSpanClamped<1>(backup.alpha(sy), &img.alpha[y * size_t(w)], w,
+                                            k.x, k.x + k.bw, k.dx);
+                }
+            }
+        });
+        break;
+    }
+    case GlitchMode::ChannelSlice: {
+        // One colour channel of a band slides sideways; bands over the same
+        // rows add up
+        std::uniform_int_distribution<int> cDist(0, std::min(ch, 3) - 1);
+        withChannels(ch, [&]<int CH>(IntC<CH>) {
+            for (int b = 0; b < bands; ++b) {
+                int bandY = yDist(rng);
+                int bandH = hDist(rng);
+                int shift = shiftDist(rng);
+                int c = cDist(rng);
+                if (shift == 0) continue;
+                for (int y = bandY; y < std::min(bandY + bandH, h); ++y)
+                    shiftChannelInPlace<CH>(&img.data[y * rowBytes], w, c, shift);
+            }
+        });
+        break;
+    }
     }
 }
 
@@ -529,55 +1358,51 @@ void applyGlitch(ImageBuffer& img, int bands, int amplitude, int seed) {
 // 8. Palette
 // ---------------------------------------------------------------------------
 
-static std::vector<std::array<uint8_t, 3>> getPalette(PalettePreset preset) {
+static std::span<const Rgb> getPalette(PalettePreset preset) {
+    static const Rgb gameBoy[] = {{15,56,15}, {48,98,48}, {139,172,15}, {155,188,15}};
+    // Simplified 16-color NES palette
+    static const Rgb nes[] = {
+        {0,0,0},       {0,0,170},     {0,170,0},     {0,170,170},
+        {170,0,0},     {170,0,170},   {170,85,0},    {170,170,170},
+        {85,85,85},    {85,85,255},   {85,255,85},   {85,255,255},
+        {255,85,85},   {255,85,255},  {255,255,85},  {255,255,255}
+    };
+    static const Rgb windows98[] = {
+        {0,0,0},       {128,0,0},     {0,128,0},     {128,128,0},
+        {0,0,128},     {128,0,128},   {0,128,128},   {192,192,192},
+        {128,128,128}, {255,0,0},     {0,255,0},     {255,255,0},
+        {0,0,255},     {255,0,255},   {0,255,255},   {255,255,255}
+    };
+    static const Rgb thermal[] = {
+        {0,0,32},      {0,0,64},      {0,0,128},     {0,0,192},
+        {0,64,192},    {0,128,192},   {0,192,128},   {0,255,64},
+        {64,255,0},    {128,255,0},   {192,255,0},   {255,255,0},
+        {255,192,0},   {255,128,0},   {255,64,0},    {255,0,0}
+    };
+    static const Rgb monoGreen[] = {{0,32,0}, {0,85,0}, {0,170,0}, {0,255,0}};
+
     switch (preset) {
-    case PalettePreset::GameBoy:
-        return {{15,56,15}, {48,98,48}, {139,172,15}, {155,188,15}};
-    case PalettePreset::NES:
-        // Simplified 16-color NES palette
-        return {
-            {0,0,0},       {0,0,170},     {0,170,0},     {0,170,170},
-            {170,0,0},     {170,0,170},   {170,85,0},    {170,170,170},
-            {85,85,85},    {85,85,255},   {85,255,85},   {85,255,255},
-            {255,85,85},   {255,85,255},  {255,255,85},  {255,255,255}
-        };
-    case PalettePreset::Windows98:
-        return {
-            {0,0,0},       {128,0,0},     {0,128,0},     {128,128,0},
-            {0,0,128},     {128,0,128},   {0,128,128},   {192,192,192},
-            {128,128,128}, {255,0,0},     {0,255,0},     {255,255,0},
-            {0,0,255},     {255,0,255},   {0,255,255},   {255,255,255}
-        };
-    case PalettePreset::Thermal:
-        return {
-            {0,0,32},      {0,0,64},      {0,0,128},     {0,0,192},
-            {0,64,192},    {0,128,192},   {0,192,128},   {0,255,64},
-            {64,255,0},    {128,255,0},   {192,255,0},   {255,255,0},
-            {255,192,0},   {255,128,0},   {255,64,0},    {255,0,0}
-        };
-    case PalettePreset::MonoGreen:
-        return {{0,32,0}, {0,85,0}, {0,170,0}, {0,255,0}};
-    default:
-        return {};
+    case PalettePreset::GameBoy:   return gameBoy;
+    case PalettePreset::NES:       return nes;
+    case PalettePreset::Windows98: return windows98;
+    case PalettePreset::Thermal:   return thermal;
+    case PalettePreset::MonoGreen: return monoGreen;
+    default:                       return {};
     }
 }
 
 void applyPalette(ImageBuffer& img, PalettePreset preset,
-                  const std::vector<std::array<uint8_t, 3>>& customPalette) {
+                  const std::vector<std::array<uint8_t, 3>>& customPalette,
+                  const AlphaTiles* visible) {
     if (!img.valid() || preset == PalettePreset::None) return;
+    toInterleaved(img);
 
-    auto pal = (preset == PalettePreset::Custom) ? customPalette : getPalette(preset);
+    std::span<const Rgb> pal = (preset == PalettePreset::Custom)
+        ? std::span<const Rgb>(customPalette) : getPalette(preset);
     if (pal.empty()) return;
 
-    int total = img.width * img.height;
-    for (int i = 0; i < total; ++i) {
-        int idx = i * img.channels;
-        std::array<uint8_t, 3> c = {img.data[idx], img.data[idx + 1], img.data[idx + 2]};
-        auto nc = nearestPaletteColor(c, pal);
-        img.data[idx + 0] = nc[0];
-        img.data[idx + 1] = nc[1];
-        img.data[idx + 2] = nc[2];
-    }
+    PaletteMapper mapper(pal);
+    mapPixels(img, mapper, visible);
 }
 
 // ---------------------------------------------------------------------------
@@ -613,61 +1438,158 @@ static float gradientNoise(float x, float y, int seed) {
 
 void applyDisplacement(ImageBuffer& img, int amount, int seed) {
     if (!img.valid() || amount <= 0) return;
+    toInterleaved(img);
 
     int w = img.width, h = img.height, ch = img.channels;
-    std::vector<uint8_t> orig(img.data);
+    ByteBuffer orig(img.data);
+    bool hasAlpha = !img.alpha.empty();
+    ByteBuffer origAlpha;
+    if (hasAlpha) origAlpha = img.alpha;
     float scale = 8.f;  // noise frequency
     float strength = amount * 0.5f;  // pixel displacement range
 
-    for (int y = 0; y < h; ++y) {
-        for (int x = 0; x < w; ++x) {
-            float nx = static_cast<float>(x) / w * scale;
-            float ny = static_cast<float>(y) / h * scale;
-            float dx = gradientNoise(nx, ny, seed) * strength;
-            float dy = gradientNoise(nx + 100.f, ny + 100.f, seed) * strength;
-
-            int sx = std::clamp(static_cast<int>(x + dx), 0, w - 1);
-            int sy = std::clamp(static_cast<int>(y + dy), 0, h - 1);
-
-            uint8_t* dst = &img.data[(y * w + x) * ch];
-            const uint8_t* src = &orig[(sy * w + sx) * ch];
-            std::memcpy(dst, src, ch);
-        }
-    }
+    // Offsets stay within +-strength rows of the destination
+    int reach = static_cast<int>(std::ceil(strength)) + 1;
+    size_t rowBytes = static_cast<size_t>(w) * ch;
+    ScratchArray<float> colNx(w);
+    for (int x = 0; x < w; ++x) colNx[x] = static_cast<float>(x) / w * scale;
+    sweepBands(h, {{&orig, rowBytes, reach}, {&origAlpha, static_cast<size_t>(w), reach},
+                   {&img.data, rowBytes}, {&img.alpha, static_cast<size_t>(w)}},
+               [&](int y0, int y1) {
+        withChannels(ch, [&]<int CH>(IntC<CH>) {
+            withFlag(hasAlpha, [&]<bool HAS_ALPHA>(BoolC<HAS_ALPHA>) {
+                for (int y = y0; y < y1; ++y) {
+                    float ny = static_cast<float>(y) / h * scale;
+                    uint8_t* dst = &img.data[pixelIndex(0, y, w) * CH];
+                    for (int x = 0; x < w; ++x) {
+                        float nx = colNx[x];
+                        float dx = gradientNoise(nx, ny, seed) * strength;
+                        float dy = gradientNoise(nx + 100.f, ny + 100.f, seed) * strength;
+
+                        int sx = std::clamp(static_cast<int>(x + dx), 0, w - 1);
+                        int sy = std::clamp(static_cast<int>(y + dy), 0, h - 1);
+
+                        size_t from = pixelIndex(sx, sy, w);
+                        std::memcpy(dst + x * CH, &orig[from * CH], CH);
+                        if constexpr (HAS_ALPHA) img.alpha[pixelIndex(x, y, w)] = origAlpha[from];
+                    }
+                }
+            });
+        });
+    });
 }
 
 // ---------------------------------------------------------------------------
 // 10. Master pipeline
 // ---------------------------------------------------------------------------
 
+// True once `next` differs from `prev` by at most `tolerance` in every byte.
+// Passes are deterministic, so with tolerance 0 every later pass would
+// reproduce `next` exactly.
+static bool passSettled(const ImageBuffer& prev, const ImageBuffer& next, int tolerance) {
+    if (prev.width != next.width || prev.height != next.height ||
+        prev.channels != next.channels || prev.layout != next.layout ||
+        prev.data.size() != next.data.size() || prev.alpha.size() != next.alpha.size())
+        return false;
+    auto within = [tolerance](const ByteBuffer& a, const ByteBuffer& b) {
+        if (tolerance <= 0) return a.empty() || std::memcmp(a.data(), b.data(), a.size()) == 0;
+        for (size_t i = 0; i < a.size(); ++i)
+            if (std::abs(a[i] - b[i]) > tolerance) return false;
+        return true;
+    };
+    return within(prev.data, next.data) && within(prev.alpha, next.alpha);
+}
+
+int passCount(const Settings& settings) {
+    return settings.iterativeDestroy && settings.iterativeCount > 1 ? settings.iterativeCount : 1;
+}
+
 ImageBuffer processImage(const ImageBuffer& input, const Settings& settings,
                          std::atomic<bool>& cancel) {
+    return processImage(input, settings, cancel, PassHooks{});
+}
+
+ImageBuffer processImage(const ImageBuffer& input, const Settings& settings,
+                         std::atomic<bool>& cancel, const PassHooks& hooks) {
     if (!input.valid()) return {};
-    ImageBuffer img = input;
+    SHAKAL_TRACE_SCOPE_PIXELS("processImage", input.pixelCount());
+
+    // Work on packed RGB; alpha rides along in its own plane
+    ImageBuffer img = (input.channels == 4 && input.layout == PixelLayout::Interleaved)
+        ? splitAlpha(input) : input;
+    toRGB(img);
+
+    // Where the image can be seen, so stages can skip fully transparent
+    // tiles. Redone after the stages that move alpha.
+    AlphaTiles tiles;
+    const AlphaTiles* visible = nullptr;
+    auto findVisible = [&] {
+        visible = nullptr;
+        if (img.alpha.empty()) return;
+        tiles = AlphaTiles::build(img);
+        visible = &tiles;
+    };
+    findVisible();
 
-    auto step = [&](auto fn) {
-        if (!cancel.load(std::memory_order_relaxed)) fn();
+    auto step = [&](const char* stage, auto fn) {
+        if (cancel.load(std::memory_order_relaxed)) return;
+        SHAKAL_TRACE_SCOPE_PIXELS(stage, img.pixelCount());
+        fn();
     };
 
     auto applyOnce = [&]() {
-        step([&] { applyResolution(img, settings.resolution, settings.hd8k); });
-        step([&] { colorQuantize(img, settings.quantization, settings.ditherMode); });
-        step([&] { applySharpen(img, settings.sharpen); });
-        step([&] { applyNoise(img, settings.noiseIntensity, settings.noiseType, settings.noisePerChannel); });
-        step([&] { applyRGBShift(img, settings.rgbShiftAmount, settings.rgbShiftX, settings.rgbShiftY); });
-        step([&] { applyGlitch(img, settings.glitchBands, settings.glitchAmplitude, settings.glitchSeed); });
-        step([&] { applyDisplacement(img, settings.displacement, settings.displacementSeed); });
-        step([&] { applyJpegCompression(img, settings.jpegQuality, settings.jpegIterations); });
-        step([&] { applyPalette(img, settings.palette, settings.customPalette); });
+        step("resolution", [&] {
+            applyResolution(img, settings.resolution, settings.hd8k);
+            if (settings.resolution < 100) findVisible();
+        });
+        step("quantize", [&] {
+            colorQuantize(img, settings.quantization, settings.ditherMode, visible);
+        });
+        step("sharpen", [&] { applySharpen(img, settings.sharpen, visible); });
+        step("noise", [&] { applyNoise(img, settings.noiseIntensity, settings.noiseType,
+                              settings.noisePerChannel, settings.noiseSeed); });
+        step("rgbShift", [&] { applyRGBShift(img, settings.rgbShiftAmount, settings.rgbShiftX,
+                                             settings.rgbShiftY, settings.rgbShiftOffsets); });
+        step("glitch", [&] {
+            applyGlitch(img, settings.glitchBands, settings.glitchAmplitude,
+                        settings.glitchSeed, settings.glitchMode);
+            if (settings.glitchBands > 0 && settings.glitchAmplitude > 0) findVisible();
+        });
+        step("displacement", [&] {
+            applyDisplacement(img, settings.displacement, settings.displacementSeed);
+            if (settings.displacement > 0) findVisible();
+        });
+        step("jpeg", [&] {
+            applyJpegCompression(img, settings.jpegQuality, settings.jpegIterations, visible);
+        });
+        step("palette", [&] {
+            applyPalette(img, settings.palette, settings.customPalette, visible);
+        });
     };
 
-    if (settings.iterativeDestroy && settings.iterativeCount > 1) {
-        for (int i = 0; i < settings.iterativeCount && !cancel.load(std::memory_order_relaxed); ++i)
-            applyOnce();
-    } else {
+    // Repeated JPEG + palette generations tend to converge; once a pass
+    // settles the remaining ones are skipped
+    const int passes = passCount(settings);
+    ImageBuffer previous;
+    for (int pass = hooks.donePasses + 1; pass <= passes; ++pass) {
+        if (cancel.load(std::memory_order_relaxed)) break;
+        const bool more = pass < passes;
+        if (more) previous = img;
         applyOnce();
+        if (cancel.load(std::memory_order_relaxed)) break;
+        if (more && passSettled(previous, img, settings.iterativeTolerance)) break;
+        if (hooks.onPass) {
+            ImageBuffer out = img;
+            toRGBA(out);
+            hooks.onPass(pass, out);
+        }
     }
 
+    // After all passes, so it stays legible and resumed runs add it once
+    if (settings.watermark)
+        step("watermark", [&] { Watermark::apply(img, settings.watermarkText); });
+
+    toRGBA(img);
     return img;
 }
 
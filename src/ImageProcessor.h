@@ -1,22 +1,41 @@
 #pragma once
 
+#include "BufferPool.h"
+
 #include <vector>
 #include <array>
 #include <string>
 #include <cstdint>
 #include <atomic>
+#include <functional>
+
+// How the channels of ImageBuffer::data are arranged
+enum class PixelLayout {
+    Interleaved, // RGBARGBA... or RGBRGB...
+    Planar       // RRR...GGG...BBB... (one width*height plane per channel)
+};
 
 struct ImageBuffer {
-    std::vector<uint8_t> data;
+    ByteBuffer data;
+    ByteBuffer alpha; // separate alpha plane for 3-channel images; empty = opaque
     int width = 0;
     int height = 0;
     int channels = 4; // RGBA
+    PixelLayout layout = PixelLayout::Interleaved;
     bool valid() const { return !data.empty() && width > 0 && height > 0; }
+    size_t pixelCount() const { return static_cast<size_t>(width) * height; }
+    uint8_t* plane(int c) { return data.data() + c * pixelCount(); }
+    const uint8_t* plane(int c) const { return data.data() + c * pixelCount(); }
 };
 
 enum class DitherMode { Off, Ordered, FloydSteinberg };
 enum class NoiseType { Gaussian, SaltPepper, DigitalBanding };
+enum class GlitchMode { Rows, Blocks, ChannelSlice };
+
+using RgbShiftOffsets = std::array<std::array<float, 2>, 3>;
 enum class PalettePreset { None, GameBoy, NES, Windows98, Thermal, MonoGreen, Custom };
+enum class PngFilter { None, Sub, Up, Average, Paeth, Adaptive }; // Adaptive = best per row
+enum class JpegSubsampling { S444, S422, S420 };
 
 struct Settings {
     // HD8K toggle - nearest neighbor vs bilinear
@@ -44,16 +63,21 @@ struct Settings {
     int noiseIntensity = 0;
     NoiseType noiseType = NoiseType::Gaussian;
     bool noisePerChannel = false;
+    int noiseSeed = 42;
 
     // RGB shift 0-100
     int rgbShiftAmount = 0;
     bool rgbShiftX = true;
     bool rgbShiftY = false;
+    // Extra (x, y) movement of R, G and B in pixels, on top of the amount;
+    // fractional values blend neighbouring pixels
+    RgbShiftOffsets rgbShiftOffsets{};
 
     // Glitch
     int glitchBands = 0;
     int glitchAmplitude = 0;
     int glitchSeed = 42;
+    GlitchMode glitchMode = GlitchMode::Rows;
 
     // Palette
     PalettePreset palette = PalettePreset::None;
@@ -62,6 +86,9 @@ struct Settings {
     // Iterative destroy
     bool iterativeDestroy = false;
     int iterativeCount = 1;
+    // Stop early once a pass moves no byte by more than this. 0 stops only
+    // when a pass changes nothing, which leaves the result exact.
+    int iterativeTolerance = 0;
 
     // Watermark
     bool watermark = false;
@@ -70,24 +97,124 @@ struct Settings {
     // Randomize seed
     int randomSeed = 0;
 
+    // Animations: offset the noise, glitch and displacement seeds by the frame
+    // index so every frame gets its own pattern
+    bool animateSeeds = false;
+
     // Strip EXIF on save
     bool stripExif = true;
+
+    // Keep processed results on disk between sessions (see ResultCache)
+    bool diskCache = false;
+
+    // PNG export: zlib-style level 0-9 (0 = store, 1 = run-length) and row filter
+    int pngLevel = 6;
+    PngFilter pngFilter = PngFilter::Adaptive;
+
+    // JPEG export (the JPEG effect above is separate)
+    int jpegExportQuality = 90;
+    JpegSubsampling jpegSubsampling = JpegSubsampling::S420;
+    // File size limit in KB (0 = off): the export uses the highest quality
+    // up to jpegExportQuality that fits, and with jpegTargetResize also a
+    // smaller resolution when even low quality does not
+    int jpegTargetKB = 0;
+    bool jpegTargetResize = false;
 };
 
 namespace ImageProcessor {
 
-void colorQuantize(ImageBuffer& img, int level, DitherMode dither);
-void applySharpen(ImageBuffer& img, int level);
+// Layout conversion. processImage works on packed RGB with alpha split off
+// into its own plane and converts back to RGBA at the end; kernels switch to
+// planar where that vectorizes better.
+void toRGB(ImageBuffer& img);         // RGBA -> RGB + alpha plane (dropped if opaque)
+void toRGBA(ImageBuffer& img);        // any layout -> interleaved RGBA
+void toPlanar(ImageBuffer& img);      // interleaved -> planar
+void toInterleaved(ImageBuffer& img); // planar -> interleaved
+
+// Row `y` of any layout as interleaved pixels, a split-off alpha plane
+// appended as the last channel (packedChannels() bytes per pixel)
+int packedChannels(const ImageBuffer& img);
+void packRow(const ImageBuffer& img, int y, uint8_t* dst);
+
+// Coarse map of where an image can be seen: which TILE x TILE tiles hold at
+// least one pixel with alpha > 0, kept per tile row as runs of occupied
+// columns. Stages handed one leave the RGB of empty tiles as it was, which
+// only ever shows under alpha 0. The arrays come from the scratch pool like
+// any other per-run temporary.
+struct AlphaTiles {
+    static constexpr int TILE = 16;
+    struct Span { int x0, x1; };   // pixel columns [x0, x1)
+
+    int width = 0;
+    int height = 0;
+    int tilesX = 0;
+    int tilesY = 0;
+    ScratchArray<uint8_t> occupied;   // tilesX * tilesY
+    ScratchArray<Span> spans;         // room for the most runs the tiles can form
+    ScratchArray<uint32_t> rowStart;  // tile row t owns spans[rowStart[t], rowStart[t + 1])
+
+    // From the alpha plane or fourth channel; every tile is occupied without one
+    static AlphaTiles build(const ImageBuffer& img);
+
+    // Occupied tiles plus every tile within `radius` pixels of one, for
+    // stages whose output reads that far
+    AlphaTiles grown(int radius) const;
+
+    // Runs of pixel row y
+    const Span* rowBegin(int y) const { return spans.data() + rowStart[y / TILE]; }
+    const Span* rowEnd(int y) const { return spans.data() + rowStart[y / TILE + 1]; }
+
+    // Tile-aligned box [x0, x1) x [y0, y1) around every occupied tile;
+    // false if there is none
+    bool bounds(int& x0, int& y0, int& x1, int& y1) const;
+
+private:
+    void collectSpans();
+};
+
+// Stages that take `visible` may skip tiles it marks empty; nullptr (the
+// default) processes everything. colorQuantize builds its palette from
+// pixels with alpha > 0 either way.
+void colorQuantize(ImageBuffer& img, int level, DitherMode dither,
+                   const AlphaTiles* visible = nullptr);
+void applySharpen(ImageBuffer& img, int level, const AlphaTiles* visible = nullptr);
 void applyResolution(ImageBuffer& img, int resPercent, bool hd8k);
-void applyJpegCompression(ImageBuffer& img, int quality, int iterations);
-void applyNoise(ImageBuffer& img, int intensity, NoiseType type, bool perChannel);
-void applyRGBShift(ImageBuffer& img, int amount, bool shiftX, bool shiftY);
-void applyGlitch(ImageBuffer& img, int bands, int amplitude, int seed);
+// Box-filtered copy at newW x newH (at most the original size), interleaved
+ImageBuffer downscale(const ImageBuffer& img, int newW, int newH);
+void applyJpegCompression(ImageBuffer& img, int quality, int iterations,
+                          const AlphaTiles* visible = nullptr);
+void applyNoise(ImageBuffer& img, int intensity, NoiseType type, bool perChannel, int seed);
+void applyRGBShift(ImageBuffer& img, int amount, bool shiftX, bool shiftY,
+                   const RgbShiftOffsets& offsets = {});
+void applyGlitch(ImageBuffer& img, int bands, int amplitude, int seed,
+                 GlitchMode mode = GlitchMode::Rows);
 void applyPalette(ImageBuffer& img, PalettePreset preset,
-                  const std::vector<std::array<uint8_t, 3>>& customPalette);
+                  const std::vector<std::array<uint8_t, 3>>& customPalette,
+                  const AlphaTiles* visible = nullptr);
 void applyDisplacement(ImageBuffer& img, int amount, int seed);
 
+// Median-cut palette of up to `numColors` (max 256) colors for `count` pixels,
+// which are reordered in place. Returns the number of colors written.
+int medianCutPalette(std::array<uint8_t, 3>* pixels, size_t count, int numColors,
+                     std::array<uint8_t, 3>* palette);
+
 ImageBuffer processImage(const ImageBuffer& input, const Settings& settings,
                          std::atomic<bool>& cancel);
 
+// Number of times processImage runs the effect chain for `settings`
+int passCount(const Settings& settings);
+
+// Iterative destroy in installments. `donePasses` says `input` is an image
+// onPass handed out earlier for the same source and settings; only the
+// passes after it run. onPass receives every pass finished here except one
+// that settles (see Settings::iterativeTolerance), in processImage's output
+// layout, so resuming from any of them gives what a full run would.
+struct PassHooks {
+    int donePasses = 0;
+    std::function<void(int pass, const ImageBuffer& image)> onPass;
+};
+
+ImageBuffer processImage(const ImageBuffer& input, const Settings& settings,
+                         std::atomic<bool>& cancel, const PassHooks& hooks);
+
 } // namespace ImageProcessor
@@ -0,0 +1,119 @@
+#include "ImageSaver.h"
+#include "Animation.h"
+#include "JpegWriter.h"
+#include "PngWriter.h"
+#include "ThreadPool.h"
+#include "stb_image_write.h"
+
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+
+ImageSaver::~ImageSaver() {
+    // Queued saves are dropped; the running one has to finish writing its file
+    if (m_future.valid())
+        m_future.wait();
+}
+
+bool ImageSaver::saveFile(const ImageBuffer& img, const std::string& path, const Settings& settings,
+                          std::atomic<float>* progress) {
+    if (!img.valid() || path.empty()) return false;
+
+    auto ext = std::filesystem::path(path).extension().string();
+    for (auto& c : ext) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+    if ((ext == ".jpg" || ext == ".jpeg") && settings.jpegTargetKB > 0) {
+        // Candidates are encoded in memory; only the winner reaches the disk
+        JpegWriter::BudgetResult fitted;
+        if (!JpegWriter::encodeForSettings(img, settings, fitted, progress)) return false;
+        FILE* f = std::fopen(path.c_str(), "wb");
+        if (!f) return false;
+        bool ok = std::fwrite(fitted.file.data(), 1, fitted.file.size(), f) == fitted.file.size();
+        ok = std::fclose(f) == 0 && ok;
+        if (!ok) std::remove(path.c_str());
+        return ok;
+    }
+    if (ext == ".jpg" || ext == ".jpeg") {
+        JpegWriter::Options options;
+        options.quality = settings.jpegExportQuality;
+        options.subsampling = settings.jpegSubsampling;
+        return JpegWriter::writeFile(path, img, options, progress);
+    }
+    if (ext == ".gif")
+        return Animation::writeGif(path, img, progress);
+    if (ext != ".bmp") {
+        // PNG, also the default for unknown extensions
+        PngWriter::Options options;
+        options.level = settings.pngLevel;
+        options.filter = settings.pngFilter;
+        return PngWriter::writeFile(path, img, options, progress);
+    }
+
+    // BMP goes through stb, which takes interleaved pixels only
+    ImageBuffer packed;
+    const ImageBuffer* src = &img;
+    if (img.layout != PixelLayout::Interleaved || !img.alpha.empty()) {
+        packed = img;
+        ImageProcessor::toRGBA(packed);
+        src = &packed;
+    }
+
+    int ok = stbi_write_bmp(path.c_str(), src->width, src->height, src->channels,
+                            src->data.data());
+    if (progress) progress->store(1.0f);
+    return ok != 0;
+}
+
+void ImageSaver::save(ImageBuffer img, const std::string& path, const Settings& settings,
+                      std::function<void(bool)> onSaved) {
+    m_queue.push_back({std::move(img), {}, path, settings, nullptr, std::move(onSaved)});
+    if (!m_future.valid())
+        startNext();
+}
+
+void ImageSaver::saveAnimation(const std::string& sourcePath, const std::string& path,
+                               const Settings& settings, ResultCache* cache,
+                               std::function<void(bool)> onSaved) {
+    m_queue.push_back({{}, sourcePath, path, settings, cache, std::move(onSaved)});
+    if (!m_future.valid())
+        startNext();
+}
+
+void ImageSaver::startNext() {
+    if (m_queue.empty()) return;
+    auto job = std::make_shared<Job>(std::move(m_queue.front()));
+    m_queue.pop_front();
+
+    m_callback = std::move(job->onSaved);
+    m_progress.store(0.0f);
+    // A thread of its own: the encoder blocks on chunks it hands to ThreadPool::shared()
+    m_future = std::async(std::launch::async, [this, job] {
+        // Exports give way to the preview being edited
+        ThreadPool::PriorityScope background(ThreadPool::Priority::Background);
+        if (!job->sourcePath.empty()) {
+            Animation::Options options;
+            options.cache = job->cache;
+            return Animation::processGif(job->sourcePath, job->path, job->settings, options,
+                                         &m_progress);
+        }
+        return saveFile(job->image, job->path, job->settings, &m_progress);
+    });
+}
+
+bool ImageSaver::isSaving() const {
+    return m_future.valid() || !m_queue.empty();
+}
+
+void ImageSaver::poll() {
+    if (!m_future.valid() ||
+        m_future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return;
+
+    bool ok = m_future.get();
+    auto callback = std::move(m_callback);
+    m_callback = nullptr;
+    startNext();
+    if (callback)
+        callback(ok);
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "ImageProcessor.h"
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <future>
+#include <string>
+
+class ResultCache;
+
+// ---------------------------------------------------------------------------
+// ImageSaver - encodes and writes images on a background thread
+//
+// The format follows the file extension (PNG when unknown). PNG and JPEG go
+// through the multithreaded PngWriter / JpegWriter and report progress; saves
+// requested while one is running are queued and written in order. Animated
+// GIFs are re-read from their source file and processed frame by frame.
+// ---------------------------------------------------------------------------
+
+class ImageSaver {
+public:
+    ImageSaver() = default;
+    ~ImageSaver();
+
+    // Queue `img` for writing with the export options in `settings`.
+    // `onSaved` is called from poll() with the outcome.
+    void save(ImageBuffer img, const std::string& path, const Settings& settings,
+              std::function<void(bool)> onSaved);
+
+    // Process every frame of the GIF at `sourcePath` with `settings` and write
+    // the animation to `path`. `cache`, if given, must outlive the save.
+    void saveAnimation(const std::string& sourcePath, const std::string& path,
+                       const Settings& settings, ResultCache* cache,
+                       std::function<void(bool)> onSaved);
+
+    // True until the callback of the last queued save has run
+    bool isSaving() const;
+
+    // Fraction of the running save that is written (0 for formats without progress)
+    float progress() const { return m_progress.load(); }
+
+    // Deliver a finished save and start the next one (call from main thread)
+    void poll();
+
+    // Synchronous save, as run by the background task
+    static bool saveFile(const ImageBuffer& img, const std::string& path, const Settings& settings,
+                         std::atomic<float>* progress = nullptr);
+
+private:
+    struct Job {
+        ImageBuffer image;
+        std::string sourcePath;  // animation source; empty for still images
+        std::string path;
+        Settings settings;
+        ResultCache* cache = nullptr;
+        std::function<void(bool)> onSaved;
+    };
+    void startNext();
+
+    std::future<bool> m_future;
+    std::function<void(bool)> m_callback;
+    std::deque<Job> m_queue;
+    std::atomic<float> m_progress{0.0f};
+};
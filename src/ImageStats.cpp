@@ -0,0 +1,251 @@
+#include "ImageStats.h"
+#include "Kernels.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// Same weights as Kernels::ssimMoments
+inline int luma(int r, int g, int b) {
+    return (77 * r + 150 * g + 29 * b + 128) >> 8;
+}
+
+bool measurable(const ImageBuffer& img) {
+    return img.valid() && img.channels >= 3 && img.layout == PixelLayout::Interleaved;
+}
+
+// SSIM of one 8x8 block from its moments (a, b, a^2, b^2, ab sums)
+double blockSsim(const uint32_t* m) {
+    constexpr double N = 64.0;
+    constexpr double C1 = (0.01 * 255) * (0.01 * 255);
+    constexpr double C2 = (0.03 * 255) * (0.03 * 255);
+    const double muA = m[0] / N, muB = m[1] / N;
+    const double varA = m[2] / N - muA * muA;
+    const double varB = m[3] / N - muB * muB;
+    const double cov = m[4] / N - muA * muB;
+    return ((2 * muA * muB + C1) * (2 * cov + C2)) /
+           ((muA * muA + muB * muB + C1) * (varA + varB + C2));
+}
+
+// fn(index) for every index on the shared pool; returns once all are done
+template <typename Fn>
+void forEachBand(int count, Fn&& fn) {
+    std::vector<std::future<void>> tasks;
+    tasks.reserve(count);
+    for (int i = 0; i < count; ++i)
+        tasks.push_back(ThreadPool::shared().submit([&fn, i] { fn(i); }));
+    for (auto& task : tasks) task.wait();
+}
+
+} // namespace
+
+ImageStats::~ImageStats() {
+    cancel();
+    wait();
+}
+
+void ImageStats::wait() {
+    if (m_task.valid()) m_task.wait();
+}
+
+void ImageStats::cancel() {
+    m_cancel.store(true);
+}
+
+void ImageStats::update(const ImageBuffer& source, uint64_t sourceId, const ImageBuffer& processed) {
+    cancel();
+    wait();
+    m_cancel.store(false);
+
+    if (sourceId != m_sourceId) {
+        m_source = source;
+        m_sourceId = sourceId;
+        m_sourceCounted = false;
+        m_bandValid.clear();    // every figure but the histograms involves the source
+    }
+    m_processed = processed;
+
+    // As in Pipeline: the outcome goes through a promise so it is ready by
+    // the time the wake callback runs
+    m_running.store(true);
+    auto promise = std::make_shared<std::promise<bool>>();
+    m_result = promise->get_future();
+    m_task = std::async(std::launch::async, [this, promise]() {
+        bool ok = false;
+        try {
+            ok = measure();
+        } catch (...) {
+        }
+        promise->set_value(ok);
+        m_running.store(false);
+        if (m_wake) m_wake();
+    });
+}
+
+bool ImageStats::poll() {
+    if (!m_result.valid() || m_result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return false;
+    if (!m_result.get()) return false;
+    m_report = m_pending;
+    m_hasReport = true;
+    return true;
+}
+
+// Runs on the update's worker thread
+bool ImageStats::measure() {
+    const auto start = std::chrono::steady_clock::now();
+    const ImageBuffer& img = m_processed;
+    if (!measurable(img)) return false;
+
+    const int bands = (img.height + BAND_ROWS - 1) / BAND_ROWS;
+    const bool compared = measurable(m_source) && m_source.width == img.width &&
+                          m_source.height == img.height;
+    const bool reshaped = m_measured.width != img.width || m_measured.height != img.height ||
+                          m_measured.channels != img.channels;
+    if (reshaped) {
+        m_measured.width = img.width;
+        m_measured.height = img.height;
+        m_measured.channels = img.channels;
+        m_measured.data = ByteBuffer(img.data.size());
+    }
+    if (reshaped || compared != m_compared || m_bandValid.size() != static_cast<size_t>(bands)) {
+        m_bands.assign(bands, Band{});
+        m_bandValid.assign(bands, 0);
+    }
+    m_compared = compared;
+
+    m_bandChanged.assign(bands, 0);
+    forEachBand(bands, [this](int b) { measureBand(b); });
+    const int measured = static_cast<int>(std::count(m_bandChanged.begin(), m_bandChanged.end(), 1));
+    if (measured > 0) m_colorsCounted = false;
+    if (m_cancel.load()) return false;
+
+    // A cancelled count leaves the last finished one in place
+    if (!m_colorsCounted) {
+        uint64_t colors = countColors(m_measured);
+        if (m_cancel.load()) return false;
+        m_colors = colors;
+        m_colorsCounted = true;
+    }
+    if (!m_sourceCounted && measurable(m_source)) {
+        uint64_t colors = countColors(m_source);
+        if (m_cancel.load()) return false;
+        m_sourceColors = colors;
+        m_sourceCounted = true;
+    }
+
+    Report& r = m_pending;
+    r.width = img.width;
+    r.height = img.height;
+    r.uniqueColors = m_colors;
+    r.sourceUniqueColors = m_sourceColors;
+    r.compared = compared;
+    r.bands = bands;
+    r.bandsMeasured = measured;
+    std::memset(r.histogram, 0, sizeof(r.histogram));
+    uint64_t sse[3] = {};
+    double ssimSum = 0.0;
+    int64_t ssimBlocks = 0;
+    for (const Band& band : m_bands) {
+        for (int c = 0; c < 4; ++c)
+            for (int i = 0; i < 256; ++i) r.histogram[c][i] += band.histogram[c][i];
+        for (int c = 0; c < 3; ++c) sse[c] += band.squaredError[c];
+        ssimSum += band.ssimSum;
+        ssimBlocks += band.ssimBlocks;
+    }
+    const double pixels = static_cast<double>(img.pixelCount());
+    for (int c = 0; c < 3; ++c) r.mse[c] = compared ? sse[c] / pixels : 0.0;
+    const double mse = (r.mse[0] + r.mse[1] + r.mse[2]) / 3.0;
+    r.psnr = !compared ? 0.0
+           : mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse)
+           : std::numeric_limits<double>::infinity();
+    r.ssim = compared && ssimBlocks > 0 ? ssimSum / ssimBlocks : (compared ? 1.0 : 0.0);
+    r.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+// One pool task: skipped when the band's pixels are the ones already measured
+void ImageStats::measureBand(int index) {
+    if (m_cancel.load()) return;
+
+    const ImageBuffer& img = m_processed;
+    const int w = img.width, ch = img.channels;
+    const int y0 = index * BAND_ROWS;
+    const int y1 = std::min(img.height, y0 + BAND_ROWS);
+    const size_t rowBytes = static_cast<size_t>(w) * ch;
+    const uint8_t* cur = img.data.data() + y0 * rowBytes;
+    uint8_t* kept = m_measured.data.data() + y0 * rowBytes;
+    const size_t bytes = (y1 - y0) * rowBytes;
+    if (m_bandValid[index] && std::memcmp(cur, kept, bytes) == 0) return;
+
+    Band& band = m_bands[index];
+    std::memset(&band, 0, sizeof(band));
+    for (int y = y0; y < y1; ++y) {
+        const uint8_t* p = img.data.data() + y * rowBytes;
+        for (int x = 0; x < w; ++x, p += ch) {
+            ++band.histogram[0][p[0]];
+            ++band.histogram[1][p[1]];
+            ++band.histogram[2][p[2]];
+            ++band.histogram[3][luma(p[0], p[1], p[2])];
+        }
+    }
+
+    if (m_compared) {
+        const Kernels::Table& k = Kernels::table();
+        const int sch = m_source.channels;
+        const size_t srcRow = static_cast<size_t>(w) * sch;
+        for (int y = y0; y < y1; ++y)
+            k.squaredError(m_source.data.data() + y * srcRow, sch, img.data.data() + y * rowBytes,
+                           ch, w, band.squaredError);
+
+        // Whole blocks only; bands start on a block row
+        const int blocks = w / 8;
+        ScratchArray<uint32_t> moments(static_cast<size_t>(blocks) * 5);
+        for (int by = y0; by + 8 <= y1 && blocks > 0; by += 8) {
+            std::fill(moments.begin(), moments.end(), 0u);
+            for (int y = by; y < by + 8; ++y)
+                k.ssimMoments(m_source.data.data() + y * srcRow, sch,
+                              img.data.data() + y * rowBytes, ch, blocks, moments.data());
+            for (int i = 0; i < blocks; ++i) band.ssimSum += blockSsim(&moments[i * 5]);
+            band.ssimBlocks += blocks;
+        }
+    }
+
+    std::memcpy(kept, cur, bytes);
+    m_bandValid[index] = 1;
+    m_bandChanged[index] = 1;
+}
+
+// Distinct RGB values: one bit per color, set from all bands at once
+uint64_t ImageStats::countColors(const ImageBuffer& img) {
+    m_colorBits.assign(size_t(1) << 18, 0);
+    const int w = img.width, ch = img.channels;
+    const int bands = (img.height + BAND_ROWS - 1) / BAND_ROWS;
+    forEachBand(bands, [&](int b) {
+        if (m_cancel.load()) return;
+        const int y0 = b * BAND_ROWS;
+        const int y1 = std::min(img.height, y0 + BAND_ROWS);
+        const uint8_t* p = img.data.data() + static_cast<size_t>(y0) * w * ch;
+        const uint8_t* end = img.data.data() + static_cast<size_t>(y1) * w * ch;
+        uint32_t last = ~0u;
+        for (; p < end; p += ch) {
+            const uint32_t color = (p[0] << 16) | (p[1] << 8) | p[2];
+            if (color == last) continue;    // runs of one color are common
+            last = color;
+            std::atomic_ref<uint64_t> word(m_colorBits[color >> 6]);
+            const uint64_t bit = uint64_t(1) << (color & 63);
+            if (!(word.load(std::memory_order_relaxed) & bit))
+                word.fetch_or(bit, std::memory_order_relaxed);
+        }
+    });
+    uint64_t count = 0;
+    for (uint64_t word : m_colorBits) count += std::popcount(word);
+    return count;
+}
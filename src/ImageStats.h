@@ -0,0 +1,107 @@
+#pragma once
+
+#include "ImageProcessor.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// ImageStats - figures for the metrics panel, measured off the UI thread
+//
+// For a processed image against its source: RGB and luma histograms, the
+// number of distinct colors, per-channel MSE with PSNR, and SSIM as the mean
+// over 8x8 luma blocks. update() snapshots the images and measures them in
+// the background, one BAND_ROWS band per ThreadPool::shared() task, with the
+// per-row loops in Kernels. Bands keep their partial sums and are only
+// measured again when their pixels changed, so a result that differs from
+// the last one in a region costs that region; the color count alone is taken
+// over the whole image again, from a 2^24-bit set. cancel() makes way for a
+// processing run: queued bands return at once and no report is published.
+// ---------------------------------------------------------------------------
+
+class ImageStats {
+public:
+    static constexpr int BAND_ROWS = 64;    // whole 8-row SSIM blocks
+
+    struct Report {
+        int width = 0;
+        int height = 0;
+        uint32_t histogram[4][256] = {};    // R, G, B, luma of the processed image
+        uint64_t uniqueColors = 0;
+        uint64_t sourceUniqueColors = 0;
+        bool compared = false;              // same size as the source: the rest is set
+        double mse[3] = {};                 // per RGB channel
+        double psnr = 0.0;                  // dB over RGB; infinity when identical
+        double ssim = 0.0;
+        double ms = 0.0;                    // wall time of the update
+        int bandsMeasured = 0;              // bands that changed since the last report
+        int bands = 0;
+    };
+
+    ImageStats() = default;
+    ~ImageStats();
+
+    ImageStats(const ImageStats&) = delete;
+    ImageStats& operator=(const ImageStats&) = delete;
+
+    // Called on a worker thread once a report is ready for poll(). Set before
+    // the first update.
+    void setWakeCallback(std::function<void()> wake) { m_wake = std::move(wake); }
+
+    // Measure `processed` against `source` in the background, replacing any
+    // run in progress. `sourceId` must change whenever the source does; the
+    // source is only copied then. Interleaved RGB(A) images only.
+    void update(const ImageBuffer& source, uint64_t sourceId, const ImageBuffer& processed);
+
+    // Drop the run in progress, if any
+    void cancel();
+
+    bool isRunning() const { return m_running.load(); }
+
+    // Pick up a finished run (call from main thread); true if report() changed
+    bool poll();
+
+    bool hasReport() const { return m_hasReport; }
+    const Report& report() const { return m_report; }
+
+private:
+    struct Band {
+        uint32_t histogram[4][256];
+        uint64_t squaredError[3];
+        double ssimSum;
+        int ssimBlocks;
+    };
+
+    void wait();
+    bool measure();
+    void measureBand(int index);
+    uint64_t countColors(const ImageBuffer& img);
+
+    ImageBuffer m_source;
+    uint64_t m_sourceId = ~0ull;
+    uint64_t m_sourceColors = 0;
+    bool m_sourceCounted = false;
+
+    ImageBuffer m_processed;                // snapshot being measured
+    ImageBuffer m_measured;                 // the pixels m_bands describe
+    std::vector<Band> m_bands;
+    std::vector<uint8_t> m_bandValid;
+    std::vector<uint8_t> m_bandChanged;
+    std::vector<uint64_t> m_colorBits;
+    uint64_t m_colors = 0;
+    bool m_colorsCounted = false;
+    bool m_compared = false;
+
+    std::atomic<bool> m_cancel{false};
+    std::atomic<bool> m_running{false};
+    std::future<void> m_task;               // the worker, joined before the next update
+    std::future<bool> m_result;             // ready before m_wake runs
+    std::function<void()> m_wake;
+
+    Report m_pending;                       // written by the worker
+    Report m_report;
+    bool m_hasReport = false;
+};
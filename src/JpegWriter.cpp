@@ -0,0 +1,607 @@
+#include "JpegWriter.h"
+#include "Kernels.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <memory>
+#include <vector>
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Tables (ITU T.81 Annex K)
+// ---------------------------------------------------------------------------
+
+constexpr int MAX_DIMENSION = 65535;
+
+// Zigzag position -> natural (row-major) index
+constexpr uint8_t ZIGZAG[64] = {
+     0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63
+};
+
+// Natural order
+constexpr uint8_t LUMA_QUANT[64] = {
+    16, 11, 10, 16,  24,  40,  51,  61,
+    12, 12, 14, 19,  26,  58,  60,  55,
+    14, 13, 16, 24,  40,  57,  69,  56,
+    14, 17, 22, 29,  51,  87,  80,  62,
+    18, 22, 37, 56,  68, 109, 103,  77,
+    24, 35, 55, 64,  81, 104, 113,  92,
+    49, 64, 78, 87, 103, 121, 120, 101,
+    72, 92, 95, 98, 112, 100, 103,  99
+};
+constexpr uint8_t CHROMA_QUANT[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99,
+    18, 21, 26, 66, 99, 99, 99, 99,
+    24, 26, 56, 99, 99, 99, 99, 99,
+    47, 66, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99
+};
+
+// Huffman tables as code counts per length 1..16 followed by the symbols
+constexpr uint8_t DC_LUMA_COUNTS[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+constexpr uint8_t DC_CHROMA_COUNTS[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+constexpr uint8_t DC_VALUES[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+constexpr uint8_t AC_LUMA_COUNTS[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+constexpr uint8_t AC_LUMA_VALUES[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+constexpr uint8_t AC_CHROMA_COUNTS[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+constexpr uint8_t AC_CHROMA_VALUES[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+
+// Scale factors of the AAN DCT outputs
+constexpr float AAN_SCALE[8] = {
+    1.0f, 1.387039845f, 1.306562965f, 1.175875602f,
+    1.0f, 0.785694958f, 0.541196100f, 0.275899379f
+};
+
+struct HuffTable {
+    uint16_t code[256] = {};
+    uint8_t size[256] = {};
+};
+
+HuffTable buildHuffTable(const uint8_t* counts, const uint8_t* values) {
+    HuffTable t;
+    uint16_t code = 0;
+    int k = 0;
+    for (int len = 1; len <= 16; ++len) {
+        for (int i = 0; i < counts[len - 1]; ++i, ++k) {
+            t.code[values[k]] = code++;
+            t.size[values[k]] = static_cast<uint8_t>(len);
+        }
+        code <<= 1;
+    }
+    return t;
+}
+
+// Everything the strips share; read-only once encoding starts
+struct Encoder {
+    int width = 0, height = 0;
+    int components = 3;           // 1 = grayscale, 3 = YCbCr
+    int hs = 1, vs = 1;           // luma samples per chroma sample
+    int mcuWidth = 8, mcuHeight = 8;
+    int mcusPerRow = 0, mcuRows = 0;
+    uint8_t quant[2][64];         // natural order
+    float divisors[2][64];        // 1 / (quant * AAN scale), natural order
+    HuffTable dc[2], ac[2];
+};
+
+Encoder makeEncoder(const ImageBuffer& img, const JpegWriter::Options& options) {
+    Encoder e;
+    e.width = img.width;
+    e.height = img.height;
+    e.components = ImageProcessor::packedChannels(img) >= 3 ? 3 : 1;
+    if (e.components == 3) {
+        e.hs = options.subsampling == JpegSubsampling::S444 ? 1 : 2;
+        e.vs = options.subsampling == JpegSubsampling::S420 ? 2 : 1;
+    }
+    e.mcuWidth = 8 * e.hs;
+    e.mcuHeight = 8 * e.vs;
+    e.mcusPerRow = (e.width + e.mcuWidth - 1) / e.mcuWidth;
+    e.mcuRows = (e.height + e.mcuHeight - 1) / e.mcuHeight;
+
+    const int quality = std::clamp(options.quality, 1, 100);
+    const int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+    for (int t = 0; t < 2; ++t) {
+        const uint8_t* base = t == 0 ? LUMA_QUANT : CHROMA_QUANT;
+        for (int k = 0; k < 64; ++k) {
+            int q = std::clamp((base[k] * scale + 50) / 100, 1, 255);
+            e.quant[t][k] = static_cast<uint8_t>(q);
+            e.divisors[t][k] = 1.0f / (q * AAN_SCALE[k >> 3] * AAN_SCALE[k & 7] * 8.0f);
+        }
+    }
+    e.dc[0] = buildHuffTable(DC_LUMA_COUNTS, DC_VALUES);
+    e.dc[1] = buildHuffTable(DC_CHROMA_COUNTS, DC_VALUES);
+    e.ac[0] = buildHuffTable(AC_LUMA_COUNTS, AC_LUMA_VALUES);
+    e.ac[1] = buildHuffTable(AC_CHROMA_COUNTS, AC_CHROMA_VALUES);
+    return e;
+}
+
+// ---------------------------------------------------------------------------
+// Entropy coding
+// ---------------------------------------------------------------------------
+
+// MSB-first, with a 0x00 stuffed after every 0xFF
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : m_out(out) {}
+
+    void put(uint32_t value, int n) {
+        m_bits = (m_bits << n) | (value & ((1u << n) - 1));
+        m_count += n;
+        while (m_count >= 8) {
+            uint8_t b = static_cast<uint8_t>(m_bits >> (m_count - 8));
+            m_out.push_back(b);
+            if (b == 0xFF) m_out.push_back(0);
+            m_count -= 8;
+        }
+    }
+
+    // Pad with 1 bits, as required before a marker
+    void flush() {
+        if (m_count > 0) put(0x7F, 8 - m_count);
+    }
+
+    void marker(uint8_t code) {
+        m_out.push_back(0xFF);
+        m_out.push_back(code);
+    }
+
+private:
+    std::vector<uint8_t>& m_out;
+    uint64_t m_bits = 0;
+    int m_count = 0;
+};
+
+// Bit length of |v| and its JPEG extra-bits representation
+inline int magnitudeBits(int v) {
+    unsigned a = static_cast<unsigned>(v < 0 ? -v : v);
+    int n = 0;
+    while (a) { ++n; a >>= 1; }
+    return n;
+}
+
+void encodeBlock(BitWriter& bits, float* block, const float* divisors,
+                 const HuffTable& dc, const HuffTable& ac, int& prevDc) {
+    Kernels::table().fdct8x8(block);
+
+    int coef[64];
+    for (int i = 0; i < 64; ++i) {
+        int k = ZIGZAG[i];
+        coef[i] = static_cast<int>(std::lround(block[k] * divisors[k]));
+    }
+
+    int diff = coef[0] - prevDc;
+    prevDc = coef[0];
+    int n = magnitudeBits(diff);
+    bits.put(dc.code[n], dc.size[n]);
+    if (n) bits.put(static_cast<uint32_t>(diff < 0 ? diff - 1 : diff), n);
+
+    int run = 0;
+    for (int i = 1; i < 64; ++i) {
+        int v = coef[i];
+        if (v == 0) { ++run; continue; }
+        while (run >= 16) {
+            bits.put(ac.code[0xF0], ac.size[0xF0]);  // ZRL
+            run -= 16;
+        }
+        n = magnitudeBits(v);
+        int sym = (run << 4) | n;
+        bits.put(ac.code[sym], ac.size[sym]);
+        bits.put(static_cast<uint32_t>(v < 0 ? v - 1 : v), n);
+        run = 0;
+    }
+    if (run > 0) bits.put(ac.code[0x00], ac.size[0x00]);  // EOB
+}
+
+// Entropy-coded data of MCU rows [mcuRow0, mcuRow1), ending byte-aligned and,
+// unless it holds the last row, with the restart marker for the next strip
+std::vector<uint8_t> encodeStrip(const ImageBuffer& img, const Encoder& e, int mcuRow0, int mcuRow1) {
+    const int srcChannels = ImageProcessor::packedChannels(img);
+    const size_t paddedWidth = static_cast<size_t>(e.mcusPerRow) * e.mcuWidth;
+    const int stripHeight = (mcuRow1 - mcuRow0) * e.mcuHeight;
+    const size_t planeSize = paddedWidth * stripHeight;
+
+    // Level-shifted Y, Cb, Cr at full resolution; edges are replicated out
+    // to whole MCUs
+    ScratchArray<uint8_t> row(static_cast<size_t>(img.width) * srcChannels);
+    ScratchArray<float> planes(planeSize * e.components);
+    for (int r = 0; r < stripHeight; ++r) {
+        int y = std::min(mcuRow0 * e.mcuHeight + r, e.height - 1);
+        ImageProcessor::packRow(img, y, row.data());
+        float* Y = planes.data() + static_cast<size_t>(r) * paddedWidth;
+        for (size_t x = 0; x < paddedWidth; ++x) {
+            const uint8_t* p = row.data() + std::min<size_t>(x, e.width - 1) * srcChannels;
+            if (e.components == 1) {
+                Y[x] = p[0] - 128.0f;
+                continue;
+            }
+            float R = p[0], G = p[1], B = p[2];
+            Y[x]                 =  0.29900f * R + 0.58700f * G + 0.11400f * B - 128.0f;
+            Y[x + planeSize]     = -0.16874f * R - 0.33126f * G + 0.50000f * B;
+            Y[x + 2 * planeSize] =  0.50000f * R - 0.41869f * G - 0.08131f * B;
+        }
+    }
+
+    std::vector<uint8_t> out;
+    out.reserve(planeSize / 4);
+    BitWriter bits(out);
+    float block[64];
+    const float chromaScale = 1.0f / (e.hs * e.vs);
+
+    for (int mr = mcuRow0; mr < mcuRow1; ++mr) {
+        int prevDc[3] = {0, 0, 0};
+        const size_t top = static_cast<size_t>(mr - mcuRow0) * e.mcuHeight;
+        for (int mx = 0; mx < e.mcusPerRow; ++mx) {
+            const size_t left = static_cast<size_t>(mx) * e.mcuWidth;
+
+            for (int by = 0; by < e.vs; ++by) {
+                for (int bx = 0; bx < e.hs; ++bx) {
+                    const float* src = planes.data() + (top + by * 8) * paddedWidth + left + bx * 8;
+                    for (int j = 0; j < 8; ++j)
+                        std::memcpy(block + j * 8, src + j * paddedWidth, 8 * sizeof(float));
+                    encodeBlock(bits, block, e.divisors[0], e.dc[0], e.ac[0], prevDc[0]);
+                }
+            }
+
+            for (int c = 1; c < e.components; ++c) {
+                // Box-filtered down to one sample per hs x vs luma samples
+                const float* plane = planes.data() + c * planeSize;
+                for (int j = 0; j < 8; ++j) {
+                    for (int i = 0; i < 8; ++i) {
+                        const float* s = plane + (top + j * e.vs) * paddedWidth + left + i * e.hs;
+                        float sum = 0.0f;
+                        for (int dy = 0; dy < e.vs; ++dy)
+                            for (int dx = 0; dx < e.hs; ++dx)
+                                sum += s[dy * paddedWidth + dx];
+                        block[j * 8 + i] = sum * chromaScale;
+                    }
+                }
+                encodeBlock(bits, block, e.divisors[1], e.dc[1], e.ac[1], prevDc[c]);
+            }
+        }
+
+        bits.flush();
+        // One restart interval per MCU row: RST0..RST7 cycle through the image
+        if (mr < e.mcuRows - 1)
+            bits.marker(static_cast<uint8_t>(0xD0 + (mr & 7)));
+    }
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// File structure
+// ---------------------------------------------------------------------------
+
+void put16(std::vector<uint8_t>& out, int v) {
+    out.push_back(static_cast<uint8_t>(v >> 8));
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+void putHuffTable(std::vector<uint8_t>& out, int tableClass, int id,
+                  const uint8_t* counts, const uint8_t* values) {
+    int n = 0;
+    for (int i = 0; i < 16; ++i) n += counts[i];
+    out.push_back(static_cast<uint8_t>((tableClass << 4) | id));
+    out.insert(out.end(), counts, counts + 16);
+    out.insert(out.end(), values, values + n);
+}
+
+// SOI through SOS
+std::vector<uint8_t> buildHeader(const Encoder& e) {
+    const int tables = e.components == 3 ? 2 : 1;
+    std::vector<uint8_t> h;
+
+    h.insert(h.end(), {0xFF, 0xD8});  // SOI
+
+    // APP0 JFIF 1.01, no density, no thumbnail
+    h.insert(h.end(), {0xFF, 0xE0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0x00,
+                       0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00});
+
+    h.insert(h.end(), {0xFF, 0xDB});  // DQT
+    put16(h, 2 + 65 * tables);
+    for (int t = 0; t < tables; ++t) {
+        h.push_back(static_cast<uint8_t>(t));
+        for (int i = 0; i < 64; ++i) h.push_back(e.quant[t][ZIGZAG[i]]);
+    }
+
+    h.insert(h.end(), {0xFF, 0xC0});  // SOF0 baseline
+    put16(h, 8 + 3 * e.components);
+    h.push_back(8);
+    put16(h, e.height);
+    put16(h, e.width);
+    h.push_back(static_cast<uint8_t>(e.components));
+    for (int c = 0; c < e.components; ++c) {
+        h.push_back(static_cast<uint8_t>(c + 1));
+        h.push_back(c == 0 ? static_cast<uint8_t>((e.hs << 4) | e.vs) : 0x11);
+        h.push_back(c == 0 ? 0 : 1);
+    }
+
+    h.insert(h.end(), {0xFF, 0xC4});  // DHT
+    put16(h, 2 + (17 + 12) + (17 + 162) + (tables == 2 ? (17 + 12) + (17 + 162) : 0));
+    putHuffTable(h, 0, 0, DC_LUMA_COUNTS, DC_VALUES);
+    putHuffTable(h, 1, 0, AC_LUMA_COUNTS, AC_LUMA_VALUES);
+    if (tables == 2) {
+        putHuffTable(h, 0, 1, DC_CHROMA_COUNTS, DC_VALUES);
+        putHuffTable(h, 1, 1, AC_CHROMA_COUNTS, AC_CHROMA_VALUES);
+    }
+
+    h.insert(h.end(), {0xFF, 0xDD});  // DRI: one MCU row per interval
+    put16(h, 4);
+    put16(h, e.mcusPerRow);
+
+    h.insert(h.end(), {0xFF, 0xDA});  // SOS
+    put16(h, 6 + 2 * e.components);
+    h.push_back(static_cast<uint8_t>(e.components));
+    for (int c = 0; c < e.components; ++c) {
+        h.push_back(static_cast<uint8_t>(c + 1));
+        h.push_back(c == 0 ? 0x00 : 0x11);
+    }
+    h.insert(h.end(), {0x00, 0x3F, 0x00});  // full spectral range, no approximation
+    return h;
+}
+
+} // namespace
+
+namespace JpegWriter {
+
+bool encode(const ImageBuffer& img, const Options& options, const Sink& sink,
+            std::atomic<float>* progress) {
+    const int channels = ImageProcessor::packedChannels(img);
+    if (!img.valid() || !sink || channels < 1 || channels > 4) return false;
+    if (img.width > MAX_DIMENSION || img.height > MAX_DIMENSION) return false;
+    if (progress) progress->store(0.0f);
+
+    ThreadPool& pool = options.pool ? *options.pool : ThreadPool::shared();
+    const Encoder enc = makeEncoder(img, options);
+
+    std::vector<uint8_t> header = buildHeader(enc);
+    if (!sink(header.data(), header.size())) return false;
+
+    const int stripRows = std::max(1, options.stripMcuRows);
+    const int numStrips = (enc.mcuRows + stripRows - 1) / stripRows;
+
+    // Strips are encoded ahead of the writer by at most two per worker
+    const int maxInFlight = static_cast<int>(pool.size()) * 2;
+    std::deque<std::future<std::vector<uint8_t>>> inFlight;
+    int submitted = 0;
+    auto submitNext = [&] {
+        int row0 = submitted * stripRows;
+        int row1 = std::min(enc.mcuRows, row0 + stripRows);
+        inFlight.push_back(pool.submit([&img, &enc, row0, row1] {
+            return encodeStrip(img, enc, row0, row1);
+        }));
+        ++submitted;
+    };
+
+    bool ok = true;
+    for (int written = 0; written < numStrips && ok; ++written) {
+        while (submitted < numStrips && static_cast<int>(inFlight.size()) < maxInFlight)
+            submitNext();
+        std::vector<uint8_t> strip;
+        try {
+            strip = inFlight.front().get();
+        } catch (...) {
+            // Out of memory in a worker: finish as a failed write
+            inFlight.pop_front();
+            ok = false;
+            break;
+        }
+        inFlight.pop_front();
+        ok = sink(strip.data(), strip.size());
+        if (progress) progress->store(static_cast<float>(written + 1) / numStrips);
+    }
+    // Workers reference `img` and `enc`: never return while any are still running
+    for (auto& f : inFlight) f.wait();
+    if (!ok) return false;
+
+    static const uint8_t EOI[2] = {0xFF, 0xD9};
+    return sink(EOI, 2);
+}
+
+bool writeFile(const std::string& path, const ImageBuffer& img, const Options& options,
+               std::atomic<float>* progress) {
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = encode(img, options, [f](const uint8_t* data, size_t size) {
+        return std::fwrite(data, 1, size, f) == size;
+    }, progress);
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok) std::remove(path.c_str());
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// Size budget
+// ---------------------------------------------------------------------------
+
+namespace {
+
+constexpr float RESIZE_STEP = 0.85f;    // per side, per step
+constexpr int MIN_RESIZE_SIDE = 16;
+
+// Highest quality in [lo, hi] whose encode of `img` fits; 0 if none does.
+// The winning file goes to `file`.
+int searchQuality(const ImageBuffer& img, const Options& options, const Budget& budget,
+                  int lo, int hi, std::vector<uint8_t>& file, int& encodes,
+                  std::atomic<float>* progress) {
+    const int span = hi - lo + 1;
+    const int k = std::max(1, budget.candidates);
+    int best = 0;
+
+    while (lo <= hi) {
+        // Evenly spread over [lo, hi], always including hi
+        const int n = hi - lo + 1;
+        std::vector<int> qualities;
+        for (int i = 0; i < k; ++i) {
+            int q = lo - 1 + static_cast<int>(static_cast<int64_t>(n) * (i + 1) / k);
+            if (q >= lo && (qualities.empty() || q != qualities.back())) qualities.push_back(q);
+        }
+
+        struct Candidate {
+            std::vector<uint8_t> file;
+            bool fits = false;
+            bool tooBig = false;
+        };
+        std::vector<Candidate> candidates(qualities.size());
+        std::atomic<int> roundBest{0};
+        std::vector<std::future<void>> running;
+        running.reserve(qualities.size());
+        const ThreadPool::Priority priority = ThreadPool::currentPriority();
+        for (size_t i = 0; i < qualities.size(); ++i) {
+            // Threads of their own: encode() blocks on the strips it hands the pool
+            running.push_back(std::async(std::launch::async, [&, i] {
+                ThreadPool::PriorityScope scope(priority);
+                Candidate& c = candidates[i];
+                const int q = qualities[i];
+                Options candidate = options;
+                candidate.quality = q;
+                bool ok = encode(img, candidate, [&](const uint8_t* data, size_t size) {
+                    if (c.file.size() + size > budget.bytes) {
+                        c.tooBig = true;
+                        return false;
+                    }
+                    if (roundBest.load(std::memory_order_relaxed) > q) return false;
+                    c.file.insert(c.file.end(), data, data + size);
+                    return true;
+                });
+                if (!ok) {
+                    c.file = {};
+                    return;
+                }
+                c.fits = true;
+                int seen = roundBest.load();
+                while (seen < q && !roundBest.compare_exchange_weak(seen, q)) {}
+            }));
+        }
+        for (auto& task : running) task.wait();
+        for (auto& task : running) task.get();    // rethrows out of memory
+        encodes += static_cast<int>(qualities.size());
+
+        // Fits up to candidate `f`; the next one up bounds the range from above
+        int f = -1;
+        for (size_t i = 0; i < qualities.size(); ++i)
+            if (candidates[i].fits) f = static_cast<int>(i);
+        if (f >= 0) {
+            best = qualities[f];
+            file = std::move(candidates[f].file);
+            lo = best + 1;
+        }
+        for (size_t i = f + 1; i < qualities.size(); ++i) {
+            if (candidates[i].tooBig) {
+                hi = qualities[i] - 1;
+                break;
+            }
+        }
+        if (f < 0 && !candidates.empty() && !candidates[0].tooBig) break;    // encode failed
+        if (progress)
+            progress->store(1.0f - static_cast<float>(std::max(0, hi - lo + 1)) / span);
+    }
+    return best;
+}
+
+} // namespace
+
+bool encodeToBudget(const ImageBuffer& img, const Options& options, const Budget& budget,
+                    BudgetResult& result, std::atomic<float>* progress) {
+    result = {};
+    if (!img.valid() || budget.bytes == 0) return false;
+    const int maxQuality = std::clamp(options.quality, 1, 100);
+    const int minQuality = std::clamp(budget.minQuality, 1, maxQuality);
+
+    ImageBuffer scaled;
+    const ImageBuffer* src = &img;
+    float scale = 1.0f;
+    while (true) {
+        // Below full size, one encode at minQuality rules a step out before
+        // a whole search is spent on it
+        std::vector<uint8_t> file;
+        int quality = 0;
+        if (src == &img || searchQuality(*src, options, budget, minQuality, minQuality, file,
+                                         result.encodes, nullptr) > 0) {
+            const int lo = src == &img ? minQuality : minQuality + 1;
+            quality = searchQuality(*src, options, budget, lo, maxQuality, file,
+                                    result.encodes, progress);
+            if (quality == 0 && src != &img) quality = minQuality;
+        }
+        if (quality > 0) {
+            result.file = std::move(file);
+            result.quality = quality;
+            result.width = src->width;
+            result.height = src->height;
+            if (progress) progress->store(1.0f);
+            return true;
+        }
+        if (!budget.allowResize) return false;
+
+        scale *= RESIZE_STEP;
+        int w = static_cast<int>(img.width * scale);
+        int h = static_cast<int>(img.height * scale);
+        if (std::min(w, h) < MIN_RESIZE_SIDE) return false;
+        scaled = ImageProcessor::downscale(img, w, h);
+        if (!scaled.valid()) return false;
+        src = &scaled;
+    }
+}
+
+bool encodeForSettings(const ImageBuffer& img, const Settings& settings, BudgetResult& result,
+                       std::atomic<float>* progress) {
+    Options options;
+    options.quality = settings.jpegExportQuality;
+    options.subsampling = settings.jpegSubsampling;
+    if (settings.jpegTargetKB > 0) {
+        Budget budget;
+        budget.bytes = static_cast<size_t>(settings.jpegTargetKB) * 1024;
+        // Rather fewer pixels than quality this low
+        budget.minQuality = settings.jpegTargetResize ? 40 : 1;
+        budget.allowResize = settings.jpegTargetResize;
+        return encodeToBudget(img, options, budget, result, progress);
+    }
+
+    result = {};
+    bool ok = encode(img, options, [&](const uint8_t* data, size_t size) {
+        result.file.insert(result.file.end(), data, data + size);
+        return true;
+    }, progress);
+    result.quality = options.quality;
+    result.width = img.width;
+    result.height = img.height;
+    result.encodes = 1;
+    return ok;
+}
+
+} // namespace JpegWriter
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "ImageProcessor.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// ---------------------------------------------------------------------------
+// JpegWriter - multithreaded baseline JPEG encoder
+//
+// The image is cut into horizontal strips of whole MCU rows that are encoded
+// on a ThreadPool. The restart interval is one MCU row, so every strip starts
+// with fresh DC predictors and the strips are joined with RSTn markers in
+// order. Quantization and Huffman tables are the standard ones from Annex K.
+// ---------------------------------------------------------------------------
+
+namespace JpegWriter {
+
+struct Options {
+    int quality = 90;                                       // 1..100, IJG table scaling
+    JpegSubsampling subsampling = JpegSubsampling::S420;
+    int stripMcuRows = 4;                                   // MCU rows per parallel strip
+    ThreadPool* pool = nullptr;                             // nullptr = ThreadPool::shared()
+};
+
+// Receives the file front to back; returning false aborts the encode
+using Sink = std::function<bool(const uint8_t* data, size_t size)>;
+
+// 1-2 channels are written as grayscale, 3-4 as YCbCr (alpha is dropped).
+// Any PixelLayout is accepted; both dimensions must be at most 65535.
+// `progress`, if given, goes from 0 to 1 as strips are written.
+bool encode(const ImageBuffer& img, const Options& options, const Sink& sink,
+            std::atomic<float>* progress = nullptr);
+
+// encode() into a file; a partially written file is removed on failure
+bool writeFile(const std::string& path, const ImageBuffer& img, const Options& options,
+               std::atomic<float>* progress = nullptr);
+
+// ---------------------------------------------------------------------------
+// Size budget: the highest quality up to Options::quality whose file fits in
+// `bytes`. Each round encodes `candidates` qualities spread over the range
+// still open, every one on a thread of its own with its strips on the pool;
+// a candidate stops as soon as its output passes the budget or a higher
+// quality has already fit, and the next round searches between the best fit
+// and the lowest quality above it that did not. With allowResize the search
+// is repeated at steps of 85% of the width and height while even minQuality
+// is too big. Only the winning file is kept.
+// ---------------------------------------------------------------------------
+
+struct Budget {
+    size_t bytes = 0;
+    int minQuality = 1;
+    bool allowResize = false;
+    int candidates = 4;                                     // encodes per round
+};
+
+struct BudgetResult {
+    std::vector<uint8_t> file;
+    int quality = 0;
+    int width = 0;                                          // smaller than the image
+    int height = 0;                                         // after a resize step
+    int encodes = 0;                                        // candidates started
+};
+
+// False if nothing fits, even at the smallest size allowed
+bool encodeToBudget(const ImageBuffer& img, const Options& options, const Budget& budget,
+                    BudgetResult& result, std::atomic<float>* progress = nullptr);
+
+// The JPEG an export with `settings` produces: jpegExportQuality and
+// jpegSubsampling, searched against Settings::jpegTargetKB when it is set
+bool encodeForSettings(const ImageBuffer& img, const Settings& settings, BudgetResult& result,
+                       std::atomic<float>* progress = nullptr);
+
+} // namespace JpegWriter
@@ -0,0 +1,385 @@
+#include "Kernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SHAKAL_KERNELS_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace Kernels {
+
+// One per KernelsXxx.cpp; nullptr where the architecture doesn't match
+const Table* scalarTable();
+const Table* sse2Table();
+const Table* avx2Table();
+const Table* avx512Table();
+const Table* neonTable();
+
+} // namespace Kernels
+
+namespace {
+
+using Kernels::Level;
+using Kernels::Table;
+
+const Level ALL_LEVELS[] = {Level::Scalar, Level::SSE2, Level::AVX2, Level::AVX512, Level::NEON};
+
+#ifdef SHAKAL_KERNELS_X86
+struct CpuidRegs {
+    uint32_t eax = 0, ebx = 0, ecx = 0, edx = 0;
+};
+
+CpuidRegs cpuid(uint32_t leaf, uint32_t subleaf) {
+    CpuidRegs r;
+#if defined(_MSC_VER)
+    int regs[4];
+    __cpuidex(regs, static_cast<int>(leaf), static_cast<int>(subleaf));
+    r = {static_cast<uint32_t>(regs[0]), static_cast<uint32_t>(regs[1]),
+         static_cast<uint32_t>(regs[2]), static_cast<uint32_t>(regs[3])};
+#else
+    if (!__get_cpuid_count(leaf, subleaf, &r.eax, &r.ebx, &r.ecx, &r.edx)) return {};
+#endif
+    return r;
+}
+
+// Register state the OS saves on context switch (XCR0)
+uint64_t osSavedState() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (static_cast<uint64_t>(hi) << 32) | lo;
+#endif
+}
+
+bool cpuSupports(Level level) {
+    const CpuidRegs basic = cpuid(0, 0);
+    const CpuidRegs f1 = cpuid(1, 0);
+    const CpuidRegs f7 = basic.eax >= 7 ? cpuid(7, 0) : CpuidRegs{};
+    const bool osxsave = (f1.ecx >> 27) & 1;
+    const uint64_t xcr0 = osxsave ? osSavedState() : 0;
+    const bool ymm = (f1.ecx >> 28 & 1) && (xcr0 & 0x6) == 0x6;        // AVX, XMM+YMM state
+    const bool zmm = ymm && (xcr0 & 0xE0) == 0xE0;                     // opmask, ZMM state
+
+    switch (level) {
+    case Level::Scalar: return true;
+    case Level::SSE2:   return (f1.edx >> 26) & 1;
+    case Level::AVX2:   return ymm && ((f7.ebx >> 5) & 1);
+    case Level::AVX512: {
+        // F, DQ, BW, VL
+        const uint32_t bits = (1u << 16) | (1u << 17) | (1u << 30) | (1u << 31);
+        return zmm && ((f7.ebx >> 5) & 1) && (f7.ebx & bits) == bits;
+    }
+    case Level::NEON:   return false;
+    }
+    return false;
+}
+#else
+// Off x86 the NEON table only exists where NEON is part of the target
+bool cpuSupports(Level level) {
+    return level == Level::Scalar || level == Level::NEON;
+}
+#endif
+
+const Table* builtTable(Level level) {
+    switch (level) {
+    case Level::Scalar: return Kernels::scalarTable();
+    case Level::SSE2:   return Kernels::sse2Table();
+    case Level::AVX2:   return Kernels::avx2Table();
+    case Level::AVX512: return Kernels::avx512Table();
+    case Level::NEON:   return Kernels::neonTable();
+    }
+    return nullptr;
+}
+
+const Table* initialTable() {
+    if (const char* env = std::getenv("SHAKAL_KERNELS"); env && *env) {
+        Level level;
+        if (!Kernels::parseLevel(env, level))
+            std::fprintf(stderr, "SHAKAL_KERNELS: unknown level '%s'\n", env);
+        else if (const Table* t = Kernels::tableFor(level))
+            return t;
+        else
+            std::fprintf(stderr, "SHAKAL_KERNELS: %s is not available here\n", env);
+    }
+    return Kernels::tableFor(Kernels::detect());
+}
+
+std::atomic<const Table*> s_active{nullptr};
+
+// ---- Verification -----------------------------------------------------------
+
+// Runs one kernel through `cases` randomized calls on `t` and on the scalar
+// table; `run(table, rng, out)` must draw its inputs from `rng` only
+template <typename Fn>
+bool sameAsScalar(const Table& t, const Table& scalar, int cases, Fn&& run) {
+    std::vector<uint8_t> expected, actual;
+    for (int i = 0; i < cases; ++i) {
+        std::mt19937 rngA(1234 + i), rngB(1234 + i);
+        expected.clear();
+        actual.clear();
+        run(scalar, rngA, expected);
+        run(t, rngB, actual);
+        if (expected != actual) return false;
+    }
+    return true;
+}
+
+template <typename T>
+void appendBytes(std::vector<uint8_t>& out, const T* data, size_t count) {
+    const auto* bytes = reinterpret_cast<const uint8_t*>(data);
+    out.insert(out.end(), bytes, bytes + count * sizeof(T));
+}
+
+std::vector<uint8_t> randomBytes(std::mt19937& rng, size_t n) {
+    std::vector<uint8_t> v(n);
+    for (auto& b : v) b = static_cast<uint8_t>(rng());
+    return v;
+}
+
+int randomInt(std::mt19937& rng, int lo, int hi) {
+    return std::uniform_int_distribution<int>(lo, hi)(rng);
+}
+
+std::string verifyTable(const Table& t, const Table& scalar) {
+    std::string failed;
+    auto check = [&](const char* kernel, bool ok) {
+        if (!ok) failed += failed.empty() ? kernel : std::string(", ") + kernel;
+    };
+
+    check("nearestPalette", sameAsScalar(t, scalar, 40, [](const Table& k, std::mt19937& rng,
+                                                           std::vector<uint8_t>& out) {
+        const int stride = randomInt(rng, 3, 4);
+        const size_t count = static_cast<size_t>(randomInt(rng, 1, 700));
+        const int size = randomInt(rng, 1, 256);
+        std::vector<uint8_t> pixels = randomBytes(rng, count * stride);
+        std::vector<float> pal(3 * 256);
+        // Few distinct values so ties between entries actually happen
+        for (auto& v : pal) v = static_cast<float>(randomInt(rng, 0, 7) * 36);
+        std::vector<uint8_t> indices(count);
+        k.nearestPalette(pixels.data(), count, stride, pal.data(), pal.data() + 256,
+                         pal.data() + 512, size, indices.data());
+        appendBytes(out, indices.data(), count);
+    }));
+
+    check("convolveRows", sameAsScalar(t, scalar, 40, [](const Table& k, std::mt19937& rng,
+                                                         std::vector<uint8_t>& out) {
+        const int taps = randomInt(rng, 1, 33);
+        const int width = randomInt(rng, 1, 1000);
+        std::vector<uint8_t> data = randomBytes(rng, static_cast<size_t>(taps) * width);
+        std::vector<const uint8_t*> rows(taps);
+        std::vector<float> weights(taps);
+        for (int i = 0; i < taps; ++i) {
+            rows[i] = data.data() + static_cast<size_t>(i) * width;
+            weights[i] = std::uniform_real_distribution<float>(-0.5f, 1.0f)(rng);
+        }
+        std::vector<float> acc(width);
+        std::vector<uint8_t> row(width);
+        k.convolveRows(rows.data(), weights.data(), taps, width, acc.data(), row.data());
+        appendBytes(out, row.data(), row.size());
+    }));
+
+    check("bilinearRow", sameAsScalar(t, scalar, 40, [](const Table& k, std::mt19937& rng,
+                                                        std::vector<uint8_t>& out) {
+        const int channels = randomInt(rng, 1, 4);
+        const int srcWidth = randomInt(rng, 1, 300);
+        const int width = randomInt(rng, 1, 1000);
+        std::vector<uint8_t> top = randomBytes(rng, static_cast<size_t>(srcWidth) * channels);
+        std::vector<uint8_t> bottom = randomBytes(rng, top.size());
+        std::vector<int32_t> x0(width), x1(width);
+        std::vector<float> xf(width);
+        for (int x = 0; x < width; ++x) {
+            x0[x] = randomInt(rng, 0, srcWidth - 1);
+            x1[x] = std::min(x0[x] + 1, srcWidth - 1);
+            xf[x] = std::uniform_real_distribution<float>(0.f, 1.f)(rng);
+        }
+        const float yf = std::uniform_real_distribution<float>(0.f, 1.f)(rng);
+        std::vector<uint8_t> row(static_cast<size_t>(width) * channels);
+        k.bilinearRow(top.data(), bottom.data(), x0.data(), x1.data(), xf.data(), yf,
+                      width, channels, row.data());
+        appendBytes(out, row.data(), row.size());
+    }));
+
+    check("addOffsets", sameAsScalar(t, scalar, 40, [](const Table& k, std::mt19937& rng,
+                                                       std::vector<uint8_t>& out) {
+        const int channels = randomInt(rng, 3, 4);
+        static const int STRIDES[] = {0, 1, 3};
+        const int stride = STRIDES[randomInt(rng, 0, 2)];
+        const int width = randomInt(rng, 1, 1000);
+        std::vector<uint8_t> pixels = randomBytes(rng, static_cast<size_t>(width) * channels);
+        std::vector<int32_t> offsets(static_cast<size_t>(width) * 3);
+        for (auto& o : offsets) o = randomInt(rng, -300, 300);
+        k.addOffsets(pixels.data(), width, channels, offsets.data(), stride);
+        appendBytes(out, pixels.data(), pixels.size());
+    }));
+
+    check("shiftChannels", sameAsScalar(t, scalar, 40, [](const Table& k, std::mt19937& rng,
+                                                          std::vector<uint8_t>& out) {
+        const int channels = randomInt(rng, 3, 4);
+        const int width = randomInt(rng, 1, 1000);
+        const size_t rowBytes = static_cast<size_t>(width) * channels;
+        std::vector<uint8_t> data = randomBytes(rng, rowBytes * 4);
+        const uint8_t* rows[3] = {data.data(), data.data() + rowBytes, data.data() + 2 * rowBytes};
+        int dx[3];
+        for (int& d : dx) d = randomInt(rng, -width - 4, width + 4);
+        uint8_t* dst = data.data() + 3 * rowBytes;
+        k.shiftChannels(rows, dx, width, channels, dst);
+        appendBytes(out, dst, rowBytes);
+    }));
+
+    check("lerpChannel", sameAsScalar(t, scalar, 40, [](const Table& k, std::mt19937& rng,
+                                                        std::vector<uint8_t>& out) {
+        const int channels = randomInt(rng, 3, 4);
+        const int width = randomInt(rng, 1, 1000);
+        const size_t rowBytes = static_cast<size_t>(width) * channels;
+        std::vector<uint8_t> data = randomBytes(rng, rowBytes * 3);
+        const int dx = randomInt(rng, -width - 4, width + 4);
+        const float fx = std::uniform_real_distribution<float>(0.f, 1.f)(rng);
+        const float fy = std::uniform_real_distribution<float>(0.f, 1.f)(rng);
+        const int c = randomInt(rng, 0, 2);
+        uint8_t* dst = data.data() + 2 * rowBytes;
+        k.lerpChannel(data.data(), data.data() + rowBytes, dx, fx, fy, width, channels, c, dst);
+        appendBytes(out, dst, rowBytes);
+    }));
+
+    check("blendMask", sameAsScalar(t, scalar, 40, [](const Table& k, std::mt19937& rng,
+                                                      std::vector<uint8_t>& out) {
+        const int channels = randomInt(rng, 3, 4);
+        const int width = randomInt(rng, 1, 1000);
+        std::vector<uint8_t> pixels = randomBytes(rng, static_cast<size_t>(width) * channels);
+        std::vector<uint8_t> mask = randomBytes(rng, width);
+        std::vector<uint8_t> color = randomBytes(rng, 3);
+        k.blendMask(pixels.data(), mask.data(), width, channels, color.data(),
+                    randomInt(rng, 0, 255));
+        appendBytes(out, pixels.data(), pixels.size());
+    }));
+
+    check("fdct8x8", sameAsScalar(t, scalar, 200, [](const Table& k, std::mt19937& rng,
+                                                     std::vector<uint8_t>& out) {
+        float block[64];
+        for (float& v : block) v = std::uniform_real_distribution<float>(-128.f, 127.f)(rng);
+        k.fdct8x8(block);
+        appendBytes(out, block, 64);
+    }));
+
+    check("squaredError", sameAsScalar(t, scalar, 40, [](const Table& k, std::mt19937& rng,
+                                                         std::vector<uint8_t>& out) {
+        const int ca = randomInt(rng, 3, 4), cb = randomInt(rng, 3, 4);
+        const int width = randomInt(rng, 1, 1000);
+        std::vector<uint8_t> a = randomBytes(rng, static_cast<size_t>(width) * ca);
+        std::vector<uint8_t> b = randomBytes(rng, static_cast<size_t>(width) * cb);
+        uint64_t sums[3] = {1, 2, 3};
+        k.squaredError(a.data(), ca, b.data(), cb, width, sums);
+        appendBytes(out, sums, 3);
+    }));
+
+    check("ssimMoments", sameAsScalar(t, scalar, 40, [](const Table& k, std::mt19937& rng,
+                                                        std::vector<uint8_t>& out) {
+        const int ca = randomInt(rng, 3, 4), cb = randomInt(rng, 3, 4);
+        const int blocks = randomInt(rng, 1, 130);
+        std::vector<uint8_t> a = randomBytes(rng, static_cast<size_t>(blocks) * 8 * ca);
+        std::vector<uint8_t> b = randomBytes(rng, static_cast<size_t>(blocks) * 8 * cb);
+        std::vector<uint32_t> moments(static_cast<size_t>(blocks) * 5, 7);
+        k.ssimMoments(a.data(), ca, b.data(), cb, blocks, moments.data());
+        appendBytes(out, moments.data(), moments.size());
+    }));
+
+    check("hashStripes", sameAsScalar(t, scalar, 40, [](const Table& k, std::mt19937& rng,
+                                                        std::vector<uint8_t>& out) {
+        const size_t stripes = static_cast<size_t>(randomInt(rng, 1, 100));
+        std::vector<uint8_t> data = randomBytes(rng, stripes * 64);
+        uint64_t lanes[8];
+        for (auto& l : lanes) l = (static_cast<uint64_t>(rng()) << 32) | rng();
+        k.hashStripes(data.data(), stripes, lanes);
+        appendBytes(out, lanes, 8);
+    }));
+
+    return failed;
+}
+
+} // namespace
+
+namespace Kernels {
+
+const char* levelName(Level level) {
+    switch (level) {
+    case Level::Scalar: return "scalar";
+    case Level::SSE2:   return "sse2";
+    case Level::AVX2:   return "avx2";
+    case Level::AVX512: return "avx512";
+    case Level::NEON:   return "neon";
+    }
+    return "?";
+}
+
+bool parseLevel(const char* name, Level& level) {
+    for (Level l : ALL_LEVELS) {
+        if (std::strcmp(name, levelName(l)) == 0) {
+            level = l;
+            return true;
+        }
+    }
+    return false;
+}
+
+Level detect() {
+    Level best = Level::Scalar;
+    for (Level l : ALL_LEVELS)
+        if (tableFor(l)) best = l;   // ALL_LEVELS is in increasing order per architecture
+    return best;
+}
+
+const Table* tableFor(Level level) {
+    return cpuSupports(level) ? builtTable(level) : nullptr;
+}
+
+const Table& table() {
+    const Table* t = s_active.load(std::memory_order_acquire);
+    if (!t) {
+        const Table* initial = initialTable();
+        s_active.compare_exchange_strong(t, initial, std::memory_order_acq_rel);
+        t = s_active.load(std::memory_order_acquire);
+    }
+    return *t;
+}
+
+bool force(Level level) {
+    const Table* t = tableFor(level);
+    if (!t) return false;
+    s_active.store(t, std::memory_order_release);
+    return true;
+}
+
+bool verify() {
+    const Table* scalar = scalarTable();
+    bool ok = true;
+    for (Level level : ALL_LEVELS) {
+        if (level == Level::Scalar) continue;
+        const Table* t = tableFor(level);
+        if (!t) {
+            std::fprintf(stderr, "Kernels: %s: not available\n", levelName(level));
+            continue;
+        }
+        std::string failed = verifyTable(*t, *scalar);
+        std::fprintf(stderr, "Kernels: %s: %s%s\n", levelName(level),
+                     failed.empty() ? "matches scalar" : "MISMATCH in ", failed.c_str());
+        ok = ok && failed.empty();
+    }
+    std::fprintf(stderr, "Kernels: active %s\n", table().name);
+    return ok;
+}
+
+} // namespace Kernels
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// ---------------------------------------------------------------------------
+// Kernels - hot inner loops built once per instruction set
+//
+// KernelsImpl.h holds the loops as plain C++ written for the vectorizer.
+// KernelsScalar/Sse2/Avx2/Avx512/Neon.cpp each compile it with their own
+// target flags (see CMakeLists.txt), and table() hands out the best level
+// this CPU supports. Every level computes bit-identical results: the Scalar
+// level (vectorization off) is the reference, verify() checks the others
+// against it, and force() pins a level for benchmarking.
+//
+// The level can also be pinned with SHAKAL_KERNELS=scalar|sse2|avx2|avx512|neon
+// in the environment or with --kernels LEVEL on the command line.
+// ---------------------------------------------------------------------------
+
+namespace Kernels {
+
+enum class Level { Scalar, SSE2, AVX2, AVX512, NEON };
+
+struct Table {
+    Level level;
+    const char* name;
+
+    // Index of the nearest palette entry (squared RGB distance, first one on
+    // ties) for `count` RGB pixels `stride` bytes apart. The palette is given
+    // as `size` (<= 256) floats per channel.
+    void (*nearestPalette)(const uint8_t* pixels, size_t count, int stride,
+                           const float* palR, const float* palG, const float* palB,
+                           int size, uint8_t* indices);
+
+    // out[x] = rounded, clamped sum over k of rows[k][x] * weights[k], added
+    // in k order. `acc` is scratch for `width` floats.
+    void (*convolveRows)(const uint8_t* const* rows, const float* weights, int taps,
+                         int width, float* acc, uint8_t* out);
+
+    // One bilinear output row of `channels`-byte pixels: columns x0[x] and
+    // x1[x] of `top` and `bottom` blended by xf[x], then the rows by `yf`
+    void (*bilinearRow)(const uint8_t* top, const uint8_t* bottom,
+                        const int32_t* x0, const int32_t* x1, const float* xf, float yf,
+                        int width, int channels, uint8_t* out);
+
+    // Saturating add to the RGB bytes of `width` pixels: one offset per
+    // channel (offsetStride 3), per pixel (1) or for the whole row (0)
+    void (*addOffsets)(uint8_t* pixels, int width, int channels,
+                       const int32_t* offsets, int offsetStride);
+
+    // Channel c (0..2) of every pixel of `out` from rows[c] at x + dx[c],
+    // clamped to the row; further channels are left alone
+    void (*shiftChannels)(const uint8_t* const* rows, const int* dx, int width,
+                          int channels, uint8_t* out);
+
+    // Channel c of every pixel of `out` sampled between x + dx and x + dx + 1
+    // (weight fx on the right, columns clamped to the row) and between `top`
+    // and `bottom` (weight fy on bottom); other channels are left alone
+    void (*lerpChannel)(const uint8_t* top, const uint8_t* bottom, int dx, float fx,
+                        float fy, int width, int channels, int c, uint8_t* out);
+
+    // `color` over the RGB bytes of `width` pixels with alpha
+    // mask[x] * opacity / 255 (both 0-255), rounded; further channels are
+    // left alone
+    void (*blendMask)(uint8_t* pixels, const uint8_t* mask, int width, int channels,
+                      const uint8_t* color, int opacity);
+
+    // In-place AAN forward DCT of a row-major 8x8 block, rows then columns
+    void (*fdct8x8)(float* block);
+
+    // Per-channel sums of squared differences over the RGB bytes of `width`
+    // pixels of `a` and `b` (aChannels and bChannels bytes apart), added to
+    // sums[0..2]
+    void (*squaredError)(const uint8_t* a, int aChannels, const uint8_t* b, int bChannels,
+                         int width, uint64_t* sums);
+
+    // Luma (77 R + 150 G + 29 B + 128) >> 8 of one row of `a` and of `b`,
+    // summed over 8-pixel blocks: block i adds sum a, sum b, sum a^2, sum b^2
+    // and sum ab to moments[5i .. 5i + 4]. Pixels past the last block are skipped.
+    void (*ssimMoments)(const uint8_t* a, int aChannels, const uint8_t* b, int bChannels,
+                        int blocks, uint32_t* moments);
+
+    // Folds `stripes` 64-byte stripes of `data` into the eight hash lanes
+    // (see ResultCache::hashBytes)
+    void (*hashStripes)(const uint8_t* data, size_t stripes, uint64_t* lanes);
+};
+
+const char* levelName(Level level);
+bool parseLevel(const char* name, Level& level);
+
+// Best level this CPU and build support
+Level detect();
+
+// Table for `level`, or nullptr if this build or CPU lacks it
+const Table* tableFor(Level level);
+
+// The active table: SHAKAL_KERNELS if set and usable, else detect()
+const Table& table();
+
+// Make `level` the active one. False (and no change) if it is unavailable.
+bool force(Level level);
+
+// Run every available level on test patterns against Scalar; reports to
+// stderr and returns false on any mismatch
+bool verify();
+
+} // namespace Kernels
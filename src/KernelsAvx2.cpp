@@ -0,0 +1,11 @@
+// AVX2 kernels: KernelsImpl.h built with AVX2 enabled (flags in CMakeLists.txt)
+#include "Kernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SHAKAL_KERNELS_LEVEL Level::AVX2
+#define SHAKAL_KERNELS_NAME "avx2"
+#define SHAKAL_KERNELS_ENTRY avx2Table
+#include "KernelsImpl.h"
+#else
+namespace Kernels { const Table* avx2Table() { return nullptr; } }
+#endif
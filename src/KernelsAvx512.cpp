@@ -0,0 +1,11 @@
+// AVX-512 kernels: KernelsImpl.h built with AVX-512 F/BW/DQ/VL enabled (flags in CMakeLists.txt)
+#include "Kernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SHAKAL_KERNELS_LEVEL Level::AVX512
+#define SHAKAL_KERNELS_NAME "avx512"
+#define SHAKAL_KERNELS_ENTRY avx512Table
+#include "KernelsImpl.h"
+#else
+namespace Kernels { const Table* avx512Table() { return nullptr; } }
+#endif
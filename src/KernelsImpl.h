@@ -0,0 +1,423 @@
+// Kernel bodies, included once by each KernelsXxx.cpp after it defines
+// SHAKAL_KERNELS_LEVEL, SHAKAL_KERNELS_NAME and SHAKAL_KERNELS_ENTRY.
+//
+// Everything here has internal linkage and avoids standard library templates:
+// an inline function instantiated in a TU built with -mavx2 could otherwise
+// be the copy the linker keeps for the whole program. Keep floating-point
+// expressions in the same order as the scalar code they replace; the TUs are
+// built with -ffp-contract=off so no level fuses multiply-adds.
+
+#include "Kernels.h"
+#include <cstring>
+
+#if defined(_MSC_VER)
+#define SHAKAL_RESTRICT __restrict
+#else
+#define SHAKAL_RESTRICT __restrict__
+#endif
+
+namespace {
+
+inline int clampInt(int v, int lo, int hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+inline uint8_t saturateByte(int v) {
+    return static_cast<uint8_t>(clampInt(v, 0, 255));
+}
+
+// clamp(round(v)) with std::round's halfway-away-from-zero, in a form the
+// vectorizer handles (no libm call)
+inline uint8_t roundToByte(float v) {
+    int i = static_cast<int>(v);
+    float frac = v - static_cast<float>(i);
+    i += static_cast<int>(frac >= 0.5f) - static_cast<int>(frac <= -0.5f);
+    return saturateByte(i);
+}
+
+// ---- Palette search ---------------------------------------------------------
+
+// Pixels go in batches, each compared against every palette entry in turn:
+// the inner loop runs across pixels, so it vectorizes whatever the palette size.
+// Distances are whole numbers below 2^24, so float is exact.
+void nearestPalette(const uint8_t* SHAKAL_RESTRICT pixels, size_t count, int stride,
+                    const float* SHAKAL_RESTRICT palR, const float* SHAKAL_RESTRICT palG,
+                    const float* SHAKAL_RESTRICT palB, int size,
+                    uint8_t* SHAKAL_RESTRICT indices) {
+    constexpr int BATCH = 64;
+    float r[BATCH], g[BATCH], b[BATCH], best[BATCH];
+    int32_t index[BATCH];
+    for (size_t i0 = 0; i0 < count; i0 += BATCH) {
+        const int n = static_cast<int>(count - i0 < BATCH ? count - i0 : BATCH);
+        const uint8_t* p = pixels + i0 * stride;
+        for (int i = 0; i < n; ++i) {
+            r[i] = p[i * stride + 0];
+            g[i] = p[i * stride + 1];
+            b[i] = p[i * stride + 2];
+            best[i] = 1e30f;
+            index[i] = 0;
+        }
+        for (int j = 0; j < size; ++j) {
+            const float pr = palR[j], pg = palG[j], pb = palB[j];
+            for (int i = 0; i < n; ++i) {
+                float dr = r[i] - pr, dg = g[i] - pg, db = b[i] - pb;
+                float d = dr * dr + dg * dg + db * db;
+                // Mask select rather than ?: so SSE2 (no blend) still vectorizes
+                int32_t closer = -static_cast<int32_t>(d < best[i]);
+                index[i] = (index[i] & ~closer) | (j & closer);
+                best[i] = d < best[i] ? d : best[i];
+            }
+        }
+        for (int i = 0; i < n; ++i) indices[i0 + i] = static_cast<uint8_t>(index[i]);
+    }
+}
+
+// ---- Convolution ------------------------------------------------------------
+
+void convolveRows(const uint8_t* const* rows, const float* weights, int taps, int width,
+                  float* SHAKAL_RESTRICT acc, uint8_t* SHAKAL_RESTRICT out) {
+    for (int x = 0; x < width; ++x) acc[x] = 0.f;
+    for (int k = 0; k < taps; ++k) {
+        const uint8_t* SHAKAL_RESTRICT row = rows[k];
+        const float w = weights[k];
+        for (int x = 0; x < width; ++x) acc[x] += row[x] * w;
+    }
+    for (int x = 0; x < width; ++x) out[x] = roundToByte(acc[x]);
+}
+
+// ---- Bilinear resample ------------------------------------------------------
+
+template <int CH>
+void bilinearRowN(const uint8_t* SHAKAL_RESTRICT top, const uint8_t* SHAKAL_RESTRICT bottom,
+                  const int32_t* x0, const int32_t* x1, const float* xf, float yf,
+                  int width, int ch, uint8_t* SHAKAL_RESTRICT out) {
+    const int n = CH ? CH : ch;
+    for (int x = 0; x < width; ++x) {
+        const float f = xf[x];
+        const uint8_t* p00 = top + x0[x] * n;
+        const uint8_t* p10 = top + x1[x] * n;
+        const uint8_t* p01 = bottom + x0[x] * n;
+        const uint8_t* p11 = bottom + x1[x] * n;
+        for (int c = 0; c < n; ++c) {
+            float t = p00[c] * (1 - f) + p10[c] * f;
+            float b = p01[c] * (1 - f) + p11[c] * f;
+            out[x * n + c] = roundToByte(t * (1 - yf) + b * yf);
+        }
+    }
+}
+
+void bilinearRow(const uint8_t* top, const uint8_t* bottom, const int32_t* x0,
+                 const int32_t* x1, const float* xf, float yf, int width, int channels,
+                 uint8_t* out) {
+    switch (channels) {
+    case 1:  bilinearRowN<1>(top, bottom, x0, x1, xf, yf, width, 1, out); break;
+    case 3:  bilinearRowN<3>(top, bottom, x0, x1, xf, yf, width, 3, out); break;
+    case 4:  bilinearRowN<4>(top, bottom, x0, x1, xf, yf, width, 4, out); break;
+    default: bilinearRowN<0>(top, bottom, x0, x1, xf, yf, width, channels, out); break;
+    }
+}
+
+// ---- Noise offsets ----------------------------------------------------------
+
+template <int CH, int STRIDE>
+void addOffsetsN(uint8_t* SHAKAL_RESTRICT pixels, int width, int ch,
+                 const int32_t* SHAKAL_RESTRICT offsets) {
+    const int n = CH ? CH : ch;
+    for (int x = 0; x < width; ++x) {
+        uint8_t* p = pixels + x * n;
+        for (int c = 0; c < 3; ++c) {
+            int o = offsets[x * STRIDE + (STRIDE == 3 ? c : 0)];
+            p[c] = saturateByte(p[c] + o);
+        }
+    }
+}
+
+template <int STRIDE>
+void addOffsetsS(uint8_t* pixels, int width, int channels, const int32_t* offsets) {
+    switch (channels) {
+    case 3:  addOffsetsN<3, STRIDE>(pixels, width, 3, offsets); break;
+    case 4:  addOffsetsN<4, STRIDE>(pixels, width, 4, offsets); break;
+    default: addOffsetsN<0, STRIDE>(pixels, width, channels, offsets); break;
+    }
+}
+
+void addOffsets(uint8_t* pixels, int width, int channels, const int32_t* offsets,
+                int offsetStride) {
+    switch (offsetStride) {
+    case 0:  addOffsetsS<0>(pixels, width, channels, offsets); break;
+    case 1:  addOffsetsS<1>(pixels, width, channels, offsets); break;
+    default: addOffsetsS<3>(pixels, width, channels, offsets); break;
+    }
+}
+
+// ---- Channel shift ----------------------------------------------------------
+
+// Columns that would read left of 0 or right of width - 1 take the edge
+// pixel; the rest is a plain strided copy.
+template <int CH>
+void shiftChannelsN(const uint8_t* const* rows, const int* dx, int width, int ch,
+                    uint8_t* SHAKAL_RESTRICT out) {
+    const int n = CH ? CH : ch;
+    for (int c = 0; c < 3; ++c) {
+        const uint8_t* SHAKAL_RESTRICT src = rows[c];
+        const int d = clampInt(dx[c], -width, width);   // further reads the same edge
+        const int lo = clampInt(-d, 0, width);
+        const int hi = clampInt(width - d, lo, width);
+        for (int x = 0; x < lo; ++x) out[x * n + c] = src[c];
+        for (int x = lo; x < hi; ++x) out[x * n + c] = src[(x + d) * n + c];
+        for (int x = hi; x < width; ++x) out[x * n + c] = src[(width - 1) * n + c];
+    }
+}
+
+void shiftChannels(const uint8_t* const* rows, const int* dx, int width, int channels,
+                   uint8_t* out) {
+    switch (channels) {
+    case 3:  shiftChannelsN<3>(rows, dx, width, 3, out); break;
+    case 4:  shiftChannelsN<4>(rows, dx, width, 4, out); break;
+    default: shiftChannelsN<0>(rows, dx, width, channels, out); break;
+    }
+}
+
+// Channel c of `out` from the bilinear sample of `top` and `bottom` at
+// x + dx + fx, columns clamped to the row. Only the ends clamp; the middle
+// is a plain strided blend.
+template <int CH>
+void lerpChannelN(const uint8_t* SHAKAL_RESTRICT top, const uint8_t* SHAKAL_RESTRICT bottom,
+                  int dx, float fx, float fy, int width, int ch, int c,
+                  uint8_t* SHAKAL_RESTRICT out) {
+    const int n = CH ? CH : ch;
+    dx = clampInt(dx, -width, width);                   // further reads the same edge
+    const int lo = clampInt(-dx, 0, width);
+    const int hi = clampInt(width - 1 - dx, lo, width);
+    auto blend = [&](int x, int a, int b) {
+        float t = top[a * n + c] * (1 - fx) + top[b * n + c] * fx;
+        float u = bottom[a * n + c] * (1 - fx) + bottom[b * n + c] * fx;
+        out[x * n + c] = roundToByte(t * (1 - fy) + u * fy);
+    };
+    for (int x = 0; x < lo; ++x)
+        blend(x, clampInt(x + dx, 0, width - 1), clampInt(x + dx + 1, 0, width - 1));
+    for (int x = lo; x < hi; ++x) {
+        const uint8_t* t = top + (x + dx) * n + c;
+        const uint8_t* u = bottom + (x + dx) * n + c;
+        float a = t[0] * (1 - fx) + t[n] * fx;
+        float b = u[0] * (1 - fx) + u[n] * fx;
+        out[x * n + c] = roundToByte(a * (1 - fy) + b * fy);
+    }
+    for (int x = hi; x < width; ++x)
+        blend(x, clampInt(x + dx, 0, width - 1), clampInt(x + dx + 1, 0, width - 1));
+}
+
+void lerpChannel(const uint8_t* top, const uint8_t* bottom, int dx, float fx, float fy,
+                 int width, int channels, int c, uint8_t* out) {
+    switch (channels) {
+    case 3:  lerpChannelN<3>(top, bottom, dx, fx, fy, width, 3, c, out); break;
+    case 4:  lerpChannelN<4>(top, bottom, dx, fx, fy, width, 4, c, out); break;
+    default: lerpChannelN<0>(top, bottom, dx, fx, fy, width, channels, c, out); break;
+    }
+}
+
+// ---- Mask blend -------------------------------------------------------------
+
+template <int CH>
+void blendMaskN(uint8_t* SHAKAL_RESTRICT pixels, const uint8_t* SHAKAL_RESTRICT mask, int width,
+                int ch, const uint8_t* color, int opacity) {
+    const int n = CH ? CH : ch;
+    const int r = color[0], g = color[1], b = color[2];
+    for (int x = 0; x < width; ++x) {
+        const int a = (mask[x] * opacity + 127) / 255;
+        uint8_t* p = pixels + x * n;
+        p[0] = static_cast<uint8_t>((p[0] * (255 - a) + r * a + 127) / 255);
+        p[1] = static_cast<uint8_t>((p[1] * (255 - a) + g * a + 127) / 255);
+        p[2] = static_cast<uint8_t>((p[2] * (255 - a) + b * a + 127) / 255);
+    }
+}
+
+void blendMask(uint8_t* pixels, const uint8_t* mask, int width, int channels,
+               const uint8_t* color, int opacity) {
+    switch (channels) {
+    case 3:  blendMaskN<3>(pixels, mask, width, 3, color, opacity); break;
+    case 4:  blendMaskN<4>(pixels, mask, width, 4, color, opacity); break;
+    default: blendMaskN<0>(pixels, mask, width, channels, color, opacity); break;
+    }
+}
+
+// ---- Forward DCT ------------------------------------------------------------
+
+// AAN forward DCT (jfdctflt) down all 8 columns at once: lane c of every
+// line is column c, so each statement is an 8-wide vector operation
+void fdctColumns(float* SHAKAL_RESTRICT d) {
+    float tmp0[8], tmp1[8], tmp2[8], tmp3[8], tmp4[8], tmp5[8], tmp6[8], tmp7[8];
+    for (int c = 0; c < 8; ++c) {
+        tmp0[c] = d[0 * 8 + c] + d[7 * 8 + c]; tmp7[c] = d[0 * 8 + c] - d[7 * 8 + c];
+        tmp1[c] = d[1 * 8 + c] + d[6 * 8 + c]; tmp6[c] = d[1 * 8 + c] - d[6 * 8 + c];
+        tmp2[c] = d[2 * 8 + c] + d[5 * 8 + c]; tmp5[c] = d[2 * 8 + c] - d[5 * 8 + c];
+        tmp3[c] = d[3 * 8 + c] + d[4 * 8 + c]; tmp4[c] = d[3 * 8 + c] - d[4 * 8 + c];
+    }
+    for (int c = 0; c < 8; ++c) {
+        // Even part
+        float tmp10 = tmp0[c] + tmp3[c], tmp13 = tmp0[c] - tmp3[c];
+        float tmp11 = tmp1[c] + tmp2[c], tmp12 = tmp1[c] - tmp2[c];
+        d[0 * 8 + c] = tmp10 + tmp11;
+        d[4 * 8 + c] = tmp10 - tmp11;
+        float z1 = (tmp12 + tmp13) * 0.707106781f;
+        d[2 * 8 + c] = tmp13 + z1;
+        d[6 * 8 + c] = tmp13 - z1;
+
+        // Odd part
+        tmp10 = tmp4[c] + tmp5[c];
+        tmp11 = tmp5[c] + tmp6[c];
+        tmp12 = tmp6[c] + tmp7[c];
+        float z5 = (tmp10 - tmp12) * 0.382683433f;
+        float z2 = tmp10 * 0.541196100f + z5;
+        float z4 = tmp12 * 1.306562965f + z5;
+        float z3 = tmp11 * 0.707106781f;
+        float z11 = tmp7[c] + z3, z13 = tmp7[c] - z3;
+        d[5 * 8 + c] = z13 + z2;
+        d[3 * 8 + c] = z13 - z2;
+        d[1 * 8 + c] = z11 + z4;
+        d[7 * 8 + c] = z11 - z4;
+    }
+}
+
+void transpose8x8(float* SHAKAL_RESTRICT d) {
+    for (int r = 0; r < 8; ++r)
+        for (int c = r + 1; c < 8; ++c) {
+            float t = d[r * 8 + c];
+            d[r * 8 + c] = d[c * 8 + r];
+            d[c * 8 + r] = t;
+        }
+}
+
+void fdct8x8(float* block) {
+    // Row pass as a column pass over the transpose
+    transpose8x8(block);
+    fdctColumns(block);
+    transpose8x8(block);
+    fdctColumns(block);
+}
+
+// ---- Image statistics -------------------------------------------------------
+
+// A squared difference is below 2^16, so 32-bit lanes take 2^16 pixels
+// before they are folded into the 64-bit totals
+template <int CA, int CB>
+void squaredErrorN(const uint8_t* SHAKAL_RESTRICT a, int ca, const uint8_t* SHAKAL_RESTRICT b,
+                   int cb, int width, uint64_t* sums) {
+    const int na = CA ? CA : ca, nb = CB ? CB : cb;
+    constexpr int CHUNK = 1 << 16;
+    for (int x0 = 0; x0 < width; x0 += CHUNK) {
+        const int x1 = width - x0 < CHUNK ? width : x0 + CHUNK;
+        uint32_t s0 = 0, s1 = 0, s2 = 0;
+        for (int x = x0; x < x1; ++x) {
+            const int d0 = a[x * na + 0] - b[x * nb + 0];
+            const int d1 = a[x * na + 1] - b[x * nb + 1];
+            const int d2 = a[x * na + 2] - b[x * nb + 2];
+            s0 += static_cast<uint32_t>(d0 * d0);
+            s1 += static_cast<uint32_t>(d1 * d1);
+            s2 += static_cast<uint32_t>(d2 * d2);
+        }
+        sums[0] += s0;
+        sums[1] += s1;
+        sums[2] += s2;
+    }
+}
+
+void squaredError(const uint8_t* a, int aChannels, const uint8_t* b, int bChannels, int width,
+                  uint64_t* sums) {
+    if (aChannels == 4 && bChannels == 4)      squaredErrorN<4, 4>(a, 4, b, 4, width, sums);
+    else if (aChannels == 3 && bChannels == 3) squaredErrorN<3, 3>(a, 3, b, 3, width, sums);
+    else squaredErrorN<0, 0>(a, aChannels, b, bChannels, width, sums);
+}
+
+// Luma of eight blocks at a time into flat arrays, then the block sums over
+// those; a block's sums stay below 2^19 per row
+template <int CA, int CB>
+void ssimMomentsN(const uint8_t* SHAKAL_RESTRICT a, int ca, const uint8_t* SHAKAL_RESTRICT b,
+                  int cb, int blocks, uint32_t* SHAKAL_RESTRICT moments) {
+    const int na = CA ? CA : ca, nb = CB ? CB : cb;
+    constexpr int BATCH = 64;
+    int32_t la[BATCH], lb[BATCH];
+    for (int b0 = 0; b0 < blocks; b0 += BATCH / 8) {
+        const int count = blocks - b0 < BATCH / 8 ? blocks - b0 : BATCH / 8;
+        const uint8_t* pa = a + b0 * 8 * na;
+        const uint8_t* pb = b + b0 * 8 * nb;
+        for (int i = 0; i < count * 8; ++i) {
+            la[i] = (77 * pa[i * na] + 150 * pa[i * na + 1] + 29 * pa[i * na + 2] + 128) >> 8;
+            lb[i] = (77 * pb[i * nb] + 150 * pb[i * nb + 1] + 29 * pb[i * nb + 2] + 128) >> 8;
+        }
+        for (int k = 0; k < count; ++k) {
+            uint32_t sa = 0, sb = 0, saa = 0, sbb = 0, sab = 0;
+            for (int j = 0; j < 8; ++j) {
+                const int32_t x = la[k * 8 + j], y = lb[k * 8 + j];
+                sa += x;
+                sb += y;
+                saa += x * x;
+                sbb += y * y;
+                sab += x * y;
+            }
+            uint32_t* m = moments + 5 * (b0 + k);
+            m[0] += sa;
+            m[1] += sb;
+            m[2] += saa;
+            m[3] += sbb;
+            m[4] += sab;
+        }
+    }
+}
+
+void ssimMoments(const uint8_t* a, int aChannels, const uint8_t* b, int bChannels, int blocks,
+                 uint32_t* moments) {
+    if (aChannels == 4 && bChannels == 4)      ssimMomentsN<4, 4>(a, 4, b, 4, blocks, moments);
+    else if (aChannels == 3 && bChannels == 3) ssimMomentsN<3, 3>(a, 3, b, 3, blocks, moments);
+    else ssimMomentsN<0, 0>(a, aChannels, b, bChannels, blocks, moments);
+}
+
+// ---- Hashing ----------------------------------------------------------------
+
+// Keys for the source hash: the first 64 fractional bytes of pi
+constexpr uint64_t HASH_KEY[8] = {
+    0x243F6A8885A308D3ull, 0x13198A2E03707344ull, 0xA4093822299F31D0ull, 0x082EFA98EC4E6C89ull,
+    0x452821E638D01377ull, 0xBE5466CF34E90C6Cull, 0xC0AC29B7C97C50DDull, 0x3F84D5B5B5470917ull,
+};
+
+// Each lane adds its word to the neighbouring lane and the product of the
+// keyed word's halves to itself: 32 x 32 -> 64 multiplies that every level
+// vectorizes, with no multiply on the lanes' dependency chain. Lanes are
+// scrambled after every HASH_BLOCK_STRIPES stripes.
+constexpr size_t HASH_BLOCK_STRIPES = 16;
+
+void hashStripes(const uint8_t* SHAKAL_RESTRICT data, size_t stripes,
+                 uint64_t* SHAKAL_RESTRICT lanes) {
+    uint64_t acc[8];
+    for (int i = 0; i < 8; ++i) acc[i] = lanes[i];
+    for (size_t s = 0; s < stripes; ++s) {
+        const uint8_t* p = data + s * 64;
+        for (int i = 0; i < 8; ++i) {
+            uint64_t x;
+            std::memcpy(&x, p + 8 * i, 8);
+            const uint64_t k = x ^ HASH_KEY[i];
+            acc[i ^ 1] += x;
+            acc[i] += static_cast<uint64_t>(static_cast<uint32_t>(k)) * static_cast<uint32_t>(k >> 32);
+        }
+        if ((s + 1) % HASH_BLOCK_STRIPES == 0) {
+            for (int i = 0; i < 8; ++i)
+                acc[i] = (acc[i] ^ (acc[i] >> 47) ^ HASH_KEY[7 - i]) * 0x9E3779B1u;
+        }
+    }
+    for (int i = 0; i < 8; ++i) lanes[i] = acc[i];
+}
+
+} // namespace
+
+namespace Kernels {
+
+const Table* SHAKAL_KERNELS_ENTRY() {
+    static const Table table = {
+        SHAKAL_KERNELS_LEVEL, SHAKAL_KERNELS_NAME,
+        nearestPalette, convolveRows, bilinearRow, addOffsets, shiftChannels, lerpChannel,
+        blendMask, fdct8x8, squaredError, ssimMoments, hashStripes,
+    };
+    return &table;
+}
+
+} // namespace Kernels
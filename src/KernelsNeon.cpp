@@ -0,0 +1,11 @@
+// NEON kernels: KernelsImpl.h built for ARM with NEON (the AArch64 baseline) (flags in CMakeLists.txt)
+#include "Kernels.h"
+
+#if defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define SHAKAL_KERNELS_LEVEL Level::NEON
+#define SHAKAL_KERNELS_NAME "neon"
+#define SHAKAL_KERNELS_ENTRY neonTable
+#include "KernelsImpl.h"
+#else
+namespace Kernels { const Table* neonTable() { return nullptr; } }
+#endif
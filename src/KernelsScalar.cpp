@@ -0,0 +1,7 @@
+// Reference kernels: KernelsImpl.h built with vectorization disabled (flags in CMakeLists.txt)
+#include "Kernels.h"
+
+#define SHAKAL_KERNELS_LEVEL Level::Scalar
+#define SHAKAL_KERNELS_NAME "scalar"
+#define SHAKAL_KERNELS_ENTRY scalarTable
+#include "KernelsImpl.h"
@@ -0,0 +1,11 @@
+// SSE2 kernels: KernelsImpl.h built for the x86 baseline (flags in CMakeLists.txt)
+#include "Kernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SHAKAL_KERNELS_LEVEL Level::SSE2
+#define SHAKAL_KERNELS_NAME "sse2"
+#define SHAKAL_KERNELS_ENTRY sse2Table
+#include "KernelsImpl.h"
+#else
+namespace Kernels { const Table* sse2Table() { return nullptr; } }
+#endif
@@ -0,0 +1,353 @@
+// ---------------------------------------------------------------------------
+// shakal.node - processImage for Node.js, run on the libuv threadpool
+//
+//   const { process } = require('shakal.node');
+//   const { data, width, height } = await process(buffer, { jpegQuality: 20 },
+//       { format: 'rgba', signal });
+//
+// `buffer` is an encoded image, or raw RGBA when options.width and
+// options.height are given; raw input is read in place, so it must not be
+// modified until the promise settles. Settings use the SettingsFile keys,
+// clamped to the editor's ranges. Encoded input over MAX_PIXELS is refused
+// from its header, before it is decoded.
+// options.format 'rgba' (default) gives the pixels, 'png' / 'jpeg' the
+// encoded file. Either way the returned Buffer wraps the result's own memory
+// rather than a copy. Aborting options.signal rejects the promise with the
+// signal's reason: a request still waiting for a thread is dropped, a
+// running one stops at the next stage.
+// ---------------------------------------------------------------------------
+
+#define NAPI_VERSION 8
+#include <node_api.h>
+
+#include "ImageLoader.h"
+#include "ImageProcessor.h"
+#include "JpegWriter.h"
+#include "PngWriter.h"
+#include "SettingsFile.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+enum class Output { Rgba, Png, Jpeg };
+
+// Same bound as shakald's default: 64 Mpx decodes to 256 MiB of RGBA
+constexpr uint64_t MAX_PIXELS = uint64_t(64) << 20;
+
+struct Job {
+    napi_async_work work = nullptr;
+    napi_deferred deferred = nullptr;
+    napi_ref inputRef = nullptr;      // keeps the input Buffer alive for the worker
+    napi_ref signalRef = nullptr;
+    napi_ref listenerRef = nullptr;
+
+    const uint8_t* input = nullptr;
+    size_t inputSize = 0;
+    int rawWidth = 0;                 // > 0: input is raw RGBA
+    int rawHeight = 0;
+    Settings settings;
+    Output output = Output::Rgba;
+    std::atomic<bool> cancel{false};
+
+    // Filled in on the worker thread
+    ImageBuffer result;
+    std::vector<uint8_t> encoded;
+    int width = 0;                    // of what `data` holds: a JPEG under a
+    int height = 0;                   // size target may be smaller than result
+    std::string error;
+};
+
+bool throwIf(napi_env env, bool failed, const char* message) {
+    if (failed) napi_throw_error(env, nullptr, message);
+    return failed;
+}
+
+std::string stringValue(napi_env env, napi_value value) {
+    napi_value str;
+    size_t length = 0;
+    if (napi_coerce_to_string(env, value, &str) != napi_ok ||
+        napi_get_value_string_utf8(env, str, nullptr, 0, &length) != napi_ok)
+        return {};
+    std::string out(length, '\0');
+    napi_get_value_string_utf8(env, str, out.data(), length + 1, &length);
+    return out;
+}
+
+napi_value property(napi_env env, napi_value object, const char* name) {
+    napi_value value = nullptr;
+    bool has = false;
+    if (object && napi_has_named_property(env, object, name, &has) == napi_ok && has)
+        napi_get_named_property(env, object, name, &value);
+    return value;
+}
+
+bool isNullish(napi_env env, napi_value value) {
+    napi_valuetype type = napi_undefined;
+    if (value) napi_typeof(env, value, &type);
+    return type == napi_undefined || type == napi_null;
+}
+
+// { key: value } as SettingsFile text; booleans become 1 / 0. A line break
+// or '=' would let one entry write others, so those throw instead.
+bool parseSettings(napi_env env, napi_value object, Settings& settings) {
+    napi_value names;
+    uint32_t count = 0;
+    if (isNullish(env, object) || napi_get_property_names(env, object, &names) != napi_ok ||
+        napi_get_array_length(env, names, &count) != napi_ok)
+        return true;
+
+    std::string text;
+    for (uint32_t i = 0; i < count; ++i) {
+        napi_value key, value;
+        napi_valuetype type;
+        napi_get_element(env, names, i, &key);
+        napi_get_property(env, object, key, &value);
+        napi_typeof(env, value, &type);
+        std::string v;
+        if (type == napi_boolean) {
+            bool b = false;
+            napi_get_value_bool(env, value, &b);
+            v = b ? "1" : "0";
+        } else {
+            v = stringValue(env, value);
+        }
+        const std::string k = stringValue(env, key);
+        const bool clean = k.find_first_of("\r\n=") == std::string::npos &&
+                           v.find_first_of("\r\n=") == std::string::npos;
+        if (throwIf(env, !clean, "process: settings can't contain line breaks or '='"))
+            return false;
+        text += k + "=" + v + "\n";
+    }
+    SettingsFile::parse(text, settings);
+    return true;
+}
+
+// An Error named AbortError, for signals without a reason
+napi_value abortError(napi_env env) {
+    napi_value message, error, name;
+    napi_create_string_utf8(env, "The operation was aborted", NAPI_AUTO_LENGTH, &message);
+    napi_create_error(env, nullptr, message, &error);
+    napi_create_string_utf8(env, "AbortError", NAPI_AUTO_LENGTH, &name);
+    napi_set_named_property(env, error, "name", name);
+    return error;
+}
+
+napi_value abortReason(napi_env env, napi_value signal) {
+    napi_value reason = property(env, signal, "reason");
+    return isNullish(env, reason) ? abortError(env) : reason;
+}
+
+// A Buffer over `owner`'s memory, released with it once JS lets go. Runtimes
+// that forbid external buffers get a copy instead.
+template <typename T>
+napi_value wrapBuffer(napi_env env, std::unique_ptr<T> owner, uint8_t* data, size_t size) {
+    napi_value buffer = nullptr;
+    napi_status status = napi_create_external_buffer(env, size, data,
+        [](napi_env, void*, void* hint) { delete static_cast<T*>(hint); }, owner.get(), &buffer);
+    if (status == napi_ok) {
+        owner.release();
+        return buffer;
+    }
+    void* copy;
+    napi_create_buffer_copy(env, size, data, &copy, &buffer);
+    return buffer;
+}
+
+void execute(napi_env, void* data) {
+    Job& job = *static_cast<Job*>(data);
+    if (job.cancel.load()) return;
+
+    ImageBuffer source;
+    if (job.rawWidth > 0) {
+        // The caller's Buffer stays referenced until complete(), so the
+        // pixels are borrowed rather than copied
+        source.width = job.rawWidth;
+        source.height = job.rawHeight;
+        source.channels = 4;
+        source.data = ByteBuffer::adopt(const_cast<uint8_t*>(job.input), job.inputSize,
+                                        [](void*, uint8_t*) {});
+    } else {
+        int width = 0, height = 0;
+        if (ImageLoader::probeMemory(job.input, job.inputSize, width, height) &&
+            static_cast<uint64_t>(width) * static_cast<uint64_t>(height) > MAX_PIXELS) {
+            job.error = "image too large";
+            return;
+        }
+        source = ImageLoader::decodeMemory(job.input, job.inputSize);
+    }
+    if (!source.valid()) {
+        job.error = "cannot decode image";
+        return;
+    }
+
+    job.result = ImageProcessor::processImage(source, job.settings, job.cancel);
+    job.width = job.result.width;
+    job.height = job.result.height;
+    if (job.cancel.load() || job.output == Output::Rgba) return;
+
+    auto sink = [&](const uint8_t* bytes, size_t size) {
+        job.encoded.insert(job.encoded.end(), bytes, bytes + size);
+        return true;
+    };
+    bool ok;
+    if (job.output == Output::Jpeg) {
+        JpegWriter::BudgetResult fitted;
+        ok = JpegWriter::encodeForSettings(job.result, job.settings, fitted);
+        job.encoded = std::move(fitted.file);
+        job.width = fitted.width;
+        job.height = fitted.height;
+    } else {
+        PngWriter::Options options;
+        options.level = job.settings.pngLevel;
+        options.filter = job.settings.pngFilter;
+        ok = PngWriter::encode(job.result, options, sink);
+    }
+    if (!ok) job.error = "cannot encode result";
+}
+
+void complete(napi_env env, napi_status status, void* data) {
+    std::unique_ptr<Job> job(static_cast<Job*>(data));
+
+    napi_value signal = nullptr;
+    if (job->signalRef) {
+        napi_get_reference_value(env, job->signalRef, &signal);
+        napi_value remove, listener, args[2];
+        napi_get_named_property(env, signal, "removeEventListener", &remove);
+        napi_get_reference_value(env, job->listenerRef, &listener);
+        napi_create_string_utf8(env, "abort", NAPI_AUTO_LENGTH, &args[0]);
+        args[1] = listener;
+        napi_call_function(env, signal, remove, 2, args, nullptr);
+        napi_delete_reference(env, job->listenerRef);
+        napi_delete_reference(env, job->signalRef);
+    }
+    napi_delete_reference(env, job->inputRef);
+    napi_delete_async_work(env, job->work);
+
+    if (status == napi_cancelled || job->cancel.load()) {
+        napi_reject_deferred(env, job->deferred, signal ? abortReason(env, signal) : abortError(env));
+        return;
+    }
+    if (!job->error.empty()) {
+        napi_value message, error;
+        napi_create_string_utf8(env, job->error.c_str(), NAPI_AUTO_LENGTH, &message);
+        napi_create_error(env, nullptr, message, &error);
+        napi_reject_deferred(env, job->deferred, error);
+        return;
+    }
+
+    napi_value result, buffer, width, height;
+    napi_create_object(env, &result);
+    napi_create_int32(env, job->width, &width);
+    napi_create_int32(env, job->height, &height);
+    if (job->output == Output::Rgba) {
+        auto image = std::make_unique<ImageBuffer>(std::move(job->result));
+        uint8_t* pixels = image->data.data();
+        const size_t size = image->data.size();
+        buffer = wrapBuffer(env, std::move(image), pixels, size);
+    } else {
+        auto file = std::make_unique<std::vector<uint8_t>>(std::move(job->encoded));
+        uint8_t* bytes = file->data();
+        const size_t size = file->size();
+        buffer = wrapBuffer(env, std::move(file), bytes, size);
+    }
+    napi_set_named_property(env, result, "data", buffer);
+    napi_set_named_property(env, result, "width", width);
+    napi_set_named_property(env, result, "height", height);
+    napi_resolve_deferred(env, job->deferred, result);
+}
+
+napi_value onAbort(napi_env env, napi_callback_info info) {
+    void* data;
+    napi_get_cb_info(env, info, nullptr, nullptr, nullptr, &data);
+    Job* job = static_cast<Job*>(data);
+    job->cancel.store(true);
+    // Fails harmlessly once a thread has picked the work up
+    napi_cancel_async_work(env, job->work);
+    return nullptr;
+}
+
+// process(input, settings?, options?) -> Promise<{ data, width, height }>
+napi_value processAsync(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value argv[3] = {};
+    napi_get_cb_info(env, info, &argc, argv, nullptr, nullptr);
+
+    bool isBuffer = false;
+    if (argc > 0) napi_is_buffer(env, argv[0], &isBuffer);
+    if (throwIf(env, !isBuffer, "process: input must be a Buffer")) return nullptr;
+
+    auto job = std::make_unique<Job>();
+    void* input;
+    napi_get_buffer_info(env, argv[0], &input, &job->inputSize);
+    job->input = static_cast<const uint8_t*>(input);
+    if (!parseSettings(env, argc > 1 ? argv[1] : nullptr, job->settings)) return nullptr;
+
+    napi_value options = argc > 2 && !isNullish(env, argv[2]) ? argv[2] : nullptr;
+    napi_value width = property(env, options, "width");
+    napi_value height = property(env, options, "height");
+    if (!isNullish(env, width) || !isNullish(env, height)) {
+        napi_get_value_int32(env, width, &job->rawWidth);
+        napi_get_value_int32(env, height, &job->rawHeight);
+        const bool sized = job->rawWidth > 0 && job->rawHeight > 0 &&
+            job->inputSize == static_cast<size_t>(job->rawWidth) * job->rawHeight * 4;
+        if (throwIf(env, !sized, "process: raw input must be width * height * 4 bytes of RGBA"))
+            return nullptr;
+    }
+    napi_value format = property(env, options, "format");
+    if (!isNullish(env, format)) {
+        const std::string f = stringValue(env, format);
+        if (f == "png") job->output = Output::Png;
+        else if (f == "jpeg" || f == "jpg") job->output = Output::Jpeg;
+        else if (throwIf(env, f != "rgba", "process: format must be 'rgba', 'png' or 'jpeg'"))
+            return nullptr;
+    }
+
+    napi_value promise;
+    napi_create_promise(env, &job->deferred, &promise);
+
+    napi_value signal = property(env, options, "signal");
+    if (!isNullish(env, signal)) {
+        bool aborted = false;
+        napi_value flag = property(env, signal, "aborted");
+        if (flag) napi_get_value_bool(env, flag, &aborted);
+        if (aborted) {
+            napi_reject_deferred(env, job->deferred, abortReason(env, signal));
+            return promise;
+        }
+    }
+
+    napi_value name;
+    napi_create_string_utf8(env, "shakal.process", NAPI_AUTO_LENGTH, &name);
+    napi_create_reference(env, argv[0], 1, &job->inputRef);
+    napi_create_async_work(env, nullptr, name, execute, complete, job.get(), &job->work);
+
+    if (!isNullish(env, signal)) {
+        napi_value add, listener, args[2];
+        napi_create_function(env, "onAbort", NAPI_AUTO_LENGTH, onAbort, job.get(), &listener);
+        napi_get_named_property(env, signal, "addEventListener", &add);
+        napi_create_string_utf8(env, "abort", NAPI_AUTO_LENGTH, &args[0]);
+        args[1] = listener;
+        napi_call_function(env, signal, add, 2, args, nullptr);
+        napi_create_reference(env, signal, 1, &job->signalRef);
+        napi_create_reference(env, listener, 1, &job->listenerRef);
+    }
+
+    napi_queue_async_work(env, job->work);
+    job.release();   // complete() takes it back
+    return promise;
+}
+
+} // namespace
+
+NAPI_MODULE_INIT() {
+    napi_value fn;
+    napi_create_function(env, "process", NAPI_AUTO_LENGTH, processAsync, nullptr, &fn);
+    napi_set_named_property(env, exports, "process", fn);
+    return exports;
+}
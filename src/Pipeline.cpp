@@ -1,37 +1,82 @@
 #include "Pipeline.h"
-#include <thread>
 
-Pipeline::Pipeline()
-    : m_lastSubmitTime(std::chrono::steady_clock::now()) {}
+Pipeline::Pipeline(std::shared_ptr<ResultCache> cache)
+    : m_pool(BufferPool::create()),
+      m_cache(cache ? std::move(cache) : std::make_shared<ResultCache>()),
+      m_lastSubmitTime(std::chrono::steady_clock::now()) {}
 
 Pipeline::~Pipeline() {
-    m_cancel.store(true);
-    if (m_future.valid())
-        m_future.wait();
+    retire();
+}
+
+void Pipeline::retire() {
+    if (!m_run) return;
+    m_run->cancel.store(true);
+    // Unclaimed, it never touches the Pipeline: whichever queue entry comes
+    // up finds it claimed here and returns
+    if (m_run->claimed.exchange(true))
+        m_finished.wait();
+    m_run.reset();
 }
 
 void Pipeline::submit(const ImageBuffer& source, const Settings& settings,
                       std::function<void(ImageBuffer)> onComplete) {
+    // The worker's copy of the source comes from the pipeline's pool too
+    BufferPool::Scope scope(*m_pool);
+
     // Cancel any in-progress work
-    m_cancel.store(true);
-    if (m_future.valid()) {
-        m_future.wait();
-    }
+    retire();
 
-    m_cancel.store(false);
+    auto run = std::make_shared<Run>();
+    run->source = source;
+    run->settings = settings;
+    run->wake = m_wake;
     m_processing.store(true);
     m_callback = std::move(onComplete);
 
-    m_future = std::async(std::launch::async,
-        [this, source, settings]() {
-            return ImageProcessor::processImage(source, settings, m_cancel);
-        });
+    // The result goes through a promise rather than the task's own future,
+    // so it is ready by the time the wake callback runs
+    m_future = run->result.get_future();
+    m_finished = run->finished.get_future();
+    m_run = run;
+    schedule(run);
 
     markSubmitTime();
 }
 
+void Pipeline::schedule(const std::shared_ptr<Run>& run) {
+    ThreadPool::shared().submit(m_priority, [this, run]() { execute(*run); });
+}
+
+void Pipeline::execute(Run& run) {
+    if (run.claimed.exchange(true)) return;
+    {
+        BufferPool::Scope workerScope(*m_pool);
+        try {
+            uint64_t allocations = m_lastAllocations.load();
+            ImageBuffer result = m_cache->process(run.source, run.settings, run.cancel,
+                                                  &allocations);
+            m_lastAllocations.store(allocations);
+            run.result.set_value(std::move(result));
+        } catch (...) {
+            run.result.set_exception(std::current_exception());
+        }
+        run.source = ImageBuffer{};     // m_run outlives the work; don't hold the copy
+    }
+    run.finished.set_value();
+    if (run.wake) run.wake();
+}
+
+void Pipeline::setPriority(ThreadPool::Priority priority) {
+    if (priority == m_priority) return;
+    m_priority = priority;
+    // Queue it again in the new class; the first entry to come up runs it
+    if (m_run && !m_run->claimed.load())
+        schedule(m_run);
+}
+
 void Pipeline::cancel() {
-    m_cancel.store(true);
+    if (m_run) m_run->cancel.store(true);
 }
 
 bool Pipeline::isProcessing() const {
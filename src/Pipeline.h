@@ -1,5 +1,8 @@
 #pragma once
 #include "ImageProcessor.h"
+#include "BufferPool.h"
+#include "ResultCache.h"
+#include "ThreadPool.h"
 #include <future>
 #include <atomic>
 #include <mutex>
@@ -7,17 +10,28 @@
 #include <deque>
 #include <functional>
 #include <chrono>
+#include <memory>
 
+// Runs processImage for one document as a ThreadPool::shared() task of the
+// pipeline's priority class
 class Pipeline {
 public:
-    Pipeline();
+    // `cache` may be shared with other pipelines; nullptr gives this one its own
+    explicit Pipeline(std::shared_ptr<ResultCache> cache = nullptr);
     ~Pipeline();
 
     // Submit a new processing request. Cancels any in-progress one.
-    // The callback is called on completion with the result.
+    // The callback is called on completion with the result, which comes
+    // straight from the result cache when this source and settings were
+    // processed before.
     void submit(const ImageBuffer& source, const Settings& settings,
                 std::function<void(ImageBuffer)> onComplete);
 
+    // Class of the next submits. A request still waiting in the pool's queue
+    // moves to the new class as well.
+    void setPriority(ThreadPool::Priority priority);
+    ThreadPool::Priority priority() const { return m_priority; }
+
     // Cancel current processing
     void cancel();
 
@@ -27,6 +41,10 @@ public:
     // Poll for completed results (call from main thread)
     void poll();
 
+    // Called on the worker thread once a result is ready for poll(), so an
+    // idle main loop can sleep until then. Set before the first submit.
+    void setWakeCallback(std::function<void()> wake) { m_wake = std::move(wake); }
+
     // Undo/Redo support (up to 10 steps)
     void pushState(const Settings& settings, const ImageBuffer& result);
     bool canUndo() const;
@@ -39,16 +57,49 @@ public:
     bool shouldUpdate(int debounceMs = 100) const;
     void markSubmitTime();
 
+    // Scratch pool every processing stage draws from
+    BufferPool& getBufferPool() { return *m_pool; }
+
+    // Results of earlier submits (and of anything else sharing it)
+    ResultCache& getResultCache() { return *m_cache; }
+
+    // Heap allocations made by the last completed processImage call
+    uint64_t lastAllocationCount() const { return m_lastAllocations.load(); }
+
 private:
     struct HistoryEntry {
         Settings settings;
         ImageBuffer image;
     };
 
-    std::atomic<bool> m_cancel{false};
+    // One submit. It may be queued more than once (see setPriority); the
+    // first worker to claim it runs it and the other entries return at once,
+    // touching nothing but the Run.
+    struct Run {
+        ImageBuffer source;
+        Settings settings;
+        std::atomic<bool> cancel{false};
+        std::atomic<bool> claimed{false};
+        std::promise<ImageBuffer> result;   // ready before wake runs
+        std::promise<void> finished;        // the worker is done with the Pipeline
+        std::function<void()> wake;
+    };
+
+    void schedule(const std::shared_ptr<Run>& run);
+    void execute(Run& run);
+    void retire();                          // cancel m_run; wait if a worker has it
+
+    std::shared_ptr<BufferPool> m_pool;
+    std::shared_ptr<ResultCache> m_cache;
+    std::atomic<uint64_t> m_lastAllocations{0};
+
+    ThreadPool::Priority m_priority = ThreadPool::Priority::Interactive;
     std::atomic<bool> m_processing{false};
+    std::shared_ptr<Run> m_run;
+    std::future<void> m_finished;
     std::future<ImageBuffer> m_future;
     std::function<void(ImageBuffer)> m_callback;
+    std::function<void()> m_wake;
 
     std::deque<HistoryEntry> m_undoStack;
     std::deque<HistoryEntry> m_redoStack;
@@ -0,0 +1,820 @@
+#include "PngWriter.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <vector>
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Checksums
+// ---------------------------------------------------------------------------
+
+struct CrcTable {
+    uint32_t v[256];
+    CrcTable() {
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            v[n] = c;
+        }
+    }
+};
+
+uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t size) {
+    static const CrcTable table;
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+        crc = table.v[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+constexpr uint32_t ADLER_BASE = 65521;
+
+uint32_t adler32(const uint8_t* data, size_t size) {
+    uint32_t a = 1, b = 0;
+    while (size > 0) {
+        // Largest run before b can overflow 32 bits
+        size_t n = std::min<size_t>(size, 5552);
+        size -= n;
+        for (size_t i = 0; i < n; ++i) {
+            a += data[i];
+            b += a;
+        }
+        data += n;
+        a %= ADLER_BASE;
+        b %= ADLER_BASE;
+    }
+    return (b << 16) | a;
+}
+
+// Adler-32 of A||B from adler(A), adler(B) and |B| (as zlib's adler32_combine)
+uint32_t adler32Combine(uint32_t adlerA, uint32_t adlerB, size_t lengthB) {
+    uint32_t rem = static_cast<uint32_t>(lengthB % ADLER_BASE);
+    uint32_t sum1 = adlerA & 0xFFFF;
+    uint32_t sum2 = static_cast<uint32_t>((static_cast<uint64_t>(rem) * sum1) % ADLER_BASE);
+    sum1 += (adlerB & 0xFFFF) + ADLER_BASE - 1;
+    sum2 += (adlerA >> 16) + (adlerB >> 16) + ADLER_BASE - rem;
+    if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+    if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+    if (sum2 >= 2 * ADLER_BASE) sum2 -= 2 * ADLER_BASE;
+    if (sum2 >= ADLER_BASE) sum2 -= ADLER_BASE;
+    return sum1 | (sum2 << 16);
+}
+
+void putBE32(uint8_t* p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v >> 24);
+    p[1] = static_cast<uint8_t>(v >> 16);
+    p[2] = static_cast<uint8_t>(v >> 8);
+    p[3] = static_cast<uint8_t>(v);
+}
+
+// ---------------------------------------------------------------------------
+// Deflate (RFC 1951)
+// ---------------------------------------------------------------------------
+
+constexpr int WINDOW_SIZE = 32768;
+constexpr int MIN_MATCH = 3;
+constexpr int MAX_MATCH = 258;
+constexpr int HASH_BITS = 15;
+constexpr int NUM_LITLEN = 286;
+constexpr int NUM_DIST = 30;
+constexpr int NUM_CODELEN = 19;
+constexpr int MAX_BITS = 15;
+constexpr int MAX_CODELEN_BITS = 7;
+constexpr size_t BLOCK_TOKENS = size_t(1) << 15;
+constexpr size_t MAX_STORED = 65535;
+
+constexpr uint16_t LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+constexpr uint8_t LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+constexpr uint16_t DIST_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+constexpr uint8_t DIST_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+constexpr uint8_t CODELEN_ORDER[NUM_CODELEN] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+// Symbol lookups and the fixed Huffman code lengths (RFC 1951 3.2.6)
+struct DeflateTables {
+    uint8_t lengthCode[MAX_MATCH + 1];  // match length -> index into LENGTH_BASE
+    uint8_t distCode[WINDOW_SIZE + 1];  // distance -> index into DIST_BASE
+    uint8_t fixedLitLen[288];
+    uint8_t fixedDist[32];
+
+    DeflateTables() {
+        for (int c = 0; c < 29; ++c)
+            for (int len = LENGTH_BASE[c]; len < LENGTH_BASE[c] + (1 << LENGTH_EXTRA[c]) && len <= MAX_MATCH; ++len)
+                lengthCode[len] = static_cast<uint8_t>(c);  // 258 ends on code 285, not 284 + 31
+        for (int c = 0; c < 30; ++c)
+            for (int d = DIST_BASE[c]; d < DIST_BASE[c] + (1 << DIST_EXTRA[c]) && d <= WINDOW_SIZE; ++d)
+                distCode[d] = static_cast<uint8_t>(c);
+        for (int i = 0; i < 288; ++i)
+            fixedLitLen[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+        for (int i = 0; i < 32; ++i)
+            fixedDist[i] = 5;
+    }
+};
+
+const DeflateTables& tables() {
+    static const DeflateTables t;
+    return t;
+}
+
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : m_out(out) {}
+
+    // LSB-first, n <= 32
+    void put(uint32_t value, int n) {
+        m_bits |= static_cast<uint64_t>(value) << m_count;
+        m_count += n;
+        while (m_count >= 8) {
+            m_out.push_back(static_cast<uint8_t>(m_bits));
+            m_bits >>= 8;
+            m_count -= 8;
+        }
+    }
+
+    void alignToByte() {
+        if (m_count > 0) put(0, 8 - m_count);
+    }
+
+    // Only valid on a byte boundary
+    void putBytes(const uint8_t* data, size_t size) {
+        m_out.insert(m_out.end(), data, data + size);
+    }
+
+private:
+    std::vector<uint8_t>& m_out;
+    uint64_t m_bits = 0;
+    int m_count = 0;
+};
+
+// Code lengths for `freq`, limited to `maxBits`. Fewer than two used symbols
+// are padded to two so every code is complete.
+void buildCodeLengths(const uint32_t* freq, int n, int maxBits, uint8_t* lengths) {
+    std::fill(lengths, lengths + n, 0);
+
+    std::vector<int> symbols;
+    for (int i = 0; i < n; ++i)
+        if (freq[i]) symbols.push_back(i);
+    if (symbols.size() < 2) {
+        int a = symbols.empty() ? 0 : symbols[0];
+        lengths[a] = 1;
+        lengths[a == 0 ? 1 : 0] = 1;
+        return;
+    }
+
+    // Least frequent first; ties by symbol so the output is deterministic
+    std::sort(symbols.begin(), symbols.end(), [&](int a, int b) {
+        return freq[a] != freq[b] ? freq[a] < freq[b] : a < b;
+    });
+
+    // Huffman tree by the two-queue method: leaves are already sorted and
+    // internal nodes are created in non-decreasing weight order
+    const size_t count = symbols.size();
+    std::vector<uint64_t> weight(2 * count - 1);
+    std::vector<int> parent(2 * count - 1, -1);
+    for (size_t i = 0; i < count; ++i) weight[i] = freq[symbols[i]];
+    size_t leaf = 0, node = count, next = count;
+    auto takeMin = [&]() -> size_t {
+        if (leaf < count && (node >= next || weight[leaf] <= weight[node])) return leaf++;
+        return node++;
+    };
+    for (; next < 2 * count - 1; ++next) {
+        size_t a = takeMin();
+        size_t b = takeMin();
+        weight[next] = weight[a] + weight[b];
+        parent[a] = parent[b] = static_cast<int>(next);
+    }
+
+    // Depth of every leaf, then a histogram of depths clamped to maxBits
+    std::vector<int> depth(2 * count - 1, 0);
+    for (size_t i = 2 * count - 1; i-- > 0;)
+        if (parent[i] >= 0) depth[i] = depth[parent[i]] + 1;
+
+    int lengthCount[MAX_BITS + 2] = {};
+    bool overflow = false;
+    for (size_t i = 0; i < count; ++i) {
+        int d = depth[i];
+        if (d > maxBits) { d = maxBits; overflow = true; }
+        ++lengthCount[d];
+    }
+
+    if (overflow) {
+        // Restore the Kraft equality: each step drops one code from the
+        // deepest level and splits a shallower leaf into two
+        uint32_t total = 0;
+        for (int i = 1; i <= maxBits; ++i)
+            total += static_cast<uint32_t>(lengthCount[i]) << (maxBits - i);
+        while (total > (1u << maxBits)) {
+            --lengthCount[maxBits];
+            for (int i = maxBits - 1; i > 0; --i) {
+                if (lengthCount[i]) {
+                    --lengthCount[i];
+                    lengthCount[i + 1] += 2;
+                    break;
+                }
+            }
+            --total;
+        }
+    }
+
+    // Longest codes go to the least frequent symbols
+    size_t s = 0;
+    for (int len = maxBits; len > 0; --len)
+        for (int k = 0; k < lengthCount[len]; ++k)
+            lengths[symbols[s++]] = static_cast<uint8_t>(len);
+}
+
+// Canonical codes, bit-reversed for LSB-first output
+void buildCodes(const uint8_t* lengths, int n, uint16_t* codes) {
+    int lengthCount[MAX_BITS + 1] = {};
+    for (int i = 0; i < n; ++i) ++lengthCount[lengths[i]];
+    lengthCount[0] = 0;
+
+    uint32_t nextCode[MAX_BITS + 1] = {};
+    uint32_t code = 0;
+    for (int bits = 1; bits <= MAX_BITS; ++bits) {
+        code = (code + lengthCount[bits - 1]) << 1;
+        nextCode[bits] = code;
+    }
+    for (int i = 0; i < n; ++i) {
+        int len = lengths[i];
+        if (!len) { codes[i] = 0; continue; }
+        uint32_t c = nextCode[len]++;
+        uint32_t rev = 0;
+        for (int b = 0; b < len; ++b) rev |= ((c >> b) & 1u) << (len - 1 - b);
+        codes[i] = static_cast<uint16_t>(rev);
+    }
+}
+
+// Literal (dist == 0) or match
+struct Token {
+    uint16_t litOrLen;
+    uint16_t dist;
+};
+
+struct MatchParams {
+    int goodLength;  // shorten the lazy search once a match this long is found
+    int lazyLength;  // try the next position only below this length (0 = greedy)
+    int niceLength;  // stop searching at this length
+    int maxChain;
+};
+
+// Levels 2..9 follow zlib's configuration table
+constexpr MatchParams MATCH_PARAMS[10] = {
+    {0, 0, 0, 0},          // 0: store
+    {0, 0, 0, 0},          // 1: run-length
+    {4, 0, 8, 4},
+    {4, 0, 32, 32},
+    {4, 4, 16, 16},
+    {8, 16, 32, 32},
+    {8, 16, 128, 128},
+    {8, 32, 128, 256},
+    {32, 128, 258, 1024},
+    {32, 258, 258, 4096},
+};
+
+class DeflateEncoder {
+public:
+    DeflateEncoder(std::vector<uint8_t>& out, int level)
+        : m_bits(out), m_level(std::clamp(level, 0, 9)) {}
+
+    // Compress in[start, size); in[0, start) is history that matches may
+    // reference. Ends with a final block, or with a sync flush otherwise.
+    void compress(const uint8_t* in, size_t start, size_t size, bool final) {
+        if (m_level == 0) {
+            writeStored(in + start, size - start, final);
+        } else {
+            m_tokens.clear();
+            m_tokens.reserve(BLOCK_TOKENS);
+            m_blockStart = start;
+            if (m_level == 1) compressRle(in, start, size);
+            else              compressLz77(in, start, size);
+            flushBlock(in, size, final);
+        }
+        if (!final) {
+            // Empty stored block: byte-aligns the stream so the next chunk can follow
+            m_bits.put(0, 3);
+            m_bits.alignToByte();
+            const uint8_t marker[4] = {0x00, 0x00, 0xFF, 0xFF};
+            m_bits.putBytes(marker, 4);
+        }
+        m_bits.alignToByte();
+    }
+
+private:
+    void literal(const uint8_t* in, size_t pos, uint8_t value) {
+        m_tokens.push_back({value, 0});
+        maybeFlush(in, pos + 1);
+    }
+
+    void match(const uint8_t* in, size_t pos, int length, int dist) {
+        m_tokens.push_back({static_cast<uint16_t>(length), static_cast<uint16_t>(dist)});
+        maybeFlush(in, pos + length);
+    }
+
+    void maybeFlush(const uint8_t* in, size_t end) {
+        if (m_tokens.size() >= BLOCK_TOKENS) flushBlock(in, end, false);
+    }
+
+    // Runs of one byte as distance-1 matches
+    void compressRle(const uint8_t* in, size_t start, size_t size) {
+        size_t p = start;
+        while (p < size) {
+            if (p > 0) {
+                const uint8_t v = in[p - 1];
+                size_t maxLen = std::min<size_t>(MAX_MATCH, size - p);
+                size_t len = 0;
+                while (len < maxLen && in[p + len] == v) ++len;
+                if (len >= MIN_MATCH) {
+                    match(in, p, static_cast<int>(len), 1);
+                    p += len;
+                    continue;
+                }
+            }
+            literal(in, p, in[p]);
+            ++p;
+        }
+    }
+
+    static uint32_t hash3(const uint8_t* p) {
+        uint32_t v = p[0] | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16);
+        return (v * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    void insert(const uint8_t* in, size_t pos, size_t size) {
+        if (pos + MIN_MATCH > size) return;
+        uint32_t h = hash3(in + pos);
+        m_prev[pos] = m_head[h];
+        m_head[h] = static_cast<int32_t>(pos);
+    }
+
+    struct Match { int length = 0; int dist = 0; };
+
+    // Longest match for `pos` (which must already be inserted)
+    Match findMatch(const uint8_t* in, size_t pos, size_t size, int chain) const {
+        Match best;
+        if (pos + MIN_MATCH > size) return best;
+        const int maxLen = static_cast<int>(std::min<size_t>(MAX_MATCH, size - pos));
+        const int nice = std::min(MATCH_PARAMS[m_level].niceLength, maxLen);
+        const int64_t limit = static_cast<int64_t>(pos) - WINDOW_SIZE;
+        int bestLen = MIN_MATCH - 1;
+        const uint8_t* cur = in + pos;
+
+        for (int64_t cand = m_prev[pos]; cand >= 0 && cand >= limit && chain-- > 0; cand = m_prev[cand]) {
+            const uint8_t* ref = in + cand;
+            if (ref[bestLen] != cur[bestLen] || ref[0] != cur[0] || ref[1] != cur[1]) continue;
+            int len = 2;
+            while (len < maxLen && ref[len] == cur[len]) ++len;
+            if (len > bestLen) {
+                bestLen = len;
+                best.length = len;
+                best.dist = static_cast<int>(pos - cand);
+                if (len >= nice) break;
+            }
+        }
+        return best;
+    }
+
+    void compressLz77(const uint8_t* in, size_t start, size_t size) {
+        const MatchParams& params = MATCH_PARAMS[m_level];
+        m_head.assign(size_t(1) << HASH_BITS, -1);
+        m_prev.assign(size, -1);
+        for (size_t p = start > WINDOW_SIZE ? start - WINDOW_SIZE : 0; p < start; ++p)
+            insert(in, p, size);
+
+        size_t p = start;
+        Match cur;
+        bool haveCur = false;
+        while (p < size) {
+            if (!haveCur) {
+                insert(in, p, size);
+                cur = findMatch(in, p, size, params.maxChain);
+            }
+            haveCur = false;
+
+            if (cur.length < MIN_MATCH) {
+                literal(in, p, in[p]);
+                ++p;
+                continue;
+            }
+
+            size_t inserted = p + 1;
+            if (params.lazyLength > 0 && cur.length < params.lazyLength && p + 1 < size) {
+                // Lazy evaluation: a longer match one byte later wins
+                int chain = cur.length >= params.goodLength ? params.maxChain >> 2 : params.maxChain;
+                insert(in, p + 1, size);
+                Match next = findMatch(in, p + 1, size, chain);
+                if (next.length > cur.length) {
+                    literal(in, p, in[p]);
+                    ++p;
+                    cur = next;
+                    haveCur = true;
+                    continue;
+                }
+                inserted = p + 2;
+            }
+
+            match(in, p, cur.length, cur.dist);
+            for (size_t q = inserted; q < p + cur.length; ++q)
+                insert(in, q, size);
+            p += cur.length;
+        }
+    }
+
+    void writeStored(const uint8_t* data, size_t size, bool final) {
+        do {
+            size_t n = std::min(size, MAX_STORED);
+            size -= n;
+            m_bits.put((final && size == 0) ? 1 : 0, 1);
+            m_bits.put(0, 2);
+            m_bits.alignToByte();
+            uint8_t header[4] = {
+                static_cast<uint8_t>(n), static_cast<uint8_t>(n >> 8),
+                static_cast<uint8_t>(~n), static_cast<uint8_t>(~n >> 8)
+            };
+            m_bits.putBytes(header, 4);
+            m_bits.putBytes(data, n);
+            data += n;
+        } while (size > 0);
+    }
+
+    // Emit the pending tokens (covering in[m_blockStart, end)) as whichever
+    // of a dynamic, fixed or stored block is smallest
+    void flushBlock(const uint8_t* in, size_t end, bool final) {
+        const DeflateTables& t = tables();
+        const size_t rawSize = end - m_blockStart;
+
+        uint32_t litFreq[NUM_LITLEN] = {};
+        uint32_t distFreq[NUM_DIST] = {};
+        uint64_t extraBits = 0;
+        for (const Token& tok : m_tokens) {
+            if (tok.dist == 0) {
+                ++litFreq[tok.litOrLen];
+            } else {
+                int lc = t.lengthCode[tok.litOrLen];
+                int dc = t.distCode[tok.dist];
+                ++litFreq[257 + lc];
+                ++distFreq[dc];
+                extraBits += LENGTH_EXTRA[lc] + DIST_EXTRA[dc];
+            }
+        }
+        litFreq[256] = 1;
+
+        uint8_t litLen[NUM_LITLEN], distLen[NUM_DIST];
+        buildCodeLengths(litFreq, NUM_LITLEN, MAX_BITS, litLen);
+        buildCodeLengths(distFreq, NUM_DIST, MAX_BITS, distLen);
+
+        // Code-length alphabet: lengths run-length coded with symbols 16/17/18
+        int numLit = NUM_LITLEN;
+        while (numLit > 257 && litLen[numLit - 1] == 0) --numLit;
+        int numDist = NUM_DIST;
+        while (numDist > 1 && distLen[numDist - 1] == 0) --numDist;
+
+        uint8_t all[NUM_LITLEN + NUM_DIST];
+        std::memcpy(all, litLen, numLit);
+        std::memcpy(all + numLit, distLen, numDist);
+        const int numAll = numLit + numDist;
+
+        struct ClSymbol { uint8_t sym; uint8_t extra; };
+        std::vector<ClSymbol> clSymbols;
+        uint32_t clFreq[NUM_CODELEN] = {};
+        for (int i = 0; i < numAll;) {
+            uint8_t len = all[i];
+            int run = 1;
+            while (i + run < numAll && all[i + run] == len) ++run;
+            i += run;
+            if (len == 0) {
+                while (run >= 11) { int n = std::min(run, 138); clSymbols.push_back({18, static_cast<uint8_t>(n - 11)}); run -= n; }
+                if (run >= 3)     { clSymbols.push_back({17, static_cast<uint8_t>(run - 3)}); run = 0; }
+            } else {
+                clSymbols.push_back({len, 0});
+                --run;
+                while (run >= 3) { int n = std::min(run, 6); clSymbols.push_back({16, static_cast<uint8_t>(n - 3)}); run -= n; }
+            }
+            while (run-- > 0) clSymbols.push_back({len, 0});
+        }
+        for (const ClSymbol& s : clSymbols) ++clFreq[s.sym];
+
+        uint8_t clLen[NUM_CODELEN];
+        buildCodeLengths(clFreq, NUM_CODELEN, MAX_CODELEN_BITS, clLen);
+        int numCl = NUM_CODELEN;
+        while (numCl > 4 && clLen[CODELEN_ORDER[numCl - 1]] == 0) --numCl;
+
+        // Sizes in bits of the three encodings
+        uint64_t dynamicBits = 3 + 5 + 5 + 4 + 3 * static_cast<uint64_t>(numCl) + extraBits;
+        uint64_t fixedBits = 3 + extraBits;
+        for (const ClSymbol& s : clSymbols)
+            dynamicBits += clLen[s.sym] + (s.sym == 16 ? 2 : s.sym == 17 ? 3 : s.sym == 18 ? 7 : 0);
+        for (int i = 0; i < NUM_LITLEN; ++i) {
+            dynamicBits += static_cast<uint64_t>(litFreq[i]) * litLen[i];
+            fixedBits += static_cast<uint64_t>(litFreq[i]) * t.fixedLitLen[i];
+        }
+        for (int i = 0; i < NUM_DIST; ++i) {
+            dynamicBits += static_cast<uint64_t>(distFreq[i]) * distLen[i];
+            fixedBits += static_cast<uint64_t>(distFreq[i]) * t.fixedDist[i];
+        }
+        const uint64_t storedBits = (rawSize + 5 * ((rawSize + MAX_STORED - 1) / MAX_STORED)) * 8 + 7;
+
+        if (storedBits <= dynamicBits && storedBits <= fixedBits) {
+            writeStored(in + m_blockStart, rawSize, final);
+        } else if (fixedBits <= dynamicBits) {
+            m_bits.put(final ? 1 : 0, 1);
+            m_bits.put(1, 2);
+            uint16_t litCodes[288], distCodes[32];
+            buildCodes(t.fixedLitLen, 288, litCodes);
+            buildCodes(t.fixedDist, 32, distCodes);
+            writeTokens(litCodes, t.fixedLitLen, distCodes, t.fixedDist);
+        } else {
+            m_bits.put(final ? 1 : 0, 1);
+            m_bits.put(2, 2);
+            m_bits.put(numLit - 257, 5);
+            m_bits.put(numDist - 1, 5);
+            m_bits.put(numCl - 4, 4);
+            for (int i = 0; i < numCl; ++i)
+                m_bits.put(clLen[CODELEN_ORDER[i]], 3);
+
+            uint16_t clCodes[NUM_CODELEN];
+            buildCodes(clLen, NUM_CODELEN, clCodes);
+            for (const ClSymbol& s : clSymbols) {
+                m_bits.put(clCodes[s.sym], clLen[s.sym]);
+                if (s.sym == 16)      m_bits.put(s.extra, 2);
+                else if (s.sym == 17) m_bits.put(s.extra, 3);
+                else if (s.sym == 18) m_bits.put(s.extra, 7);
+            }
+
+            uint16_t litCodes[NUM_LITLEN], distCodes[NUM_DIST];
+            buildCodes(litLen, NUM_LITLEN, litCodes);
+            buildCodes(distLen, NUM_DIST, distCodes);
+            writeTokens(litCodes, litLen, distCodes, distLen);
+        }
+
+        m_tokens.clear();
+        m_blockStart = end;
+    }
+
+    void writeTokens(const uint16_t* litCodes, const uint8_t* litLen,
+                     const uint16_t* distCodes, const uint8_t* distLen) {
+        const DeflateTables& t = tables();
+        for (const Token& tok : m_tokens) {
+            if (tok.dist == 0) {
+                m_bits.put(litCodes[tok.litOrLen], litLen[tok.litOrLen]);
+                continue;
+            }
+            int lc = t.lengthCode[tok.litOrLen];
+            m_bits.put(litCodes[257 + lc], litLen[257 + lc]);
+            m_bits.put(tok.litOrLen - LENGTH_BASE[lc], LENGTH_EXTRA[lc]);
+            int dc = t.distCode[tok.dist];
+            m_bits.put(distCodes[dc], distLen[dc]);
+            m_bits.put(tok.dist - DIST_BASE[dc], DIST_EXTRA[dc]);
+        }
+        m_bits.put(litCodes[256], litLen[256]);
+    }
+
+    BitWriter m_bits;
+    int m_level;
+    std::vector<Token> m_tokens;
+    size_t m_blockStart = 0;
+    std::vector<int32_t> m_head;
+    std::vector<int32_t> m_prev;
+};
+
+// ---------------------------------------------------------------------------
+// Row filters (PNG spec 9)
+// ---------------------------------------------------------------------------
+
+uint8_t paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return static_cast<uint8_t>(a);
+    if (pb <= pc) return static_cast<uint8_t>(b);
+    return static_cast<uint8_t>(c);
+}
+
+// out[0] = filter type, out[1..rowBytes] = filtered row
+void filterRow(int type, const uint8_t* cur, const uint8_t* prev, size_t rowBytes,
+               int bpp, uint8_t* out) {
+    out[0] = static_cast<uint8_t>(type);
+    uint8_t* o = out + 1;
+    switch (type) {
+    case 0:
+        std::memcpy(o, cur, rowBytes);
+        break;
+    case 1:
+        for (size_t i = 0; i < rowBytes; ++i)
+            o[i] = static_cast<uint8_t>(cur[i] - (i >= size_t(bpp) ? cur[i - bpp] : 0));
+        break;
+    case 2:
+        for (size_t i = 0; i < rowBytes; ++i)
+            o[i] = static_cast<uint8_t>(cur[i] - prev[i]);
+        break;
+    case 3:
+        for (size_t i = 0; i < rowBytes; ++i) {
+            int left = i >= size_t(bpp) ? cur[i - bpp] : 0;
+            o[i] = static_cast<uint8_t>(cur[i] - ((left + prev[i]) >> 1));
+        }
+        break;
+    default:
+        for (size_t i = 0; i < rowBytes; ++i) {
+            bool hasLeft = i >= size_t(bpp);
+            o[i] = static_cast<uint8_t>(cur[i] - paeth(hasLeft ? cur[i - bpp] : 0, prev[i],
+                                                        hasLeft ? prev[i - bpp] : 0));
+        }
+        break;
+    }
+}
+
+// Score of a filtered row for the adaptive heuristic: sum of |signed byte|
+uint64_t filterCost(const uint8_t* row, size_t rowBytes) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < rowBytes; ++i)
+        sum += static_cast<uint64_t>(std::abs(static_cast<int>(static_cast<int8_t>(row[i]))));
+    return sum;
+}
+
+struct EncodedChunk {
+    std::vector<uint8_t> bytes;   // one complete IDAT chunk
+    uint32_t adler = 1;           // of this chunk's filtered bytes
+    size_t rawSize = 0;
+};
+
+// Filter rows [row0, row1) and deflate them into an IDAT chunk. The rows just
+// above (up to 32 KiB of filtered data) are filtered again as match history.
+EncodedChunk encodeChunk(const ImageBuffer& img, const PngWriter::Options& options,
+                         int row0, int row1, bool first, bool last) {
+    const int bpp = ImageProcessor::packedChannels(img);
+    const size_t rowBytes = static_cast<size_t>(img.width) * bpp;
+    const size_t lineBytes = rowBytes + 1;
+
+    const int historyRows = options.level >= 2 && row0 > 0
+        ? static_cast<int>(std::min<size_t>(row0, (WINDOW_SIZE + lineBytes - 1) / lineBytes))
+        : 0;
+    const int startRow = row0 - historyRows;
+
+    ScratchArray<uint8_t> prev(rowBytes, 0);
+    ScratchArray<uint8_t> cur(rowBytes);
+    ScratchArray<uint8_t> filtered(static_cast<size_t>(row1 - startRow) * lineBytes);
+    ScratchArray<uint8_t> trial(options.filter == PngFilter::Adaptive ? lineBytes : 0);
+    if (startRow > 0) ImageProcessor::packRow(img, startRow - 1, prev.data());
+
+    for (int y = startRow; y < row1; ++y) {
+        ImageProcessor::packRow(img, y, cur.data());
+        uint8_t* out = filtered.data() + static_cast<size_t>(y - startRow) * lineBytes;
+        if (options.filter == PngFilter::Adaptive) {
+            uint64_t bestCost = UINT64_MAX;
+            for (int type = 0; type < 5; ++type) {
+                filterRow(type, cur.data(), prev.data(), rowBytes, bpp, trial.data());
+                uint64_t cost = filterCost(trial.data() + 1, rowBytes);
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    std::memcpy(out, trial.data(), lineBytes);
+                }
+            }
+        } else {
+            filterRow(static_cast<int>(options.filter), cur.data(), prev.data(), rowBytes, bpp, out);
+        }
+        std::swap(prev, cur);
+    }
+
+    const size_t historyBytes = std::min<size_t>(static_cast<size_t>(historyRows) * lineBytes, WINDOW_SIZE);
+    const size_t skip = static_cast<size_t>(historyRows) * lineBytes - historyBytes;
+    const uint8_t* in = filtered.data() + skip;
+    const size_t size = filtered.size() - skip;
+
+    EncodedChunk chunk;
+    chunk.rawSize = size - historyBytes;
+    chunk.adler = adler32(in + historyBytes, chunk.rawSize);
+
+    std::vector<uint8_t>& bytes = chunk.bytes;
+    bytes.reserve(chunk.rawSize / 2 + 64);
+    bytes.resize(8);  // length + type, filled in below
+    std::memcpy(bytes.data() + 4, "IDAT", 4);
+    if (first) {
+        // zlib header: deflate, 32K window, FLEVEL from the compression level
+        static const uint8_t FLG[4] = {0x01, 0x5E, 0x9C, 0xDA};
+        int flevel = options.level < 2 ? 0 : options.level < 6 ? 1 : options.level == 6 ? 2 : 3;
+        bytes.push_back(0x78);
+        bytes.push_back(FLG[flevel]);
+    }
+    DeflateEncoder(bytes, options.level).compress(in, historyBytes, size, last);
+
+    putBE32(bytes.data(), static_cast<uint32_t>(bytes.size() - 8));
+    uint8_t crc[4];
+    putBE32(crc, crc32Update(0, bytes.data() + 4, bytes.size() - 4));
+    bytes.insert(bytes.end(), crc, crc + 4);
+    return chunk;
+}
+
+bool writeChunk(const PngWriter::Sink& sink, const char* type, const uint8_t* data, uint32_t size) {
+    uint8_t head[8];
+    putBE32(head, size);
+    std::memcpy(head + 4, type, 4);
+    uint8_t crc[4];
+    putBE32(crc, crc32Update(crc32Update(0, head + 4, 4), data, size));
+    return sink(head, 8) && (size == 0 || sink(data, size)) && sink(crc, 4);
+}
+
+} // namespace
+
+namespace PngWriter {
+
+bool encode(const ImageBuffer& img, const Options& options, const Sink& sink,
+            std::atomic<float>* progress) {
+    const int channels = ImageProcessor::packedChannels(img);
+    if (!img.valid() || !sink || channels < 1 || channels > 4) return false;
+    if (progress) progress->store(0.0f);
+
+    ThreadPool& pool = options.pool ? *options.pool : ThreadPool::shared();
+    Options opt = options;
+    opt.level = std::clamp(opt.level, 0, 9);
+
+    static const uint8_t SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    static const uint8_t COLOR_TYPE[5] = {0, 0, 4, 2, 6};  // by channel count
+    uint8_t ihdr[13];
+    putBE32(ihdr, static_cast<uint32_t>(img.width));
+    putBE32(ihdr + 4, static_cast<uint32_t>(img.height));
+    ihdr[8] = 8;                     // bit depth
+    ihdr[9] = COLOR_TYPE[channels];
+    ihdr[10] = ihdr[11] = ihdr[12] = 0;
+    if (!sink(SIGNATURE, 8) || !writeChunk(sink, "IHDR", ihdr, 13)) return false;
+
+    const size_t lineBytes = static_cast<size_t>(img.width) * channels + 1;
+    const int rowsPerChunk = static_cast<int>(std::clamp<size_t>(
+        opt.chunkBytes / lineBytes, 1, static_cast<size_t>(img.height)));
+    const int numChunks = (img.height + rowsPerChunk - 1) / rowsPerChunk;
+
+    // Chunks are compressed ahead of the writer by at most two per worker
+    const int maxInFlight = static_cast<int>(pool.size()) * 2;
+    std::deque<std::future<EncodedChunk>> inFlight;
+    int submitted = 0;
+    auto submitNext = [&] {
+        int row0 = submitted * rowsPerChunk;
+        int row1 = std::min(img.height, row0 + rowsPerChunk);
+        bool first = submitted == 0, last = submitted == numChunks - 1;
+        inFlight.push_back(pool.submit([&img, &opt, row0, row1, first, last] {
+            return encodeChunk(img, opt, row0, row1, first, last);
+        }));
+        ++submitted;
+    };
+
+    bool ok = true;
+    uint32_t adler = 1;
+    for (int written = 0; written < numChunks && ok; ++written) {
+        while (submitted < numChunks && static_cast<int>(inFlight.size()) < maxInFlight)
+            submitNext();
+        EncodedChunk chunk;
+        try {
+            chunk = inFlight.front().get();
+        } catch (...) {
+            // Out of memory in a worker: finish as a failed write
+            inFlight.pop_front();
+            ok = false;
+            break;
+        }
+        inFlight.pop_front();
+        adler = written == 0 ? chunk.adler : adler32Combine(adler, chunk.adler, chunk.rawSize);
+        ok = sink(chunk.bytes.data(), chunk.bytes.size());
+        if (progress) progress->store(static_cast<float>(written + 1) / numChunks);
+    }
+    // Workers reference `img`: never return while any are still running
+    for (auto& f : inFlight) f.wait();
+    if (!ok) return false;
+
+    // The zlib trailer goes in its own small IDAT once every chunk is summed
+    uint8_t trailer[4];
+    putBE32(trailer, adler);
+    return writeChunk(sink, "IDAT", trailer, 4) && writeChunk(sink, "IEND", nullptr, 0);
+}
+
+bool writeFile(const std::string& path, const ImageBuffer& img, const Options& options,
+               std::atomic<float>* progress) {
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = encode(img, options, [f](const uint8_t* data, size_t size) {
+        return std::fwrite(data, 1, size, f) == size;
+    }, progress);
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok) std::remove(path.c_str());
+    return ok;
+}
+
+} // namespace PngWriter
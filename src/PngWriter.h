@@ -0,0 +1,44 @@
+#pragma once
+
+#include "ImageProcessor.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+class ThreadPool;
+
+// ---------------------------------------------------------------------------
+// PngWriter - multithreaded PNG encoder
+//
+// Rows are filtered and deflated in independent chunks on a ThreadPool. A
+// chunk may reference the last 32 KiB of the rows before it and ends on a
+// byte boundary (sync flush), so the compressed chunks join into a single
+// zlib stream in row order; their Adler-32 sums are combined at the end.
+// ---------------------------------------------------------------------------
+
+namespace PngWriter {
+
+struct Options {
+    int level = 6;                          // 0 = store, 1 = run-length only, 2..9 = LZ77 effort
+    PngFilter filter = PngFilter::Adaptive;
+    size_t chunkBytes = size_t(1) << 20;    // filtered bytes per independent chunk
+    ThreadPool* pool = nullptr;             // nullptr = ThreadPool::shared()
+};
+
+// Receives the file front to back; returning false aborts the encode
+using Sink = std::function<bool(const uint8_t* data, size_t size)>;
+
+// 8-bit gray, gray+alpha, RGB or RGBA depending on the buffer's channels (a
+// separate alpha plane is interleaved back in); any PixelLayout is accepted.
+// `progress`, if given, goes from 0 to 1 as chunks are written.
+bool encode(const ImageBuffer& img, const Options& options, const Sink& sink,
+            std::atomic<float>* progress = nullptr);
+
+// encode() into a file; a partially written file is removed on failure
+bool writeFile(const std::string& path, const ImageBuffer& img, const Options& options,
+               std::atomic<float>* progress = nullptr);
+
+} // namespace PngWriter
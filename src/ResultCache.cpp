@@ -0,0 +1,497 @@
+#include "ResultCache.h"
+#include "ImageLoader.h"
+#include "Kernels.h"
+#include "PngWriter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Bump when the key derivation or the stored format changes
+constexpr uint64_t CACHE_VERSION = 5;
+
+// Inputs this long (pixel data) take the stripe kernel; shorter ones
+// (settings, headers) plain xxHash64
+constexpr size_t STRIPE_MIN_BYTES = 1024;
+
+// Keeps iterative-destroy pass keys apart from result keys
+constexpr uint64_t PASS_KEY_SEED = 0x7061737365730001ull;
+
+constexpr uint64_t PRIME1 = 11400714785074694791ull;
+constexpr uint64_t PRIME2 = 14029467366897019727ull;
+constexpr uint64_t PRIME3 = 1609587929392839161ull;
+constexpr uint64_t PRIME4 = 9650029242287828579ull;
+constexpr uint64_t PRIME5 = 2870177450012600261ull;
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t read64(const uint8_t* p) { uint64_t v; std::memcpy(&v, p, 8); return v; }
+inline uint32_t read32(const uint8_t* p) { uint32_t v; std::memcpy(&v, p, 4); return v; }
+
+inline uint64_t round64(uint64_t acc, uint64_t input) {
+    acc += input * PRIME2;
+    return rotl(acc, 31) * PRIME1;
+}
+
+inline uint64_t mergeRound(uint64_t acc, uint64_t val) {
+    acc ^= round64(0, val);
+    return acc * PRIME1 + PRIME4;
+}
+
+uint64_t xxHash64(const void* data, size_t size, uint64_t seed) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* const end = p + size;
+    uint64_t h;
+
+    if (size >= 32) {
+        // Four independent lanes over 32-byte stripes
+        uint64_t v1 = seed + PRIME1 + PRIME2;
+        uint64_t v2 = seed + PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME1;
+        const uint8_t* const limit = end - 32;
+        do {
+            v1 = round64(v1, read64(p));
+            v2 = round64(v2, read64(p + 8));
+            v3 = round64(v3, read64(p + 16));
+            v4 = round64(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = mergeRound(h, v1);
+        h = mergeRound(h, v2);
+        h = mergeRound(h, v3);
+        h = mergeRound(h, v4);
+    } else {
+        h = seed + PRIME5;
+    }
+    h += static_cast<uint64_t>(size);
+
+    for (; p + 8 <= end; p += 8)
+        h = rotl(h ^ round64(0, read64(p)), 27) * PRIME1 + PRIME4;
+    if (p + 4 <= end) {
+        h = rotl(h ^ (static_cast<uint64_t>(read32(p)) * PRIME1), 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    for (; p < end; ++p)
+        h = rotl(h ^ (*p * PRIME5), 11) * PRIME1;
+
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+// Settings as a flat list of values; a disabled effect contributes only
+// its "off" marker
+class SettingsWriter {
+public:
+    void add(int64_t v) { m_values.push_back(v); }
+    void add(bool v) { m_values.push_back(v ? 1 : 0); }
+    void add(float v) {
+        // Bit pattern, with -0 folded into 0
+        int32_t bits;
+        v += 0.f;
+        std::memcpy(&bits, &v, sizeof(bits));
+        m_values.push_back(bits);
+    }
+    template <typename E, typename = std::enable_if_t<std::is_enum_v<E>>>
+    void add(E v) { m_values.push_back(static_cast<int64_t>(v)); }
+    void add(const std::string& s) {
+        add(static_cast<int64_t>(s.size()));
+        m_values.push_back(static_cast<int64_t>(ResultCache::hashBytes(s.data(), s.size())));
+    }
+    uint64_t hash() const {
+        return ResultCache::hashBytes(m_values.data(), m_values.size() * sizeof(int64_t));
+    }
+private:
+    std::vector<int64_t> m_values;
+};
+
+bool parseKey(const std::string& name, ResultCache::Key& key) {
+    if (name.size() != 32 + 4 || name.compare(32, 4, ".png") != 0) return false;
+    for (int i = 0; i < 32; ++i)
+        if (!std::isxdigit(static_cast<unsigned char>(name[i]))) return false;
+    key.source = std::stoull(name.substr(0, 16), nullptr, 16);
+    key.settings = std::stoull(name.substr(16, 16), nullptr, 16);
+    return true;
+}
+
+void removeFiles(const std::vector<std::string>& paths) {
+    std::error_code ec;
+    for (const auto& path : paths) fs::remove(path, ec);
+}
+
+} // namespace
+
+ResultCache::ResultCache(size_t memoryBudget) : m_memoryBudget(memoryBudget) {}
+
+// ---------------------------------------------------------------------------
+// Keys
+// ---------------------------------------------------------------------------
+
+uint64_t ResultCache::hashBytes(const void* data, size_t size, uint64_t seed) {
+    if (size < STRIPE_MIN_BYTES) return xxHash64(data, size, seed);
+
+    // Whole 64-byte stripes go through the vectorized lane kernel; the lanes
+    // and the bytes after the last whole stripe are then folded by xxHash64
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const size_t stripes = size / 64;
+    uint64_t lanes[8];
+    for (int i = 0; i < 8; ++i) lanes[i] = (seed + static_cast<uint64_t>(i)) * PRIME1 + PRIME5;
+    Kernels::table().hashStripes(p, stripes, lanes);
+    const uint64_t h = xxHash64(lanes, sizeof(lanes), seed ^ static_cast<uint64_t>(size));
+    return xxHash64(p + stripes * 64, size - stripes * 64, h);
+}
+
+uint64_t ResultCache::hashImage(const ImageBuffer& img) {
+    const int64_t header[5] = {img.width, img.height, img.channels,
+                               static_cast<int64_t>(img.layout), img.alpha.empty() ? 0 : 1};
+    uint64_t h = hashBytes(header, sizeof(header), CACHE_VERSION);
+    h = hashBytes(img.data.data(), img.data.size(), h);
+    if (!img.alpha.empty()) h = hashBytes(img.alpha.data(), img.alpha.size(), h);
+    return h;
+}
+
+// Mirrors the early-outs of the processImage stages: keep in sync when a
+// stage starts reading another field
+uint64_t ResultCache::hashSettings(const Settings& s) {
+    SettingsWriter w;
+    w.add(static_cast<int64_t>(CACHE_VERSION));
+
+    const bool resample = s.resolution > 0 && s.resolution < 100;
+    w.add(resample ? static_cast<int64_t>(s.resolution) : 100);
+    w.add(resample && s.hd8k);
+
+    w.add(static_cast<int64_t>(std::max(0, s.quantization)));
+    if (s.quantization > 0) w.add(s.ditherMode);
+
+    w.add(static_cast<int64_t>(std::max(0, s.sharpen)));
+
+    w.add(static_cast<int64_t>(std::max(0, s.noiseIntensity)));
+    if (s.noiseIntensity > 0) {
+        w.add(s.noiseType);
+        w.add(s.noisePerChannel);
+        w.add(static_cast<int64_t>(s.noiseSeed));
+    }
+
+    // RGB shift moves something only with an axis switched on or an offset set
+    const bool shiftAxes = s.rgbShiftAmount > 0 && (s.rgbShiftX || s.rgbShiftY);
+    bool shiftOffsets = false;
+    for (const auto& offset : s.rgbShiftOffsets)
+        shiftOffsets |= offset[0] != 0.f || offset[1] != 0.f;
+    w.add(shiftAxes);
+    if (shiftAxes) {
+        w.add(static_cast<int64_t>(s.rgbShiftAmount));
+        w.add(s.rgbShiftX);
+        w.add(s.rgbShiftY);
+    }
+    w.add(shiftOffsets);
+    if (shiftOffsets) {
+        for (const auto& offset : s.rgbShiftOffsets) {
+            w.add(offset[0]);
+            w.add(offset[1]);
+        }
+    }
+
+    const bool glitch = s.glitchBands > 0 && s.glitchAmplitude > 0;
+    w.add(glitch);
+    if (glitch) {
+        w.add(static_cast<int64_t>(s.glitchBands));
+        w.add(static_cast<int64_t>(s.glitchAmplitude));
+        w.add(static_cast<int64_t>(s.glitchSeed));
+        w.add(s.glitchMode);
+    }
+
+    w.add(static_cast<int64_t>(std::max(0, s.displacement)));
+    if (s.displacement > 0) w.add(static_cast<int64_t>(s.displacementSeed));
+
+    const bool jpeg = s.jpegQuality > 0 && s.jpegQuality < 100;
+    w.add(jpeg ? static_cast<int64_t>(s.jpegQuality) : 100);
+    if (jpeg) w.add(static_cast<int64_t>(s.jpegIterations));
+
+    w.add(s.palette);
+    if (s.palette == PalettePreset::Custom) {
+        w.add(static_cast<int64_t>(s.customPalette.size()));
+        for (const auto& c : s.customPalette)
+            w.add(static_cast<int64_t>((c[0] << 16) | (c[1] << 8) | c[2]));
+    }
+
+    const int passes = ImageProcessor::passCount(s);
+    w.add(static_cast<int64_t>(passes));
+    if (passes > 1) w.add(static_cast<int64_t>(std::max(0, s.iterativeTolerance)));
+
+    w.add(s.watermark);
+    if (s.watermark) w.add(s.watermarkText);
+    return w.hash();
+}
+
+ResultCache::Key ResultCache::makeKey(const ImageBuffer& source, const Settings& settings) {
+    return {hashImage(source), hashSettings(settings)};
+}
+
+ResultCache::Key ResultCache::makePassKey(uint64_t source, const Settings& settings, int pass) {
+    // Everything a pass depends on, the tolerance included: it decides
+    // whether a run would have stopped before this pass
+    Settings s = settings;
+    s.iterativeDestroy = true;
+    s.iterativeCount = 2;
+    s.watermark = false;
+    const int64_t tagged[2] = {static_cast<int64_t>(hashSettings(s)), pass};
+    return {source, hashBytes(tagged, sizeof(tagged), PASS_KEY_SEED)};
+}
+
+// ---------------------------------------------------------------------------
+// Storage
+// ---------------------------------------------------------------------------
+
+void ResultCache::setDiskTier(const std::string& directory, size_t budget) {
+    // Earlier sessions' entries, oldest first, so trimming drops those first.
+    // The scan happens before taking the lock.
+    std::vector<std::pair<fs::file_time_type, std::pair<Key, size_t>>> found;
+    std::error_code ec;
+    bool usable = false;
+    if (!directory.empty()) {
+        fs::create_directories(directory, ec);
+        usable = fs::is_directory(directory, ec);
+    }
+    if (usable) {
+        for (const auto& item : fs::directory_iterator(directory, ec)) {
+            Key key;
+            if (!item.is_regular_file(ec) || !parseKey(item.path().filename().string(), key)) continue;
+            found.push_back({item.last_write_time(ec), {key, static_cast<size_t>(item.file_size(ec))}});
+        }
+        std::sort(found.begin(), found.end(),
+                  [](const auto& a, const auto& b) { return a.first < b.first; });
+    }
+
+    std::vector<std::string> doomed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_diskDir = usable ? directory : std::string();
+        m_diskIndex.clear();
+        m_diskBytes = 0;
+        m_diskBudget = budget;
+        for (const auto& [time, entry] : found) {
+            m_diskIndex[entry.first] = {entry.second, ++m_diskClock};
+            m_diskBytes += entry.second;
+        }
+        trimDisk(doomed);
+    }
+    removeFiles(doomed);
+}
+
+std::string ResultCache::diskPath(const std::string& directory, const Key& key) {
+    char name[40];
+    std::snprintf(name, sizeof(name), "%016llx%016llx.png",
+                  static_cast<unsigned long long>(key.source),
+                  static_cast<unsigned long long>(key.settings));
+    return (fs::path(directory) / name).string();
+}
+
+void ResultCache::trimDisk(std::vector<std::string>& doomed) {
+    while (m_diskBytes > m_diskBudget && !m_diskIndex.empty()) {
+        auto oldest = std::min_element(m_diskIndex.begin(), m_diskIndex.end(),
+            [](const auto& a, const auto& b) { return a.second.lastUse < b.second.lastUse; });
+        doomed.push_back(diskPath(m_diskDir, oldest->first));
+        m_diskBytes -= oldest->second.size;
+        m_diskIndex.erase(oldest);
+    }
+}
+
+void ResultCache::storeInMemory(const Key& key, Blob png) {
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+        m_memoryBytes -= it->second->png->size();
+        m_lru.erase(it->second);
+        m_index.erase(it);
+    }
+    if (png->size() > m_memoryBudget) return;
+
+    m_memoryBytes += png->size();
+    m_lru.push_front({key, std::move(png)});
+    m_index[key] = m_lru.begin();
+    while (m_memoryBytes > m_memoryBudget) {
+        m_memoryBytes -= m_lru.back().png->size();
+        m_index.erase(m_lru.back().key);
+        m_lru.pop_back();
+    }
+}
+
+bool ResultCache::get(const Key& key, ImageBuffer& out) {
+    const bool hit = find(key, out);
+    (hit ? m_hits : m_misses).fetch_add(1, std::memory_order_relaxed);
+    return hit;
+}
+
+bool ResultCache::find(const Key& key, ImageBuffer& out) {
+    Blob png;
+    std::string path;
+    uint64_t lastUse = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(key);
+        if (it != m_index.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second);
+            png = it->second->png;
+        } else if (auto disk = m_diskIndex.find(key); disk != m_diskIndex.end()) {
+            path = diskPath(m_diskDir, key);
+            lastUse = disk->second.lastUse;
+        }
+    }
+
+    if (!png && !path.empty()) {
+        // Promote from disk. The file is read whole rather than at its
+        // indexed size, since a concurrent put may have replaced it.
+        std::vector<uint8_t> bytes;
+        FILE* f = std::fopen(path.c_str(), "rb");
+        bool ok = f && std::fseek(f, 0, SEEK_END) == 0;
+        const long size = ok ? std::ftell(f) : -1;
+        ok = ok && size > 0 && std::fseek(f, 0, SEEK_SET) == 0;
+        if (ok) {
+            bytes.resize(static_cast<size_t>(size));
+            ok = std::fread(bytes.data(), 1, bytes.size(), f) == bytes.size();
+        }
+        if (f) std::fclose(f);
+        if (ok) {
+            std::error_code ec;
+            fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+            png = std::make_shared<const std::vector<uint8_t>>(std::move(bytes));
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto disk = m_diskIndex.find(key);
+        if (ok) {
+            if (disk != m_diskIndex.end()) disk->second.lastUse = ++m_diskClock;
+            storeInMemory(key, png);
+        } else if (disk != m_diskIndex.end() && disk->second.lastUse == lastUse) {
+            // Gone or unreadable, and not rewritten meanwhile
+            m_diskBytes -= disk->second.size;
+            m_diskIndex.erase(disk);
+        }
+    }
+
+    // Decode outside the lock
+    ImageBuffer img = png ? ImageLoader::decodeMemory(png->data(), png->size()) : ImageBuffer{};
+    if (!img.valid()) return false;
+    out = std::move(img);
+    return true;
+}
+
+void ResultCache::put(const Key& key, const ImageBuffer& result) {
+    if (!result.valid()) return;
+
+    // RLE over Sub-filtered rows: fast both ways, and the posterized,
+    // blocky output of most effect chains shrinks well
+    PngWriter::Options options;
+    options.level = 1;
+    options.filter = PngFilter::Sub;
+    auto bytes = std::make_shared<std::vector<uint8_t>>();
+    bool ok = PngWriter::encode(result, options, [&bytes](const uint8_t* data, size_t size) {
+        bytes->insert(bytes->end(), data, data + size);
+        return true;
+    });
+    if (!ok) return;
+    Blob png = std::move(bytes);
+
+    std::string directory;
+    uint64_t ticket = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_diskDir.empty() && png->size() <= m_diskBudget) {
+            directory = m_diskDir;
+            ticket = ++m_diskWrites;
+        }
+    }
+
+    bool written = false;
+    if (!directory.empty()) {
+        // Write-then-rename so a concurrent reader never sees half a file;
+        // the ticket keeps concurrent writers of one key off each other's
+        // temporary, and parseKey never picks it up
+        const std::string path = diskPath(directory, key);
+        const std::string tmp = path + "." + std::to_string(ticket) + ".tmp";
+        FILE* f = std::fopen(tmp.c_str(), "wb");
+        written = f && std::fwrite(png->data(), 1, png->size(), f) == png->size();
+        if (f) written = std::fclose(f) == 0 && written;
+        std::error_code ec;
+        if (written) fs::rename(tmp, path, ec);
+        if (!written || ec) {
+            fs::remove(tmp, ec);
+            written = false;
+        }
+    }
+
+    std::vector<std::string> doomed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // A file written into a directory that was switched away from
+        // meanwhile stays there unindexed, as if from an earlier session
+        if (written && m_diskDir == directory) {
+            auto [it, inserted] = m_diskIndex.try_emplace(key);
+            if (!inserted) m_diskBytes -= it->second.size;
+            it->second = {png->size(), ++m_diskClock};
+            m_diskBytes += png->size();
+            trimDisk(doomed);
+        }
+        storeInMemory(key, std::move(png));
+    }
+    removeFiles(doomed);
+}
+
+ImageBuffer ResultCache::process(const ImageBuffer& source, const Settings& settings,
+                                 std::atomic<bool>& cancel, uint64_t* allocations) {
+    const Key key = makeKey(source, settings);
+    ImageBuffer result;
+    if (get(key, result)) return result;
+
+    // Only processImage's own allocations count; storing passes doesn't
+    uint64_t before = 0;
+    uint64_t storing = 0;
+    const int passes = ImageProcessor::passCount(settings);
+    if (passes == 1) {
+        before = BufferPool::threadAllocationCount();
+        result = ImageProcessor::processImage(source, settings, cancel);
+    } else {
+        // Iterative destroy: keep every pass, and start from the latest one
+        // already known so changing the count only runs the difference
+        ImageProcessor::PassHooks hooks;
+        ImageBuffer resumed;
+        for (int pass = passes; pass >= 1; --pass) {
+            if (find(makePassKey(key.source, settings, pass), resumed)) {
+                hooks.donePasses = pass;
+                break;
+            }
+        }
+        hooks.onPass = [&](int pass, const ImageBuffer& image) {
+            const uint64_t start = BufferPool::threadAllocationCount();
+            put(makePassKey(key.source, settings, pass), image);
+            storing += BufferPool::threadAllocationCount() - start;
+        };
+        before = BufferPool::threadAllocationCount();
+        result = ImageProcessor::processImage(hooks.donePasses ? resumed : source, settings,
+                                              cancel, hooks);
+    }
+    if (allocations) *allocations = BufferPool::threadAllocationCount() - before - storing;
+    if (!cancel.load(std::memory_order_relaxed)) put(key, result);
+    return result;
+}
+
+ResultCache::Stats ResultCache::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats s;
+    s.hits = m_hits.load(std::memory_order_relaxed);
+    s.misses = m_misses.load(std::memory_order_relaxed);
+    s.memoryBytes = m_memoryBytes;
+    s.diskBytes = m_diskBytes;
+    return s;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "ImageProcessor.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// ResultCache - processImage results keyed by what they were made from
+//
+// The key is a hash of the source pixels plus a canonical hash of the
+// Settings: only fields processImage reads count, and parameters of disabled
+// effects are ignored, so e.g. changing the glitch seed with glitch off still
+// hits. Results are held PNG-compressed in memory and evicted least recently
+// used first once over the byte budget. An optional disk tier keeps every
+// result as <key>.png in a directory, with its own budget. Disk reads and
+// writes happen outside the lock, which only guards the indexes.
+//
+// All methods are thread-safe.
+// ---------------------------------------------------------------------------
+
+class ResultCache {
+public:
+    struct Key {
+        uint64_t source = 0;
+        uint64_t settings = 0;
+        bool operator==(const Key& o) const { return source == o.source && settings == o.settings; }
+    };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        size_t memoryBytes = 0;
+        size_t diskBytes = 0;
+    };
+
+    explicit ResultCache(size_t memoryBudget = size_t(256) << 20);
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    // 64-bit hash of raw bytes: xxHash64 below 1 KiB, above that a
+    // vectorized 8-lane stripe loop (Kernels::Table::hashStripes) folded
+    // by xxHash64
+    static uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
+    // Dimensions, layout and pixels, alpha plane included
+    static uint64_t hashImage(const ImageBuffer& img);
+    static uint64_t hashSettings(const Settings& settings);
+    static Key makeKey(const ImageBuffer& source, const Settings& settings);
+    // The image after `pass` iterative-destroy passes over `source` (a
+    // hashImage value); watermark and pass count don't take part
+    static Key makePassKey(uint64_t source, const Settings& settings, int pass);
+
+    // Keep results in `directory` too (created if needed), trimmed to
+    // `budget` bytes. An empty directory turns the disk tier off.
+    void setDiskTier(const std::string& directory, size_t budget = size_t(1) << 30);
+
+    // Counts towards the hit/miss stats, once per call
+    bool get(const Key& key, ImageBuffer& out);
+    void put(const Key& key, const ImageBuffer& result);
+
+    // processImage(source, settings), served from the cache when possible.
+    // Cancelled runs are not stored, but their finished iterative-destroy
+    // passes are, and later runs resume from the latest one. Counts one hit
+    // or miss per call. `allocations`, if given, receives the heap
+    // allocations processImage made on this thread; it is left alone on a hit.
+    ImageBuffer process(const ImageBuffer& source, const Settings& settings,
+                        std::atomic<bool>& cancel, uint64_t* allocations = nullptr);
+
+    Stats stats() const;
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            return static_cast<size_t>(k.source ^ (k.settings * 0x9E3779B97F4A7C15ull));
+        }
+    };
+    using Blob = std::shared_ptr<const std::vector<uint8_t>>;
+    struct Entry {
+        Key key;
+        Blob png;
+    };
+    struct DiskEntry {
+        size_t size = 0;
+        uint64_t lastUse = 0;
+    };
+
+    bool find(const Key& key, ImageBuffer& out);     // get() without the stats
+    void storeInMemory(const Key& key, Blob png);    // m_mutex held
+    static std::string diskPath(const std::string& directory, const Key& key);
+    // Drops index entries down to the budget; the caller removes `doomed`
+    // after unlocking. m_mutex held.
+    void trimDisk(std::vector<std::string>& doomed);
+
+    mutable std::mutex m_mutex;
+    size_t m_memoryBudget;
+    size_t m_memoryBytes = 0;
+    std::list<Entry> m_lru;                          // most recent first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_index;
+
+    std::string m_diskDir;
+    size_t m_diskBudget = 0;
+    size_t m_diskBytes = 0;
+    uint64_t m_diskClock = 0;
+    uint64_t m_diskWrites = 0;                       // names put()'s temporaries
+    std::unordered_map<Key, DiskEntry, KeyHash> m_diskIndex;
+
+    std::atomic<uint64_t> m_hits{0};
+    std::atomic<uint64_t> m_misses{0};
+};
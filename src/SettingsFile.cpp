@@ -0,0 +1,149 @@
+#include "SettingsFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace SettingsFile {
+
+namespace {
+
+void appendf(std::string& out, const char* format, ...) {
+    char buf[512];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (n > 0) out.append(buf, std::min<size_t>(n, sizeof(buf) - 1));
+}
+
+} // namespace
+
+std::string toText(const Settings& settings) {
+    std::string text;
+    appendf(text, "hd8k=%d\n",            settings.hd8k ? 1 : 0);
+    appendf(text, "quantization=%d\n",     settings.quantization);
+    appendf(text, "ditherMode=%d\n",       static_cast<int>(settings.ditherMode));
+    appendf(text, "sharpen=%d\n",          settings.sharpen);
+    appendf(text, "resolution=%d\n",       settings.resolution);
+    appendf(text, "displacement=%d\n",     settings.displacement);
+    appendf(text, "displacementSeed=%d\n", settings.displacementSeed);
+    appendf(text, "jpegQuality=%d\n",      settings.jpegQuality);
+    appendf(text, "jpegIterations=%d\n",   settings.jpegIterations);
+    appendf(text, "noiseIntensity=%d\n",   settings.noiseIntensity);
+    appendf(text, "noiseType=%d\n",        static_cast<int>(settings.noiseType));
+    appendf(text, "noisePerChannel=%d\n",  settings.noisePerChannel ? 1 : 0);
+    appendf(text, "noiseSeed=%d\n",        settings.noiseSeed);
+    appendf(text, "rgbShiftAmount=%d\n",   settings.rgbShiftAmount);
+    appendf(text, "rgbShiftX=%d\n",        settings.rgbShiftX ? 1 : 0);
+    appendf(text, "rgbShiftY=%d\n",        settings.rgbShiftY ? 1 : 0);
+    const auto& o = settings.rgbShiftOffsets;
+    appendf(text, "rgbShiftOffsets=%g,%g,%g,%g,%g,%g\n",
+            o[0][0], o[0][1], o[1][0], o[1][1], o[2][0], o[2][1]);
+    appendf(text, "glitchBands=%d\n",      settings.glitchBands);
+    appendf(text, "glitchAmplitude=%d\n",  settings.glitchAmplitude);
+    appendf(text, "glitchSeed=%d\n",       settings.glitchSeed);
+    appendf(text, "glitchMode=%d\n",       static_cast<int>(settings.glitchMode));
+    appendf(text, "palette=%d\n",          static_cast<int>(settings.palette));
+    appendf(text, "iterativeDestroy=%d\n", settings.iterativeDestroy ? 1 : 0);
+    appendf(text, "iterativeCount=%d\n",   settings.iterativeCount);
+    appendf(text, "iterativeTolerance=%d\n", settings.iterativeTolerance);
+    appendf(text, "watermark=%d\n",        settings.watermark ? 1 : 0);
+    appendf(text, "watermarkText=%s\n",    settings.watermarkText.c_str());
+    appendf(text, "randomSeed=%d\n",       settings.randomSeed);
+    appendf(text, "stripExif=%d\n",        settings.stripExif ? 1 : 0);
+    appendf(text, "diskCache=%d\n",        settings.diskCache ? 1 : 0);
+    appendf(text, "pngLevel=%d\n",         settings.pngLevel);
+    appendf(text, "pngFilter=%d\n",        static_cast<int>(settings.pngFilter));
+    appendf(text, "jpegExportQuality=%d\n", settings.jpegExportQuality);
+    appendf(text, "jpegSubsampling=%d\n",  static_cast<int>(settings.jpegSubsampling));
+    appendf(text, "jpegTargetKB=%d\n",     settings.jpegTargetKB);
+    appendf(text, "jpegTargetResize=%d\n", settings.jpegTargetResize ? 1 : 0);
+    appendf(text, "animateSeeds=%d\n",     settings.animateSeeds ? 1 : 0);
+    return text;
+}
+
+void parse(const std::string& text, Settings& settings) {
+    for (size_t pos = 0; pos < text.size();) {
+        size_t end = std::min(text.find('\n', pos), text.size());
+        std::string line = text.substr(pos, std::min<size_t>(end - pos, 511));
+        pos = end + 1;
+
+        char key[128];
+        char val[384];
+        if (sscanf(line.c_str(), "%127[^=]=%383[^\n]", key, val) != 2) continue;
+
+        // Values are clamped to the editor's ranges: files and daemon
+        // requests come from anywhere, and the effects assume those bounds
+        int iv = atoi(val);
+        if      (strcmp(key, "hd8k") == 0)            settings.hd8k = iv != 0;
+        else if (strcmp(key, "quantization") == 0)     settings.quantization = std::clamp(iv, 0, 100);
+        else if (strcmp(key, "ditherMode") == 0)       settings.ditherMode = static_cast<DitherMode>(std::clamp(iv, 0, 2));
+        else if (strcmp(key, "sharpen") == 0)          settings.sharpen = std::clamp(iv, 0, 100);
+        else if (strcmp(key, "resolution") == 0)       settings.resolution = std::clamp(iv, 1, 100);
+        else if (strcmp(key, "displacement") == 0)     settings.displacement = std::clamp(iv, 0, 100);
+        else if (strcmp(key, "displacementSeed") == 0) settings.displacementSeed = iv;
+        else if (strcmp(key, "jpegQuality") == 0)      settings.jpegQuality = std::clamp(iv, 0, 100);
+        else if (strcmp(key, "jpegIterations") == 0)   settings.jpegIterations = std::clamp(iv, 1, 20);
+        else if (strcmp(key, "noiseIntensity") == 0)   settings.noiseIntensity = std::clamp(iv, 0, 100);
+        else if (strcmp(key, "noiseType") == 0)        settings.noiseType = static_cast<NoiseType>(std::clamp(iv, 0, 2));
+        else if (strcmp(key, "noisePerChannel") == 0)  settings.noisePerChannel = iv != 0;
+        else if (strcmp(key, "noiseSeed") == 0)        settings.noiseSeed = iv;
+        else if (strcmp(key, "rgbShiftAmount") == 0)   settings.rgbShiftAmount = std::clamp(iv, 0, 100);
+        else if (strcmp(key, "rgbShiftX") == 0)        settings.rgbShiftX = iv != 0;
+        else if (strcmp(key, "rgbShiftY") == 0)        settings.rgbShiftY = iv != 0;
+        else if (strcmp(key, "rgbShiftOffsets") == 0) {
+            auto& o = settings.rgbShiftOffsets;
+            float v[6] = {};
+            if (sscanf(val, "%f,%f,%f,%f,%f,%f", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]) == 6) {
+                // %f takes nan, inf and 1e30 too; keep to the UI's range
+                for (float& f : v) f = std::isfinite(f) ? std::clamp(f, -50.f, 50.f) : 0.f;
+                o = {{{v[0], v[1]}, {v[2], v[3]}, {v[4], v[5]}}};
+            }
+        }
+        else if (strcmp(key, "glitchBands") == 0)      settings.glitchBands = std::clamp(iv, 0, 50);
+        else if (strcmp(key, "glitchAmplitude") == 0)  settings.glitchAmplitude = std::clamp(iv, 0, 200);
+        else if (strcmp(key, "glitchSeed") == 0)       settings.glitchSeed = iv;
+        else if (strcmp(key, "glitchMode") == 0)       settings.glitchMode = static_cast<GlitchMode>(std::clamp(iv, 0, 2));
+        else if (strcmp(key, "palette") == 0)          settings.palette = static_cast<PalettePreset>(std::clamp(iv, 0, 6));
+        else if (strcmp(key, "iterativeDestroy") == 0) settings.iterativeDestroy = iv != 0;
+        else if (strcmp(key, "iterativeCount") == 0)   settings.iterativeCount = std::clamp(iv, 1, 20);
+        else if (strcmp(key, "iterativeTolerance") == 0) settings.iterativeTolerance = std::clamp(iv, 0, 16);
+        else if (strcmp(key, "watermark") == 0)        settings.watermark = iv != 0;
+        else if (strcmp(key, "watermarkText") == 0)    settings.watermarkText = val;
+        else if (strcmp(key, "randomSeed") == 0)       settings.randomSeed = iv;
+        else if (strcmp(key, "stripExif") == 0)        settings.stripExif = iv != 0;
+        else if (strcmp(key, "diskCache") == 0)        settings.diskCache = iv != 0;
+        else if (strcmp(key, "pngLevel") == 0)         settings.pngLevel = std::clamp(iv, 0, 9);
+        else if (strcmp(key, "pngFilter") == 0)        settings.pngFilter = static_cast<PngFilter>(std::clamp(iv, 0, 5));
+        else if (strcmp(key, "jpegExportQuality") == 0) settings.jpegExportQuality = std::clamp(iv, 1, 100);
+        else if (strcmp(key, "jpegSubsampling") == 0)  settings.jpegSubsampling = static_cast<JpegSubsampling>(std::clamp(iv, 0, 2));
+        else if (strcmp(key, "jpegTargetKB") == 0)     settings.jpegTargetKB = std::max(iv, 0);
+        else if (strcmp(key, "jpegTargetResize") == 0) settings.jpegTargetResize = iv != 0;
+        else if (strcmp(key, "animateSeeds") == 0)     settings.animateSeeds = iv != 0;
+    }
+}
+
+bool save(const char* path, const Settings& settings) {
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+    const std::string text = toText(settings);
+    const bool written = fwrite(text.data(), 1, text.size(), f) == text.size();
+    return fclose(f) == 0 && written;
+}
+
+bool load(const char* path, Settings& settings) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    std::string text;
+    char buf[4096];
+    for (size_t n; (n = fread(buf, 1, sizeof(buf), f)) > 0;) text.append(buf, n);
+    fclose(f);
+    parse(text, settings);
+    return true;
+}
+
+} // namespace SettingsFile
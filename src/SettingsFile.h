@@ -0,0 +1,25 @@
+#pragma once
+#include "ImageProcessor.h"
+
+#include <string>
+
+// ---------------------------------------------------------------------------
+// SettingsFile - Settings as simple INI-style key=value lines
+//
+// Unknown keys are skipped and missing keys keep their current value, so
+// files written by older builds still load. Values outside the editor's
+// ranges are clamped into them.
+// ---------------------------------------------------------------------------
+
+namespace SettingsFile {
+
+bool save(const char* path, const Settings& settings);
+
+// Overlays the keys found in `path` onto `settings`. False if it can't be read.
+bool load(const char* path, Settings& settings);
+
+// The same format in memory, e.g. for settings sent over a socket
+std::string toText(const Settings& settings);
+void parse(const std::string& text, Settings& settings);
+
+} // namespace SettingsFile
@@ -3,6 +3,7 @@
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 #include <vector>
@@ -19,6 +20,7 @@ typedef float GLfloat;
 typedef char GLchar;
 typedef unsigned char GLboolean;
 typedef signed long long int GLsizeiptr;
+typedef signed long long int GLintptr;
 typedef void GLvoid;
 
 // ---------------------------------------------------------------------------
@@ -37,6 +39,7 @@ typedef void GLvoid;
 #define GL_TEXTURE_WRAP_S                 0x2802
 #define GL_TEXTURE_WRAP_T                 0x2803
 #define GL_TEXTURE_2D                     0x0DE1
+#define GL_MAX_TEXTURE_SIZE               0x0D33
 #define GL_TEXTURE0                       0x84C0
 #define GL_CLAMP_TO_EDGE                  0x812F
 #define GL_FRAGMENT_SHADER                0x8B30
@@ -49,6 +52,15 @@ typedef void GLvoid;
 #define GL_COLOR_ATTACHMENT0              0x8CE0
 #define GL_FRAMEBUFFER_COMPLETE           0x8CD5
 #define GL_COLOR_BUFFER_BIT               0x00004000
+#define GL_RGBA8                          0x8058
+#define GL_LINEAR_MIPMAP_LINEAR           0x2703
+#define GL_TEXTURE_MAX_LEVEL              0x813D
+#define GL_TEXTURE_IMMUTABLE_FORMAT       0x912F
+#define GL_UNPACK_ALIGNMENT               0x0CF5
+#define GL_PIXEL_UNPACK_BUFFER            0x88EC
+#define GL_STREAM_DRAW                    0x88E0
+#define GL_MAP_WRITE_BIT                  0x0002
+#define GL_MAP_INVALIDATE_BUFFER_BIT      0x0008
 
 // ---------------------------------------------------------------------------
 // GL function pointer types and storage
@@ -98,6 +110,14 @@ DECL_GL(void,   glEnableVertexAttribArray, GLuint)
 DECL_GL(void,   glDeleteBuffers, GLsizei, const GLuint*)
 DECL_GL(void,   glDeleteVertexArrays, GLsizei, const GLuint*)
 DECL_GL(void,   glDrawArrays, GLenum, GLint, GLsizei)
+DECL_GL(void,   glGetIntegerv, GLenum, GLint*)
+DECL_GL(void,   glTexSubImage2D, GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, const void*)
+DECL_GL(void,   glGenerateMipmap, GLenum)
+DECL_GL(void,   glPixelStorei, GLenum, GLint)
+DECL_GL(void*,  glMapBufferRange, GLenum, GLintptr, GLsizeiptr, GLbitfield)
+DECL_GL(GLboolean, glUnmapBuffer, GLenum)
+DECL_GL(void,   glGetTexParameteriv, GLenum, GLenum, GLint*)
+DECL_GL(void,   glTexStorage2D, GLenum, GLsizei, GLenum, GLsizei, GLsizei) // GL 4.2 / ARB_texture_storage
 
 #undef DECL_GL
 
@@ -109,6 +129,7 @@ DECL_GL(void,   glDrawArrays, GLenum, GLint, GLsizei)
     if (!name##_) return false;
 
 static bool s_initialized = false;
+static GLint s_maxTextureSize = 8192;
 
 // ---------------------------------------------------------------------------
 // Embedded shaders
@@ -283,6 +304,18 @@ bool init() {
     LOAD_GL(glDeleteBuffers)
     LOAD_GL(glDeleteVertexArrays)
     LOAD_GL(glDrawArrays)
+    LOAD_GL(glGetIntegerv)
+    LOAD_GL(glTexSubImage2D)
+    LOAD_GL(glGenerateMipmap)
+    LOAD_GL(glPixelStorei)
+    LOAD_GL(glMapBufferRange)
+    LOAD_GL(glUnmapBuffer)
+    LOAD_GL(glGetTexParameteriv)
+
+    // Optional: without it preview storage is allocated level by level
+    glTexStorage2D_ = reinterpret_cast<PFN_glTexStorage2D>(glfwGetProcAddress("glTexStorage2D"));
+
+    glGetIntegerv_(GL_MAX_TEXTURE_SIZE, &s_maxTextureSize);
 
     s_initialized = true;
     return true;
@@ -378,8 +411,30 @@ void applyDisplacementGPU(unsigned int program, unsigned int inputTexture,
     glDeleteTextures_(1, &renderTex);
 }
 
+// Images larger than GL_MAX_TEXTURE_SIZE are shown from a nearest-neighbour
+// reduction that fits; ImGui stretches the texture to the image size anyway.
+static const uint8_t* fitTextureSize(const uint8_t* data, int& width, int& height,
+                                     int channels, std::vector<uint8_t>& scratch) {
+    int limit = std::max<GLint>(s_maxTextureSize, 1);
+    if (width <= limit && height <= limit) return data;
+    int step = std::max((width + limit - 1) / limit, (height + limit - 1) / limit);
+    int w = width / step, h = height / step;
+    scratch.resize(static_cast<size_t>(w) * h * channels);
+    for (int y = 0; y < h; ++y) {
+        const uint8_t* src = data + static_cast<size_t>(y) * step * width * channels;
+        uint8_t* dst = scratch.data() + static_cast<size_t>(y) * w * channels;
+        for (int x = 0; x < w; ++x)
+            std::memcpy(dst + x * channels, src + static_cast<size_t>(x) * step * channels, channels);
+    }
+    width = w;
+    height = h;
+    return scratch.data();
+}
+
 unsigned int uploadTexture(const uint8_t* data, int width, int height, int channels) {
     if (!s_initialized || !data) return 0;
+    std::vector<uint8_t> scratch;
+    data = fitTextureSize(data, width, height, channels, scratch);
 
     GLuint tex = 0;
     glGenTextures_(1, &tex);
@@ -407,23 +462,191 @@ void deleteProgram(unsigned int prog) {
     glDeleteProgram_(prog);
 }
 
-unsigned int createPreviewTexture(const uint8_t* data, int width, int height, int channels) {
-    return uploadTexture(data, width, height, channels);
+// ---------------------------------------------------------------------------
+// Preview textures
+// ---------------------------------------------------------------------------
+
+static constexpr int UPLOAD_RING_SIZE = 3;
+static GLuint s_uploadBuffers[UPLOAD_RING_SIZE] = {};
+static int s_nextUploadBuffer = 0;
+
+int previewLodForScale(float displayScale) {
+    int lod = 0;
+    while (lod < 30 && displayScale * static_cast<float>(2 << lod) <= 1.0f) ++lod;
+    return lod;
 }
 
-void updatePreviewTexture(unsigned int tex, const uint8_t* data,
-                          int width, int height, int channels) {
-    if (!s_initialized || !tex || !data) return;
-    glBindTexture_(GL_TEXTURE_2D, tex);
-    GLenum fmt = (channels == 4) ? GL_RGBA : GL_RGB;
-    glTexImage2D_(GL_TEXTURE_2D, 0, static_cast<GLint>(fmt),
-                  width, height, 0, fmt, GL_UNSIGNED_BYTE, data);
+// Box-reduce `src` by `factor` into RGBA `dst` of w x h texels
+static void reducePreview(uint8_t* dst, const uint8_t* src, int width, int height,
+                          int channels, int factor, int w, int h) {
+    if (factor == 1 && channels == 4) {
+        std::memcpy(dst, src, static_cast<size_t>(w) * h * 4);
+        return;
+    }
+    for (int y = 0; y < h; ++y) {
+        int y0 = y * factor, y1 = std::min(height, y0 + factor);
+        for (int x = 0; x < w; ++x) {
+            int x0 = x * factor, x1 = std::min(width, x0 + factor);
+            uint32_t acc[4] = {0, 0, 0, 0};
+            for (int sy = y0; sy < y1; ++sy) {
+                const uint8_t* row = src + (static_cast<size_t>(sy) * width + x0) * channels;
+                for (int sx = x0; sx < x1; ++sx, row += channels) {
+                    acc[0] += row[0];
+                    acc[1] += row[1];
+                    acc[2] += row[2];
+                    acc[3] += channels == 4 ? row[3] : 255;
+                }
+            }
+            uint32_t n = static_cast<uint32_t>((y1 - y0) * (x1 - x0));
+            uint8_t* d = dst + (static_cast<size_t>(y) * w + x) * 4;
+            for (int c = 0; c < 4; ++c) d[c] = static_cast<uint8_t>((acc[c] + n / 2) / n);
+        }
+    }
+}
+
+static void allocatePreviewStorage(PreviewTexture& tex, int w, int h) {
+    int levels = 1;
+    while ((std::max(w, h) >> levels) > 0) ++levels;
+
+    GLuint id = 0;
+    glGenTextures_(1, &id);
+    glBindTexture_(GL_TEXTURE_2D, id);
+    if (glTexStorage2D_) {
+        glTexStorage2D_(GL_TEXTURE_2D, levels, GL_RGBA8, w, h);
+    } else {
+        for (int l = 0; l < levels; ++l)
+            glTexImage2D_(GL_TEXTURE_2D, l, GL_RGBA8, std::max(1, w >> l), std::max(1, h >> l),
+                          0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glTexParameteri_(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    glTexParameteri_(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri_(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri_(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri_(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    tex.id = id;
+    tex.width = w;
+    tex.height = h;
+}
+
+void uploadPreview(PreviewTexture& tex, const uint8_t* data, int width, int height,
+                   int channels, int lod) {
+    if (!s_initialized || !data || width <= 0 || height <= 0) return;
+
+    // Level 0 holds the image reduced by 2^lod, never above the GL limit
+    int limit = std::max<GLint>(s_maxTextureSize, 1);
+    lod = std::clamp(lod, 0, 30);
+    while (lod < 30 && (((width - 1) >> lod) + 1 > limit || ((height - 1) >> lod) + 1 > limit)) ++lod;
+    int factor = 1 << lod;
+    int w = (width + factor - 1) / factor;
+    int h = (height + factor - 1) / factor;
+
+    if (tex.id && (tex.width != w || tex.height != h)) deletePreview(tex);
+    if (!tex.id) allocatePreviewStorage(tex, w, h);
+    tex.lod = lod;
+    tex.sourceWidth = width;
+    tex.sourceHeight = height;
+
+    // Stream through the next buffer of the ring. Orphaning its storage lets
+    // the driver keep feeding earlier uploads while this one is written.
+    if (!s_uploadBuffers[0]) glGenBuffers_(UPLOAD_RING_SIZE, s_uploadBuffers);
+    GLuint pbo = s_uploadBuffers[s_nextUploadBuffer];
+    s_nextUploadBuffer = (s_nextUploadBuffer + 1) % UPLOAD_RING_SIZE;
+
+    auto bytes = static_cast<GLsizeiptr>(static_cast<size_t>(w) * h * 4);
+    glBindTexture_(GL_TEXTURE_2D, tex.id);
+    glPixelStorei_(GL_UNPACK_ALIGNMENT, 4);
+    glBindBuffer_(GL_PIXEL_UNPACK_BUFFER, pbo);
+    glBufferData_(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+    void* mapped = glMapBufferRange_(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+                                     GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped) {
+        reducePreview(static_cast<uint8_t*>(mapped), data, width, height, channels, factor, w, h);
+        glUnmapBuffer_(GL_PIXEL_UNPACK_BUFFER);
+        glTexSubImage2D_(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer_(GL_PIXEL_UNPACK_BUFFER, 0);
+    } else {
+        // Mapping failed: upload from client memory
+        glBindBuffer_(GL_PIXEL_UNPACK_BUFFER, 0);
+        std::vector<uint8_t> texels(static_cast<size_t>(bytes));
+        reducePreview(texels.data(), data, width, height, channels, factor, w, h);
+        glTexSubImage2D_(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+    }
+    glGenerateMipmap_(GL_TEXTURE_2D);
+}
+
+void deletePreview(PreviewTexture& tex) {
+    if (s_initialized && tex.id) {
+        GLuint t = tex.id;
+        glDeleteTextures_(1, &t);
+    }
+    tex = PreviewTexture{};
+}
+
+bool verifyPreviewUpload() {
+    if (!s_initialized) {
+        std::fprintf(stderr, "ShaderManager: GL not initialized\n");
+        return false;
+    }
+
+    // Odd sizes exercise the partial blocks of every reduction
+    const int W = 203, H = 97;
+    std::vector<uint8_t> image(static_cast<size_t>(W) * H * 4);
+    std::vector<uint8_t> expected, readBack;
+    GLuint fbo = 0;
+    glGenFramebuffers_(1, &fbo);
+    glBindFramebuffer_(GL_FRAMEBUFFER, fbo);
+
+    bool ok = true;
+    PreviewTexture tex;
+    for (int lod = 0; lod <= 2; ++lod) {
+        for (int pass = 0; pass < 2; ++pass) {
+            for (size_t i = 0; i < image.size(); ++i)
+                image[i] = static_cast<uint8_t>(i * 7 + i / 811 + pass * 91 + lod * 13);
+
+            unsigned int previousId = tex.id;
+            uploadPreview(tex, image.data(), W, H, 4, lod);
+
+            int factor = 1 << lod;
+            int w = (W + factor - 1) / factor, h = (H + factor - 1) / factor;
+            expected.resize(static_cast<size_t>(w) * h * 4);
+            readBack.assign(expected.size(), 0);
+            reducePreview(expected.data(), image.data(), W, H, 4, factor, w, h);
+
+            glFramebufferTexture2D_(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex.id, 0);
+            if (glCheckFramebufferStatus_(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE)
+                glReadPixels_(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, readBack.data());
+
+            bool sizeOk = tex.width == w && tex.height == h && tex.lod == lod;
+            bool reused = pass == 0 || tex.id == previousId;
+            bool pixelsOk = readBack == expected;
+            GLint immutable = 0;
+            glGetTexParameteriv_(GL_TEXTURE_2D, GL_TEXTURE_IMMUTABLE_FORMAT, &immutable);
+
+            std::fprintf(stderr, "ShaderManager: preview lod %d pass %d: %dx%d %s%s%s%s\n",
+                         lod, pass, w, h,
+                         pixelsOk ? "pixels ok" : "PIXEL MISMATCH",
+                         sizeOk ? "" : ", WRONG SIZE",
+                         reused ? "" : ", STORAGE REALLOCATED",
+                         immutable ? ", immutable" : "");
+            ok = ok && pixelsOk && sizeOk && reused;
+        }
+    }
+
+    glBindFramebuffer_(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers_(1, &fbo);
+    deletePreview(tex);
+    return ok;
 }
 
 void shutdown() {
     if (!s_initialized) return;
     if (s_quadVBO) { glDeleteBuffers_(1, &s_quadVBO); s_quadVBO = 0; }
     if (s_quadVAO) { glDeleteVertexArrays_(1, &s_quadVAO); s_quadVAO = 0; }
+    if (s_uploadBuffers[0]) {
+        glDeleteBuffers_(UPLOAD_RING_SIZE, s_uploadBuffers);
+        for (GLuint& b : s_uploadBuffers) b = 0;
+    }
     s_initialized = false;
 }
 
@@ -34,9 +34,31 @@ void deleteTexture(unsigned int tex);
 // Delete shader program
 void deleteProgram(unsigned int prog);
 
-// Create texture for displaying preview in ImGui
-unsigned int createPreviewTexture(const uint8_t* data, int width, int height, int channels);
-void updatePreviewTexture(unsigned int tex, const uint8_t* data, int width, int height, int channels);
+// Preview texture shown in ImGui. Storage is immutable and sized for display:
+// level 0 holds the image box-reduced by 2^lod, the rest of the mip chain is
+// generated on the GPU.
+struct PreviewTexture {
+    unsigned int id = 0;
+    int width = 0;          // level-0 size
+    int height = 0;
+    int lod = 0;            // power-of-two reduction of the source in level 0
+    int sourceWidth = 0;
+    int sourceHeight = 0;
+};
+
+// Coarsest reduction that still gives one texel per screen pixel at `displayScale`
+int previewLodForScale(float displayScale);
+
+// Upload an image into `tex` reduced by 2^lod (raised as needed to fit
+// GL_MAX_TEXTURE_SIZE). Storage is reallocated only when its size changes;
+// texels stream through a ring of pixel-unpack buffers.
+void uploadPreview(PreviewTexture& tex, const uint8_t* data, int width, int height,
+                   int channels, int lod);
+void deletePreview(PreviewTexture& tex);
+
+// Round-trip test patterns through uploadPreview and read them back; reports
+// to stderr. Needs a current context (runs on Mesa llvmpipe).
+bool verifyPreviewUpload();
 
 // Cleanup
 void shutdown();
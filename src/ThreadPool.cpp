@@ -0,0 +1,76 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    m_workers.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i)
+        m_workers.emplace_back([this] { workerLoop(); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for (auto& t : m_workers)
+        t.join();
+}
+
+ThreadPool& ThreadPool::shared() {
+    // Intentionally leaked: background jobs may still be queued during static destruction
+    static auto* s_pool = new ThreadPool();
+    return *s_pool;
+}
+
+void ThreadPool::enqueue(Priority priority, std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queues[static_cast<int>(priority)].push_back(std::move(task));
+    }
+    m_cv.notify_one();
+}
+
+int ThreadPool::nextQueue() const {
+    for (int p = 0; p < NUM_PRIORITIES; ++p) {
+        if (m_queues[p].empty()) continue;
+        // One worker stays free of background work while there is more than one
+        if (p == static_cast<int>(Priority::Background) &&
+            m_backgroundRunning + 1 >= m_workers.size() && m_backgroundRunning > 0)
+            return -1;
+        return p;
+    }
+    return -1;
+}
+
+void ThreadPool::workerLoop() {
+    s_current = this;
+    for (;;) {
+        std::function<void()> task;
+        bool background;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            int queue = -1;
+            m_cv.wait(lock, [&] {
+                queue = nextQueue();
+                return queue >= 0 || (m_stop && m_backgroundRunning == 0);
+            });
+            // Drain what is queued before exiting so no future is left broken
+            if (queue < 0) return;
+            task = std::move(m_queues[queue].front());
+            m_queues[queue].pop_front();
+            background = queue == static_cast<int>(Priority::Background);
+            if (background) ++m_backgroundRunning;
+        }
+        task();
+        if (background) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                --m_backgroundRunning;
+            }
+            // A worker held back by the cap may take the next one now
+            m_cv.notify_all();
+        }
+    }
+}
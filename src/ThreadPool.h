@@ -0,0 +1,98 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// ThreadPool - fixed set of worker threads draining prioritized FIFOs
+//
+// Encoders split their work into independent pieces and submit them here
+// instead of spawning threads per call. shared() is sized to the machine and
+// lives for the whole process. Tasks submitted from one of the pool's own
+// workers run inline, so a task may itself use an encoder without the pool
+// deadlocking on workers that all wait for queued work.
+//
+// Every task has a priority class. A free worker takes the oldest task of the
+// most urgent class, and Background tasks never occupy the last worker, so
+// interactive work starts as soon as any running task ends. Submits without
+// an explicit class use the calling thread's (see PriorityScope), Normal by
+// default.
+// ---------------------------------------------------------------------------
+
+class ThreadPool {
+public:
+    enum class Priority {
+        Interactive,    // the preview the user is looking at
+        Normal,
+        Background      // other documents, exports
+    };
+
+    // Makes `priority` the default for submits from this thread for the
+    // lifetime of the scope
+    class PriorityScope {
+    public:
+        explicit PriorityScope(Priority priority) : m_prev(s_priority) { s_priority = priority; }
+        ~PriorityScope() { s_priority = m_prev; }
+        PriorityScope(const PriorityScope&) = delete;
+        PriorityScope& operator=(const PriorityScope&) = delete;
+    private:
+        Priority m_prev;
+    };
+
+    // Default class of submits from the calling thread
+    static Priority currentPriority() { return s_priority; }
+
+    // 0 threads = one per hardware thread
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    static ThreadPool& shared();
+
+    unsigned size() const { return static_cast<unsigned>(m_workers.size()); }
+
+    template <typename F>
+    auto submit(F&& fn) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        return submit(s_priority, std::forward<F>(fn));
+    }
+
+    template <typename F>
+    auto submit(Priority priority, F&& fn) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using R = std::invoke_result_t<std::decay_t<F>>;
+        // std::function needs a copyable target; packaged_task is move-only
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(fn));
+        std::future<R> result = task->get_future();
+        if (s_current == this)
+            (*task)();
+        else
+            enqueue(priority, [task] { (*task)(); });
+        return result;
+    }
+
+private:
+    static constexpr int NUM_PRIORITIES = 3;
+
+    void enqueue(Priority priority, std::function<void()> task);
+    void workerLoop();
+    int nextQueue() const;                  // m_mutex held; -1 if nothing may start
+
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_queues[NUM_PRIORITIES];
+    unsigned m_backgroundRunning = 0;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop = false;
+
+    inline static thread_local ThreadPool* s_current = nullptr;  // pool of this worker thread
+    inline static thread_local Priority s_priority = Priority::Normal;
+};
@@ -0,0 +1,164 @@
+#include "Trace.h"
+#include "BufferPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+namespace {
+
+constexpr size_t RING_CAPACITY = size_t(1) << 16;
+
+struct Ring {
+    std::mutex mutex;
+    std::vector<Trace::Event> events;    // grows to RING_CAPACITY, then wraps
+    size_t next = 0;                     // slot of the next event once full
+    uint64_t count = 0;
+};
+
+Ring& ring() {
+    // Intentionally leaked: worker threads may still record at exit
+    static auto* s_ring = new Ring;
+    return *s_ring;
+}
+
+uint64_t nowNs() {
+    using Clock = std::chrono::steady_clock;
+    static const Clock::time_point s_origin = Clock::now();
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - s_origin).count());
+}
+
+uint32_t threadId() {
+    static std::atomic<uint32_t> s_nextId{1};
+    thread_local uint32_t t_id = s_nextId.fetch_add(1, std::memory_order_relaxed);
+    return t_id;
+}
+
+thread_local uint32_t t_depth = 0;
+
+// Ring contents oldest first; the ring's mutex must be held
+std::vector<Trace::Event> ordered(const Ring& r) {
+    std::vector<Trace::Event> out;
+    out.reserve(r.events.size());
+    out.insert(out.end(), r.events.begin() + r.next, r.events.end());
+    out.insert(out.end(), r.events.begin(), r.events.begin() + r.next);
+    return out;
+}
+
+} // namespace
+
+namespace Trace {
+
+Span::Span(const char* name, uint64_t pixels)
+    : m_name(name), m_pixels(pixels), m_depth(t_depth++) {
+    // The outer span's peak so far is set aside and folded back in on exit
+    m_outerPeak = BufferPool::resetThreadPeak();
+    m_startBytes = BufferPool::threadBytesInUse();
+    m_start = nowNs();
+}
+
+Span::~Span() {
+    Event e;
+    e.name = m_name;
+    e.startNs = m_start;
+    e.durationNs = nowNs() - m_start;
+    e.pixels = m_pixels;
+    e.peakScratchBytes = std::max<int64_t>(0, BufferPool::threadPeakBytes() - m_startBytes);
+    e.thread = threadId();
+    e.depth = m_depth;
+    BufferPool::raiseThreadPeak(m_outerPeak);
+    --t_depth;
+
+    Ring& r = ring();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (r.events.size() < RING_CAPACITY) {
+        r.events.push_back(e);
+    } else {
+        r.events[r.next] = e;
+        r.next = (r.next + 1) % RING_CAPACITY;
+    }
+    ++r.count;
+}
+
+uint64_t eventCount() {
+    Ring& r = ring();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return r.count;
+}
+
+std::vector<Event> events() {
+    Ring& r = ring();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return ordered(r);
+}
+
+std::vector<Stage> lastBreakdown(const char* root, double* totalMs) {
+    if (totalMs) *totalMs = 0.0;
+    std::vector<Event> all = events();
+
+    // Events are stored as spans end, so children precede their root
+    auto rootIt = std::find_if(all.rbegin(), all.rend(), [root](const Event& e) {
+        return std::strcmp(e.name, root) == 0;
+    });
+    if (rootIt == all.rend()) return {};
+    const Event rootEvent = *rootIt;
+    if (totalMs) *totalMs = rootEvent.durationNs / 1e6;
+
+    std::vector<Event> children;
+    for (auto it = rootIt + 1; it != all.rend(); ++it) {
+        if (it->thread != rootEvent.thread) continue;
+        if (it->startNs < rootEvent.startNs) break;
+        if (it->depth == rootEvent.depth + 1) children.push_back(*it);
+    }
+    std::reverse(children.begin(), children.end());
+
+    std::vector<Stage> stages;
+    for (const Event& e : children) {
+        auto same = std::find_if(stages.begin(), stages.end(), [&e](const Stage& s) {
+            return std::strcmp(s.name, e.name) == 0;
+        });
+        if (same == stages.end()) {
+            stages.push_back({e.name, 0.0, 0, 0});
+            same = stages.end() - 1;
+        }
+        same->ms += e.durationNs / 1e6;
+        same->pixels += e.pixels;
+        same->peakScratchBytes = std::max(same->peakScratchBytes, e.peakScratchBytes);
+    }
+    return stages;
+}
+
+bool writeChromeJson(const std::string& path) {
+    std::vector<Event> all = events();
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+
+    bool ok = std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", f) >= 0;
+    for (size_t i = 0; i < all.size() && ok; ++i) {
+        const Event& e = all[i];
+        // Complete ("X") events; timestamps are in microseconds
+        ok = std::fprintf(f,
+            "%s{\"name\":\"%s\",\"cat\":\"shakal\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+            "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"pixels\":%llu,\"peakScratchBytes\":%lld}}",
+            i ? ",\n" : "", e.name, e.thread, e.startNs / 1e3, e.durationNs / 1e3,
+            static_cast<unsigned long long>(e.pixels),
+            static_cast<long long>(e.peakScratchBytes)) > 0;
+    }
+    ok = ok && std::fputs("\n]}\n", f) >= 0;
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok) std::remove(path.c_str());
+    return ok;
+}
+
+void clear() {
+    Ring& r = ring();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.events.clear();
+    r.next = 0;
+}
+
+} // namespace Trace
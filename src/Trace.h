@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Trace - scoped timing spans for the processing pipeline
+//
+// SHAKAL_TRACE_SCOPE("name") times the rest of the enclosing block. Each
+// span records wall time, the pixels it worked on and the peak pool scratch
+// the calling thread held inside it. Spans go to a fixed-size ring shared by
+// all threads; export it as Chrome trace_event JSON (chrome://tracing,
+// Perfetto) or read back the last run's per-stage breakdown.
+//
+// The macros compile to nothing unless SHAKAL_TRACE is defined (CMake option
+// SHAKAL_TRACE), so release builds pay nothing. Names must be string
+// literals: only the pointer is kept.
+// ---------------------------------------------------------------------------
+
+namespace Trace {
+
+struct Event {
+    const char* name = nullptr;
+    uint64_t startNs = 0;             // since the first span of the process
+    uint64_t durationNs = 0;
+    uint64_t pixels = 0;
+    int64_t peakScratchBytes = 0;     // pool bytes above the span's start
+    uint32_t thread = 0;              // small sequential id
+    uint32_t depth = 0;               // spans open on the thread around this one
+};
+
+class Span {
+public:
+    explicit Span(const char* name, uint64_t pixels = 0);
+    ~Span();
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+private:
+    const char* m_name;
+    uint64_t m_pixels;
+    uint64_t m_start;
+    int64_t m_startBytes;
+    int64_t m_outerPeak;
+    uint32_t m_depth;
+};
+
+struct Stage {
+    const char* name = nullptr;
+    double ms = 0.0;
+    uint64_t pixels = 0;
+    int64_t peakScratchBytes = 0;
+};
+
+// Spans recorded so far; cheap, for polling whether anything changed
+uint64_t eventCount();
+
+// Recorded spans still in the ring, oldest first
+std::vector<Event> events();
+
+// Direct children of the most recent finished span named `root`, in order.
+// Repeated names (iterative destroy) are merged: times and pixels add up,
+// scratch takes the maximum. `totalMs` receives the root's own time.
+std::vector<Stage> lastBreakdown(const char* root, double* totalMs = nullptr);
+
+// Write the ring as Chrome trace_event JSON. False on I/O error.
+bool writeChromeJson(const std::string& path);
+
+void clear();
+
+} // namespace Trace
+
+#define SHAKAL_TRACE_CONCAT2(a, b) a##b
+#define SHAKAL_TRACE_CONCAT(a, b) SHAKAL_TRACE_CONCAT2(a, b)
+
+#ifdef SHAKAL_TRACE
+#define SHAKAL_TRACE_SCOPE(name) \
+    ::Trace::Span SHAKAL_TRACE_CONCAT(traceSpan_, __LINE__)(name)
+#define SHAKAL_TRACE_SCOPE_PIXELS(name, pixels) \
+    ::Trace::Span SHAKAL_TRACE_CONCAT(traceSpan_, __LINE__)(name, static_cast<uint64_t>(pixels))
+#else
+// Unevaluated, so arguments cost nothing but still count as used
+#define SHAKAL_TRACE_SCOPE(name) static_cast<void>(sizeof(name))
+#define SHAKAL_TRACE_SCOPE_PIXELS(name, pixels) \
+    static_cast<void>(sizeof(name) + sizeof(pixels))
+#endif
@@ -1,13 +1,18 @@
 #include "UI.h"
+#include "SettingsFile.h"
 #include "ShaderManager.h"
 #include "imgui.h"
 
+#include <cctype>
+#include <cfloat>
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <random>
 #include <algorithm>
 #include <cstdint>
+#include <vector>
 
 #ifdef _WIN32
 #  ifndef WIN32_LEAN_AND_MEAN
@@ -17,22 +22,20 @@
 #  include <commdlg.h>
 #endif
 
-// stb_image for loading (expected to be available via third_party)
-#ifndef STB_IMAGE_IMPLEMENTATION
-#  include "stb_image.h"
-#endif
-
-static constexpr int MAX_FILE_SIZE = 20 * 1024 * 1024; // 20 MB
-static constexpr int MAX_DIMENSION = 8192;
-
 // ---------------------------------------------------------------------------
 // Construction / Destruction
 // ---------------------------------------------------------------------------
 
-UI::UI()  = default;
+UI::UI() : m_cache(std::make_shared<ResultCache>()) {
+    openDocument();
+}
+
 UI::~UI() {
-    if (m_sourceTexture)    ShaderManager::deleteTexture(m_sourceTexture);
-    if (m_processedTexture) ShaderManager::deleteTexture(m_processedTexture);
+    for (auto& doc : m_documents) {
+        ShaderManager::deletePreview(doc->sourcePreview);
+        ShaderManager::deletePreview(doc->processedPreview);
+    }
+    for (auto& preview : m_variationPreviews) ShaderManager::deletePreview(preview);
 }
 
 void UI::init() {
@@ -46,6 +49,25 @@ void UI::init() {
 bool UI::render() {
     m_settingsChanged = false;
 
+    // Pick up a finished background decode or save before drawing
+    m_loader.poll();
+    m_saver.poll();
+
+    // Statistics wait for the preview: a new processing run goes first
+    if (m_doc->pipeline.isProcessing()) m_stats.cancel();
+    if (m_stats.poll()) {
+        const ImageStats::Report& r = m_stats.report();
+        for (int c = 0; c < 4; ++c)
+            for (int i = 0; i < 256; ++i)
+                m_statsHistogram[c][i] = static_cast<float>(r.histogram[c][i]);
+    }
+
+    for (int index : m_variations.poll()) {
+        const ImageBuffer& img = m_variations.tiles()[index].image;
+        ShaderManager::uploadPreview(m_variationPreviews[index], img.data.data(), img.width,
+                                     img.height, img.channels, 0);
+    }
+
     // Menu bar in a full-width host window
     ImGuiViewport* vp = ImGui::GetMainViewport();
     ImGui::SetNextWindowPos(vp->WorkPos);
@@ -62,13 +84,15 @@ bool UI::render() {
     renderControlPanel();
     renderPreview();
     renderStatusBar();
+    if (m_showStats) renderStatsPanel();
+    if (m_showVariations) renderVariationsPanel();
 
     // Detect changes
     if (m_settingsChanged) {
-        m_needsReprocess = true;
+        m_doc->needsReprocess = true;
     }
 
-    m_prevSettings = m_settings;
+    m_prevSettings = m_doc->settings;
     return m_settingsChanged;
 }
 
@@ -85,6 +109,17 @@ void UI::renderMenuBar() {
             if (ImGui::MenuItem("Сохранить...", "Ctrl+S")) {
                 m_wantsSave = true;
             }
+            ImGui::Separator();
+            if (ImGui::MenuItem("Новая вкладка"))
+                openDocument();
+            if (ImGui::MenuItem("Закрыть вкладку", nullptr, false, m_documents.size() > 1))
+                closeDocument(m_activeDocument);
+#ifdef SHAKAL_TRACE
+            if (ImGui::MenuItem("Экспорт трассировки", nullptr, false, !m_tracePath.empty())) {
+                if (!Trace::writeChromeJson(m_tracePath))
+                    std::fprintf(stderr, "Cannot write trace %s\n", m_tracePath.c_str());
+            }
+#endif
             ImGui::Separator();
             if (ImGui::MenuItem("Выход", "Alt+F4")) {
                 // Caller handles quit
@@ -92,20 +127,26 @@ void UI::renderMenuBar() {
             ImGui::EndMenu();
         }
         if (ImGui::BeginMenu("Правка")) {
-            if (ImGui::MenuItem("Отменить", "Ctrl+Z", false, m_pipeline.canUndo())) {
+            if (ImGui::MenuItem("Отменить", "Ctrl+Z", false, m_doc->pipeline.canUndo())) {
                 ImageBuffer undoImg;
-                m_settings = m_pipeline.undo(undoImg);
+                m_doc->settings = m_doc->pipeline.undo(undoImg);
                 if (undoImg.valid()) setProcessedImage(undoImg);
                 m_settingsChanged = true;
             }
-            if (ImGui::MenuItem("Повторить", "Ctrl+Y", false, m_pipeline.canRedo())) {
+            if (ImGui::MenuItem("Повторить", "Ctrl+Y", false, m_doc->pipeline.canRedo())) {
                 ImageBuffer redoImg;
-                m_settings = m_pipeline.redo(redoImg);
+                m_doc->settings = m_doc->pipeline.redo(redoImg);
                 if (redoImg.valid()) setProcessedImage(redoImg);
                 m_settingsChanged = true;
             }
             ImGui::EndMenu();
         }
+        if (ImGui::BeginMenu("Вид")) {
+            if (ImGui::MenuItem("Статистика", nullptr, &m_showStats) && m_showStats)
+                updateStats();
+            ImGui::MenuItem("Вариации", nullptr, &m_showVariations);
+            ImGui::EndMenu();
+        }
         ImGui::EndMenuBar();
     }
 }
@@ -138,7 +179,7 @@ void UI::renderControlPanel() {
     // ---- HD8K ---------------------------------------------------------------
     if (ImGui::Checkbox("HD8K (\xd1\x87\xd0\xb5\xd1\x82\xd0\xba\xd0\xb8\xd0\xb5 "
                         "\xd0\xbf\xd0\xb8\xd0\xba\xd1\x81\xd0\xb5\xd0\xbb\xd0\xb8)",
-                        &m_settings.hd8k)) { // "HD8K (четкие пиксели)"
+                        &m_doc->settings.hd8k)) { // "HD8K (четкие пиксели)"
         m_settingsChanged = true;
     }
 
@@ -147,22 +188,22 @@ void UI::renderControlPanel() {
     // ---- Степень сжатия (Color quantization) --------------------------------
     if (ImGui::SliderInt("\xd0\xa1\xd1\x82\xd0\xb5\xd0\xbf\xd0\xb5\xd0\xbd\xd1\x8c "
                          "\xd1\x81\xd0\xb6\xd0\xb0\xd1\x82\xd0\xb8\xd1\x8f",
-                         &m_settings.quantization, 0, 100)) { // "Степень сжатия"
+                         &m_doc->settings.quantization, 0, 100)) { // "Степень сжатия"
         m_settingsChanged = true;
     }
-    if (m_settings.quantization == 0)
+    if (m_doc->settings.quantization == 0)
         ImGui::TextDisabled("\xd0\x9e\xd1\x80\xd0\xb8\xd0\xb3\xd0\xb8\xd0\xbd\xd0\xb0\xd0\xbb"); // "Оригинал"
-    else if (m_settings.quantization <= 50)
+    else if (m_doc->settings.quantization <= 50)
         ImGui::TextDisabled("128 \xd1\x86\xd0\xb2\xd0\xb5\xd1\x82\xd0\xbe\xd0\xb2"); // "128 цветов"
     else
         ImGui::TextDisabled("2 \xd1\x86\xd0\xb2\xd0\xb5\xd1\x82\xd0\xb0"); // "2 цвета"
 
     {
         const char* ditherItems[] = { "Off", "Ordered", "Floyd-Steinberg" };
-        int cur = static_cast<int>(m_settings.ditherMode);
+        int cur = static_cast<int>(m_doc->settings.ditherMode);
         if (ImGui::Combo("\xd0\x94\xd0\xb8\xd0\xb7\xd0\xb5\xd1\x80\xd0\xb8\xd0\xbd\xd0\xb3",
                          &cur, ditherItems, 3)) { // "Дизеринг"
-            m_settings.ditherMode = static_cast<DitherMode>(cur);
+            m_doc->settings.ditherMode = static_cast<DitherMode>(cur);
             m_settingsChanged = true;
         }
     }
@@ -172,7 +213,7 @@ void UI::renderControlPanel() {
     // ---- Резкость деда (Sharpen) --------------------------------------------
     if (ImGui::SliderInt("\xd0\xa0\xd0\xb5\xd0\xb7\xd0\xba\xd0\xbe\xd1\x81\xd1\x82\xd1\x8c "
                          "\xd0\xb4\xd0\xb5\xd0\xb4\xd0\xb0",
-                         &m_settings.sharpen, 0, 100)) { // "Резкость деда"
+                         &m_doc->settings.sharpen, 0, 100)) { // "Резкость деда"
         m_settingsChanged = true;
     }
 
@@ -180,7 +221,7 @@ void UI::renderControlPanel() {
 
     // ---- Разрешение (Resolution %) ------------------------------------------
     if (ImGui::SliderInt("\xd0\xa0\xd0\xb0\xd0\xb7\xd1\x80\xd0\xb5\xd1\x88\xd0\xb5\xd0\xbd\xd0\xb8\xd0\xb5 %",
-                         &m_settings.resolution, 1, 100)) { // "Разрешение %"
+                         &m_doc->settings.resolution, 1, 100)) { // "Разрешение %"
         m_settingsChanged = true;
     }
     // Resolution preset buttons
@@ -191,12 +232,12 @@ void UI::renderControlPanel() {
             char label[16];
             snprintf(label, sizeof(label), "%d", presets[i]);
             if (ImGui::Button(label)) {
-                if (m_sourceImage.width > 0) {
-                    int pct = std::clamp(presets[i] * 100 / m_sourceImage.width, 1, 100);
-                    m_settings.resolution = pct;
+                if (m_doc->source.width > 0) {
+                    int pct = std::clamp(presets[i] * 100 / m_doc->source.width, 1, 100);
+                    m_doc->settings.resolution = pct;
                 } else {
-                    m_settings.resolution = presets[i] * 100 / 1920;
-                    if (m_settings.resolution < 1) m_settings.resolution = 1;
+                    m_doc->settings.resolution = presets[i] * 100 / 1920;
+                    if (m_doc->settings.resolution < 1) m_doc->settings.resolution = 1;
                 }
                 m_settingsChanged = true;
             }
@@ -208,10 +249,10 @@ void UI::renderControlPanel() {
     // ---- Зыбучесть шакалов (Displacement) -----------------------------------
     if (ImGui::SliderInt("\xd0\x97\xd1\x8b\xd0\xb1\xd1\x83\xd1\x87\xd0\xb5\xd1\x81\xd1\x82\xd1\x8c "
                          "\xd1\x88\xd0\xb0\xd0\xba\xd0\xb0\xd0\xbb\xd0\xbe\xd0\xb2",
-                         &m_settings.displacement, 0, 100)) { // "Зыбучесть шакалов"
+                         &m_doc->settings.displacement, 0, 100)) { // "Зыбучесть шакалов"
         m_settingsChanged = true;
     }
-    if (ImGui::InputInt("Seed##disp", &m_settings.displacementSeed)) {
+    if (ImGui::InputInt("Seed##disp", &m_doc->settings.displacementSeed)) {
         m_settingsChanged = true;
     }
 
@@ -219,13 +260,13 @@ void UI::renderControlPanel() {
 
     // ---- JPEG quality -------------------------------------------------------
     if (ImGui::SliderInt("\xd0\x91\xd0\xb8\xd1\x82\xd1\x80\xd0\xb5\xd0\xb9\xd1\x82 JPEG",
-                         &m_settings.jpegQuality, 1, 100)) { // "Битрейт JPEG"
+                         &m_doc->settings.jpegQuality, 1, 100)) { // "Битрейт JPEG"
         m_settingsChanged = true;
     }
     ImGui::Text("\xd0\xa6\xd0\xb8\xd0\xba\xd0\xbb\xd0\xb8\xd1\x87\xd0\xb5\xd1\x81\xd0\xba\xd0\xbe\xd0\xb5 "
                 "\xd1\x81\xd0\xb6\xd0\xb0\xd1\x82\xd0\xb8\xd0\xb5"); // "Циклическое сжатие"
     if (ImGui::SliderInt("\xd0\x98\xd1\x82\xd0\xb5\xd1\x80\xd0\xb0\xd1\x86\xd0\xb8\xd0\xb8##jpeg",
-                         &m_settings.jpegIterations, 1, 20)) { // "Итерации"
+                         &m_doc->settings.jpegIterations, 1, 20)) { // "Итерации"
         m_settingsChanged = true;
     }
 
@@ -233,19 +274,22 @@ void UI::renderControlPanel() {
 
     // ---- Шум (Noise) --------------------------------------------------------
     if (ImGui::SliderInt("\xd0\xa8\xd1\x83\xd0\xbc",
-                         &m_settings.noiseIntensity, 0, 100)) { // "Шум"
+                         &m_doc->settings.noiseIntensity, 0, 100)) { // "Шум"
         m_settingsChanged = true;
     }
     {
         const char* noiseItems[] = { "Gaussian", "Salt & Pepper", "Digital Banding" };
-        int cur = static_cast<int>(m_settings.noiseType);
+        int cur = static_cast<int>(m_doc->settings.noiseType);
         if (ImGui::Combo("\xd0\xa2\xd0\xb8\xd0\xbf \xd1\x88\xd1\x83\xd0\xbc\xd0\xb0",
                          &cur, noiseItems, 3)) { // "Тип шума"
-            m_settings.noiseType = static_cast<NoiseType>(cur);
+            m_doc->settings.noiseType = static_cast<NoiseType>(cur);
             m_settingsChanged = true;
         }
     }
-    if (ImGui::Checkbox("Per-channel##noise", &m_settings.noisePerChannel)) {
+    if (ImGui::Checkbox("Per-channel##noise", &m_doc->settings.noisePerChannel)) {
+        m_settingsChanged = true;
+    }
+    if (ImGui::InputInt("Seed##noise", &m_doc->settings.noiseSeed)) {
         m_settingsChanged = true;
     }
 
@@ -253,23 +297,41 @@ void UI::renderControlPanel() {
 
     // ---- RGB shift ----------------------------------------------------------
     if (ImGui::SliderInt("RGB \xd1\x81\xd0\xb4\xd0\xb2\xd0\xb8\xd0\xb3",
-                         &m_settings.rgbShiftAmount, 0, 100)) { // "RGB сдвиг"
+                         &m_doc->settings.rgbShiftAmount, 0, 100)) { // "RGB сдвиг"
         m_settingsChanged = true;
     }
-    if (ImGui::Checkbox("X##rgb", &m_settings.rgbShiftX)) m_settingsChanged = true;
+    if (ImGui::Checkbox("X##rgb", &m_doc->settings.rgbShiftX)) m_settingsChanged = true;
     ImGui::SameLine();
-    if (ImGui::Checkbox("Y##rgb", &m_settings.rgbShiftY)) m_settingsChanged = true;
+    if (ImGui::Checkbox("Y##rgb", &m_doc->settings.rgbShiftY)) m_settingsChanged = true;
+    {
+        // Per-channel (x, y) offsets; fractional values blend
+        static const char* const labels[3] = {"R##rgboff", "G##rgboff", "B##rgboff"};
+        for (int c = 0; c < 3; ++c) {
+            if (ImGui::DragFloat2(labels[c], m_doc->settings.rgbShiftOffsets[c].data(),
+                                  0.05f, -50.f, 50.f, "%.2f")) {
+                m_settingsChanged = true;
+            }
+        }
+    }
 
     ImGui::Separator();
 
     // ---- Glitch -------------------------------------------------------------
-    if (ImGui::SliderInt("Glitch bands", &m_settings.glitchBands, 0, 50)) {
+    if (ImGui::SliderInt("Glitch bands", &m_doc->settings.glitchBands, 0, 50)) {
         m_settingsChanged = true;
     }
-    if (ImGui::SliderInt("Glitch amplitude", &m_settings.glitchAmplitude, 0, 200)) {
+    if (ImGui::SliderInt("Glitch amplitude", &m_doc->settings.glitchAmplitude, 0, 200)) {
         m_settingsChanged = true;
     }
-    if (ImGui::InputInt("Seed##glitch", &m_settings.glitchSeed)) {
+    {
+        const char* glitchItems[] = { "Rows", "Blocks", "Channel slice" };
+        int cur = static_cast<int>(m_doc->settings.glitchMode);
+        if (ImGui::Combo("Glitch mode", &cur, glitchItems, 3)) {
+            m_doc->settings.glitchMode = static_cast<GlitchMode>(cur);
+            m_settingsChanged = true;
+        }
+    }
+    if (ImGui::InputInt("Seed##glitch", &m_doc->settings.glitchSeed)) {
         m_settingsChanged = true;
     }
 
@@ -280,10 +342,10 @@ void UI::renderControlPanel() {
         const char* palItems[] = {
             "None", "Game Boy", "NES", "Windows 98", "Thermal", "Mono Green", "Custom"
         };
-        int cur = static_cast<int>(m_settings.palette);
+        int cur = static_cast<int>(m_doc->settings.palette);
         if (ImGui::Combo("\xd0\x9f\xd0\x90\xd0\x9b\xd0\x98\xd0\xa2\xd0\xa0\xd0\xab",
                          &cur, palItems, 7)) { // "ПАЛИТРЫ"
-            m_settings.palette = static_cast<PalettePreset>(cur);
+            m_doc->settings.palette = static_cast<PalettePreset>(cur);
             m_settingsChanged = true;
         }
     }
@@ -293,14 +355,25 @@ void UI::renderControlPanel() {
     // ---- Iterative destroy --------------------------------------------------
     if (ImGui::Checkbox("\xd0\x98\xd1\x82\xd0\xb5\xd1\x80\xd0\xb0\xd1\x82\xd0\xb8\xd0\xb2\xd0\xbd\xd0\xbe\xd0\xb5 "
                         "\xd1\x83\xd0\xbd\xd0\xb8\xd1\x87\xd1\x82\xd0\xbe\xd0\xb6\xd0\xb5\xd0\xbd\xd0\xb8\xd0\xb5",
-                        &m_settings.iterativeDestroy)) { // "Итеративное уничтожение"
+                        &m_doc->settings.iterativeDestroy)) { // "Итеративное уничтожение"
         m_settingsChanged = true;
     }
-    if (m_settings.iterativeDestroy) {
+    if (m_doc->settings.iterativeDestroy) {
         if (ImGui::SliderInt("\xd0\x9a\xd0\xbe\xd0\xbb-\xd0\xb2\xd0\xbe##iter",
-                             &m_settings.iterativeCount, 1, 20)) { // "Кол-во"
+                             &m_doc->settings.iterativeCount, 1, 20)) { // "Кол-во"
             m_settingsChanged = true;
         }
+        if (ImGui::SliderInt("\xd0\x94\xd0\xbe\xd0\xbf\xd1\x83\xd1\x81\xd0\xba##iter",
+                             &m_doc->settings.iterativeTolerance, 0, 16)) { // "Допуск"
+            m_settingsChanged = true;
+        }
+        if (ImGui::IsItemHovered())
+            ImGui::SetTooltip("\xd0\x9e\xd1\x81\xd1\x82\xd0\xb0\xd0\xbd\xd0\xbe\xd0\xb2\xd0\xb8\xd1\x82\xd1\x8c\xd1\x81\xd1\x8f, "
+                              "\xd0\xba\xd0\xbe\xd0\xb3\xd0\xb4\xd0\xb0 \xd0\xbf\xd1\x80\xd0\xbe\xd1\x85\xd0\xbe\xd0\xb4 "
+                              "\xd0\xbc\xd0\xb5\xd0\xbd\xd1\x8f\xd0\xb5\xd1\x82 \xd0\xb1\xd0\xb0\xd0\xb9\xd1\x82\xd1\x8b "
+                              "\xd0\xbd\xd0\xb5 \xd0\xb1\xd0\xbe\xd0\xbb\xd1\x8c\xd1\x88\xd0\xb5 \xd1\x87\xd0\xb5\xd0\xbc "
+                              "\xd0\xbd\xd0\xb0 \xd1\x81\xd1\x82\xd0\xbe\xd0\xbb\xd1\x8c\xd0\xba\xd0\xbe");
+            // "Остановиться, когда проход меняет байты не больше чем на столько"
     }
 
     ImGui::Separator();
@@ -308,15 +381,15 @@ void UI::renderControlPanel() {
     // ---- Watermark ----------------------------------------------------------
     if (ImGui::Checkbox("\xd0\x92\xd0\xbe\xd0\xb4\xd1\x8f\xd0\xbd\xd0\xbe\xd0\xb9 "
                         "\xd0\xb7\xd0\xbd\xd0\xb0\xd0\xba",
-                        &m_settings.watermark)) { // "Водяной знак"
+                        &m_doc->settings.watermark)) { // "Водяной знак"
         m_settingsChanged = true;
     }
-    if (m_settings.watermark) {
+    if (m_doc->settings.watermark) {
         char buf[256];
-        snprintf(buf, sizeof(buf), "%s", m_settings.watermarkText.c_str());
+        snprintf(buf, sizeof(buf), "%s", m_doc->settings.watermarkText.c_str());
         if (ImGui::InputText("\xd0\xa2\xd0\xb5\xd0\xba\xd1\x81\xd1\x82##wm",
                              buf, sizeof(buf))) { // "Текст"
-            m_settings.watermarkText = buf;
+            m_doc->settings.watermarkText = buf;
             m_settingsChanged = true;
         }
     }
@@ -324,10 +397,55 @@ void UI::renderControlPanel() {
     ImGui::Separator();
 
     // ---- Strip EXIF ---------------------------------------------------------
-    if (ImGui::Checkbox("Strip EXIF", &m_settings.stripExif)) {
+    if (ImGui::Checkbox("Strip EXIF", &m_doc->settings.stripExif)) {
         m_settingsChanged = true;
     }
 
+    // ---- Result cache -------------------------------------------------------
+    if (ImGui::Checkbox("\xd0\x9a\xd1\x8d\xd1\x88 \xd0\xbd\xd0\xb0 \xd0\xb4\xd0\xb8\xd1\x81\xd0\xba\xd0\xb5",
+                        &m_doc->settings.diskCache)) { // "Кэш на диске"
+        applyCacheSettings();
+    }
+
+    // ---- PNG export ---------------------------------------------------------
+    // Only affects saving, so no reprocess
+    ImGui::SliderInt("PNG \xd1\x81\xd0\xb6\xd0\xb0\xd1\x82\xd0\xb8\xd0\xb5",
+                     &m_doc->settings.pngLevel, 0, 9); // "PNG сжатие"
+    if (m_doc->settings.pngLevel == 0)
+        ImGui::TextDisabled("\xd0\x91\xd0\xb5\xd0\xb7 \xd1\x81\xd0\xb6\xd0\xb0\xd1\x82\xd0\xb8\xd1\x8f"); // "Без сжатия"
+    else if (m_doc->settings.pngLevel == 1)
+        ImGui::TextDisabled("RLE");
+    {
+        const char* filterItems[] = { "None", "Sub", "Up", "Average", "Paeth", "Adaptive" };
+        int cur = static_cast<int>(m_doc->settings.pngFilter);
+        if (ImGui::Combo("PNG \xd1\x84\xd0\xb8\xd0\xbb\xd1\x8c\xd1\x82\xd1\x80",
+                         &cur, filterItems, 6)) { // "PNG фильтр"
+            m_doc->settings.pngFilter = static_cast<PngFilter>(cur);
+        }
+    }
+
+    // ---- JPEG export --------------------------------------------------------
+    ImGui::SliderInt("JPEG \xd0\xba\xd0\xb0\xd1\x87\xd0\xb5\xd1\x81\xd1\x82\xd0\xb2\xd0\xbe",
+                     &m_doc->settings.jpegExportQuality, 1, 100); // "JPEG качество"
+    {
+        const char* subsamplingItems[] = { "4:4:4", "4:2:2", "4:2:0" };
+        int cur = static_cast<int>(m_doc->settings.jpegSubsampling);
+        if (ImGui::Combo("JPEG \xd1\x86\xd0\xb2\xd0\xb5\xd1\x82",
+                         &cur, subsamplingItems, 3)) { // "JPEG цвет"
+            m_doc->settings.jpegSubsampling = static_cast<JpegSubsampling>(cur);
+        }
+    }
+    // 0 = off; otherwise the save searches quality (and size) to fit the limit
+    if (ImGui::InputInt("\xd0\x9b\xd0\xb8\xd0\xbc\xd0\xb8\xd1\x82 JPEG, \xd0\x9a\xd0\x91", &m_doc->settings.jpegTargetKB, 64, 1024)) // "Лимит JPEG, КБ"
+        m_doc->settings.jpegTargetKB = std::max(0, m_doc->settings.jpegTargetKB);
+    if (m_doc->settings.jpegTargetKB > 0)
+        ImGui::Checkbox("\xd0\xa3\xd0\xbc\xd0\xb5\xd0\xbd\xd1\x8c\xd1\x88\xd0\xb0\xd1\x82\xd1\x8c \xd1\x80\xd0\xb0\xd0\xb7\xd1\x80\xd0\xb5\xd1\x88\xd0\xb5\xd0\xbd\xd0\xb8\xd0\xb5",
+                        &m_doc->settings.jpegTargetResize); // "Уменьшать разрешение"
+
+    // ---- GIF export ---------------------------------------------------------
+    ImGui::Checkbox("GIF: \xd1\x81\xd0\xb8\xd0\xb4\xd1\x8b \xd0\xbf\xd0\xbe \xd0\xba\xd0\xb0\xd0\xb4\xd1\x80\xd0\xb0\xd0\xbc",
+                    &m_doc->settings.animateSeeds); // "GIF: сиды по кадрам"
+
     ImGui::Separator();
 
     // ---- Randomize / Reset --------------------------------------------------
@@ -346,13 +464,13 @@ void UI::renderControlPanel() {
     // ---- Undo / Redo buttons ------------------------------------------------
     ImGui::Separator();
     {
-        bool canUndo = m_pipeline.canUndo();
-        bool canRedo = m_pipeline.canRedo();
+        bool canUndo = m_doc->pipeline.canUndo();
+        bool canRedo = m_doc->pipeline.canRedo();
         if (!canUndo) ImGui::BeginDisabled();
         if (ImGui::Button("\xd0\x9e\xd1\x82\xd0\xbc\xd0\xb5\xd0\xbd\xd0\xb0",
                           ImVec2(ImGui::GetContentRegionAvail().x * 0.5f, 0))) { // "Отмена"
             ImageBuffer undoImg;
-            m_settings = m_pipeline.undo(undoImg);
+            m_doc->settings = m_doc->pipeline.undo(undoImg);
             if (undoImg.valid()) setProcessedImage(undoImg);
             m_settingsChanged = true;
         }
@@ -364,7 +482,7 @@ void UI::renderControlPanel() {
         if (ImGui::Button("\xd0\x9f\xd0\xbe\xd0\xb2\xd1\x82\xd0\xbe\xd1\x80",
                           ImVec2(-1, 0))) { // "Повтор"
             ImageBuffer redoImg;
-            m_settings = m_pipeline.redo(redoImg);
+            m_doc->settings = m_doc->pipeline.redo(redoImg);
             if (redoImg.valid()) setProcessedImage(redoImg);
             m_settingsChanged = true;
         }
@@ -381,14 +499,16 @@ void UI::renderControlPanel() {
 void UI::renderPreview() {
     ImGui::Begin("\xd0\x9f\xd1\x80\xd0\xb5\xd0\xb4\xd0\xbf\xd1\x80\xd0\xbe\xd1\x81\xd0\xbc\xd0\xbe\xd1\x82\xd1\x80"); // "Предпросмотр"
 
+    renderDocumentTabs();
+
     // Tab bar for before/after toggle
     if (ImGui::BeginTabBar("##preview_tabs")) {
         if (ImGui::BeginTabItem("\xd0\x94\xd0\xbe")) { // "До"
-            m_showOriginal = true;
+            m_doc->showOriginal = true;
             ImGui::EndTabItem();
         }
         if (ImGui::BeginTabItem("\xd0\x9f\xd0\xbe\xd1\x81\xd0\xbb\xd0\xb5")) { // "После"
-            m_showOriginal = false;
+            m_doc->showOriginal = false;
             ImGui::EndTabItem();
         }
         ImGui::EndTabBar();
@@ -397,21 +517,29 @@ void UI::renderPreview() {
     // Zoom via mouse wheel
     if (ImGui::IsWindowHovered()) {
         float wheel = ImGui::GetIO().MouseWheel;
-        if (wheel > 0.0f) m_zoom *= 1.1f;
-        else if (wheel < 0.0f) m_zoom /= 1.1f;
-        m_zoom = std::clamp(m_zoom, 0.1f, 20.0f);
+        if (wheel > 0.0f) m_doc->zoom *= 1.1f;
+        else if (wheel < 0.0f) m_doc->zoom /= 1.1f;
+        m_doc->zoom = std::clamp(m_doc->zoom, 0.1f, 20.0f);
     }
 
     // Determine which texture/image to show
-    GLuint tex   = m_showOriginal ? m_sourceTexture : m_processedTexture;
-    int    imgW  = m_showOriginal ? m_sourceImage.width : m_processedImage.width;
-    int    imgH  = m_showOriginal ? m_sourceImage.height : m_processedImage.height;
+    ShaderManager::PreviewTexture& preview = m_doc->showOriginal ? m_doc->sourcePreview : m_doc->processedPreview;
+    const ImageBuffer& shown = m_doc->showOriginal ? m_doc->source : m_doc->processed;
+    int imgW = shown.width;
+    int imgH = shown.height;
+
+    // Zooming in past the detail held by the texture brings in a finer level
+    if (preview.id && shown.valid() && ShaderManager::previewLodForScale(m_doc->zoom) < preview.lod)
+        uploadPreview(preview, shown, m_doc->zoom);
+    GLuint tex = preview.id;
 
     if (tex != 0 && imgW > 0 && imgH > 0) {
-        ImVec2 dispSize(imgW * m_zoom, imgH * m_zoom);
+        ImVec2 dispSize(imgW * m_doc->zoom, imgH * m_doc->zoom);
         ImGui::Image((ImTextureID)(intptr_t)tex, dispSize);
 
-        ImGui::Text("%dx%d  (zoom %.0f%%)", imgW, imgH, m_zoom * 100.0f);
+        ImGui::Text("%dx%d  (zoom %.0f%%)", imgW, imgH, m_doc->zoom * 100.0f);
+    } else if (m_loader.isLoading()) {
+        ImGui::TextDisabled("\xd0\x97\xd0\xb0\xd0\xb3\xd1\x80\xd1\x83\xd0\xb7\xd0\xba\xd0\xb0..."); // "Загрузка..."
     } else {
         ImGui::TextDisabled("\xd0\x9d\xd0\xb5\xd1\x82 "
                             "\xd0\xb8\xd0\xb7\xd0\xbe\xd0\xb1\xd1\x80\xd0\xb0\xd0\xb6\xd0\xb5\xd0\xbd\xd0\xb8\xd1\x8f"); // "Нет изображения"
@@ -434,11 +562,43 @@ void UI::renderStatusBar() {
                              ImGuiWindowFlags_NoSavedSettings;
     ImGui::Begin("##StatusBar", nullptr, flags);
 
-    if (m_pipeline.isProcessing()) {
+    if (m_loader.isLoading()) {
+        ImGui::Text("\xd0\x97\xd0\xb0\xd0\xb3\xd1\x80\xd1\x83\xd0\xb7\xd0\xba\xd0\xb0..."); // "Загрузка..."
+        ImGui::SameLine();
+        // Decoding reports no progress: show an indeterminate bar
+        ImGui::ProgressBar(-1.0f * static_cast<float>(ImGui::GetTime()), ImVec2(120.0f, 0.0f), "");
+    } else if (m_saver.isSaving()) {
+        ImGui::Text("\xd0\xa1\xd0\xbe\xd1\x85\xd1\x80\xd0\xb0\xd0\xbd\xd0\xb5\xd0\xbd\xd0\xb8\xd0\xb5..."); // "Сохранение..."
+        ImGui::SameLine();
+        ImGui::ProgressBar(m_saver.progress(), ImVec2(120.0f, 0.0f));
+    } else if (m_doc->pipeline.isProcessing()) {
         ImGui::Text("\xd0\x9e\xd0\xb1\xd1\x80\xd0\xb0\xd0\xb1\xd0\xbe\xd1\x82\xd0\xba\xd0\xb0..."); // "Обработка..."
-    } else if (m_sourceImage.valid()) {
+    } else if (m_doc->source.valid()) {
         ImGui::Text("\xd0\x93\xd0\xbe\xd1\x82\xd0\xbe\xd0\xb2\xd0\xbe | %dx%d",
-                    m_sourceImage.width, m_sourceImage.height); // "Готово | WxH"
+                    m_doc->source.width, m_doc->source.height); // "Готово | WxH"
+#ifdef SHAKAL_DEBUG_ALLOCATIONS
+        ImGui::SameLine();
+        ImGui::TextDisabled("| alloc/run: %llu",
+                            static_cast<unsigned long long>(m_doc->pipeline.lastAllocationCount()));
+#endif
+#ifdef SHAKAL_TRACE
+        if (uint64_t seen = Trace::eventCount(); seen != m_traceSeen) {
+            m_traceSeen = seen;
+            m_traceStages = Trace::lastBreakdown("processImage", &m_traceTotalMs);
+        }
+        if (!m_traceStages.empty()) {
+            ImGui::SameLine();
+            ImGui::TextDisabled("| %.1f ms:", m_traceTotalMs);
+            for (const Trace::Stage& stage : m_traceStages) {
+                if (stage.ms < 0.05) continue;  // disabled effects
+                ImGui::SameLine();
+                ImGui::TextDisabled("%s %.1f", stage.name, stage.ms);
+                if (ImGui::IsItemHovered())
+                    ImGui::SetTooltip("%.2f ms, %.2f Mpx, scratch %.1f MiB", stage.ms,
+                                      stage.pixels / 1e6, stage.peakScratchBytes / 1048576.0);
+            }
+        }
+#endif
     } else {
         ImGui::Text("\xd0\x97\xd0\xb0\xd0\xb3\xd1\x80\xd1\x83\xd0\xb7\xd0\xb8\xd1\x82\xd0\xb5 "
                     "\xd0\xb8\xd0\xb7\xd0\xbe\xd0\xb1\xd1\x80\xd0\xb0\xd0\xb6\xd0\xb5\xd0\xbd\xd0\xb8\xd0\xb5"); // "Загрузите изображение"
@@ -452,114 +612,330 @@ void UI::renderStatusBar() {
 // ---------------------------------------------------------------------------
 
 bool UI::loadImage(const char* path) {
-    // Check file size
-    FILE* f = fopen(path, "rb");
-    if (!f) return false;
-    fseek(f, 0, SEEK_END);
-    long sz = ftell(f);
-    fclose(f);
-    if (sz > MAX_FILE_SIZE) return false;
-
-    int w, h, ch;
-    unsigned char* pixels = stbi_load(path, &w, &h, &ch, 4);
-    if (!pixels) return false;
-
-    if (w > MAX_DIMENSION || h > MAX_DIMENSION) {
-        // Offer downscale: clamp to MAX_DIMENSION keeping aspect ratio
-        float scale = std::min(static_cast<float>(MAX_DIMENSION) / w,
-                               static_cast<float>(MAX_DIMENSION) / h);
-        int nw = static_cast<int>(w * scale);
-        int nh = static_cast<int>(h * scale);
-
-        // Simple box downscale via a temporary buffer
-        std::vector<uint8_t> tmp(nw * nh * 4);
-        for (int y = 0; y < nh; ++y) {
-            for (int x = 0; x < nw; ++x) {
-                int sx = x * w / nw;
-                int sy = y * h / nh;
-                memcpy(&tmp[(y * nw + x) * 4], &pixels[(sy * w + sx) * 4], 4);
-            }
-        }
-        stbi_image_free(pixels);
-        m_sourceImage.width    = nw;
-        m_sourceImage.height   = nh;
-        m_sourceImage.channels = 4;
-        m_sourceImage.data.assign(tmp.begin(), tmp.end());
-    } else {
-        m_sourceImage.width    = w;
-        m_sourceImage.height   = h;
-        m_sourceImage.channels = 4;
-        m_sourceImage.data.assign(pixels, pixels + w * h * 4);
-        stbi_image_free(pixels);
+    if (!path || !*path) return false;
+    m_loader.loadFile(path, [this, file = std::string(path)](ImageBuffer img) {
+        if (!img.valid()) return;  // undecodable: keep the current image
+        Document& doc = m_doc->source.valid() ? openDocument() : *m_doc;
+        doc.sourcePath = file;
+        doc.name = file.substr(file.find_last_of("/\\") + 1);
+        setSourceImage(std::move(img));
+    });
+    return true;
+}
+
+bool UI::loadImageFromMemory(const unsigned char* data, int len) {
+    if (!data || len <= 0) return false;
+    m_loader.loadMemory(std::vector<uint8_t>(data, data + len),
+                        [this](ImageBuffer img) {
+                            if (!img.valid()) return;
+                            Document& doc = m_doc->source.valid() ? openDocument() : *m_doc;
+                            doc.sourcePath.clear();
+                            char name[64];
+                            std::snprintf(name, sizeof(name), "\xd0\x92\xd1\x81\xd1\x82\xd0\xb0\xd0\xb2\xd0\xba\xd0\xb0 %d", ++m_pastedCount); // "Вставка N"
+                            doc.name = name;
+                            setSourceImage(std::move(img));
+                        });
+    return true;
+}
+
+// Case-insensitive suffix match
+static bool hasExtension(const std::string& path, const char* ext) {
+    size_t n = strlen(ext);
+    if (path.size() < n) return false;
+    for (size_t i = 0; i < n; ++i) {
+        char c = path[path.size() - n + i];
+        if (std::tolower(static_cast<unsigned char>(c)) != ext[i]) return false;
     }
+    return true;
+}
+
+bool UI::saveImage(const std::string& path) {
+    const ImageBuffer& img = m_doc->processed.valid() ? m_doc->processed : m_doc->source;
+    if (!img.valid() || path.empty()) return false;
+
+    auto onSaved = [path](bool ok) {
+        if (!ok) std::fprintf(stderr, "Failed to save %s\n", path.c_str());
+    };
 
-    // Upload source texture
-    if (m_sourceTexture) ShaderManager::deleteTexture(m_sourceTexture);
-    m_sourceTexture = ShaderManager::createPreviewTexture(
-        m_sourceImage.data.data(), m_sourceImage.width, m_sourceImage.height, 4);
+    // GIF to GIF keeps the animation: every frame is re-read from the source
+    if (hasExtension(path, ".gif") && hasExtension(m_doc->sourcePath, ".gif")) {
+        m_saver.saveAnimation(m_doc->sourcePath, path, m_doc->settings, &m_doc->pipeline.getResultCache(),
+                              onSaved);
+        return true;
+    }
 
-    m_zoom = 1.0f;
-    m_needsReprocess = true;
+    // The saver gets its own copy: new results may replace m_doc->processed
+    // while the file is still being written
+    BufferPool::Scope scope(m_doc->pipeline.getBufferPool());
+    m_saver.save(img, path, m_doc->settings, onSaved);
     return true;
 }
 
-bool UI::loadImageFromMemory(const unsigned char* data, int len) {
-    if (len > MAX_FILE_SIZE) return false;
-
-    int w, h, ch;
-    unsigned char* pixels = stbi_load_from_memory(data, len, &w, &h, &ch, 4);
-    if (!pixels) return false;
-
-    if (w > MAX_DIMENSION || h > MAX_DIMENSION) {
-        float scale = std::min(static_cast<float>(MAX_DIMENSION) / w,
-                               static_cast<float>(MAX_DIMENSION) / h);
-        int nw = static_cast<int>(w * scale);
-        int nh = static_cast<int>(h * scale);
-        std::vector<uint8_t> tmp(nw * nh * 4);
-        for (int y = 0; y < nh; ++y) {
-            for (int x = 0; x < nw; ++x) {
-                int sx = x * w / nw;
-                int sy = y * h / nh;
-                memcpy(&tmp[(y * nw + x) * 4], &pixels[(sy * w + sx) * 4], 4);
-            }
-        }
-        stbi_image_free(pixels);
-        m_sourceImage.width    = nw;
-        m_sourceImage.height   = nh;
-        m_sourceImage.channels = 4;
-        m_sourceImage.data.assign(tmp.begin(), tmp.end());
+// Called once a background decode finishes. Frames of any size are kept at
+// full resolution; very large ones live in scratch files (see BufferPool).
+void UI::setSourceImage(ImageBuffer img) {
+    if (!img.valid()) return;  // undecodable: keep the current image
+    m_doc->source = std::move(img);
+    m_doc->sourceGeneration = ++m_nextGeneration;
+    clearVariations();
+
+    m_doc->zoom = 1.0f;
+    uploadPreview(m_doc->sourcePreview, m_doc->source, m_doc->zoom);
+    m_doc->needsReprocess = true;
+}
+
+// ---------------------------------------------------------------------------
+// Documents
+// ---------------------------------------------------------------------------
+
+UI::Document& UI::openDocument() {
+    auto doc = std::make_unique<Document>(m_cache);
+    doc->id = ++m_nextDocumentId;
+    if (m_doc) doc->settings = m_doc->settings;
+    doc->pipeline.setWakeCallback(m_wake);
+    m_documents.push_back(std::move(doc));
+    if (!m_doc) {
+        m_doc = m_documents.back().get();
+        m_activeDocument = 0;
     } else {
-        m_sourceImage.width    = w;
-        m_sourceImage.height   = h;
-        m_sourceImage.channels = 4;
-        m_sourceImage.data.assign(pixels, pixels + w * h * 4);
-        stbi_image_free(pixels);
+        activateDocument(m_documents.size() - 1);
     }
+    m_selectTab = m_activeDocument;
+    return *m_doc;
+}
 
-    if (m_sourceTexture) ShaderManager::deleteTexture(m_sourceTexture);
-    m_sourceTexture = ShaderManager::createPreviewTexture(
-        m_sourceImage.data.data(), m_sourceImage.width, m_sourceImage.height, 4);
+// The active document's pipeline runs in the interactive class, every other
+// one in the background class, behind it
+void UI::activateDocument(size_t index) {
+    if (index >= m_documents.size() || m_documents[index].get() == m_doc) return;
+    if (m_settingsChanged) {
+        m_doc->needsReprocess = true;
+        m_settingsChanged = false;
+    }
+    m_doc->pipeline.setPriority(ThreadPool::Priority::Background);
+    m_doc = m_documents[index].get();
+    m_activeDocument = index;
+    m_doc->pipeline.setPriority(ThreadPool::Priority::Interactive);
+    m_prevSettings = m_doc->settings;
+    applyCacheSettings();
+
+    m_stats.cancel();
+    clearVariations();
+    updateStats();
+}
 
-    m_zoom = 1.0f;
-    m_needsReprocess = true;
-    return true;
+void UI::closeDocument(size_t index) {
+    if (index >= m_documents.size() || m_documents.size() < 2) return;
+    Document* closing = m_documents[index].get();
+    if (closing == m_doc) activateDocument(index > 0 ? index - 1 : 1);
+    ShaderManager::deletePreview(closing->sourcePreview);
+    ShaderManager::deletePreview(closing->processedPreview);
+    // Waits only for a run a worker has already started; it was cancelled
+    m_documents.erase(m_documents.begin() + index);
+    if (m_activeDocument > index) --m_activeDocument;
+    m_selectTab = m_activeDocument;
+}
+
+void UI::renderDocumentTabs() {
+    if (!ImGui::BeginTabBar("##documents", ImGuiTabBarFlags_FittingPolicyScroll)) return;
+    size_t closing = SIZE_MAX;
+    for (size_t i = 0; i < m_documents.size(); ++i) {
+        Document& doc = *m_documents[i];
+        // Names repeat, so the ID after ### is the document's own
+        char label[320];
+        std::snprintf(label, sizeof(label), "%s%s###doc%d", doc.pipeline.isProcessing() ? "* " : "",
+                      doc.name.empty() ? "\xd0\x9f\xd1\x83\xd1\x81\xd1\x82\xd0\xbe" : doc.name.c_str(), doc.id); // "Пусто"
+        bool open = true;
+        const ImGuiTabItemFlags flags = i == m_selectTab ? ImGuiTabItemFlags_SetSelected : 0;
+        if (ImGui::BeginTabItem(label, m_documents.size() > 1 ? &open : nullptr, flags)) {
+            // A selection made in code shows up in the tab bar a frame later
+            if (m_selectTab == SIZE_MAX) activateDocument(i);
+            else if (i == m_selectTab) m_selectTab = SIZE_MAX;
+            ImGui::EndTabItem();
+        }
+        if (!open) closing = i;
+    }
+    ImGui::EndTabBar();
+    if (closing != SIZE_MAX) closeDocument(closing);
+}
+
+void UI::processDocuments() {
+    for (auto& doc : m_documents) {
+        if (doc->needsReprocess && doc->pipeline.shouldUpdate(m_debounceMs)) {
+            doc->needsReprocess = false;
+            doc->trimmed = false;
+            doc->pipeline.markSubmitTime();
+            doc->pipeline.submit(doc->source, doc->settings, [this, d = doc.get()](ImageBuffer result) {
+                setProcessedImage(*d, std::move(result));
+            });
+        }
+        doc->pipeline.poll();
+
+        // Scratch blocks of a background document that has nothing to do go
+        // back to the OS; its images and history stay
+        if (doc.get() != m_doc && !doc->trimmed && !doc->pipeline.isProcessing()) {
+            doc->pipeline.getBufferPool().trim();
+            doc->trimmed = true;
+        }
+    }
+}
+
+bool UI::isProcessing() const {
+    for (const auto& doc : m_documents)
+        if (doc->pipeline.isProcessing() || doc->needsReprocess) return true;
+    return false;
 }
 
 // ---------------------------------------------------------------------------
-// Processed image update
+// Statistics panel
 // ---------------------------------------------------------------------------
 
-void UI::setProcessedImage(const ImageBuffer& img) {
-    m_processedImage = img;
-    if (!img.valid()) return;
+void UI::setWakeCallback(const std::function<void()>& wake) {
+    m_wake = wake;
+    for (auto& doc : m_documents) doc->pipeline.setWakeCallback(wake);
+    m_stats.setWakeCallback(wake);
+    m_variations.setWakeCallback(wake);
+}
 
-    if (m_processedTexture) {
-        ShaderManager::updatePreviewTexture(m_processedTexture,
-            img.data.data(), img.width, img.height, img.channels);
+// Measured in the background once the preview is up (see ImageStats)
+void UI::updateStats() {
+    if (m_showStats && m_doc->source.valid() && m_doc->processed.valid())
+        m_stats.update(m_doc->source, m_doc->sourceGeneration, m_doc->processed);
+}
+
+void UI::renderStatsPanel() {
+    ImGui::SetNextWindowSize(ImVec2(320, 480), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("\xd0\xa1\xd1\x82\xd0\xb0\xd1\x82\xd0\xb8\xd1\x81\xd1\x82\xd0\xb8\xd0\xba\xd0\xb0", &m_showStats)) { // "Статистика"
+        ImGui::End();
+        return;
+    }
+    if (!m_stats.hasReport()) {
+        ImGui::TextDisabled(m_stats.isRunning() ? "\xd0\x98\xd0\xb7\xd0\xbc\xd0\xb5\xd1\x80\xd0\xb5\xd0\xbd\xd0\xb8\xd0\xb5..." // "Измерение..."
+                                                : "\xd0\x9d\xd0\xb5\xd1\x82 \xd0\xb4\xd0\xb0\xd0\xbd\xd0\xbd\xd1\x8b\xd1\x85");     // "Нет данных"
+        ImGui::End();
+        return;
+    }
+
+    const ImageStats::Report& r = m_stats.report();
+    ImGui::Text("%dx%d", r.width, r.height);
+    ImGui::Text("\xd0\xa6\xd0\xb2\xd0\xb5\xd1\x82\xd0\xbe\xd0\xb2: %llu / %llu", // "Цветов: после / до"
+                static_cast<unsigned long long>(r.uniqueColors),
+                static_cast<unsigned long long>(r.sourceUniqueColors));
+    if (r.compared) {
+        if (std::isinf(r.psnr)) ImGui::Text("PSNR: \xe2\x88\x9e"); // "PSNR: ∞"
+        else ImGui::Text("PSNR: %.2f dB", r.psnr);
+        ImGui::Text("SSIM: %.4f", r.ssim);
+        ImGui::TextDisabled("MSE R %.1f  G %.1f  B %.1f", r.mse[0], r.mse[1], r.mse[2]);
     } else {
-        m_processedTexture = ShaderManager::createPreviewTexture(
-            img.data.data(), img.width, img.height, img.channels);
+        ImGui::TextDisabled("\xd0\xa0\xd0\xb0\xd0\xb7\xd0\xbc\xd0\xb5\xd1\x80 \xd0\xbe\xd1\x82\xd0\xbb\xd0\xb8\xd1\x87\xd0\xb0\xd0\xb5\xd1\x82\xd1\x81\xd1\x8f \xd0\xbe\xd1\x82 \xd0\xb8\xd1\x81\xd1\x85\xd0\xbe\xd0\xb4\xd0\xbd\xd0\xb8\xd0\xba\xd0\xb0"); // "Размер отличается от исходника"
+    }
+
+    ImGui::Separator();
+    static const char* const names[4] = {"R", "G", "B", "Y"};
+    static const ImU32 colors[4] = {IM_COL32(230, 80, 80, 255), IM_COL32(80, 200, 80, 255),
+                                    IM_COL32(90, 130, 240, 255), IM_COL32(200, 200, 200, 255)};
+    for (int c = 0; c < 4; ++c) {
+        ImGui::PushStyleColor(ImGuiCol_PlotHistogram, colors[c]);
+        ImGui::PlotHistogram(names[c], m_statsHistogram[c], 256, 0, nullptr, 0.0f, FLT_MAX,
+                             ImVec2(-24, 56));
+        ImGui::PopStyleColor();
+    }
+
+    ImGui::TextDisabled("%.1f ms, \xd0\xbf\xd0\xbe\xd0\xbb\xd0\xbe\xd1\x81 %d / %d%s", r.ms, r.bandsMeasured, r.bands, // "полос"
+                        m_stats.isRunning() ? "  ..." : "");
+    ImGui::End();
+}
+
+// ---------------------------------------------------------------------------
+// Variations panel
+// ---------------------------------------------------------------------------
+
+void UI::generateVariations() {
+    const auto mode = static_cast<Variations::Mode>(m_variationMode);
+    // Seed sweeps start from the current seed, so the first tile is the image
+    // as it is now
+    const uint32_t seed = mode == Variations::Mode::Seeds
+                              ? static_cast<uint32_t>(m_doc->settings.noiseSeed)
+                              : randomSeed();
+    m_variations.generate(m_doc->source, m_doc->sourceGeneration, m_doc->settings, mode,
+                          m_variationCount, seed);
+    for (auto& preview : m_variationPreviews) ShaderManager::deletePreview(preview);
+    m_variationPreviews.assign(m_variations.tiles().size(), {});
+}
+
+// Tiles belong to the image they were made from; their textures go with them
+void UI::clearVariations() {
+    m_variations.clear();
+    for (auto& preview : m_variationPreviews) ShaderManager::deletePreview(preview);
+    m_variationPreviews.clear();
+}
+
+void UI::renderVariationsPanel() {
+    ImGui::SetNextWindowSize(ImVec2(560, 600), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("\xd0\x92\xd0\xb0\xd1\x80\xd0\xb8\xd0\xb0\xd1\x86\xd0\xb8\xd0\xb8", &m_showVariations)) { // "Вариации"
+        ImGui::End();
+        return;
+    }
+
+    const char* modeItems[] = { "\xd0\xa1\xd0\xbb\xd1\x83\xd1\x87\xd0\xb0\xd0\xb9\xd0\xbd\xd1\x8b\xd0\xb5", "\xd0\xa1\xd0\xb8\xd0\xb4\xd1\x8b" }; // "Случайные", "Сиды"
+    ImGui::SetNextItemWidth(140);
+    ImGui::Combo("##variation_mode", &m_variationMode, modeItems, 2);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(140);
+    ImGui::SliderInt("##variation_count", &m_variationCount, 4, 36);
+    ImGui::SameLine();
+    if (!m_doc->source.valid()) ImGui::BeginDisabled();
+    if (ImGui::Button("\xd0\xa1\xd0\xbe\xd0\xb7\xd0\xb4\xd0\xb0\xd1\x82\xd1\x8c")) // "Создать"
+        generateVariations();
+    if (!m_doc->source.valid()) ImGui::EndDisabled();
+
+    // Click a tile to render its settings at full resolution. Tiles share
+    // the source's aspect, so they all get the same size.
+    const std::vector<Variations::Tile>& tiles = m_variations.tiles();
+    const float thumb = 128.0f;
+    const float aspect = m_doc->source.valid()
+        ? static_cast<float>(m_doc->source.width) / m_doc->source.height : 1.0f;
+    const ImVec2 size = aspect >= 1.0f ? ImVec2(thumb, thumb / aspect) : ImVec2(thumb * aspect, thumb);
+    const ImVec2 padding = ImGui::GetStyle().FramePadding;
+    const float cellW = size.x + padding.x * 2 + ImGui::GetStyle().ItemSpacing.x;
+    const int columns = std::max(1, static_cast<int>(ImGui::GetContentRegionAvail().x / cellW));
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        if (i % columns != 0) ImGui::SameLine();
+        ImGui::PushID(static_cast<int>(i));
+        const unsigned int tex = m_variationPreviews[i].id;
+        if (tiles[i].image.valid() && tex != 0) {
+            if (ImGui::ImageButton("##tile", (ImTextureID)(intptr_t)tex, size)) {
+                m_doc->settings = tiles[i].settings;
+                m_settingsChanged = true;
+            }
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("%.0f ms", tiles[i].ms);
+        } else {
+            ImGui::BeginDisabled();
+            ImGui::Button("...", ImVec2(size.x + padding.x * 2, size.y + padding.y * 2));
+            ImGui::EndDisabled();
+        }
+        ImGui::PopID();
     }
+    ImGui::End();
+}
+
+// ---------------------------------------------------------------------------
+// Processed image update
+// ---------------------------------------------------------------------------
+
+void UI::setProcessedImage(Document& doc, ImageBuffer img) {
+    doc.processed = std::move(img);
+    if (!doc.processed.valid()) return;
+    uploadPreview(doc.processedPreview, doc.processed, doc.zoom);
+    if (&doc == m_doc) updateStats();
+}
+
+// Uploads only as much detail as the zoom can show; mipmaps cover zooming
+// out further
+void UI::uploadPreview(ShaderManager::PreviewTexture& preview, const ImageBuffer& img, float zoom) {
+    ShaderManager::uploadPreview(preview, img.data.data(), img.width, img.height,
+                                 img.channels, ShaderManager::previewLodForScale(zoom));
 }
 
 // ---------------------------------------------------------------------------
@@ -567,75 +943,28 @@ void UI::setProcessedImage(const ImageBuffer& img) {
 // ---------------------------------------------------------------------------
 
 void UI::saveSettings(const char* path) {
-    FILE* f = fopen(path, "w");
-    if (!f) return;
-    fprintf(f, "hd8k=%d\n",            m_settings.hd8k ? 1 : 0);
-    fprintf(f, "quantization=%d\n",     m_settings.quantization);
-    fprintf(f, "ditherMode=%d\n",       static_cast<int>(m_settings.ditherMode));
-    fprintf(f, "sharpen=%d\n",          m_settings.sharpen);
-    fprintf(f, "resolution=%d\n",       m_settings.resolution);
-    fprintf(f, "displacement=%d\n",     m_settings.displacement);
-    fprintf(f, "displacementSeed=%d\n", m_settings.displacementSeed);
-    fprintf(f, "jpegQuality=%d\n",      m_settings.jpegQuality);
-    fprintf(f, "jpegIterations=%d\n",   m_settings.jpegIterations);
-    fprintf(f, "noiseIntensity=%d\n",   m_settings.noiseIntensity);
-    fprintf(f, "noiseType=%d\n",        static_cast<int>(m_settings.noiseType));
-    fprintf(f, "noisePerChannel=%d\n",  m_settings.noisePerChannel ? 1 : 0);
-    fprintf(f, "rgbShiftAmount=%d\n",   m_settings.rgbShiftAmount);
-    fprintf(f, "rgbShiftX=%d\n",        m_settings.rgbShiftX ? 1 : 0);
-    fprintf(f, "rgbShiftY=%d\n",        m_settings.rgbShiftY ? 1 : 0);
-    fprintf(f, "glitchBands=%d\n",      m_settings.glitchBands);
-    fprintf(f, "glitchAmplitude=%d\n",  m_settings.glitchAmplitude);
-    fprintf(f, "glitchSeed=%d\n",       m_settings.glitchSeed);
-    fprintf(f, "palette=%d\n",          static_cast<int>(m_settings.palette));
-    fprintf(f, "iterativeDestroy=%d\n", m_settings.iterativeDestroy ? 1 : 0);
-    fprintf(f, "iterativeCount=%d\n",   m_settings.iterativeCount);
-    fprintf(f, "watermark=%d\n",        m_settings.watermark ? 1 : 0);
-    fprintf(f, "watermarkText=%s\n",    m_settings.watermarkText.c_str());
-    fprintf(f, "randomSeed=%d\n",       m_settings.randomSeed);
-    fprintf(f, "stripExif=%d\n",        m_settings.stripExif ? 1 : 0);
-    fclose(f);
+    SettingsFile::save(path, m_doc->settings);
 }
 
 void UI::loadSettings(const char* path) {
-    FILE* f = fopen(path, "r");
-    if (!f) return;
-
-    char line[512];
-    while (fgets(line, sizeof(line), f)) {
-        char key[128];
-        char val[384];
-        if (sscanf(line, "%127[^=]=%383[^\n]", key, val) != 2) continue;
-
-        int iv = atoi(val);
-        if      (strcmp(key, "hd8k") == 0)            m_settings.hd8k = iv != 0;
-        else if (strcmp(key, "quantization") == 0)     m_settings.quantization = iv;
-        else if (strcmp(key, "ditherMode") == 0)       m_settings.ditherMode = static_cast<DitherMode>(iv);
-        else if (strcmp(key, "sharpen") == 0)          m_settings.sharpen = iv;
-        else if (strcmp(key, "resolution") == 0)       m_settings.resolution = iv;
-        else if (strcmp(key, "displacement") == 0)     m_settings.displacement = iv;
-        else if (strcmp(key, "displacementSeed") == 0) m_settings.displacementSeed = iv;
-        else if (strcmp(key, "jpegQuality") == 0)      m_settings.jpegQuality = iv;
-        else if (strcmp(key, "jpegIterations") == 0)   m_settings.jpegIterations = iv;
-        else if (strcmp(key, "noiseIntensity") == 0)   m_settings.noiseIntensity = iv;
-        else if (strcmp(key, "noiseType") == 0)        m_settings.noiseType = static_cast<NoiseType>(iv);
-        else if (strcmp(key, "noisePerChannel") == 0)  m_settings.noisePerChannel = iv != 0;
-        else if (strcmp(key, "rgbShiftAmount") == 0)   m_settings.rgbShiftAmount = iv;
-        else if (strcmp(key, "rgbShiftX") == 0)        m_settings.rgbShiftX = iv != 0;
-        else if (strcmp(key, "rgbShiftY") == 0)        m_settings.rgbShiftY = iv != 0;
-        else if (strcmp(key, "glitchBands") == 0)      m_settings.glitchBands = iv;
-        else if (strcmp(key, "glitchAmplitude") == 0)  m_settings.glitchAmplitude = iv;
-        else if (strcmp(key, "glitchSeed") == 0)       m_settings.glitchSeed = iv;
-        else if (strcmp(key, "palette") == 0)          m_settings.palette = static_cast<PalettePreset>(iv);
-        else if (strcmp(key, "iterativeDestroy") == 0) m_settings.iterativeDestroy = iv != 0;
-        else if (strcmp(key, "iterativeCount") == 0)   m_settings.iterativeCount = iv;
-        else if (strcmp(key, "watermark") == 0)        m_settings.watermark = iv != 0;
-        else if (strcmp(key, "watermarkText") == 0)    m_settings.watermarkText = val;
-        else if (strcmp(key, "randomSeed") == 0)       m_settings.randomSeed = iv;
-        else if (strcmp(key, "stripExif") == 0)        m_settings.stripExif = iv != 0;
-    }
-    fclose(f);
-    m_needsReprocess = true;
+    if (SettingsFile::load(path, m_doc->settings))
+        m_doc->needsReprocess = true;
+    applyCacheSettings();
+}
+
+void UI::setCacheDirectory(const std::string& dir) {
+    m_cacheDir = dir;
+    applyCacheSettings();
+}
+
+// The cache is shared, so its disk tier follows the active document's
+// setting; re-run on every tab switch, it only rescans the directory when
+// that actually changes it
+void UI::applyCacheSettings() {
+    std::string dir = m_doc->settings.diskCache ? m_cacheDir : std::string();
+    if (dir == m_diskTierDir) return;
+    m_cache->setDiskTier(dir);
+    m_diskTierDir = std::move(dir);
 }
 
 // ---------------------------------------------------------------------------
@@ -647,7 +976,7 @@ std::string UI::showOpenDialog() {
     char filename[MAX_PATH] = {};
     OPENFILENAMEA ofn = {};
     ofn.lStructSize = sizeof(ofn);
-    ofn.lpstrFilter = "Images\0*.png;*.jpg;*.jpeg;*.bmp;*.tga\0All\0*.*\0";
+    ofn.lpstrFilter = "Images\0*.png;*.jpg;*.jpeg;*.bmp;*.tga;*.gif\0All\0*.*\0";
     ofn.lpstrFile   = filename;
     ofn.nMaxFile    = MAX_PATH;
     ofn.Flags       = OFN_FILEMUSTEXIST | OFN_NOCHANGEDIR;
@@ -655,7 +984,7 @@ std::string UI::showOpenDialog() {
     return {};
 #else
     // Try zenity if available
-    FILE* p = popen("zenity --file-selection --file-filter='Images|*.png *.jpg *.jpeg *.bmp *.tga' 2>/dev/null", "r");
+    FILE* p = popen("zenity --file-selection --file-filter='Images|*.png *.jpg *.jpeg *.bmp *.tga *.gif' 2>/dev/null", "r");
     if (p) {
         char buf[1024] = {};
         if (fgets(buf, sizeof(buf), p)) {
@@ -676,7 +1005,7 @@ std::string UI::showSaveDialog() {
     char filename[MAX_PATH] = {};
     OPENFILENAMEA ofn = {};
     ofn.lStructSize  = sizeof(ofn);
-    ofn.lpstrFilter  = "PNG\0*.png\0JPEG\0*.jpg;*.jpeg\0BMP\0*.bmp\0All\0*.*\0";
+    ofn.lpstrFilter  = "PNG\0*.png\0JPEG\0*.jpg;*.jpeg\0BMP\0*.bmp\0GIF\0*.gif\0All\0*.*\0";
     ofn.lpstrFile    = filename;
     ofn.nMaxFile     = MAX_PATH;
     ofn.Flags        = OFN_OVERWRITEPROMPT | OFN_NOCHANGEDIR;
@@ -685,7 +1014,7 @@ std::string UI::showSaveDialog() {
     return {};
 #else
     FILE* p = popen("zenity --file-selection --save --confirm-overwrite "
-                    "--file-filter='Images|*.png *.jpg *.jpeg *.bmp' 2>/dev/null", "r");
+                    "--file-filter='Images|*.png *.jpg *.jpeg *.bmp *.gif' 2>/dev/null", "r");
     if (p) {
         char buf[1024] = {};
         if (fgets(buf, sizeof(buf), p)) {
@@ -705,35 +1034,16 @@ std::string UI::showSaveDialog() {
 // ---------------------------------------------------------------------------
 
 void UI::randomizeSettings() {
-    std::mt19937 rng(m_settings.randomSeed != 0
-        ? static_cast<unsigned>(m_settings.randomSeed)
-        : std::random_device{}());
-
-    auto randInt = [&](int lo, int hi) {
-        return std::uniform_int_distribution<int>(lo, hi)(rng);
-    };
+    Variations::randomize(m_doc->settings, randomSeed());
+}
 
-    m_settings.hd8k             = randInt(0, 1) != 0;
-    m_settings.quantization     = randInt(0, 100);
-    m_settings.ditherMode       = static_cast<DitherMode>(randInt(0, 2));
-    m_settings.sharpen          = randInt(0, 100);
-    m_settings.resolution       = randInt(10, 100);
-    m_settings.displacement     = randInt(0, 100);
-    m_settings.displacementSeed = randInt(0, 99999);
-    m_settings.jpegQuality      = randInt(1, 100);
-    m_settings.jpegIterations   = randInt(1, 10);
-    m_settings.noiseIntensity   = randInt(0, 100);
-    m_settings.noiseType        = static_cast<NoiseType>(randInt(0, 2));
-    m_settings.noisePerChannel  = randInt(0, 1) != 0;
-    m_settings.rgbShiftAmount   = randInt(0, 50);
-    m_settings.rgbShiftX        = randInt(0, 1) != 0;
-    m_settings.rgbShiftY        = randInt(0, 1) != 0;
-    m_settings.glitchBands      = randInt(0, 30);
-    m_settings.glitchAmplitude  = randInt(0, 100);
-    m_settings.glitchSeed       = randInt(0, 99999);
-    m_settings.palette          = static_cast<PalettePreset>(randInt(0, 5));
+// Seed for a roll: the settings' own when one is set, so rolls repeat
+uint32_t UI::randomSeed() const {
+    return m_doc->settings.randomSeed != 0 ? static_cast<uint32_t>(m_doc->settings.randomSeed)
+                                      : std::random_device{}();
 }
 
 void UI::resetSettings() {
-    m_settings = Settings{};
+    m_doc->settings = Settings{};
+    applyCacheSettings();
 }
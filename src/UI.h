@@ -1,7 +1,17 @@
 #pragma once
 #include "ImageProcessor.h"
 #include "Pipeline.h"
+#include "ImageLoader.h"
+#include "ImageSaver.h"
+#include "ImageStats.h"
+#include "ShaderManager.h"
+#include "Trace.h"
+#include "Variations.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 
 // Forward declare GL texture type
 typedef unsigned int GLuint;
@@ -17,43 +27,71 @@ public:
     // Render the UI. Returns true if settings changed.
     bool render();
 
-    // Load image from file path
+    // Start loading an image from file path (decoded in the background)
     bool loadImage(const char* path);
 
-    // Load image from memory (for clipboard paste)
+    // Start loading an image from memory (for clipboard paste)
     bool loadImageFromMemory(const unsigned char* data, int len);
 
-    // Get current settings
-    const Settings& getSettings() const { return m_settings; }
-    Settings& getSettings() { return m_settings; }
+    // True while a load is decoding
+    bool isLoading() const { return m_loader.isLoading(); }
+
+    // Write the processed image (or the source if nothing is processed yet)
+    // to `path` in the background
+    bool saveImage(const std::string& path);
+
+    // True while a save is being written
+    bool isSaving() const { return m_saver.isSaving(); }
+
+    // Get current settings (of the active document, as everything below)
+    const Settings& getSettings() const { return m_doc->settings; }
+    Settings& getSettings() { return m_doc->settings; }
 
     // Get source image
-    const ImageBuffer& getSourceImage() const { return m_sourceImage; }
+    const ImageBuffer& getSourceImage() const { return m_doc->source; }
 
     // Set the processed result for preview
-    void setProcessedImage(const ImageBuffer& img);
+    void setProcessedImage(ImageBuffer img) { setProcessedImage(*m_doc, std::move(img)); }
 
     // Get the processed image (for saving)
-    const ImageBuffer& getProcessedImage() const { return m_processedImage; }
+    const ImageBuffer& getProcessedImage() const { return m_doc->processed; }
 
     // Check if we need to reprocess
-    bool needsReprocess() const { return m_needsReprocess; }
-    void clearReprocessFlag() { m_needsReprocess = false; }
+    bool needsReprocess() const { return m_doc->needsReprocess; }
+    void clearReprocessFlag() { m_doc->needsReprocess = false; }
 
     // Get pipeline reference
-    Pipeline& getPipeline() { return m_pipeline; }
+    Pipeline& getPipeline() { return m_doc->pipeline; }
+
+    // Once per frame: submit the active document's pending changes once the
+    // debounce allows, pick up results of every document and release the
+    // scratch memory of idle ones
+    void processDocuments();
+
+    // True while any document's pipeline runs
+    bool isProcessing() const;
+
+    // Called from worker threads when a result or the statistics are ready
+    // for the next frame. Set before the first load.
+    void setWakeCallback(const std::function<void()>& wake);
 
     // Save/Load settings to/from INI
     void saveSettings(const char* path);
     void loadSettings(const char* path);
 
+    // Where the result cache keeps its disk tier when that is switched on
+    void setCacheDirectory(const std::string& dir);
+
+    // Where File > Export trace writes (SHAKAL_TRACE builds)
+    void setTracePath(const std::string& path) { m_tracePath = path; }
+
     // Show file open dialog (platform native)
     std::string showOpenDialog();
     // Show file save dialog
     std::string showSaveDialog();
 
     // Get save format info
-    bool getSaveStripExif() const { return m_settings.stripExif; }
+    bool getSaveStripExif() const { return m_doc->settings.stripExif; }
 
     bool wantsSave() const { return m_wantsSave; }
     void clearSaveFlag() { m_wantsSave = false; }
@@ -67,28 +105,85 @@ private:
     void renderControlPanel();
     void renderPreview();
     void renderStatusBar();
+    void renderStatsPanel();
+    void updateStats();
+    void renderVariationsPanel();
+    void generateVariations();
+    void clearVariations();
+    uint32_t randomSeed() const;
     void randomizeSettings();
     void resetSettings();
+    void setSourceImage(ImageBuffer img);
+    void uploadPreview(ShaderManager::PreviewTexture& preview, const ImageBuffer& img, float zoom);
+    void applyCacheSettings();
+
+    // One open image with everything that belongs to it. The active one is
+    // shown and edited; the others keep their state, and their pipelines run
+    // in the pool's background class.
+    struct Document {
+        explicit Document(std::shared_ptr<ResultCache> cache) : pipeline(std::move(cache)) {}
+
+        int id = 0;                     // stable tab ID
+        Settings settings;
+        Pipeline pipeline;
+        ImageBuffer source;
+        uint64_t sourceGeneration = 0;  // unique across documents, bumped with every new source
+        std::string sourcePath;         // file the source came from; empty when pasted
+        std::string name;               // tab label
+        ImageBuffer processed;
+        ShaderManager::PreviewTexture sourcePreview;
+        ShaderManager::PreviewTexture processedPreview;
+        float zoom = 1.0f;
+        bool showOriginal = false;      // split view toggle
+        bool needsReprocess = false;
+        bool trimmed = false;           // scratch pool emptied since its last run
+    };
+
+    Document& openDocument();           // new empty tab with the active one's settings
+    void activateDocument(size_t index);
+    void closeDocument(size_t index);
+    void renderDocumentTabs();
+    void setProcessedImage(Document& doc, ImageBuffer img);
+
+    std::shared_ptr<ResultCache> m_cache;   // shared by every document
+    std::vector<std::unique_ptr<Document>> m_documents;
+    Document* m_doc = nullptr;              // the active one
+    size_t m_activeDocument = 0;
+    size_t m_selectTab = SIZE_MAX;          // tab bar selects this one next frame
+    uint64_t m_nextGeneration = 0;
+    int m_nextDocumentId = 0;
+    int m_pastedCount = 0;
+    std::function<void()> m_wake;
 
-    Settings m_settings;
     Settings m_prevSettings;
-    Pipeline m_pipeline;
+    ImageLoader m_loader;
+    ImageSaver m_saver;
+    ImageStats m_stats;
+    Variations m_variations;
 
-    ImageBuffer m_sourceImage;
-    ImageBuffer m_processedImage;
+    std::vector<ShaderManager::PreviewTexture> m_variationPreviews;   // one per tile
 
-    GLuint m_sourceTexture = 0;
-    GLuint m_processedTexture = 0;
-
-    float m_zoom = 1.0f;
     float m_panX = 0.0f;
     float m_panY = 0.0f;
-    bool m_showOriginal = false; // split view toggle
+    bool m_showStats = false;
+    bool m_showVariations = false;
+    int m_variationMode = 0;        // Variations::Mode
+    int m_variationCount = 16;
+
+    // Last statistics report as plot values: R, G, B, luma
+    float m_statsHistogram[4][256] = {};
 
-    bool m_needsReprocess = false;
     bool m_wantsSave = false;
     bool m_wantsLoad = false;
     std::string m_loadPath;
+    std::string m_cacheDir;
+    std::string m_diskTierDir;              // what m_cache's disk tier was last set to
+    std::string m_tracePath;
+
+    // Last processImage breakdown, refreshed when new spans arrive
+    std::vector<Trace::Stage> m_traceStages;
+    double m_traceTotalMs = 0.0;
+    uint64_t m_traceSeen = 0;
 
     bool m_settingsChanged = false;
     int m_debounceMs = 100;
@@ -0,0 +1,135 @@
+#include "Variations.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+Variations::~Variations() {
+    cancelRun();
+    for (auto& task : m_tasks) task.wait();
+}
+
+void Variations::cancelRun() {
+    if (m_run) m_run->cancel.store(true);
+    m_run.reset();
+    m_remaining = 0;
+}
+
+void Variations::clear() {
+    cancelRun();
+    m_tiles.clear();
+}
+
+void Variations::generate(const ImageBuffer& source, uint64_t sourceId, const Settings& base,
+                          Mode mode, int count, uint32_t seed) {
+    clear();
+    if (!source.valid() || count <= 0) return;
+
+    if (sourceId != m_sourceId || !m_proxy) {
+        const int longSide = std::max(source.width, source.height);
+        const double scale = std::min(1.0, static_cast<double>(PROXY_SIDE) / longSide);
+        m_proxy = std::make_shared<const ImageBuffer>(ImageProcessor::downscale(
+            source, std::max(1, static_cast<int>(source.width * scale)),
+            std::max(1, static_cast<int>(source.height * scale))));
+        m_sourceId = sourceId;
+    }
+    if (!m_proxy->valid()) return;
+
+    // Tasks queued by earlier runs return at once; drop the ones that did
+    std::erase_if(m_tasks, [](const std::future<void>& task) {
+        return task.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    });
+
+    m_tiles.assign(count, Tile{});
+    for (int i = 0; i < count; ++i) {
+        Settings& s = m_tiles[i].settings;
+        s = base;
+        const uint32_t tileSeed = seed + static_cast<uint32_t>(i);
+        if (mode == Mode::Random) {
+            randomize(s, tileSeed);
+        } else {
+            const int swept = static_cast<int>(tileSeed % 100000);
+            s.noiseSeed = swept;
+            s.glitchSeed = swept;
+            s.displacementSeed = swept;
+        }
+    }
+
+    m_run = std::make_shared<Run>();
+    m_run->proxy = m_proxy;
+    m_run->wake = m_wake;
+    m_remaining = count;
+    for (int i = 0; i < count; ++i) {
+        // One tile per task: processImage runs its own stages inline on the
+        // worker, so the pool's parallelism goes across tiles
+        m_tasks.push_back(ThreadPool::shared().submit(
+            [run = m_run, i, settings = m_tiles[i].settings]() {
+                if (run->cancel.load()) return;
+                const auto start = std::chrono::steady_clock::now();
+                Tile tile;
+                tile.settings = settings;
+                try {
+                    tile.image = ImageProcessor::processImage(*run->proxy, settings, run->cancel);
+                } catch (...) {
+                    tile.image = ImageBuffer{};
+                }
+                if (run->cancel.load()) return;
+                tile.ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count();
+                {
+                    std::lock_guard<std::mutex> lock(run->mutex);
+                    run->finished.emplace_back(i, std::move(tile));
+                }
+                if (run->wake) run->wake();
+            }));
+    }
+}
+
+std::vector<int> Variations::poll() {
+    std::vector<int> arrived;
+    if (!m_run) return arrived;
+    std::vector<std::pair<int, Tile>> finished;
+    {
+        std::lock_guard<std::mutex> lock(m_run->mutex);
+        finished.swap(m_run->finished);
+    }
+    for (auto& [index, tile] : finished) {
+        --m_remaining;
+        if (!tile.image.valid()) continue;  // out of memory: the tile stays empty
+        m_tiles[index] = std::move(tile);
+        arrived.push_back(index);
+    }
+    if (m_remaining == 0) m_run.reset();
+    return arrived;
+}
+
+void Variations::randomize(Settings& settings, uint32_t seed) {
+    std::mt19937 rng(seed);
+
+    auto randInt = [&](int lo, int hi) {
+        return std::uniform_int_distribution<int>(lo, hi)(rng);
+    };
+
+    settings.hd8k             = randInt(0, 1) != 0;
+    settings.quantization     = randInt(0, 100);
+    settings.ditherMode       = static_cast<DitherMode>(randInt(0, 2));
+    settings.sharpen          = randInt(0, 100);
+    settings.resolution       = randInt(10, 100);
+    settings.displacement     = randInt(0, 100);
+    settings.displacementSeed = randInt(0, 99999);
+    settings.jpegQuality      = randInt(1, 100);
+    settings.jpegIterations   = randInt(1, 10);
+    settings.noiseIntensity   = randInt(0, 100);
+    settings.noiseType        = static_cast<NoiseType>(randInt(0, 2));
+    settings.noisePerChannel  = randInt(0, 1) != 0;
+    settings.rgbShiftAmount   = randInt(0, 50);
+    settings.rgbShiftX        = randInt(0, 1) != 0;
+    settings.rgbShiftY        = randInt(0, 1) != 0;
+    settings.glitchBands      = randInt(0, 30);
+    settings.glitchAmplitude  = randInt(0, 100);
+    settings.glitchSeed       = randInt(0, 99999);
+    settings.palette          = static_cast<PalettePreset>(randInt(0, 5));
+    settings.noiseSeed        = randInt(0, 99999);
+    settings.glitchMode       = static_cast<GlitchMode>(randInt(0, 2));
+}
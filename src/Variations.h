@@ -0,0 +1,85 @@
+#pragma once
+
+#include "ImageProcessor.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Variations - a grid of alternative settings rendered side by side
+//
+// generate() derives `count` settings from a base (random looks, or the base
+// with its seeds swept) and renders each on a proxy of the source, at most
+// PROXY_SIDE pixels on the long side, as its own ThreadPool::shared() task.
+// Tiles arrive in poll() as they finish; the caller renders a chosen one at
+// full resolution the usual way. Pixel-sized effects (shift, displacement,
+// glitch amplitude) look stronger on the proxy than they will on the source.
+// ---------------------------------------------------------------------------
+
+class Variations {
+public:
+    static constexpr int PROXY_SIDE = 320;
+
+    enum class Mode { Random, Seeds };
+
+    struct Tile {
+        Settings settings;
+        ImageBuffer image;          // valid once the tile arrived
+        double ms = 0.0;            // processImage time on the proxy
+    };
+
+    Variations() = default;
+    ~Variations();
+
+    Variations(const Variations&) = delete;
+    Variations& operator=(const Variations&) = delete;
+
+    // Called on a worker thread whenever a tile is ready for poll(). Set
+    // before the first generate.
+    void setWakeCallback(std::function<void()> wake) { m_wake = std::move(wake); }
+
+    // Replace the grid with `count` variations of `base`. `sourceId` must
+    // change whenever the source does; the proxy is only rebuilt then.
+    // Random mode: tile i is randomize(base, seed + i). Seeds mode: the
+    // noise, glitch and displacement seeds of base become seed + i.
+    void generate(const ImageBuffer& source, uint64_t sourceId, const Settings& base,
+                  Mode mode, int count, uint32_t seed);
+
+    // Drop the tiles and any still being rendered
+    void clear();
+
+    // Pick up finished tiles (call from main thread); returns their indices
+    std::vector<int> poll();
+
+    const std::vector<Tile>& tiles() const { return m_tiles; }
+    bool isRunning() const { return m_remaining > 0; }
+
+    // Every effect of `settings` set at random, repeatably for one seed;
+    // export and cache options are left alone
+    static void randomize(Settings& settings, uint32_t seed);
+
+private:
+    // One generate(): the tasks only touch this, never the Variations
+    struct Run {
+        std::shared_ptr<const ImageBuffer> proxy;
+        std::atomic<bool> cancel{false};
+        std::mutex mutex;
+        std::vector<std::pair<int, Tile>> finished;     // not yet polled
+        std::function<void()> wake;
+    };
+
+    void cancelRun();
+
+    std::shared_ptr<const ImageBuffer> m_proxy;
+    uint64_t m_sourceId = ~0ull;
+    std::shared_ptr<Run> m_run;
+    std::vector<std::future<void>> m_tasks;             // joined on destruction
+    std::vector<Tile> m_tiles;
+    int m_remaining = 0;
+    std::function<void()> m_wake;
+};
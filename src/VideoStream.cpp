@@ -0,0 +1,382 @@
+#include "VideoStream.h"
+#include "Animation.h"
+#include "ResultCache.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <string>
+
+namespace {
+
+// Settings that blend between keyframes; everything else steps
+constexpr int Settings::* LERP_FIELDS[] = {
+    &Settings::quantization,   &Settings::sharpen,        &Settings::resolution,
+    &Settings::displacement,   &Settings::jpegQuality,    &Settings::jpegIterations,
+    &Settings::noiseIntensity, &Settings::rgbShiftAmount, &Settings::glitchBands,
+    &Settings::glitchAmplitude, &Settings::iterativeCount,
+};
+
+enum class Format { Y4M, PAM };
+
+struct StreamFormat {
+    Format format = Format::Y4M;
+    int width = 0;
+    int height = 0;
+
+    // YUV4MPEG2
+    std::string y4mHeader;           // stream header line, written back as is
+    bool mono = false;
+    int chromaShiftX = 0;            // log2 of the chroma subsampling
+    int chromaShiftY = 0;
+    bool fullRange = false;          // XCOLORRANGE=FULL, else studio swing
+
+    // PAM
+    int depth = 3;
+    std::string pamHeader;           // first image's header, repeated per frame
+
+    int chromaWidth() const { return (width + (1 << chromaShiftX) - 1) >> chromaShiftX; }
+    int chromaHeight() const { return (height + (1 << chromaShiftY) - 1) >> chromaShiftY; }
+
+    size_t frameBytes() const {
+        const size_t luma = static_cast<size_t>(width) * height;
+        if (format == Format::PAM) return luma * depth;
+        return mono ? luma : luma + 2 * static_cast<size_t>(chromaWidth()) * chromaHeight();
+    }
+};
+
+// One header line without the '\n'. False at end of stream or on an
+// implausibly long line.
+bool readLine(FILE* in, std::string& line) {
+    constexpr size_t MAX_LINE = 4096;
+    line.clear();
+    int c;
+    while ((c = std::fgetc(in)) != EOF && c != '\n') {
+        if (line.size() >= MAX_LINE) return false;
+        line.push_back(static_cast<char>(c));
+    }
+    return c == '\n';
+}
+
+std::vector<std::string> splitTokens(const std::string& line) {
+    std::vector<std::string> tokens;
+    size_t pos = 0;
+    while (pos < line.size()) {
+        size_t end = line.find_first_of(" \t\r", pos);
+        if (end == std::string::npos) end = line.size();
+        if (end > pos) tokens.push_back(line.substr(pos, end - pos));
+        pos = end + 1;
+    }
+    return tokens;
+}
+
+bool parseY4mHeader(const std::string& line, StreamFormat& fmt) {
+    fmt.format = Format::Y4M;
+    fmt.y4mHeader = line;
+    std::string chroma = "420jpeg";
+    for (const std::string& token : splitTokens(line)) {
+        switch (token[0]) {
+            case 'W': fmt.width = std::atoi(token.c_str() + 1); break;
+            case 'H': fmt.height = std::atoi(token.c_str() + 1); break;
+            case 'C': chroma = token.substr(1); break;
+            case 'X': if (token == "XCOLORRANGE=FULL") fmt.fullRange = true; break;
+            default: break;
+        }
+    }
+
+    if (chroma == "420" || chroma == "420jpeg" || chroma == "420paldv" || chroma == "420mpeg2") {
+        fmt.chromaShiftX = fmt.chromaShiftY = 1;
+    } else if (chroma == "422") {
+        fmt.chromaShiftX = 1;
+    } else if (chroma == "mono") {
+        fmt.mono = true;
+    } else if (chroma != "444") {
+        return false;  // high bit depth, alpha, ...
+    }
+    return fmt.width > 0 && fmt.height > 0;
+}
+
+// The header lines after "P7", up to and including ENDHDR
+bool parsePamHeader(FILE* in, StreamFormat& fmt) {
+    fmt.format = Format::PAM;
+    fmt.pamHeader = "P7\n";
+    int maxval = 0;
+    std::string line;
+    for (;;) {
+        if (!readLine(in, line)) return false;
+        fmt.pamHeader += line + "\n";
+        auto tokens = splitTokens(line);
+        if (tokens.empty() || tokens[0][0] == '#') continue;
+        if (tokens[0] == "ENDHDR") break;
+        if (tokens.size() < 2) continue;
+        const int value = std::atoi(tokens[1].c_str());
+        if (tokens[0] == "WIDTH") fmt.width = value;
+        else if (tokens[0] == "HEIGHT") fmt.height = value;
+        else if (tokens[0] == "DEPTH") fmt.depth = value;
+        else if (tokens[0] == "MAXVAL") maxval = value;
+    }
+    return fmt.width > 0 && fmt.height > 0 && fmt.depth >= 1 && fmt.depth <= 4 && maxval == 255;
+}
+
+// Frames from either container; the first PAM header doubles as the stream
+// header
+class FrameReader {
+public:
+    explicit FrameReader(FILE* in) : m_in(in) {}
+
+    bool open() {
+        std::string line;
+        if (!readLine(m_in, line)) return false;
+        if (line.rfind("YUV4MPEG2", 0) == 0) return parseY4mHeader(line, m_format);
+        if (line != "P7" || !parsePamHeader(m_in, m_format)) return false;
+        m_pendingHeader = true;
+        return true;
+    }
+
+    const StreamFormat& format() const { return m_format; }
+
+    // 1 = frame read, 0 = clean end of stream, -1 = malformed or truncated
+    int next(std::vector<uint8_t>& raw) {
+        std::string line;
+        if (m_format.format == Format::Y4M) {
+            if (!readLine(m_in, line)) return line.empty() && std::feof(m_in) ? 0 : -1;
+            if (line.rfind("FRAME", 0) != 0) return -1;
+        } else if (m_pendingHeader) {
+            m_pendingHeader = false;
+        } else {
+            if (!readLine(m_in, line)) return line.empty() && std::feof(m_in) ? 0 : -1;
+            StreamFormat image;
+            if (line != "P7" || !parsePamHeader(m_in, image)) return -1;
+            if (image.width != m_format.width || image.height != m_format.height ||
+                image.depth != m_format.depth)
+                return -1;  // size changes mid-stream are not supported
+        }
+
+        raw.resize(m_format.frameBytes());
+        return std::fread(raw.data(), 1, raw.size(), m_in) == raw.size() ? 1 : -1;
+    }
+
+private:
+    FILE* m_in;
+    StreamFormat m_format;
+    bool m_pendingHeader = false;
+};
+
+inline uint8_t toByte(float v) {
+    return static_cast<uint8_t>(std::clamp(v + 0.5f, 0.0f, 255.0f));
+}
+
+// BT.601, studio swing unless the stream says full range
+ImageBuffer decodeY4m(const std::vector<uint8_t>& raw, const StreamFormat& fmt) {
+    ImageBuffer img;
+    img.width = fmt.width;
+    img.height = fmt.height;
+    img.channels = 3;
+    img.data = ByteBuffer(img.pixelCount() * 3);
+
+    const float yScale = fmt.fullRange ? 1.0f : 255.0f / 219.0f;
+    const float yOffset = fmt.fullRange ? 0.0f : 16.0f;
+    const float cScale = fmt.fullRange ? 1.0f : 255.0f / 224.0f;
+    const int cw = fmt.chromaWidth();
+    const uint8_t* yPlane = raw.data();
+    const uint8_t* uPlane = yPlane + img.pixelCount();
+    const uint8_t* vPlane = uPlane + static_cast<size_t>(cw) * fmt.chromaHeight();
+
+    uint8_t* dst = img.data.data();
+    for (int y = 0; y < fmt.height; ++y) {
+        const size_t crow = static_cast<size_t>(y >> fmt.chromaShiftY) * cw;
+        for (int x = 0; x < fmt.width; ++x, dst += 3) {
+            const float luma = (yPlane[static_cast<size_t>(y) * fmt.width + x] - yOffset) * yScale;
+            float cb = 0.0f, cr = 0.0f;
+            if (!fmt.mono) {
+                const size_t ci = crow + (x >> fmt.chromaShiftX);
+                cb = (uPlane[ci] - 128.0f) * cScale;
+                cr = (vPlane[ci] - 128.0f) * cScale;
+            }
+            dst[0] = toByte(luma + 1.402f * cr);
+            dst[1] = toByte(luma - 0.344136f * cb - 0.714136f * cr);
+            dst[2] = toByte(luma + 1.772f * cb);
+        }
+    }
+    return img;
+}
+
+std::vector<uint8_t> encodeY4m(const ImageBuffer& rgba, const StreamFormat& fmt) {
+    const int w = fmt.width, h = fmt.height;
+    const int cw = fmt.chromaWidth(), ch = fmt.chromaHeight();
+    const float yScale = fmt.fullRange ? 1.0f : 219.0f / 255.0f;
+    const float yOffset = fmt.fullRange ? 0.0f : 16.0f;
+    const float cScale = fmt.fullRange ? 1.0f : 224.0f / 255.0f;
+
+    std::vector<uint8_t> out(fmt.frameBytes());
+    const uint8_t* src = rgba.data.data();
+    for (size_t i = 0; i < rgba.pixelCount(); ++i, src += 4)
+        out[i] = toByte(yOffset + yScale * (0.299f * src[0] + 0.587f * src[1] + 0.114f * src[2]));
+    if (fmt.mono) return out;
+
+    // Chroma of each block is the mean over its pixels (clipped at the edges)
+    uint8_t* uPlane = out.data() + static_cast<size_t>(w) * h;
+    uint8_t* vPlane = uPlane + static_cast<size_t>(cw) * ch;
+    for (int cy = 0; cy < ch; ++cy) {
+        const int y0 = cy << fmt.chromaShiftY, y1 = std::min(h, (cy + 1) << fmt.chromaShiftY);
+        for (int cx = 0; cx < cw; ++cx) {
+            const int x0 = cx << fmt.chromaShiftX, x1 = std::min(w, (cx + 1) << fmt.chromaShiftX);
+            float cb = 0.0f, cr = 0.0f;
+            for (int y = y0; y < y1; ++y) {
+                const uint8_t* p = rgba.data.data() + (static_cast<size_t>(y) * w + x0) * 4;
+                for (int x = x0; x < x1; ++x, p += 4) {
+                    cb += -0.168736f * p[0] - 0.331264f * p[1] + 0.5f * p[2];
+                    cr += 0.5f * p[0] - 0.418688f * p[1] - 0.081312f * p[2];
+                }
+            }
+            const float n = static_cast<float>((y1 - y0) * (x1 - x0));
+            uPlane[static_cast<size_t>(cy) * cw + cx] = toByte(128.0f + cScale * cb / n);
+            vPlane[static_cast<size_t>(cy) * cw + cx] = toByte(128.0f + cScale * cr / n);
+        }
+    }
+    return out;
+}
+
+// Gray(+alpha) is widened to RGB(+alpha plane), RGB(A) is taken as is
+ImageBuffer decodePam(const std::vector<uint8_t>& raw, const StreamFormat& fmt) {
+    ImageBuffer img;
+    img.width = fmt.width;
+    img.height = fmt.height;
+    const size_t n = img.pixelCount();
+    if (fmt.depth >= 3) {
+        img.channels = fmt.depth;
+        img.data = ByteBuffer(raw.size());
+        std::memcpy(img.data.data(), raw.data(), raw.size());
+        return img;
+    }
+
+    img.channels = 3;
+    img.data = ByteBuffer(n * 3);
+    if (fmt.depth == 2) img.alpha = ByteBuffer(n);
+    for (size_t i = 0; i < n; ++i) {
+        const uint8_t g = raw[i * fmt.depth];
+        img.data[i * 3 + 0] = img.data[i * 3 + 1] = img.data[i * 3 + 2] = g;
+        if (fmt.depth == 2) img.alpha[i] = raw[i * 2 + 1];
+    }
+    return img;
+}
+
+std::vector<uint8_t> encodePam(const ImageBuffer& rgba, const StreamFormat& fmt) {
+    std::vector<uint8_t> out(fmt.frameBytes());
+    const uint8_t* src = rgba.data.data();
+    uint8_t* dst = out.data();
+    for (size_t i = 0; i < rgba.pixelCount(); ++i, src += 4, dst += fmt.depth) {
+        if (fmt.depth >= 3) {
+            std::memcpy(dst, src, fmt.depth);
+        } else {
+            dst[0] = toByte(0.299f * src[0] + 0.587f * src[1] + 0.114f * src[2]);
+            if (fmt.depth == 2) dst[1] = src[3];
+        }
+    }
+    return out;
+}
+
+// Raw frame in, raw frame out; empty on failure
+std::vector<uint8_t> processFrame(const std::vector<uint8_t>& raw, const StreamFormat& fmt,
+                                  const Settings& settings, ResultCache* cache) {
+    ImageBuffer img = fmt.format == Format::Y4M ? decodeY4m(raw, fmt) : decodePam(raw, fmt);
+    std::atomic<bool> cancel{false};
+    ImageBuffer result = cache ? cache->process(img, settings, cancel)
+                               : ImageProcessor::processImage(img, settings, cancel);
+    if (result.width != fmt.width || result.height != fmt.height) return {};
+    ImageProcessor::toRGBA(result);
+    return fmt.format == Format::Y4M ? encodeY4m(result, fmt) : encodePam(result, fmt);
+}
+
+bool writeFrame(FILE* out, const StreamFormat& fmt, const std::vector<uint8_t>& frame) {
+    const std::string& header = fmt.format == Format::Y4M ? std::string("FRAME\n") : fmt.pamHeader;
+    return std::fwrite(header.data(), 1, header.size(), out) == header.size() &&
+           std::fwrite(frame.data(), 1, frame.size(), out) == frame.size();
+}
+
+} // namespace
+
+namespace VideoStream {
+
+Settings settingsAt(const std::vector<Keyframe>& keyframes, int frame) {
+    if (keyframes.empty()) return Settings{};
+    auto next = std::upper_bound(keyframes.begin(), keyframes.end(), frame,
+                                 [](int f, const Keyframe& k) { return f < k.frame; });
+    if (next == keyframes.begin()) return next->settings;
+    if (next == keyframes.end()) return keyframes.back().settings;
+
+    const Keyframe& a = *(next - 1);
+    const Keyframe& b = *next;
+    const float t = static_cast<float>(frame - a.frame) / static_cast<float>(b.frame - a.frame);
+    Settings s = a.settings;
+    for (int Settings::* field : LERP_FIELDS) {
+        const float from = static_cast<float>(a.settings.*field);
+        const float to = static_cast<float>(b.settings.*field);
+        s.*field = static_cast<int>(std::lround(from + (to - from) * t));
+    }
+    return s;
+}
+
+bool run(FILE* in, FILE* out, const Options& options, int* framesWritten) {
+    if (framesWritten) *framesWritten = 0;
+    FrameReader reader(in);
+    if (!reader.open()) return false;
+    const StreamFormat& fmt = reader.format();
+
+    if (fmt.format == Format::Y4M) {
+        const std::string header = fmt.y4mHeader + "\n";
+        if (std::fwrite(header.data(), 1, header.size(), out) != header.size()) return false;
+    }
+
+    ThreadPool& pool = options.pool ? *options.pool : ThreadPool::shared();
+    const size_t maxInFlight = options.framesInFlight > 0
+        ? static_cast<size_t>(options.framesInFlight) : pool.size() * size_t(2);
+
+    // Frames are read ahead of the writer by at most maxInFlight
+    std::deque<std::future<std::vector<uint8_t>>> inFlight;
+    int submitted = 0;
+    int written = 0;
+    bool reading = true;
+    bool inputOk = true;
+    bool ok = true;
+    while (ok) {
+        while (reading && inFlight.size() < maxInFlight) {
+            std::vector<uint8_t> raw;
+            const int status = reader.next(raw);
+            if (status <= 0) {
+                reading = false;
+                inputOk = status == 0;
+                break;
+            }
+            const Settings settings =
+                Animation::frameSettings(settingsAt(options.keyframes, submitted), submitted);
+            inFlight.push_back(pool.submit([&fmt, raw = std::move(raw), settings, &options] {
+                return processFrame(raw, fmt, settings, options.cache);
+            }));
+            ++submitted;
+        }
+        if (inFlight.empty()) break;
+
+        std::vector<uint8_t> frame;
+        try {
+            frame = inFlight.front().get();
+        } catch (...) {
+            ok = false;
+        }
+        inFlight.pop_front();
+        ok = ok && !frame.empty() && writeFrame(out, fmt, frame);
+        if (ok) ++written;
+    }
+    // Workers reference the stream format: wait for stragglers
+    for (auto& f : inFlight) f.wait();
+
+    if (framesWritten) *framesWritten = written;
+    ok = std::fflush(out) == 0 && ok;
+    return ok && inputOk;
+}
+
+} // namespace VideoStream
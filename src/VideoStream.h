@@ -0,0 +1,49 @@
+#pragma once
+
+#include "ImageProcessor.h"
+
+#include <cstdio>
+#include <vector>
+
+class ResultCache;
+class ThreadPool;
+
+// ---------------------------------------------------------------------------
+// VideoStream - raw video through the effect chain, stdin to stdout style
+//
+// Reads YUV4MPEG2 (8-bit 4:2:0, 4:2:2, 4:4:4 or mono) or a sequence of PAM
+// images (MAXVAL 255, DEPTH 1-4) and writes the processed frames in the same
+// format, e.g.
+//
+//   ffmpeg -i in.mp4 -f yuv4mpegpipe - | shakalnost --stream | ffmpeg -i - out.mp4
+//
+// Frames are read in order, processed on a ThreadPool with a bounded number
+// in flight and written in order, so memory stays fixed however long the
+// stream runs.
+// ---------------------------------------------------------------------------
+
+namespace VideoStream {
+
+struct Keyframe {
+    int frame = 0;
+    Settings settings;
+};
+
+struct Options {
+    std::vector<Keyframe> keyframes;  // sorted by frame; empty = default Settings
+    int framesInFlight = 0;           // 0 = two per worker
+    ThreadPool* pool = nullptr;       // nullptr = ThreadPool::shared()
+    ResultCache* cache = nullptr;     // if set, repeated frames are processed once
+};
+
+// Settings for `frame`. Effect strengths are interpolated linearly between
+// the surrounding keyframes; switches, modes and seeds come from the earlier
+// one. Before the first / after the last keyframe it holds.
+Settings settingsAt(const std::vector<Keyframe>& keyframes, int frame);
+
+// Process frames from `in` until end of stream. False on unsupported or
+// malformed input, a truncated frame or a write error; frames before the
+// failure have been written. `framesWritten` receives the count either way.
+bool run(FILE* in, FILE* out, const Options& options, int* framesWritten = nullptr);
+
+} // namespace VideoStream
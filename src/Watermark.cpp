@@ -0,0 +1,209 @@
+#include "Watermark.h"
+#include "Kernels.h"
+#include "WatermarkFont.h"
+
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <mutex>
+
+namespace {
+
+using WatermarkFont::Glyph;
+
+constexpr size_t CACHE_ENTRIES = 16;
+
+const Glyph* findGlyph(uint32_t codepoint) {
+    const Glyph* begin = std::begin(WatermarkFont::GLYPHS);
+    const Glyph* end = std::end(WatermarkFont::GLYPHS);
+    const Glyph* it = std::lower_bound(begin, end, codepoint, [](const Glyph& g, uint32_t cp) {
+        return g.codepoint < cp;
+    });
+    return it != end && it->codepoint == codepoint ? it : nullptr;
+}
+
+// Code points of UTF-8 `text`; malformed bytes come out as U+FFFD
+std::vector<uint32_t> decodeUtf8(const std::string& text) {
+    std::vector<uint32_t> out;
+    for (size_t i = 0; i < text.size();) {
+        const uint8_t lead = static_cast<uint8_t>(text[i]);
+        const int extra = lead < 0x80 ? 0 : (lead >> 5) == 0x6 ? 1 : (lead >> 4) == 0xE ? 2
+                        : (lead >> 3) == 0x1E ? 3 : -1;
+        bool ok = extra >= 0 && i + extra < text.size();
+        uint32_t cp = ok ? lead & (0xFF >> (extra ? extra + 2 : 1)) : 0;
+        for (int k = 1; ok && k <= extra; ++k) {
+            const uint8_t cont = static_cast<uint8_t>(text[i + k]);
+            ok = (cont & 0xC0) == 0x80;
+            cp = (cp << 6) | (cont & 0x3F);
+        }
+        out.push_back(ok ? cp : 0xFFFD);
+        i += ok ? extra + 1 : 1;
+    }
+    return out;
+}
+
+// One line of `n` samples resized to `m`: bilinear when growing, box
+// average when shrinking so thin strokes don't drop out
+void resampleLine(const float* src, int n, size_t srcStride, float* dst, int m, size_t dstStride) {
+    const float scale = static_cast<float>(n) / m;
+    for (int i = 0; i < m; ++i) {
+        float v = 0.f;
+        if (m >= n) {
+            float pos = (i + 0.5f) * scale - 0.5f;
+            int i0 = static_cast<int>(std::floor(pos));
+            float f = pos - i0;
+            int a = std::clamp(i0, 0, n - 1), b = std::clamp(i0 + 1, 0, n - 1);
+            v = src[a * srcStride] * (1 - f) + src[b * srcStride] * f;
+        } else {
+            float x0 = i * scale, x1 = (i + 1) * scale;
+            for (int k = static_cast<int>(x0); k < n && k < x1; ++k) {
+                float overlap = std::min(x1, k + 1.f) - std::max(x0, static_cast<float>(k));
+                v += src[k * srcStride] * overlap;
+            }
+            v /= scale;
+        }
+        dst[i * dstStride] = v;
+    }
+}
+
+std::shared_ptr<const Watermark::Mask> buildMask(const std::string& text, int pixelHeight) {
+    auto mask = std::make_shared<Watermark::Mask>();
+
+    // Lay the text out at the font's own size
+    std::vector<const Glyph*> glyphs;
+    for (uint32_t cp : decodeUtf8(text)) {
+        const Glyph* g = findGlyph(cp);
+        if (!g) g = findGlyph('?');
+        glyphs.push_back(g);
+    }
+    int pen = 0, minX = 0, maxX = 0;
+    std::vector<int> penX;
+    for (const Glyph* g : glyphs) {
+        penX.push_back(pen);
+        if (g->width > 0) {
+            minX = std::min(minX, pen + g->left);
+            maxX = std::max(maxX, pen + g->left + g->width);
+        }
+        pen += g->advance;
+    }
+    maxX = std::max(maxX, pen);
+    const int baseW = maxX - minX, baseH = WatermarkFont::CELL_HEIGHT;
+    if (baseW <= 0 || pixelHeight <= 0) return mask;
+
+    std::vector<float> base(static_cast<size_t>(baseW) * baseH, 0.f);
+    for (size_t i = 0; i < glyphs.size(); ++i) {
+        const Glyph& g = *glyphs[i];
+        const char* bits = WatermarkFont::COVERAGE + g.offset;
+        for (int y = 0; y < g.height; ++y) {
+            float* row = &base[static_cast<size_t>(g.top + y) * baseW + penX[i] + g.left - minX];
+            for (int x = 0; x < g.width; ++x, ++bits) {
+                const char c = *bits;
+                const int v = c <= '9' ? c - '0' : c - 'a' + 10;
+                row[x] = std::max(row[x], v * 17.f);
+            }
+        }
+    }
+
+    // Scale rows, then columns
+    const int w = std::max(1, static_cast<int>(std::lround(baseW * static_cast<double>(pixelHeight) / baseH)));
+    const int h = pixelHeight;
+    std::vector<float> wide(static_cast<size_t>(w) * baseH);
+    for (int y = 0; y < baseH; ++y)
+        resampleLine(&base[static_cast<size_t>(y) * baseW], baseW, 1, &wide[static_cast<size_t>(y) * w], w, 1);
+    std::vector<float> scaled(static_cast<size_t>(w) * h);
+    for (int x = 0; x < w; ++x)
+        resampleLine(&wide[x], baseH, w, &scaled[x], h, w);
+
+    mask->width = w;
+    mask->height = h;
+    mask->coverage.resize(scaled.size());
+    for (size_t i = 0; i < scaled.size(); ++i)
+        mask->coverage[i] = static_cast<uint8_t>(std::clamp(std::lround(scaled[i]), 0l, 255l));
+    return mask;
+}
+
+struct CacheEntry {
+    std::string text;
+    int height;
+    std::shared_ptr<const Watermark::Mask> mask;
+};
+
+std::mutex s_cacheMutex;
+std::list<CacheEntry> s_cache;   // most recent first
+
+} // namespace
+
+namespace Watermark {
+
+std::shared_ptr<const Mask> textMask(const std::string& text, int pixelHeight) {
+    {
+        std::lock_guard<std::mutex> lock(s_cacheMutex);
+        for (auto it = s_cache.begin(); it != s_cache.end(); ++it) {
+            if (it->height == pixelHeight && it->text == text) {
+                s_cache.splice(s_cache.begin(), s_cache, it);
+                return it->mask;
+            }
+        }
+    }
+
+    // Rasterize outside the lock; a concurrent miss on the same key just
+    // builds the same mask twice
+    std::shared_ptr<const Mask> mask = buildMask(text, pixelHeight);
+    std::lock_guard<std::mutex> lock(s_cacheMutex);
+    s_cache.push_front({text, pixelHeight, mask});
+    if (s_cache.size() > CACHE_ENTRIES) s_cache.pop_back();
+    return mask;
+}
+
+void apply(ImageBuffer& img, const std::string& text) {
+    if (!img.valid() || text.empty()) return;
+    ImageProcessor::toInterleaved(img);
+
+    // About a twentieth of the short side, shrunk further if the text would
+    // not fit across the image
+    const int w = img.width, h = img.height;
+    int size = std::max(8, std::min(w, h) / 20);
+    std::shared_ptr<const Mask> mask = textMask(text, size);
+    if (mask->width > w - size && mask->width > 0) {
+        size = std::max(4, size * std::max(1, w - size) / mask->width);
+        mask = textMask(text, size);
+    }
+    if (mask->width == 0) return;
+
+    const int margin = size / 2;
+    const int shadow = std::max(1, size / 16);
+    const int x0 = std::max(0, w - margin - mask->width - shadow);
+    const int y0 = std::max(0, h - margin - mask->height - shadow);
+    const Kernels::Table& kernels = Kernels::table();
+    const uint8_t black[3] = {0, 0, 0};
+    const uint8_t white[3] = {255, 255, 255};
+    constexpr int SHADOW_OPACITY = 140;
+    constexpr int TEXT_OPACITY = 220;
+
+    // Shadow pass, then the text itself
+    for (int pass = 0; pass < 2; ++pass) {
+        const int ox = x0 + (pass == 0 ? shadow : 0);
+        const int oy = y0 + (pass == 0 ? shadow : 0);
+        const int cols = std::min(mask->width, w - ox);
+        const int opacity = pass == 0 ? SHADOW_OPACITY : TEXT_OPACITY;
+        if (cols <= 0) continue;
+        for (int my = 0; my < mask->height && oy + my < h; ++my) {
+            const uint8_t* m = &mask->coverage[static_cast<size_t>(my) * mask->width];
+            const size_t at = static_cast<size_t>(oy + my) * w + ox;
+            kernels.blendMask(&img.data[at * img.channels], m, cols, img.channels,
+                              pass == 0 ? black : white, opacity);
+            uint8_t* alpha = img.channels == 4 ? &img.data[at * 4 + 3]
+                           : img.alpha.empty() ? nullptr : &img.alpha[at];
+            if (!alpha) continue;
+            const int stride = img.channels == 4 ? 4 : 1;
+            for (int x = 0; x < cols; ++x) {
+                // Porter-Duff "over" on alpha
+                const int a = (m[x] * opacity + 127) / 255;
+                uint8_t& dst = alpha[x * stride];
+                dst = static_cast<uint8_t>(dst + ((255 - dst) * a + 127) / 255);
+            }
+        }
+    }
+}
+
+} // namespace Watermark
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "ImageProcessor.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Watermark - text stamped into the corner of processed images
+//
+// Text is set in the embedded WatermarkFont (Latin and Cyrillic) and scaled
+// to the requested height once; the resulting coverage mask is kept in a
+// small cache keyed by (text, height), so repeated exports and batch runs
+// rasterize it only once. Stamping blends the mask over the text's bounding
+// box and leaves the rest of the image alone.
+// ---------------------------------------------------------------------------
+
+namespace Watermark {
+
+struct Mask {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> coverage;   // width * height, 0-255
+};
+
+// Coverage of UTF-8 `text` set `pixelHeight` tall (ascent + descent).
+// Characters the font lacks show as '?'. Empty text gives an empty mask.
+std::shared_ptr<const Mask> textMask(const std::string& text, int pixelHeight);
+
+// Stamp `text` in the bottom-right corner, sized to the image: white over a
+// dark drop shadow, raising alpha underneath so it shows on transparency too
+void apply(ImageBuffer& img, const std::string& text);
+
+} // namespace Watermark
@@ -0,0 +1,651 @@
+#pragma once
+
+#include <cstdint>
+
+// ---------------------------------------------------------------------------
+// WatermarkFont - bitmap font for the watermark stage
+//
+// DejaVu Sans Bold rasterized at a 24 px cell (ascent + descent) with 4x4
+// supersampling: printable ASCII, Cyrillic (U+0401, U+0410-U+044F, U+0451)
+// and a few signs (U+00A9, U+00AB, U+00BB, U+2013, U+2014, U+2026, U+2116).
+// Each glyph keeps only its inked rows; COVERAGE holds one hex digit (0-15)
+// per pixel, glyph after glyph, rows top to bottom.
+//
+// DejaVu fonts are derived from Bitstream Vera and are free to embed and
+// modify; see https://dejavu-fonts.github.io/License.html
+// ---------------------------------------------------------------------------
+
+namespace WatermarkFont {
+
+constexpr int CELL_HEIGHT = 24;
+
+struct Glyph {
+    uint16_t codepoint;
+    uint8_t advance;   // pen movement in pixels
+    int8_t left;       // first inked column relative to the pen
+    uint8_t width;
+    uint8_t top;       // first inked row below the cell top
+    uint8_t height;
+    uint32_t offset;   // first pixel in COVERAGE
+};
+
+// Sorted by codepoint
+inline constexpr Glyph GLYPHS[] = {
+    {0x0020, 7, 0, 0, 0, 0, 0},
+    {0x0021, 9, 2, 5, 4, 16, 0},
+    {0x0022, 11, 1, 8, 4, 6, 80},
+    {0x0023, 17, 1, 15, 4, 16, 128},
+    {0x0024, 14, 1, 12, 3, 20, 368},
+    {0x0025, 21, 0, 21, 3, 17, 608},
+    {0x0026, 18, 1, 17, 3, 17, 965},
+    {0x0027, 6, 1, 4, 4, 6, 1254},
+    {0x0028, 9, 1, 7, 3, 19, 1278},
+    {0x0029, 9, 1, 7, 3, 19, 1411},
+    {0x002a, 11, 0, 11, 3, 11, 1544},
+    {0x002b, 17, 2, 14, 6, 14, 1665},
+    {0x002c, 8, 1, 5, 15, 7, 1861},
+    {0x002d, 9, 1, 7, 11, 4, 1896},
+    {0x002e, 8, 2, 4, 15, 5, 1924},
+    {0x002f, 8, 0, 8, 4, 17, 1944},
+    {0x0030, 14, 0, 14, 3, 17, 2080},
+    {0x0031, 14, 2, 11, 4, 16, 2318},
+    {0x0032, 14, 1, 12, 3, 17, 2494},
+    {0x0033, 14, 1, 12, 3, 17, 2698},
+    {0x0034, 14, 0, 14, 4, 16, 2902},
+    {0x0035, 14, 1, 12, 4, 16, 3126},
+    {0x0036, 14, 1, 13, 3, 17, 3318},
+    {0x0037, 14, 1, 12, 4, 16, 3539},
+    {0x0038, 14, 1, 13, 3, 17, 3731},
+    {0x0039, 14, 1, 13, 3, 17, 3952},
+    {0x003a, 8, 2, 4, 7, 13, 4173},
+    {0x003b, 8, 1, 5, 7, 15, 4225},
+    {0x003c, 17, 2, 14, 7, 12, 4300},
+    {0x003d, 17, 2, 14, 9, 8, 4468},
+    {0x003e, 17, 2, 14, 7, 12, 4580},
+    {0x003f, 12, 1, 10, 3, 17, 4748},
+    {0x0040, 21, 1, 19, 4, 19, 4918},
+    {0x0041, 16, 0, 16, 4, 16, 5279},
+    {0x0042, 16, 1, 14, 4, 16, 5535},
+    {0x0043, 15, 1, 13, 3, 17, 5759},
+    {0x0044, 17, 1, 16, 4, 16, 5980},
+    {0x0045, 14, 1, 12, 4, 16, 6236},
+    {0x0046, 14, 1, 12, 4, 16, 6428},
+    {0x0047, 17, 1, 15, 3, 17, 6620},
+    {0x0048, 17, 1, 15, 4, 16, 6875},
+    {0x0049, 8, 1, 5, 4, 16, 7115},
+    {0x004a, 8, -2, 8, 4, 20, 7195},
+    {0x004b, 16, 1, 16, 4, 16, 7355},
+    {0x004c, 13, 1, 12, 4, 16, 7611},
+    {0x004d, 21, 1, 18, 4, 16, 7803},
+    {0x004e, 17, 1, 15, 4, 16, 8091},
+    {0x004f, 18, 1, 16, 3, 17, 8331},
+    {0x0050, 15, 1, 14, 4, 16, 8603},
+    {0x0051, 18, 1, 16, 3, 20, 8827},
+    {0x0052, 16, 1, 15, 4, 16, 9147},
+    {0x0053, 15, 1, 13, 3, 17, 9387},
+    {0x0054, 14, 0, 14, 4, 16, 9608},
+    {0x0055, 17, 1, 14, 4, 16, 9832},
+    {0x0056, 16, 0, 16, 4, 16, 10056},
+    {0x0057, 23, 0, 23, 4, 16, 10312},
+    {0x0058, 16, 0, 16, 4, 16, 10680},
+    {0x0059, 15, -1, 17, 4, 16, 10936},
+    {0x005a, 15, 0, 15, 4, 16, 11208},
+    {0x005b, 9, 1, 8, 3, 19, 11448},
+    {0x005c, 8, 0, 8, 4, 17, 11600},
+    {0x005d, 9, 1, 7, 3, 19, 11736},
+    {0x005e, 17, 2, 14, 4, 6, 11869},
+    {0x005f, 10, 0, 11, 22, 2, 11953},
+    {0x0060, 10, 0, 7, 2, 5, 11975},
+    {0x0061, 14, 0, 13, 7, 13, 12010},
+    {0x0062, 15, 1, 13, 3, 17, 12179},
+    {0x0063, 12, 0, 11, 7, 13, 12400},
+    {0x0064, 15, 0, 14, 3, 17, 12543},
+    {0x0065, 14, 0, 13, 7, 13, 12781},
+    {0x0066, 9, 0, 10, 3, 17, 12950},
+    {0x0067, 15, 0, 14, 7, 17, 13120},
+    {0x0068, 15, 1, 13, 3, 17, 13358},
+    {0x0069, 7, 1, 5, 3, 17, 13579},
+    {0x006a, 7, -1, 7, 3, 21, 13664},
+    {0x006b, 14, 1, 14, 3, 17, 13811},
+    {0x006c, 7, 1, 5, 3, 17, 14049},
+    {0x006d, 21, 1, 19, 7, 13, 14134},
+    {0x006e, 15, 1, 13, 7, 13, 14381},
+    {0x006f, 14, 0, 14, 7, 13, 14550},
+    {0x0070, 15, 1, 13, 7, 17, 14732},
+    {0x0071, 15, 0, 14, 7, 17, 14953},
+    {0x0072, 10, 1, 10, 7, 13, 15191},
+    {0x0073, 12, 1, 11, 7, 13, 15321},
+    {0x0074, 10, 0, 10, 4, 16, 15464},
+    {0x0075, 15, 1, 12, 7, 13, 15624},
+    {0x0076, 13, 0, 14, 7, 13, 15780},
+    {0x0077, 19, 0, 19, 7, 13, 15962},
+    {0x0078, 13, 0, 13, 7, 13, 16209},
+    {0x0079, 13, 0, 14, 7, 17, 16378},
+    {0x007a, 12, 0, 12, 7, 13, 16616},
+    {0x007b, 15, 2, 11, 3, 20, 16772},
+    {0x007c, 8, 2, 3, 3, 21, 16992},
+    {0x007d, 15, 2, 11, 3, 20, 17055},
+    {0x007e, 17, 2, 14, 10, 5, 17275},
+    {0x00a9, 21, 2, 16, 4, 16, 32713},
+    {0x00ab, 13, 1, 11, 8, 10, 32969},
+    {0x00bb, 13, 1, 11, 8, 10, 33079},
+    {0x0401, 14, 1, 12, 0, 20, 17345},
+    {0x0410, 16, 0, 16, 4, 16, 17585},
+    {0x0411, 16, 1, 14, 4, 16, 17841},
+    {0x0412, 16, 1, 14, 4, 16, 18065},
+    {0x0413, 13, 1, 12, 4, 16, 18289},
+    {0x0414, 18, 1, 17, 4, 19, 18481},
+    {0x0415, 14, 1, 12, 4, 16, 18804},
+    {0x0416, 25, 0, 25, 4, 16, 18996},
+    {0x0417, 15, 1, 13, 3, 17, 19396},
+    {0x0418, 17, 1, 15, 4, 16, 19617},
+    {0x0419, 17, 1, 15, 0, 20, 19857},
+    {0x041a, 17, 1, 16, 4, 16, 20157},
+    {0x041b, 17, 0, 16, 4, 16, 20413},
+    {0x041c, 21, 1, 18, 4, 16, 20669},
+    {0x041d, 17, 1, 15, 4, 16, 20957},
+    {0x041e, 18, 1, 16, 3, 17, 21197},
+    {0x041f, 17, 1, 15, 4, 16, 21469},
+    {0x0420, 15, 1, 14, 4, 16, 21709},
+    {0x0421, 15, 1, 13, 3, 17, 21933},
+    {0x0422, 14, 0, 14, 4, 16, 22154},
+    {0x0423, 16, 0, 16, 4, 16, 22378},
+    {0x0424, 20, 1, 19, 4, 16, 22634},
+    {0x0425, 16, 0, 16, 4, 16, 22938},
+    {0x0426, 19, 1, 17, 4, 19, 23194},
+    {0x0427, 17, 1, 14, 4, 16, 23517},
+    {0x0428, 25, 1, 23, 4, 16, 23741},
+    {0x0429, 27, 1, 26, 4, 19, 24109},
+    {0x042a, 19, 1, 18, 4, 16, 24603},
+    {0x042b, 21, 1, 19, 4, 16, 24891},
+    {0x042c, 16, 1, 14, 4, 16, 25195},
+    {0x042d, 15, 1, 14, 3, 17, 25419},
+    {0x042e, 24, 1, 23, 3, 17, 25657},
+    {0x042f, 16, 1, 13, 4, 16, 26048},
+    {0x0430, 14, 0, 13, 7, 13, 26256},
+    {0x0431, 14, 0, 14, 3, 17, 26425},
+    {0x0432, 13, 1, 12, 7, 13, 26663},
+    {0x0433, 11, 1, 10, 7, 13, 26819},
+    {0x0434, 17, 1, 15, 7, 15, 26949},
+    {0x0435, 14, 0, 13, 7, 13, 27174},
+    {0x0436, 21, 0, 21, 7, 13, 27343},
+    {0x0437, 12, 1, 10, 7, 13, 27616},
+    {0x0438, 14, 1, 12, 7, 13, 27746},
+    {0x0439, 14, 1, 12, 3, 17, 27902},
+    {0x043a, 14, 1, 13, 7, 13, 28106},
+    {0x043b, 15, 1, 13, 7, 13, 28275},
+    {0x043c, 17, 1, 15, 7, 13, 28444},
+    {0x043d, 14, 1, 12, 7, 13, 28639},
+    {0x043e, 14, 0, 14, 7, 13, 28795},
+    {0x043f, 14, 1, 12, 7, 13, 28977},
+    {0x0440, 15, 1, 13, 7, 17, 29133},
+    {0x0441, 12, 0, 11, 7, 13, 29354},
+    {0x0442, 12, 0, 12, 7, 13, 29497},
+    {0x0443, 13, 0, 14, 7, 17, 29653},
+    {0x0444, 20, 1, 19, 3, 21, 29891},
+    {0x0445, 13, 0, 13, 7, 13, 30290},
+    {0x0446, 15, 1, 14, 7, 15, 30459},
+    {0x0447, 14, 1, 11, 7, 13, 30669},
+    {0x0448, 22, 1, 20, 7, 13, 30812},
+    {0x0449, 23, 1, 21, 7, 15, 31072},
+    {0x044a, 15, 0, 15, 7, 13, 31387},
+    {0x044b, 19, 1, 16, 7, 13, 31582},
+    {0x044c, 13, 1, 12, 7, 13, 31790},
+    {0x044d, 12, 1, 11, 7, 13, 31946},
+    {0x044e, 20, 1, 19, 7, 13, 32089},
+    {0x044f, 13, 0, 12, 7, 13, 32336},
+    {0x0451, 14, 0, 13, 3, 17, 32492},
+    {0x2013, 10, 1, 9, 12, 3, 33189},
+    {0x2014, 21, 1, 19, 12, 3, 33216},
+    {0x2026, 21, 1, 18, 15, 5, 33273},
+    {0x2116, 25, 0, 24, 4, 16, 33363},
+};
+
+inline constexpr char COVERAGE[] =
+    "0fff70fff70fff70fff70fff70fff70fff70eff30bff30aff000000077730fff70fff70fff70"
+    "33310ff307fb0ff307fb0ff307fb0ff307fb0ff307fb0bb205b8000001bb002bb00000005fd0"
+    "06fb00000009f900af70000000df500ef30005bbbffcbbffbbb07fffffffffffff0133bfa33c"
+    "f93330000df500ff30000001ff103ff00007ffffffffffffb07ffffffffffffb0133ef733ff6"
+    "3320001ff102ff00000005fd006fb00000009f900af700000002310023000000000005700000"
+    "00000bf0000000001cf30000007efffffea00bfffffffff02fff5bf036c05ffc0bf000003fff"
+    "7cf000000effffffb60002dfffffffd100047efffff900000bf09ffe00000bf03fff3e953cf3"
+    "bffa3fffffffffe207bfffffe91000000cf0000000000bf0000000000bf00000000002300000"
+    "000030000000003300000009fffd2000007fb000000bfe8cfe10001ef1000001ff500ff7000a"
+    "f70000003ff300cfb003fd00000003ff300cfa00df400000001ff701ff607fb0000000008ffb"
+    "dfe01ff100000000007dffa10bf7018bb8000000000004fd02effffe1000000000df40afd00e"
+    "fa000000007fb00ff7008ff00000001ff100ff7007ff0000000bf7000ef900afd0000004fd00"
+    "008ff56ff7000000df400000bffff9000000276000000026620000000001300000000000009f"
+    "ffffb100000000cfffffff300000005fffa348d300000007fff00000000000005fff70000000"
+    "000000efff500000000000cfffff30008bb400cffeeffe200dff305fff22effe21fff00affc0"
+    "05fffdaff900bffb0005ffffff2009fff20006ffff70004fffe533affff900009fffffffffff"
+    "f900007efffffb3afff90000036741000333300ff30ff30ff30ff30ff30bb20002774000cff3"
+    "005ffc000dff5002fff0008ffb000dff7000fff4003fff3003fff3003fff3000fff3000eff70"
+    "00affa0005ffe0000eff40007ff90000eff10005bb617750000dff30005ffb0000eff30009ff"
+    "90004fff0000fff3000fff7000bff7000bffb000bff9000dff7000fff5003fff1008ffc000df"
+    "f5003ffe0009ff6000bba0000000130000000007f3000005007f300405fc37f35df107efefef"
+    "d50000afff700002bfffff9104fe78f59ff109107f3028000007f3000000003710000000005b"
+    "8000000000007fb000000000007fb000000000007fb000000000007fb00000057777bfd77777"
+    "0bffffffffffff08bbbbdfebbbbb0000007fb000000000007fb000000000007fb00000000000"
+    "7fb000000000007fb000000000001320000000bbb80fffb0fffb0fff82ffd07ff30bf8003333"
+    "331ffffff7ffffff7bbbbbb5bbb8fffbfffbfffb333200000cf500001ff100006fc00000cf60"
+    "0000ff100005fd00000af800000ff200004fd000009f900000ef400004fe000008f900000df5"
+    "00002ff000008fa00000cf5000000000001300000000009efffb3000002efffffff50000cfff"
+    "97dfff2005fff7001fff9009fff1000bfff00cfff00009fff30fffe00007fff30fffb00007ff"
+    "f30fffd00007fff30efff00008fff30bfff0000bfff006fff5000effc000effe43afff40004f"
+    "fffffff9000004dfffff700000000367300000269cfff7000bffffff7000bffdfff70004303f"
+    "ff70000003fff70000003fff70000003fff70000003fff70000003fff70000003fff70000003"
+    "fff70000003fff70003779fffb7777ffffffffff7ffffffffff1333333333300000320000008"
+    "bfffffb3003fffffffff503ffa77dffff13700000cfff500000007fff700000008fff4000000"
+    "0effd0000000cffe2000002effe2000003effe2000005fffc1000006fffc0000003ffffcbbbb"
+    "b53ffffffffff73ffffffffff703333333333100001310000009dfffffc5000fffffffff900f"
+    "c877cffff20100000bfff300000007fff30000002effd0000bbefffa10000ffffff910000bbb"
+    "efffe000000009fff600000003fffb00000005fffa7c73337efff57fffffffffc05fffffffe7"
+    "000034774300000000004ffff300000000effff30000000afffff30000004ffdfff3000000ef"
+    "b7fff300000afe17fff300004ff607fff30000efb007fff3000afe1007fff3000ffc777bfff9"
+    "730ffffffffffff70ffffffffffff70777777bfff97300000007fff30000000007fff3000000"
+    "00013330000bffffffffb00bffffffffb00bffffffffb00bff300000000bff300000000bffcf"
+    "fd93000bffffffff500bfcbbeffff304100009fffa00000000fffd00000000fffe31000003ff"
+    "fb7fa5337efff67fffffffffc03cffffffe700000357630000000000030000000019effffa10"
+    "005ffffffff3003fffe8779e300dffd000000002fff5000000007fff28bb93000afffffffffa"
+    "00bffffdbefff80bfffd000dfff09fff70008fff36fff70007fff32fff80009fff00bffe303e"
+    "ffb001efffffffe20002bfffffb20000002574100007ffffffffffb7ffffffffffb7ffffffff"
+    "ff900000009fff10000001fffa00000007fff30000000effb00000006fff50000000dffd0000"
+    "0005fff50000000cffe00000003fff70000000bfff00000002fff900000009fff10000000333"
+    "20000000000023000000007dffffe910009ffffffffe102fffe53afff806fff4000fffb04fff"
+    "3000fffa00effc107fff3002bffffffe500008efffffa2000cffe77bfff307fff2000dffd0bf"
+    "ff00008fff0bfff0000afff06fff9006fffc00efffffffff4001bffffffd4000001377420000"
+    "0000020000000004cfffe9100008fffffffe2003fffc45effc00afff0005fff50effb0001fff"
+    "a0fffc0002fffd0bfff1005ffff05fffd78effff00affffffffff0007dffe9cffd000000000e"
+    "ff9000000006fff300c63038fffb000ffffffffc0000effffff9000000247730000002333bff"
+    "fbfffbfff8bbb0000000000008bbbbfffbfffbfff2333023330bfff0bfff0bfff08bbb000000"
+    "00000000008bbb0bfff0bfff0bffc0fff24ff708fc00000000000029e0000000018dfff00000"
+    "06cffffd80005affffe820007efffe94000000bffd4000000000bfffe93000000005affffd82"
+    "000000006cffffd82000000017dffff000000000029ef0000000000000408bbbbbbbbbbbb0bf"
+    "fffffffffff0577777777777700000000000000023333333333330bffffffffffff0bfffffff"
+    "fffff023333333333330ba500000000000bffe93000000005cffffd82000000016cffffc6100"
+    "0000028dffffa0000000002bfff000000016dffff000016cffffc60016cffffd810000bfffe9"
+    "30000000bfa400000000003000000000000000003100003aeffff9107fffffffe07fc77dfff6"
+    "430001fff7000001fff700000afff30000bfff80000bfff900004fff9000007fff3000000000"
+    "00000037771000007fff3000007fff3000007fff300000133300000000000133320000000000"
+    "007dfffffd7000000002dffc878bffe2000002efa1000001afe20001ef50000000005fe0009f"
+    "80007bb537308f701fe000cffffdf701fd05f8007fe309ff700cf07f400cf8000df700bf3af3"
+    "00ff5000bf700bf08f300ef7000bf700fd07f700afb002ff70af702fc003ffdaeffddfc000df"
+    "4005effc8ffe700004fe200033013200000009fe300000006600000009ffb63337dfe0000000"
+    "04dfffffffb3000000000047bba72000000000006ffff60000000000dffffc0000000002ffff"
+    "ff2000000009ffffff800000000effaaffd00000005fff55fff4000000affe00fff9000000ff"
+    "f900afff000006fff4005fff50000cfff7778fffc0002ffffffffffff1008ffffffffffff700"
+    "effd777777effd04fff80000009fff39fff20000004fff933330000000033320ffffffdb9500"
+    "00ffffffffffb000fffebbcffff500fffb0006fff900fffb0003fff900fffb001afff500ffff"
+    "ffffff8000fffffffffe7000fffd778dfff800fffb0000dfff00fffb00009fff30fffb0000df"
+    "ff30fffd777cfffe00fffffffffff500fffffffffa3000333333200000000000002300000000"
+    "7dffffd92004effffffffb04fffffbbbefb0efffa00000496fffc00000000bfff500000000ef"
+    "ff100000000ffff000000000ffff000000000bfff4000000008fffa000000001ffff50000005"
+    "07ffffc777afb009fffffffffb0003cffffffd600000137742000fffffcbb73000000fffffff"
+    "fffc20000fffffffffffe2000fffb0025dfffe000fffb00000dfff600fffb000005fffc00fff"
+    "b000000ffff00fffb000000ffff00fffb000000ffff00fffb000004fffd00fffb00000bfff80"
+    "0fffb0002bffff100fffebbefffff5000ffffffffffe50000ffffffffb700000033333000000"
+    "00000ffffffffff30ffffffffff30ffffffffff30fffb00000000fffb00000000fffc3333330"
+    "0ffffffffff00ffffffffff00fffebbbbbb00fffb00000000fffb00000000fffb00000000fff"
+    "ebbbbbb50ffffffffff70ffffffffff70333333333310ffffffffff30ffffffffff30fffffff"
+    "fff30fffb00000000fffb00000000fffc33333300ffffffffff00ffffffffff00fffebbbbbb0"
+    "0fffb00000000fffb00000000fffb00000000fffb00000000fffb00000000fffb00000000333"
+    "2000000000000002310000000007cfffffc820004efffffffffb004fffffbbbcffb00efffb10"
+    "00005906fffc0000000000bfff50000000000efff10002333331ffff0000bfffff7ffff0000b"
+    "fffff7bfff4000579fff78fffa000003fff71ffff600003fff707ffffc777afff7009fffffff"
+    "ffff70003cfffffffc500000013775300000fffb000007fff30fffb000007fff30fffb000007"
+    "fff30fffb000007fff30fffb000007fff30fffc333339fff30fffffffffffff30fffffffffff"
+    "ff30fffebbbbbdfff30fffb000007fff30fffb000007fff30fffb000007fff30fffb000007ff"
+    "f30fffb000007fff30fffb000007fff30333200000133300fffb0fffb0fffb0fffb0fffb0fff"
+    "b0fffb0fffb0fffb0fffb0fffb0fffb0fffb0fffb0fffb033320000fffb0000fffb0000fffb0"
+    "000fffb0000fffb0000fffb0000fffb0000fffb0000fffb0000fffb0000fffb0000fffb0000f"
+    "ffb0000fffb0003fffb000afff82bdffff33fffff903fffd500033100000fffb00002efff500"
+    "fffb0002efff5000fffb002efff50000fffb02efff500000fffb2efff5000000fffdefff5000"
+    "0000fffffff500000000ffffffd000000000fffffffc00000000fffccfffc0000000fffb0cff"
+    "fc000000fffb00cfffc00000fffb000cfffc0000fffb0000cfffc000fffb00000cfffc003332"
+    "000000333310fffb00000000fffb00000000fffb00000000fffb00000000fffb00000000fffb"
+    "00000000fffb00000000fffb00000000fffb00000000fffb00000000fffb00000000fffb0000"
+    "0000fffebbbbbb50ffffffffff70ffffffffff70333333333310ffffe0000007ffff70fffff5"
+    "00000dffff70fffffd00005fffff70ffffff3000bfffff70fffbffa002ffcfff70fff7dff109"
+    "ff5fff70fff75ff80ffe0fff70fff70efe8ff70fff70fff708fffff10fff70fff701ffff900f"
+    "ff70fff700bfff300fff70fff7004ffc000fff70fff7000331000fff70fff7000000000fff70"
+    "fff7000000000fff70333100000000033310ffff600003fff30ffffe00003fff30fffff70003"
+    "fff30fffffe0003fff30ffffff7003fff30fff9fff103fff30fff77ff903fff30fff70eff13f"
+    "ff30fff707ff93fff30fff700eff7fff30fff7005ffefff30fff7000dfffff30fff70005ffff"
+    "f30fff70000dffff30fff700003ffff3033310000033330000000032000000000019effffc60"
+    "000006fffffffffc10005ffffdbbffffd001efff60001cfff906fffa000001fffe0bfff40000"
+    "00cfff3efff00000008fff7ffff00000007fff7ffff00000007fff7bfff3000000afff48fff8"
+    "000000efff12ffff200009fffb008ffff977bfffe2000afffffffffe5000006dffffffa10000"
+    "0000247630000000fffffffba50000ffffffffffc000fffffffffff900fffb0006ffff00fffb"
+    "0000cfff30fffb0000cfff30fffb0005ffff00fffffffffff900ffffffffffc000fffffffca5"
+    "0000fffb0000000000fffb0000000000fffb0000000000fffb0000000000fffb000000000033"
+    "32000000000000000032000000000019effffc60000006fffffffffc20005ffffdbbffffe001"
+    "efff60001cfff906fffa000001ffff0bfff4000000cfff3efff00000008fff7ffff00000007f"
+    "ff7ffff00000007fff7bfff3000000afff48fff8000000efff02fffe200009fff9008fffe877"
+    "bfffe1000afffffffffe2000005dffffffb100000000237cffc0000000000000cffc00000000"
+    "00000cffb0000000000001333000ffffffdb9300000ffffffffff90000fffffffffff2000fff"
+    "b000afff7000fffb0004fff7000fffb0005fff5000fffc335effe0000fffffffffb20000ffff"
+    "ffffe700000fffd77dfff80000fffb000efff1000fffb0007fff9000fffb0000efff100fffb0"
+    "0007fff900fffb00000efff10333200000233310000023000000004cfffffc91008fffffffff"
+    "301ffffbbbcff306fff2000005207fff0000000006fffc520000001effffffb600005effffff"
+    "fe200017cffffffd000000038ffff3000000008fff3670000008fff37ffb7779ffff07ffffff"
+    "ffff7029effffffe7000002377530000ffffffffffffffffffffffffffffffffffffffffff00"
+    "000ffff0000000000ffff0000000000ffff0000000000ffff0000000000ffff0000000000fff"
+    "f0000000000ffff0000000000ffff0000000000ffff0000000000ffff0000000000ffff00000"
+    "00000ffff00000000003333000000fffb00000fffb0fffb00000fffb0fffb00000fffb0fffb0"
+    "0000fffb0fffb00000fffb0fffb00000fffb0fffb00000fffb0fffb00000fffb0fffb00000ff"
+    "fb0fffb00000fffb0fffd00001fffb0cfff30007fff806fffe879ffff200cfffffffff800008"
+    "ffffffe60000000367530000bfff10000002fffa5fff70000008fff50effd000000dffe009ff"
+    "f200003fff9004fff800009fff2000dffe0000effd00008fff4005fff700001fff900afff100"
+    "000cfff00fffb0000005fff55fff50000000fffacffe00000000affffff9000000004ffffff4"
+    "000000000effffd00000000008ffff80000000000033330000004fff600008fff40000afff00"
+    "fffa0000cfff80000effb00cffd0000ffffc0002fff7008fff1004ffeff0005fff4004fff500"
+    "7ff9ff3009fff0001fff900bfe3ff700dffc0000dffd00ffa0ffb01fff800009fff03ff60bff"
+    "04fff500005fff47ff307ff38fff100001fff8aff003ff6cffd000000effcefb000ffbfff900"
+    "0000afffff7000bfffff60000006fffff30008fffff20000002fffff00004ffffe00000000ef"
+    "ffc00000ffffa0000000023332000003333100002fffd000001effe006fff80000bfff4000bf"
+    "ff3006fffa00001effd01effe0000006fff9bfff30000000bffffff8000000001effffd00000"
+    "000009ffff60000000001effffe000000000bffffffa00000006fff8bfff4000002fffd01eff"
+    "e00000cfff3004fffa0007fff80000afff402fffd000000effe113331000000133310dfff300"
+    "0005fffd003fffd00000efff30009fff8000afff800000efff303fffd0000004fffc0dfff300"
+    "00000afffdfff8000000000efffffd00000000004fffff300000000000afff90000000000007"
+    "fff70000000000007fff70000000000007fff70000000000007fff70000000000007fff70000"
+    "000000007fff7000000000000133310000000bfffffffffffb00bfffffffffffb00bffffffff"
+    "fffa0000000005fffc0000000002fffe2000000001efff4000000000cfff6000000000afff90"
+    "000000008fffc0000000005fffd0000000002effe2000000000efff4000000000cfffebbbbbb"
+    "bb00fffffffffffff00fffffffffffff0033333333333330177777703ffffff03fffcbb03fff"
+    "30003fff30003fff30003fff30003fff30003fff30003fff30003fff30003fff30003fff3000"
+    "3fff30003fff30003fff30003fff97703ffffff02bbbbbb0df5000008f9000003fe000000ef4"
+    "000009f9000004fd000000ff200000af8000005fd000000ff200000bf6000006fc000001ff10"
+    "0000cf6000007fa000002ff000000df537777757fffffb5bbeffb000bffb000bffb000bffb00"
+    "0bffb000bffb000bffb000bffb000bffb000bffb000bffb000bffb000bffb000bffb377dffb7"
+    "fffffb5bbbbb800000cff3000000000cfffe20000000cffdffe200000cff704efe2000cfe300"
+    "01cfe205ba00000007b90ffffffffff3ffffffffff3023300002ef600002ef200004fd000004"
+    "73000235753000002fffffffe70003fffffffff7003940002cffe0000000004fff3004aeffff"
+    "fff305ffffffffff30effe4003fff30fff70008fff30fffc005ffff30bffffffcfff300cffff"
+    "93fff3000376200333017771000000003fff3000000003fff3000000003fff3000000003fff3"
+    "015620003fff39ffffa003fffcffffffa03ffff834efff33fffb0003fff93fff60000fffb3ff"
+    "f30000fffb3fff60000fffb3fffb0003fff93ffff734efff33fffcffffffa03fff49ffffa000"
+    "333002662000000003574200007efffffa009fffffffb05fffe533690dfff2000000fffb0000"
+    "000fffb0000000fffb0000000dfff20000006fffe5336900bfffffffb0007efffffb00000367"
+    "520000000000377700000000007fff00000000007fff00000000007fff00000364007fff0002"
+    "cfffe57fff000dffffffcfff007fffc33affff00cfff0000efff00fffb0000bfff00fffb0000"
+    "7fff00fffb0000afff00cffe0000efff007fffc33affff000dffffffcfff0002cffff57fff00"
+    "000375101333000000366300000007effffe70000bffffffff9006fff8006fff50dffc0000cf"
+    "fa0fffebbbbeffe0ffffffffffff0fffb777777770dffc0000000107fff910026d700cffffff"
+    "fff70007effffffc300000367530000000477771000cfffff3008fffebb200bffd000013cffc"
+    "33207fffffffb07fffffffb037dffd775000bffb000000bffb000000bffb000000bffb000000"
+    "bffb000000bffb000000bffb000000bffb0000002332000000002530013330001cfffe57fff0"
+    "00dffffffcfff007fffc43bffff00dffe0000efff00fffb0000afff00fffb00007fff00fffb0"
+    "000bfff00cfff2001ffff005fffe88effff000afffffeafff00008effb29fff0000001000dff"
+    "d0007400009fff7000bffbbffffc0000bfffffffa0000003777751000017771000000003fff3"
+    "000000003fff3000000003fff3000000003fff3015620003fff38ffffb003fffcffffff703ff"
+    "ffa47fffd03fffb000afff03fff60007fff03fff30007fff03fff30007fff03fff30007fff03"
+    "fff30007fff03fff30007fff03fff30007fff00333000013330177713fff33fff31777103330"
+    "3fff33fff33fff33fff33fff33fff33fff33fff33fff33fff33fff3033300017771003fff300"
+    "3fff300177710003330003fff3003fff3003fff3003fff3003fff3003fff3003fff3003fff30"
+    "03fff3003fff3003fff3003fff3008fff28cfffd0bfffe205776000177710000000003fff300"
+    "00000003fff30000000003fff30000000003fff30001333203fff3002effc203fff302effc00"
+    "03fff32effc00003fff6effc000003ffffff90000003ffffff90000003fffcfff9000003fff3"
+    "9fff900003fff30afff90003fff300cfff8003fff3000cfff5003330000033330177713fff33"
+    "fff33fff33fff33fff33fff33fff33fff33fff33fff33fff33fff33fff33fff33fff30333003"
+    "330026400002651003fff4afffe509ffff803fffcfffffeaffffff33ffffa3affffc47fffa3f"
+    "ffb002fffe000dffb3fff6000fffb000bffb3fff3000fff7000bffb3fff3000fff7000bffb3f"
+    "ff3000fff7000bffb3fff3000fff7000bffb3fff3000fff7000bffb3fff3000fff7000bffb03"
+    "3300003331000233203330015620003fff38ffffb003fffcffffff703ffffa47fffd03fffb00"
+    "0afff03fff60007fff03fff30007fff03fff30007fff03fff30007fff03fff30007fff03fff3"
+    "0007fff03fff30007fff00333000013330000003673000000008efffff900000cffffffffc00"
+    "07fffc33afff900dffe0000dfff00fffb00007fff30fffb00007fff30fffb00007fff30dffe0"
+    "000dfff007fffc339fff9000cffffffffc000008ffffff900000000377310000033300156200"
+    "03fff39ffffa003fffcffffffa03ffff834efff33fffb0003fff93fff60000fffb3fff30000f"
+    "ffb3fff60000fffb3fffb0003fff93ffff734efff33fffcffffffa03fff49ffffa003fff3026"
+    "620003fff3000000003fff3000000003fff300000000177710000000000002530013330001cf"
+    "ffe57fff000cffffffcfff007fffc33affff00cfff0000efff00fffb0000bfff00fffb00007f"
+    "ff00fffb0000afff00cffe0000efff007fffc33affff000dffffffcfff0002cffff57fff0000"
+    "0375107fff00000000007fff00000000007fff00000000007fff000000000037770033300156"
+    "03fff38fff03fffbffff03ffffe87a03fffe000003fff8000003fff4000003fff3000003fff3"
+    "000003fff3000003fff3000003fff30000003330000000013673300009fffffff608ffffffff"
+    "70dff70003860eff70000000affffdb72002dfffffff700048bdffff10000004fff39830007f"
+    "ff3bffffffffd09fffffffb2000347741000003332000000fffb000000fffb000023fffc3331"
+    "bffffffff7bffffffff757fffd777300fffb000000fffb000000fffb000000fffb000000fffb"
+    "000000cffe7770007ffffff00009fffff000000133301333000023337fff3000bfff7fff3000"
+    "bfff7fff3000bfff7fff3000bfff7fff3000bfff7fff3000bfff7fff3000bfff4fff5001ffff"
+    "2fffe55cffff0dffffffefff02dfffe5bfff000474002333233300000133306fff10000affd0"
+    "0fff70000fff7009ffd0006fff1003fff200cffa0000dff901fff400006ffe07ffd000001fff"
+    "4dff8000000affcfff10000004fffffb00000000dffff5000000007fffe00000000003332000"
+    "0003330000333000033301fff5001fff2004fff20dff9005fff6008ffd008ffd009fffa00cff"
+    "9004fff10dfefe00fff5000fff51ff6ff24fff1000cff95ff0ef68ffd00008ffd9fb0afacff8"
+    "00003fffdf706fefff400000fffff303fffff000000bffff000ffffc0000006fffc000bfff80"
+    "00000033320001333000013330000033320effb0007fff403fff602fff80008fff3cffc00000"
+    "cffeffe1000001effff500000008fffe00000003fffff8000000effdfff40000bffe0affe100"
+    "7fff300effb02fff80003fff72333000002333233200000133307fff10000cffc00fff70001f"
+    "ff6009ffd0006fff0002fff400cff90000bffa01fff400005fff16ffd000000dff7cff700000"
+    "07ffdfff10000000fffffb000000009ffff5000000002fffe0000000000cff90000000002fff"
+    "20000000bbfffb00000000ffffd1000000007776000000000233333333300bfffffffff00bff"
+    "fffffff0057777afffc0000002effc0000002effc0000002effe1000002effe2000000effe20"
+    "00000cfffa7777700ffffffffff00ffffffffff00333333333300000016777000005fffff000"
+    "00ffffcb00003fff50000003fff30000003fff30000003fff30000006fff0000004effd00007"
+    "ffffd200007ffffd30000135effe00000006fff00000003fff30000003fff30000003fff3000"
+    "0003fff60000000efffcb000005fffff0000001577703777ff7ff7ff7ff7ff7ff7ff7ff7ff7f"
+    "f7ff7ff7ff7ff7ff7ff7ff7ff7ff7ff377740000007ffffe200005bdfffa0000000bfff00000"
+    "007fff00000007fff00000007fff00000006fff10000002fffa20000007effff000008fffff0"
+    "0002fffc3300007fff10000007fff00000007fff00000007fff0000000bffe00005bdfffa000"
+    "07ffffd20000377740000000002200000000007effe920005d0afffffffebeff0bc5336dffff"
+    "e6040000002775000003ff03ff000003ff03ff0000017701770000000000000000ffffffffff"
+    "30ffffffffff30ffffffffff30fffb00000000fffb00000000fffc33333300ffffffffff00ff"
+    "ffffffff00fffebbbbbb00fffb00000000fffb00000000fffb00000000fffebbbbbb50ffffff"
+    "ffff70ffffffffff7033333333331000006ffff60000000000dffffc0000000002ffffff2000"
+    "000009ffffff800000000effaaffd00000005fff55fff4000000affe00fff9000000fff900af"
+    "ff000006fff4005fff50000cfff7778fffc0002ffffffffffff1008ffffffffffff700effd77"
+    "7777effd04fff80000009fff39fff20000004fff933330000000033320fffffffffff300ffff"
+    "fffffff300fffffffffff300fffb0000000000fffb0000000000fffc3330000000ffffffffe9"
+    "2000fffffffffff400fffebbbffffe00fffb0000dfff20fffb00008fff30fffb0000cfff20ff"
+    "fd777bfffd00fffffffffff400ffffffffe9100033333320000000ffffffdb950000ffffffff"
+    "ffb000fffebbcffff500fffb0006fff900fffb0003fff900fffb001afff500ffffffffff8000"
+    "fffffffffe7000fffd778dfff800fffb0000dfff00fffb00009fff30fffb0000dfff30fffd77"
+    "7cfffe00fffffffffff500fffffffffa300033333320000000ffffffffff70ffffffffff70ff"
+    "ffffffff70fffb00000000fffb00000000fffb00000000fffb00000000fffb00000000fffb00"
+    "000000fffb00000000fffb00000000fffb00000000fffb00000000fffb00000000fffb000000"
+    "0033320000000000fffffffffff000000fffffffffff000000fffffffffff000000fffb000ff"
+    "ff000000fffb000ffff000000fffb000ffff000000fffb000ffff000000fffb000ffff000000"
+    "fffb000ffff000003fff8000ffff000004fff6000ffff00000cfff2000ffff0008dffffbbbbf"
+    "fffbb0bfffffffffffffff0bfffffffffffffff0bff6333333333cff0bff3000000000bff0bf"
+    "f3000000000bff0233000000000023300ffffffffff30ffffffffff30ffffffffff30fffb000"
+    "00000fffb00000000fffc33333300ffffffffff00ffffffffff00fffebbbbbb00fffb0000000"
+    "0fffb00000000fffb00000000fffebbbbbb50ffffffffff70ffffffffff703333333333109ff"
+    "f500003fff700002effc000cfff50003fff70002effe00000cffe2003fff7000dffe2000000c"
+    "ffe203fff700cffe200000002effe13fff70cfff40000000002effc4fff79fff500000000000"
+    "cfffefffefffe000000000007fffffffffffffb0000000002fffefffffffefff600000000cff"
+    "f66fffff92fffe10000007fffb009fffc007fffb000003fffe1003fff7000cfff60000dfff50"
+    "003fff70002ffff2008fffa00003fff700006fffc03fffe000003fff700000bfff7233310000"
+    "003331000000333300002310000001befffffd81003fffffffffe203fb8779efffa000000002"
+    "ffff000000000fffd000000007fff70000bbdfffe700000ffffffd600000bbbcffff80000000"
+    "02efff0000000008fff310000000cfff3bc73334afffe0bffffffffff508ffffffffc4000034"
+    "7763100000fff700001ffff30fff70000bffff30fff70003fffff30fff7000bfffff30fff700"
+    "3ffffff30fff700dff9fff30fff705ffb3fff30fff70dff33fff30fff75ffb03fff30fff8eff"
+    "303fff30fffeffa003fff30ffffff1003fff30fffff90003fff30fffff10003fff30ffff8000"
+    "03fff30333300000033300000fa000e8000000008fdbfe100000000059b71000000000000000"
+    "000000fff700001ffff30fff70000bffff30fff70003fffff30fff7000bfffff30fff7003fff"
+    "fff30fff700dff9fff30fff705ffb3fff30fff70dff33fff30fff75ffb03fff30fff8eff303f"
+    "ff30fffeffa003fff30ffffff1003fff30fffff90003fff30fffff10003fff30ffff800003ff"
+    "f30333300000033300fffb000009fffc00fffb00009fffc000fffb0009fffc0000fffb005fff"
+    "c00000fffb05fffc000000fffb5fffc0000000fffeffff60000000fffffffff2000000fffffe"
+    "fffc000000ffffe2afff800000fffe200efff30000fffb0003fffe0000fffb00008fffa000ff"
+    "fb00000cfff600fffb000002fffe1033320000002333100007ffffffffff300007ffffffffff"
+    "300007ffffffffff300007fff700bfff300007fff700bfff300007fff600bfff300007fff300"
+    "bfff300007fff300bfff30000bfff300bfff30000cfff000bfff30001fffd000bfff3001cfff"
+    "9000bfff30dfffff2000bfff30ffffe40000bfff30fea5000000bfff300000000000233300ff"
+    "ffe0000007ffff70fffff500000dffff70fffffd00005fffff70ffffff3000bfffff70fffbff"
+    "a002ffcfff70fff7dff109ff5fff70fff75ff80ffe0fff70fff70efe8ff70fff70fff708ffff"
+    "f10fff70fff701ffff900fff70fff700bfff300fff70fff7004ffc000fff70fff7000331000f"
+    "ff70fff7000000000fff70fff7000000000fff70333100000000033310fffb000007fff30fff"
+    "b000007fff30fffb000007fff30fffb000007fff30fffb000007fff30fffc333339fff30ffff"
+    "fffffffff30fffffffffffff30fffebbbbbdfff30fffb000007fff30fffb000007fff30fffb0"
+    "00007fff30fffb000007fff30fffb000007fff30fffb000007fff30333200000133300000000"
+    "32000000000019effffc60000006fffffffffc10005ffffdbbffffd001efff60001cfff906ff"
+    "fa000001fffe0bfff4000000cfff3efff00000008fff7ffff00000007fff7ffff00000007fff"
+    "7bfff3000000afff48fff8000000efff12ffff200009fffb008ffff977bfffe2000affffffff"
+    "fe5000006dffffffa100000000247630000000fffffffffffff30fffffffffffff30ffffffff"
+    "fffff30fffb000007fff30fffb000007fff30fffb000007fff30fffb000007fff30fffb00000"
+    "7fff30fffb000007fff30fffb000007fff30fffb000007fff30fffb000007fff30fffb000007"
+    "fff30fffb000007fff30fffb000007fff30333200000133300fffffffba50000ffffffffffc0"
+    "00fffffffffff900fffb0006ffff00fffb0000cfff30fffb0000cfff30fffb0005ffff00ffff"
+    "fffffff900ffffffffffc000fffffffca50000fffb0000000000fffb0000000000fffb000000"
+    "0000fffb0000000000fffb00000000003332000000000000000023000000007dffffd92004ef"
+    "fffffffb04fffffbbbefb0efffa00000496fffc00000000bfff500000000efff100000000fff"
+    "f000000000ffff000000000bfff4000000008fffa000000001ffff5000000507ffffc777afb0"
+    "09fffffffffb0003cffffffd60000013774200ffffffffffffffffffffffffffffffffffffff"
+    "ffff00000ffff0000000000ffff0000000000ffff0000000000ffff0000000000ffff0000000"
+    "000ffff0000000000ffff0000000000ffff0000000000ffff0000000000ffff0000000000fff"
+    "f0000000000ffff00000000003333000003fffd000000efff10bfff500006fff9003fffb0000"
+    "dfff1000bfff3005fff900003fffb00dfff300000bfff35fffb0000003fffbcfff30000000bf"
+    "fffffb000000005ffffff5000000000dffffd00000000005ffff500000000002fffd00000000"
+    "0bbffff6000000000fffffc0000000000fffd80000000000030000000000000000000bfff300"
+    "000000000023dfff730000000019efffffffffc500005ffffffffffffffc003ffffd8dfff9af"
+    "fffa0afff900bfff302ffff1efff100bfff300bfff4ffff000bfff3007fff7efff100bfff300"
+    "bfff4afffa00bfff303ffff13ffffd9dfff9cffff9005ffffffffffffffb000018dfffffffff"
+    "a50000000013cfff630000000000000bfff3000000000000002333000000002fffd000001eff"
+    "e006fff80000bfff4000bfff3006fffa00001effd01effe0000006fff9bfff30000000bfffff"
+    "f8000000001effffd00000000009ffff60000000001effffe000000000bffffffa00000006ff"
+    "f8bfff4000002fffd01effe00000cfff3004fffa0007fff80000afff402fffd000000effe113"
+    "331000000133310fffb000007fff3000fffb000007fff3000fffb000007fff3000fffb000007"
+    "fff3000fffb000007fff3000fffb000007fff3000fffb000007fff3000fffb000007fff3000f"
+    "ffb000007fff3000fffb000007fff3000fffb000007fff3000fffb000007fff3000fffebbbbb"
+    "dfffcbb0ffffffffffffffff0ffffffffffffffff03333333333333fff00000000000000fff0"
+    "0000000000000fff000000000000003333fff700000fffb3fff700000fffb3fff700000fffb3"
+    "fff700000fffb3fff800000fffb3fffc00000fffb1ffffa7777fffb0bfffffffffffb02dffff"
+    "ffffffb0003677777fffb0000000000fffb0000000000fffb0000000000fffb0000000000fff"
+    "b0000000000fffb000000000033320fffb00003fffb00003fff70fffb00003fffb00003fff70"
+    "fffb00003fffb00003fff70fffb00003fffb00003fff70fffb00003fffb00003fff70fffb000"
+    "03fffb00003fff70fffb00003fffb00003fff70fffb00003fffb00003fff70fffb00003fffb0"
+    "0003fff70fffb00003fffb00003fff70fffb00003fffb00003fff70fffb00003fffb00003fff"
+    "70fffebbbbcfffebbbbcfff70fffffffffffffffffffff70fffffffffffffffffffff7033333"
+    "333333333333333310fffb00003fffb00003fff70000fffb00003fffb00003fff70000fffb00"
+    "003fffb00003fff70000fffb00003fffb00003fff70000fffb00003fffb00003fff70000fffb"
+    "00003fffb00003fff70000fffb00003fffb00003fff70000fffb00003fffb00003fff70000ff"
+    "fb00003fffb00003fff70000fffb00003fffb00003fff70000fffb00003fffb00003fff70000"
+    "fffb00003fffb00003fff70000fffebbbbcfffebbbbcfffdbb00ffffffffffffffffffffffff"
+    "00ffffffffffffffffffffffff00333333333333333333333cff00000000000000000000000b"
+    "ff00000000000000000000000bff000000000000000000000002330ffffffffb000000000fff"
+    "fffffb000000000ffffffffb00000000000000fffb00000000000000fffb00000000000000ff"
+    "fc33300000000000fffffffffa30000000fffffffffff5000000fffebbbefffe000000fffb00"
+    "00dfff300000fffb00007fff300000fffb0000bfff300000fffd777bfffe000000ffffffffff"
+    "f5000000ffffffffea3000000033333330000000fffb0000000007fff70fffb0000000007fff"
+    "70fffb0000000007fff70fffb0000000007fff70fffb0000000007fff70fffc3330000007fff"
+    "70ffffffffe92007fff70fffffffffff407fff70fffebbbffffe07fff70fffb0000dfff27fff"
+    "70fffb00008fff37fff70fffb0000cfff27fff70fffd777bfffd07fff70fffffffffff407fff"
+    "70ffffffffe91007fff703333332000000133310fffb0000000000fffb0000000000fffb0000"
+    "000000fffb0000000000fffb0000000000fffc3330000000ffffffffe92000fffffffffff400"
+    "fffebbbffffe00fffb0000dfff20fffb00008fff30fffb0000cfff20fffd777bfffd00ffffff"
+    "fffff400ffffffffe9100033333320000000000330000000018dffffd810000bffffffffe500"
+    "0bfebbbeffff50095000009ffff1000000000bfff90000000002fffd0008bbbbbbffff000bff"
+    "ffffffff000bffffffffff0000000001fffe0000000007fffa061000005ffff30bfa777affff"
+    "900bfffffffff90004cffffffd5000000137731000000000000000000023000000000fffb000"
+    "005cffffe9300000fffb0000cfffffffff80000fffb000cffffbbcffff7000fffb007fffd200"
+    "05ffff100fffb00efff3000009fff900fffb02fffd0000002fffd00fffebcfffb0000000ffff"
+    "00fffffffff70000000ffff00fffffffffa0000000ffff00fffb03fffc0000001fffe00fffb0"
+    "0ffff1000007fffa00fffb009fffb00002efff300fffb000efffd778efffa000fffb0002efff"
+    "ffffffc0000fffb000019ffffffe70000033320000000367520000000005abfffffff00cffff"
+    "ffffff07fffffffffff0dfff5000ffff0ffff0000ffff0dfff0000ffff06fffa333ffff009ff"
+    "ffffffff0005fffffffff0005fffc7ffff000efff20ffff007fff800ffff01fffe000ffff0bf"
+    "ff6000ffff4fffc0000ffff2333100003333000235753000002fffffffe70003fffffffff700"
+    "3940002cffe0000000004fff3004aefffffff305ffffffffff30effe4003fff30fff70008fff"
+    "30fffc005ffff30bffffffcfff300cffff93fff30003762003330000068bbfff600002efffff"
+    "ffc0000dffda775310007ff90000000000dfd03574100000ffeefffffb2000ffffffffffe200"
+    "ffffe437fffd00ffff30009fff30ffff00004fff70efff00003fff70bfff00004fff709fff30"
+    "009fff303fffc436fffd0008ffffffffe200006efffffb200000003674100000333331000003"
+    "fffffffd6003fffffffff503fff301dff903fff300cff803ffffffffd103ffffffffa103fff6"
+    "35cffc03fff3003fff13fff3019fff03fffffffffb03fffffffe900033333300000033333333"
+    "03ffffffff33ffffffff33fff3000003fff3000003fff3000003fff3000003fff3000003fff3"
+    "000003fff3000003fff3000003fff3000000333000000000333333333100000fffffffff7000"
+    "00fffffffff700003fffb77fff700003fff700fff700003fff700fff700003fff400fff70000"
+    "7fff300fff70000dfff000fff7005cfffd777fffb73bfffffffffffff7bfffffffffffff7bfc"
+    "333333333ff7bfb000000000ff7bfb000000000ff700000366300000007effffe70000bfffff"
+    "fff9006fff8006fff50dffc0000cffa0fffebbbbeffe0ffffffffffff0fffb777777770dffc0"
+    "000000107fff910026d700cfffffffff70007effffffc3000003675300003332000133300003"
+    "332009fff5007fff000cffe20009fff507fff00cffe2000009fff57fff0cffe200000009fffc"
+    "fffcffe2000000000dfffffffff50000000005ffffffffffd000000002fffbffffceffa00000"
+    "00dffc08fff04fff600000affe107fff007fff20006fff3007fff000bffd002fff70007fff00"
+    "00effb023330000133300001333001357530007ffffffe607ffffffff2440003fff5000002ff"
+    "f200fffffe5000fffffd40003369fff4000000bffaa50003eff9fffffffff3fffffffe500347"
+    "7430000333000033323fff3006fffb3fff300efffb3fff309ffffb3fff33fffffb3fff3cffff"
+    "fb3fffaffdfffb3ffffff3fffb3fffffa0fffb3ffffe10fffb3ffff700fffb3fffd000fffb03"
+    "3310003332001b3000a500000ec437f5000005efffb0000000033200000333000033323fff30"
+    "06fffb3fff300efffb3fff309ffffb3fff33fffffb3fff3cfffffb3fffaffdfffb3ffffff3ff"
+    "fb3fffffa0fffb3ffffe10fffb3ffff700fffb3fffd000fffb03331000333203330000233303"
+    "fff3005fff903fff305fff9003fff35fff90003fff9fff500003ffffffa000003fffffff4000"
+    "03ffffbffe20003fff60cffc0003fff301eff9003fff3004fff603fff30007fff20333000003"
+    "3320013333333330007fffffffff3007fffffffff3007fff979fff3007fff303fff3007fff30"
+    "3fff3007fff203fff3008fff003fff300dffd003fff36efff7003fff3bfffc0003fff3bfc700"
+    "003fff300000000033300333300000333303ffff10005ffff03ffff9000bffff03fffff003ff"
+    "fff03fffff70afffff03fffefe2ffffff03fff9ffdff9fff03fff3dfffb7fff03fff35fff37f"
+    "ff03fff30efd07fff03fff3000007fff03fff3000007fff00333000000133300333000033313"
+    "fff3000fff73fff3000fff73fff3000fff73fff3000fff73fffcbbbfff73ffffffffff73fff9"
+    "777fff73fff3000fff73fff3000fff73fff3000fff73fff3000fff7033300003331000003673"
+    "000000008efffff900000cffffffffc0007fffc33afff900dffe0000dfff00fffb00007fff30"
+    "fffb00007fff30fffb00007fff30dffe0000dfff007fffc339fff9000cffffffffc000008fff"
+    "fff9000000003773100000333333333313ffffffffff73ffffffffff73fff9777fff73fff300"
+    "0fff73fff3000fff73fff3000fff73fff3000fff73fff3000fff73fff3000fff73fff3000fff"
+    "73fff3000fff703330000333103330015620003fff39ffffa003fffcffffffa03ffff834efff"
+    "33fffb0003fff93fff60000fffb3fff30000fffb3fff60000fffb3fffb0003fff93ffff734ef"
+    "ff33fffcffffffa03fff49ffffa003fff3026620003fff3000000003fff3000000003fff3000"
+    "000001777100000000000003574200007efffffa009fffffffb05fffe533690dfff2000000ff"
+    "fb0000000fffb0000000fffb0000000dfff20000006fffe5336900bfffffffb0007efffffb00"
+    "000367520333333333332fffffffffffbfffffffffffb0000bffb00000000bffb00000000bff"
+    "b00000000bffb00000000bffb00000000bffb00000000bffb00000000bffb00000000bffb000"
+    "0000023320000233200000133307fff10000cffc00fff70001fff6009ffd0006fff0002fff40"
+    "0cff90000bffa01fff400005fff16ffd000000dff7cff70000007ffdfff10000000fffffb000"
+    "000009ffff5000000002fffe0000000000cff90000000002fff20000000bbfffb00000000fff"
+    "fd100000000777600000000000000037770000000000000007fff0000000000000007fff0000"
+    "000000000007fff0000000000026517fff0373000000affffdfffefffe4000afffffffffffff"
+    "fe203fffc44efff739fffb09fff3007fff000bfff0bfff0007fff0007fff3bffb0007fff0007"
+    "fff3bfff0007fff0007fff39fff3007fff000bfff03fffc44efff738fffb00bfffffffffffff"
+    "ff2000bffffefffefffe40000026617fff0474000000000007fff0000000000000007fff0000"
+    "000000000007fff00000000000000037770000000013330000033320effb0007fff403fff602"
+    "fff80008fff3cffc00000cffeffe1000001effff500000008fffe00000003fffff8000000eff"
+    "dfff40000bffe0affe1007fff300effb02fff80003fff72333000002333033300003331003ff"
+    "f3000fff7003fff3000fff7003fff3000fff7003fff3000fff7003fff3000fff7003fff3000f"
+    "ff7003fff3000fff7003fff3000fff7003fff9777fffb733ffffffffffff73ffffffffffff70"
+    "3333333336ff700000000003ff700000000003ff723330002332bfff000bffbbfff000bffbbf"
+    "ff000bffbbfff000bffb7fffa77dffb1effffffffb029bbbbeffb0000000bffb0000000bffb0"
+    "000000bffb0000000bffb00000002332033300003332000133303fff3000fffb0007fff03fff"
+    "3000fffb0007fff03fff3000fffb0007fff03fff3000fffb0007fff03fff3000fffb0007fff0"
+    "3fff3000fffb0007fff03fff3000fffb0007fff03fff3000fffb0007fff03fff9777fffd777b"
+    "fff03ffffffffffffffffff03ffffffffffffffffff003333333333333333330033300003332"
+    "0001333003fff3000fffb0007fff003fff3000fffb0007fff003fff3000fffb0007fff003fff"
+    "3000fffb0007fff003fff3000fffb0007fff003fff3000fffb0007fff003fff3000fffb0007f"
+    "ff003fff3000fffb0007fff003fff9777fffd777bfff773ffffffffffffffffffff3ffffffff"
+    "ffffffffffff033333333333333333cff000000000000000000bff000000000000000000bff1"
+    "333333200000007ffffffb00000007ffffffb00000000000bffb00000000000bffb000000000"
+    "00bffebbbb6000000bffffffffd00000bffc338fff70000bffb000bffb0000bffb004eff8000"
+    "0bfffffffff30000bfffffffb3000002333331000003330000000023333fff30000000bfff3f"
+    "ff30000000bfff3fff30000000bfff3fff30000000bfff3fffcbbb9300bfff3fffffffff50bf"
+    "ff3fff635cffe0bfff3fff3003fff0bfff3fff3019fff0bfff3fffffffff90bfff3fffffffd7"
+    "00bfff03333330000023330333000000003fff300000003fff300000003fff300000003fff30"
+    "0000003fffcbbb93003fffffffff503fff635cffe03fff3003fff03fff3019fff03fffffffff"
+    "903fffffffd700033333300000013763000006ffffff90007fffffffc0068334cfff90000000"
+    "dfff0017777bfff303ffffffff3017777bfff3000000dfff067334cfff907fffffffc007ffff"
+    "ff90000147630000003330000003763000003fff30009ffffff80003fff300cffffffffc003f"
+    "ff309fffa33cfff703fff30fffd0000effd03fff99fff80000bfff03ffffffff70000bfff03f"
+    "ff99fff80000bfff03fff30fffd0000effd03fff309fff933afff703fff300cffffffffc003f"
+    "ff3000bffffff80000333000001377300000000001333331004cfffffff702fffffffff707ff"
+    "f400fff707fff000fff701fff633fff7005ffffffff70009fffffff7001fff50fff700bffb00"
+    "fff705fff200fff70eff7000fff70333000033310000bb20bb2000000ff30ff3000000bb20bb"
+    "200000000000000000000366300000007effffe70000bffffffff9006fff8006fff50dffc000"
+    "0cffa0fffebbbbeffe0ffffffffffff0fffb777777770dffc0000000107fff910026d700cfff"
+    "ffffff70007effffffc300000367530000000039bbb6100000001bffbbdff7000002ee600001"
+    "af90000ce202797607f7007f409fffff30af10dc05ffa438201f60f70cfd0000000da3f50ffb"
+    "0000000bb0f70efb0000000bb0e909ff5001100f809f10cfffff307f201ec008dffb12eb0005"
+    "fc1000004ee000005efa777cfc100000019efffc500000000000020000000000002000020000"
+    "b7002c7003ef705ef607ffa19ff806ff607fe4007fe307fc2000bff72cfe40007ff609ff5000"
+    "3e7005e700000300024020001000000e5003e30000ff903ff70004efc26ffb0001cfe02dfb00"
+    "09ff00bfb02cfe43efd20efc12ffa000f8003f600004000220000bbbbbbbb2ffffffff3bbbbb"
+    "bbb2bbbbbbbbbbbbbbbbbb5ffffffffffffffffff7bbbbbbbbbbbbbbbbbb52bbb2005bbb0008"
+    "bbb3fff3007fff000bfff3fff3007fff000bfff3fff3007fff000bfff0333000133300023330"
+    "0ffff60000018bc7000000000ffffe00000dfff7000000000fffff70003fffb1000000000fff"
+    "ffe0003fff40000000000ffffff7003fff30006771000fff9fff103fff300cfffe100fff77ff"
+    "903fff305fa07f800fff70eff13fff307f703fb00fff707ff93fff307f703fb00fff700eff7f"
+    "ff306f907f900fff7005ffefff300dfcfe100fff7000dfffff30008b92005fff70005fffff30"
+    "00000003ffff30000dffff307fffffb3ffd7000003ffff307fffffb010000000003333001333"
+    "332";
+
+} // namespace WatermarkFont
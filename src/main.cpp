@@ -1,21 +1,32 @@
 #include "UI.h"
 #include "ShaderManager.h"
 #include "ImageProcessor.h"
+#include "Kernels.h"
+#include "ResultCache.h"
+#include "SettingsFile.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "VideoStream.h"
 
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 
 #include <GLFW/glfw3.h>
-#include "stb_image_write.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <memory>
 #include <string>
-#include <filesystem>
+#include <vector>
 
 #ifdef _WIN32
 #include <windows.h>
+#include <fcntl.h>
+#include <io.h>
 #endif
 
 // ---------------------------------------------------------------------------
@@ -46,6 +57,7 @@ static std::string getExeDirectory() {
 struct AppState {
     std::string droppedFile;
     UI* ui = nullptr;
+    double lastInput = 0.0;     // glfwGetTime() of the last input event
 };
 
 static void dropCallback(GLFWwindow* w, int count, const char** paths) {
@@ -54,6 +66,37 @@ static void dropCallback(GLFWwindow* w, int count, const char** paths) {
     if (state) state->droppedFile = paths[0];
 }
 
+// ---------------------------------------------------------------------------
+// Frame pacing: the loop renders at vsync rate while the user is interacting
+// or work is in flight, and otherwise sleeps in glfwWaitEventsTimeout until
+// input, a finished Pipeline result (glfwPostEmptyEvent) or the idle redraw.
+// The input callbacks go in before the ImGui backend's, which chain to them.
+// ---------------------------------------------------------------------------
+static constexpr double ACTIVE_SECONDS = 0.5;       // after input: hover delays, fades
+static constexpr double IDLE_REDRAW_SECONDS = 1.0;
+
+static std::atomic<bool> s_wakeEnabled{true};
+
+static void noteInput(GLFWwindow* w) {
+    auto* state = static_cast<AppState*>(glfwGetWindowUserPointer(w));
+    if (state) state->lastInput = glfwGetTime();
+}
+
+static void installInputCallbacks(GLFWwindow* w) {
+    glfwSetCursorPosCallback(w, [](GLFWwindow* w, double, double) { noteInput(w); });
+    glfwSetMouseButtonCallback(w, [](GLFWwindow* w, int, int, int) { noteInput(w); });
+    glfwSetScrollCallback(w, [](GLFWwindow* w, double, double) { noteInput(w); });
+    glfwSetKeyCallback(w, [](GLFWwindow* w, int, int, int, int) { noteInput(w); });
+    glfwSetCharCallback(w, [](GLFWwindow* w, unsigned int) { noteInput(w); });
+    glfwSetCursorEnterCallback(w, [](GLFWwindow* w, int) { noteInput(w); });
+    glfwSetWindowFocusCallback(w, [](GLFWwindow* w, int) { noteInput(w); });
+    glfwSetWindowRefreshCallback(w, [](GLFWwindow* w) { noteInput(w); });
+}
+
+static bool hasPendingWork(UI& ui, const AppState& state) {
+    return ui.isLoading() || ui.isSaving() || ui.isProcessing() || !state.droppedFile.empty();
+}
+
 // ---------------------------------------------------------------------------
 // Clipboard image paste (Windows only)
 // ---------------------------------------------------------------------------
@@ -88,43 +131,124 @@ static bool tryPasteClipboardImage(UI& ui) {
 #endif
 
 // ---------------------------------------------------------------------------
-// Save processed image to file
+// GLFW error callback
 // ---------------------------------------------------------------------------
-static bool saveImage(const ImageBuffer& img, const std::string& path) {
-    if (!img.valid() || path.empty()) return false;
-
-    auto ext = std::filesystem::path(path).extension().string();
-    for (auto& c : ext) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
-
-    int ok = 0;
-    if (ext == ".png") {
-        ok = stbi_write_png(path.c_str(), img.width, img.height, img.channels,
-                            img.data.data(), img.width * img.channels);
-    } else if (ext == ".jpg" || ext == ".jpeg") {
-        ok = stbi_write_jpg(path.c_str(), img.width, img.height, img.channels,
-                            img.data.data(), 90);
-    } else if (ext == ".bmp") {
-        ok = stbi_write_bmp(path.c_str(), img.width, img.height, img.channels,
-                            img.data.data());
-    } else {
-        // Default to PNG
-        ok = stbi_write_png(path.c_str(), img.width, img.height, img.channels,
-                            img.data.data(), img.width * img.channels);
-    }
-    return ok != 0;
+static void glfwErrorCb(int /*error*/, const char* description) {
+    std::fprintf(stderr, "GLFW error: %s\n", description);
 }
 
 // ---------------------------------------------------------------------------
-// GLFW error callback
+// Headless streaming mode
+//
+//   --stream [--settings FILE] [--keyframe FRAME FILE]... [--jobs N]
+//            [--cache] [--cache-dir DIR] [--trace FILE] [--kernels LEVEL]
+//
+// Raw Y4M/PAM frames from stdin, processed frames to stdout. Each keyframe
+// INI is applied on top of the one before it, so a file only needs the keys
+// that change; --settings is a keyframe at frame 0. With --cache, repeated
+// frames are processed once; --cache-dir does the same and keeps results
+// across runs. Off by default: most clips never repeat a frame, and would
+// pay for hashing and storing every one. --trace writes the per-stage
+// timing spans as Chrome trace JSON at the end (SHAKAL_TRACE builds only).
 // ---------------------------------------------------------------------------
-static void glfwErrorCb(int /*error*/, const char* description) {
-    std::fprintf(stderr, "GLFW error: %s\n", description);
+static int runStream(int argc, char** argv) {
+    struct KeyframeArg { int frame; const char* path; };
+    std::vector<KeyframeArg> keyframeArgs;
+    unsigned jobs = 0;
+    const char* cacheDir = nullptr;
+    const char* tracePath = nullptr;
+    bool useCache = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--settings") == 0 && i + 1 < argc) {
+            keyframeArgs.push_back({0, argv[++i]});
+        } else if (std::strcmp(argv[i], "--keyframe") == 0 && i + 2 < argc) {
+            int frame = std::atoi(argv[i + 1]);
+            keyframeArgs.push_back({std::max(0, frame), argv[i + 2]});
+            i += 2;
+        } else if (std::strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc) {
+            cacheDir = argv[++i];
+            useCache = true;
+        } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--kernels") == 0 && i + 1 < argc) {
+            ++i;  // applied in main()
+        } else if (std::strcmp(argv[i], "--cache") == 0) {
+            useCache = true;
+        } else if (std::strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            jobs = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        } else if (std::strcmp(argv[i], "--stream") != 0) {
+            std::fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    std::stable_sort(keyframeArgs.begin(), keyframeArgs.end(),
+                     [](const KeyframeArg& a, const KeyframeArg& b) { return a.frame < b.frame; });
+    VideoStream::Options options;
+    Settings settings;
+    for (const KeyframeArg& k : keyframeArgs) {
+        if (!SettingsFile::load(k.path, settings)) {
+            std::fprintf(stderr, "Cannot read settings %s\n", k.path);
+            return 2;
+        }
+        options.keyframes.push_back({k.frame, settings});
+    }
+
+    ResultCache cache;
+    if (cacheDir) cache.setDiskTier(cacheDir);
+    if (useCache) options.cache = &cache;
+
+    std::unique_ptr<ThreadPool> pool;
+    if (jobs > 0) {
+        pool = std::make_unique<ThreadPool>(jobs);
+        options.pool = pool.get();
+    }
+
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    static char outBuffer[1 << 20];
+    std::setvbuf(stdout, outBuffer, _IOFBF, sizeof(outBuffer));
+
+    int frames = 0;
+    bool ok = VideoStream::run(stdin, stdout, options, &frames);
+    std::fprintf(stderr, "%d frames%s\n", frames, ok ? "" : ", stream error");
+    if (tracePath) {
+#ifdef SHAKAL_TRACE
+        if (!Trace::writeChromeJson(tracePath))
+            std::fprintf(stderr, "Cannot write trace %s\n", tracePath);
+#else
+        std::fprintf(stderr, "--trace ignored: built without SHAKAL_TRACE\n");
+#endif
+    }
+    return ok ? 0 : 1;
 }
 
 // ---------------------------------------------------------------------------
 // main
 // ---------------------------------------------------------------------------
-int main(int /*argc*/, char** /*argv*/) {
+int main(int argc, char** argv) {
+    // --kernels LEVEL: pin the SIMD level (scalar, sse2, avx2, avx512, neon)
+    // for benchmarking; --verify-kernels: check every level against scalar
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--kernels") == 0 && i + 1 < argc) {
+            Kernels::Level level;
+            if (!Kernels::parseLevel(argv[i + 1], level) || !Kernels::force(level)) {
+                std::fprintf(stderr, "Kernel level %s is not available\n", argv[i + 1]);
+                return 2;
+            }
+        }
+        if (std::strcmp(argv[i], "--verify-kernels") == 0) return Kernels::verify() ? 0 : 1;
+    }
+
+    // --verify-gl: check the preview upload path on this driver and exit
+    bool verifyGL = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--verify-gl") == 0) verifyGL = true;
+        if (std::strcmp(argv[i], "--stream") == 0) return runStream(argc, argv);
+    }
+
     glfwSetErrorCallback(glfwErrorCb);
     if (!glfwInit()) {
         std::fprintf(stderr, "Failed to initialize GLFW\n");
@@ -138,6 +262,7 @@ int main(int /*argc*/, char** /*argv*/) {
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
 #endif
+    if (verifyGL) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
     GLFWwindow* window = glfwCreateWindow(
         1280, 800,
@@ -159,6 +284,18 @@ int main(int /*argc*/, char** /*argv*/) {
         std::fprintf(stderr, "Warning: ShaderManager::init() failed\n");
     }
 
+    if (verifyGL) {
+        bool ok = ShaderManager::verifyPreviewUpload();
+        ShaderManager::shutdown();
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return ok ? 0 : 1;
+    }
+
+    AppState appState;
+    glfwSetWindowUserPointer(window, &appState);
+    installInputCallbacks(window);
+
     // Dear ImGui setup
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -170,24 +307,34 @@ int main(int /*argc*/, char** /*argv*/) {
     ImGui_ImplOpenGL3_Init("#version 330");
 
     // Application state
-    AppState appState;
     UI ui;
     appState.ui = &ui;
     ui.init();
+    ui.setWakeCallback([] {
+        if (s_wakeEnabled.load()) glfwPostEmptyEvent();
+    });
 
-    glfwSetWindowUserPointer(window, &appState);
     glfwSetDropCallback(window, dropCallback);
 
     // Load persisted settings
     std::string exeDir = getExeDirectory();
     std::string iniPath = exeDir + "/shakalnost_settings.ini";
+    ui.setCacheDirectory(exeDir + "/shakalnost_cache");
+    ui.setTracePath(exeDir + "/shakalnost_trace.json");
     ui.loadSettings(iniPath.c_str());
 
     // ------------------------------------------------------------------
     // Main loop
     // ------------------------------------------------------------------
     while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
+        // A minimized window only wakes for events and finished results
+        bool iconified = glfwGetWindowAttrib(window, GLFW_ICONIFIED) != 0;
+        bool active = !iconified && (hasPendingWork(ui, appState) ||
+                                     glfwGetTime() - appState.lastInput < ACTIVE_SECONDS);
+        if (active)
+            glfwPollEvents();
+        else
+            glfwWaitEventsTimeout(IDLE_REDRAW_SECONDS);
 
         // Start ImGui frame
         ImGui_ImplOpenGL3_NewFrame();
@@ -234,27 +381,12 @@ int main(int /*argc*/, char** /*argv*/) {
         if (ui.wantsSave()) {
             ui.clearSaveFlag();
             std::string path = ui.showSaveDialog();
-            if (!path.empty()) {
-                const ImageBuffer& img = ui.getProcessedImage().valid()
-                    ? ui.getProcessedImage()
-                    : ui.getSourceImage();
-                saveImage(img, path);
-            }
-        }
-
-        // Submit processing when settings changed and debounce allows
-        if (ui.needsReprocess() && ui.getPipeline().shouldUpdate()) {
-            ui.clearReprocessFlag();
-            ui.getPipeline().markSubmitTime();
-            ui.getPipeline().submit(
-                ui.getSourceImage(), ui.getSettings(),
-                [&ui](ImageBuffer result) {
-                    ui.setProcessedImage(result);
-                });
+            if (!path.empty()) ui.saveImage(path);
         }
 
-        // Poll pipeline for completed async results
-        ui.getPipeline().poll();
+        // Submit processing when settings changed and debounce allows, and
+        // pick up completed results of every open document
+        ui.processDocuments();
 
         // Handle drag-and-drop
         if (!appState.droppedFile.empty()) {
@@ -278,6 +410,7 @@ int main(int /*argc*/, char** /*argv*/) {
     // Cleanup
     // ------------------------------------------------------------------
     ui.saveSettings(iniPath.c_str());
+    s_wakeEnabled.store(false);
 
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
@@ -292,6 +425,6 @@ int main(int /*argc*/, char** /*argv*/) {
 
 #ifdef _WIN32
 int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
-    return main(0, nullptr);
+    return main(__argc, __argv);
 }
 #endif
@@ -0,0 +1,155 @@
+#include "Daemon.h"
+#include "Kernels.h"
+#include "MappedFile.h"
+#include "SettingsFile.h"
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// shakald - the Daemon on a Unix domain socket, plus a small client for it
+//
+//   shakald [--socket PATH] [--workers N] [--queue N] [--admit-timeout MS]
+//           [--max-connections N] [--max-mpix N] [--source-cache MB]
+//           [--cache MB] [--kernels LEVEL]
+//   shakald [--socket PATH] --stats
+//   shakald [--socket PATH] --process IN OUT [--settings FILE] [--jpeg]
+//
+// The socket defaults to $SHAKAL_SOCKET, then /tmp/shakald.sock. --stats
+// prints the daemon's counters as JSON; --process sends IN with the settings
+// from FILE (defaults otherwise) and writes the PNG or JPEG reply to OUT.
+// Uploads over --max-mpix megapixels (64 by default) are refused before they
+// are decoded.
+// ---------------------------------------------------------------------------
+
+static Daemon* s_daemon = nullptr;
+
+static void onSignal(int) {
+    if (s_daemon) s_daemon->stop();
+}
+
+static const char* statusName(Daemon::Status status) {
+    switch (status) {
+    case Daemon::Status::Ok:         return "ok";
+    case Daemon::Status::Busy:       return "busy";
+    case Daemon::Status::BadRequest: return "bad request";
+    default:                         return "failed";
+    }
+}
+
+static int runClient(const std::string& socketPath, Daemon::Op op, Daemon::Format format,
+                     const char* settingsPath, const char* inPath, const char* outPath) {
+    Settings settings;
+    if (settingsPath && !SettingsFile::load(settingsPath, settings)) {
+        std::fprintf(stderr, "Cannot read settings %s\n", settingsPath);
+        return 2;
+    }
+    std::vector<uint8_t> data;
+    if (inPath) {
+        auto file = MappedFile::open(inPath);
+        if (!file) {
+            std::fprintf(stderr, "Cannot read %s\n", inPath);
+            return 2;
+        }
+        data.assign(file->data(), file->data() + file->size());
+    }
+
+    Daemon::Status status;
+    std::vector<uint8_t> payload;
+    if (!Daemon::call(socketPath, op, format, SettingsFile::toText(settings), data, status, payload)) {
+        std::fprintf(stderr, "No daemon on %s\n", socketPath.c_str());
+        return 1;
+    }
+    if (status != Daemon::Status::Ok) {
+        std::fprintf(stderr, "%s: %.*s\n", statusName(status),
+                     static_cast<int>(payload.size()), reinterpret_cast<const char*>(payload.data()));
+        return 1;
+    }
+
+    FILE* out = outPath ? std::fopen(outPath, "wb") : stdout;
+    if (!out) {
+        std::fprintf(stderr, "Cannot write %s\n", outPath);
+        return 1;
+    }
+    bool ok = std::fwrite(payload.data(), 1, payload.size(), out) == payload.size();
+    if (outPath) ok = std::fclose(out) == 0 && ok;
+    else std::fputc('\n', out);
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    Daemon::Options options;
+    const char* env = std::getenv("SHAKAL_SOCKET");
+    options.socketPath = env && *env ? env : "/tmp/shakald.sock";
+
+    bool stats = false;
+    const char* inPath = nullptr;
+    const char* outPath = nullptr;
+    const char* settingsPath = nullptr;
+    Daemon::Format format = Daemon::Format::Png;
+    for (int i = 1; i < argc; ++i) {
+        auto value = [&] { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char* arg = argv[i];
+        const char* v = nullptr;
+        if (std::strcmp(arg, "--stats") == 0) {
+            stats = true;
+        } else if (std::strcmp(arg, "--jpeg") == 0) {
+            format = Daemon::Format::Jpeg;
+        } else if (std::strcmp(arg, "--process") == 0 && i + 2 < argc) {
+            inPath = argv[i + 1];
+            outPath = argv[i + 2];
+            i += 2;
+        } else if (std::strcmp(arg, "--socket") == 0 && (v = value())) {
+            options.socketPath = v;
+        } else if (std::strcmp(arg, "--settings") == 0 && (v = value())) {
+            settingsPath = v;
+        } else if (std::strcmp(arg, "--workers") == 0 && (v = value())) {
+            options.workers = static_cast<unsigned>(std::max(1, std::atoi(v)));
+        } else if (std::strcmp(arg, "--queue") == 0 && (v = value())) {
+            options.queueLimit = std::max(1, std::atoi(v));
+        } else if (std::strcmp(arg, "--admit-timeout") == 0 && (v = value())) {
+            options.admitTimeoutMs = std::max(0, std::atoi(v));
+        } else if (std::strcmp(arg, "--max-connections") == 0 && (v = value())) {
+            options.maxConnections = std::max(1, std::atoi(v));
+        } else if (std::strcmp(arg, "--max-mpix") == 0 && (v = value())) {
+            options.maxPixels = static_cast<uint64_t>(std::max(1, std::atoi(v))) << 20;
+        } else if (std::strcmp(arg, "--source-cache") == 0 && (v = value())) {
+            options.sourceCacheBytes = static_cast<size_t>(std::max(0, std::atoi(v))) << 20;
+        } else if (std::strcmp(arg, "--cache") == 0 && (v = value())) {
+            options.resultCacheBytes = static_cast<size_t>(std::max(0, std::atoi(v))) << 20;
+        } else if (std::strcmp(arg, "--kernels") == 0 && (v = value())) {
+            Kernels::Level level;
+            if (!Kernels::parseLevel(v, level) || !Kernels::force(level)) {
+                std::fprintf(stderr, "Kernel level %s is not available\n", v);
+                return 2;
+            }
+        } else {
+            std::fprintf(stderr, "Unknown option: %s\n", arg);
+            return 2;
+        }
+    }
+
+    if (stats)
+        return runClient(options.socketPath, Daemon::Op::Stats, format, nullptr, nullptr, nullptr);
+    if (inPath)
+        return runClient(options.socketPath, Daemon::Op::Process, format, settingsPath, inPath, outPath);
+
+    Daemon daemon(options);
+    if (!daemon.listen()) return 1;
+    s_daemon = &daemon;
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::fprintf(stderr, "shakald: listening on %s (%u workers, kernels %s)\n",
+                 options.socketPath.c_str(), daemon.stats().workers, Kernels::table().name);
+    daemon.run();
+    s_daemon = nullptr;
+    std::fprintf(stderr, "shakald: stopped\n");
+    return 0;
+}